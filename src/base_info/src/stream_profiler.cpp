@@ -0,0 +1,336 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 23:41:06
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 23:41:06
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/base_info/src/stream_profiler.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+// third party headers
+// opencv
+#include "opencv2/imgcodecs.hpp"
+// ros
+#include "cv_bridge/cv_bridge.h"
+#include "sensor_msgs/image_encodings.h"
+// local headers
+#include "base_info/stream_profiler.hpp"
+#include "common_utils/read_file_from_dir.hpp"
+
+namespace {
+
+void write_json_string(std::ostream &out, const std::string &str) {
+  out << '"';
+  for (char c : str) {
+    switch (c) {
+    case '"':
+      out << "\\\"";
+      break;
+    case '\\':
+      out << "\\\\";
+      break;
+    case '\n':
+      out << "\\n";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+            << static_cast<int>(c) << std::dec << std::setfill(' ');
+      } else {
+        out << c;
+      }
+    }
+  }
+  out << '"';
+}
+
+// 直方图(微秒)输出为毫秒的分位数
+void write_json_ms(std::ostream &out, const HistogramSnapshot &h) {
+  out << "{\"count\": " << h.count << ", \"mean\": " << h.mean() / 1000.0
+      << ", \"p50\": " << h.percentile(0.5) / 1000.0
+      << ", \"p90\": " << h.percentile(0.9) / 1000.0
+      << ", \"p99\": " << h.percentile(0.99) / 1000.0
+      << ", \"max\": " << h.max / 1000.0 << "}";
+}
+
+std::string format_ms(double us) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(1) << us / 1000.0;
+  return ss.str();
+}
+
+} // namespace
+
+StreamProfiler::StreamProfiler(ros::NodeHandle nh, ros::NodeHandle pnh)
+    : nh_(nh), pnh_(pnh) {}
+
+bool StreamProfiler::init() {
+  // topics 为列表, 兼容原来只订阅一个话题的 topic_name
+  if (!pnh_.getParam("topics", topic_names_) || topic_names_.empty()) {
+    std::string topic_name;
+    pnh_.param("topic_name", topic_name, std::string("/front/image_raw"));
+    topic_names_.assign(1, topic_name);
+  }
+  pnh_.param("queue_size", queue_size_, queue_size_);
+  pnh_.param("duration_s", duration_s_, duration_s_);
+  pnh_.param("report_period_s", report_period_s_, report_period_s_);
+  pnh_.param("img_save_path", img_save_path_, img_save_path_);
+  pnh_.param("summary_path", summary_path_, summary_path_);
+  if (queue_size_ <= 0 || report_period_s_ <= 0 || duration_s_ < 0) {
+    ROS_ERROR_STREAM("[ StreamProfiler ] invalid queue_size/report_period_s/"
+                     "duration_s");
+    return false;
+  }
+
+  start_ = ros::WallTime::now();
+  last_report_ = start_;
+  for (const std::string &name : topic_names_) {
+    std::unique_ptr<Topic> topic(new Topic());
+    topic->name = name;
+    topic->compressed =
+        name.size() >= 11 &&
+        name.compare(name.size() - 11, 11, "/compressed") == 0;
+    // 到达间隔不受 Nagle 合包影响
+    const ros::TransportHints hints = ros::TransportHints().tcpNoDelay();
+    if (topic->compressed) {
+      topic->sub = nh_.subscribe<sensor_msgs::CompressedImage>(
+          name, queue_size_,
+          boost::bind(&StreamProfiler::compressed_callback, this, _1,
+                      topic.get()),
+          ros::VoidConstPtr(), hints);
+    } else {
+      topic->sub = nh_.subscribe<sensor_msgs::Image>(
+          name, queue_size_,
+          boost::bind(&StreamProfiler::image_callback, this, _1, topic.get()),
+          ros::VoidConstPtr(), hints);
+    }
+    ROS_INFO_STREAM("[ StreamProfiler ] profiling " << name);
+    topics_.push_back(std::move(topic));
+  }
+  return true;
+}
+
+void StreamProfiler::image_callback(const sensor_msgs::ImageConstPtr &msg,
+                                    Topic *topic) {
+  const ros::WallTime recv = ros::WallTime::now();
+  const ros::Time recv_stamp = ros::Time::now();
+  std::ostringstream format;
+  format << msg->width << "x" << msg->height << " " << msg->encoding;
+  std::lock_guard<std::mutex> lock(topic->mutex);
+  on_message(topic, msg->header, msg->data.size(), format.str(), recv,
+             recv_stamp);
+  topic->last_image = msg;
+}
+
+void StreamProfiler::compressed_callback(
+    const sensor_msgs::CompressedImageConstPtr &msg, Topic *topic) {
+  const ros::WallTime recv = ros::WallTime::now();
+  const ros::Time recv_stamp = ros::Time::now();
+  // 解码不持有锁, 各话题的回调可以并行
+  const cv::Mat buffer(1, static_cast<int>(msg->data.size()), CV_8UC1,
+                       const_cast<uint8_t *>(msg->data.data()));
+  cv::Mat img = cv::imdecode(buffer, cv::IMREAD_COLOR);
+  const int64_t decode_us = (ros::WallTime::now() - recv).toNSec() / 1000;
+  std::ostringstream format;
+  if (!img.empty()) {
+    format << img.cols << "x" << img.rows << " ";
+  }
+  format << msg->format;
+  std::lock_guard<std::mutex> lock(topic->mutex);
+  on_message(topic, msg->header, msg->data.size(), format.str(), recv,
+             recv_stamp);
+  if (img.empty()) {
+    topic->decode_errors++;
+    return;
+  }
+  topic->decode_us.record(static_cast<uint64_t>(decode_us));
+  topic->last_frame = img;
+}
+
+void StreamProfiler::on_message(Topic *topic, const std_msgs::Header &header,
+                                size_t bytes, const std::string &format,
+                                const ros::WallTime &recv,
+                                const ros::Time &recv_stamp) {
+  if (topic->messages == 0) {
+    topic->first_recv = recv;
+  } else {
+    topic->interarrival_us.record(
+        static_cast<uint64_t>((recv - topic->last_recv).toNSec() / 1000));
+    // seq 由发布端递增, 跳变说明网络或订阅队列丢帧
+    if (header.seq > topic->last_seq + 1) {
+      topic->dropped += header.seq - topic->last_seq - 1;
+    }
+  }
+  topic->messages++;
+  topic->bytes += bytes;
+  topic->last_recv = recv;
+  topic->last_seq = header.seq;
+  topic->size_bytes.record(bytes);
+
+  if (header.stamp.isZero()) {
+    topic->unstamped++;
+  } else if (header.stamp > recv_stamp) {
+    topic->negative_latency++;
+  } else {
+    topic->latency_us.record(
+        static_cast<uint64_t>((recv_stamp - header.stamp).toNSec() / 1000));
+  }
+
+  if (format != topic->format) {
+    if (!topic->format.empty()) {
+      const double t = (recv - start_).toSec();
+      ROS_WARN_STREAM("[ StreamProfiler ] " << topic->name << " changed from "
+                                            << topic->format << " to "
+                                            << format << " at " << t << " s");
+      topic->changes.push_back(ResolutionChange{t, topic->format, format});
+    }
+    topic->format = format;
+  }
+}
+
+void StreamProfiler::report(std::ostream &out) {
+  const ros::WallTime now = ros::WallTime::now();
+  const double period = std::max((now - last_report_).toSec(), 1e-6);
+  last_report_ = now;
+  const std::streamsize precision = out.precision();
+  out << std::left << std::setw(32) << "topic" << std::right << std::setw(8)
+      << "hz" << std::setw(9) << "MB/s" << std::setw(8) << "drop"
+      << std::setw(16) << "gap p50/p99" << std::setw(18) << "latency p50/p99"
+      << std::setw(16) << "decode p50/p99"
+      << "  format\n";
+  for (const std::unique_ptr<Topic> &topic : topics_) {
+    std::lock_guard<std::mutex> lock(topic->mutex);
+    const HistogramSnapshot interarrival = topic->interarrival_us.snapshot();
+    const HistogramSnapshot latency = topic->latency_us.snapshot();
+    const HistogramSnapshot decode = topic->decode_us.snapshot();
+    const HistogramSnapshot gap = interarrival.since(topic->report_interarrival);
+    const HistogramSnapshot lat = latency.since(topic->report_latency);
+    const HistogramSnapshot dec = decode.since(topic->report_decode);
+    const uint64_t messages = topic->messages - topic->report_messages;
+    const uint64_t bytes = topic->bytes - topic->report_bytes;
+    const uint64_t dropped = topic->dropped - topic->report_dropped;
+    out << std::left << std::setw(32) << topic->name << std::right
+        << std::fixed << std::setprecision(1) << std::setw(8)
+        << messages / period << std::setprecision(2) << std::setw(9)
+        << bytes / period / (1 << 20) << std::setw(8) << dropped
+        << std::setw(16)
+        << format_ms(gap.percentile(0.5)) + "/" +
+               format_ms(gap.percentile(0.99))
+        << std::setw(18)
+        << (lat.count > 0 ? format_ms(lat.percentile(0.5)) + "/" +
+                                format_ms(lat.percentile(0.99))
+                          : std::string("-"))
+        << std::setw(16)
+        << (dec.count > 0 ? format_ms(dec.percentile(0.5)) + "/" +
+                                format_ms(dec.percentile(0.99))
+                          : std::string("-"))
+        << "  " << (topic->messages > 0 ? topic->format : "no messages")
+        << "\n";
+    out.unsetf(std::ios::fixed);
+    topic->report_messages = topic->messages;
+    topic->report_bytes = topic->bytes;
+    topic->report_dropped = topic->dropped;
+    topic->report_interarrival = interarrival;
+    topic->report_latency = latency;
+    topic->report_decode = decode;
+  }
+  out.precision(precision);
+  out << std::flush;
+}
+
+bool StreamProfiler::write_summary(const std::string &path) const {
+  std::ofstream out(path);
+  if (!out) {
+    ROS_ERROR_STREAM("[ StreamProfiler ] cannot write " << path);
+    return false;
+  }
+  const double duration = (ros::WallTime::now() - start_).toSec();
+  out << "{\n  \"duration_s\": " << duration << ",\n  \"topics\": [";
+  for (size_t i = 0; i < topics_.size(); i++) {
+    Topic &topic = *topics_[i];
+    std::lock_guard<std::mutex> lock(topic.mutex);
+    // 第一帧到最后一帧之间的平均帧率, 少于两帧时为 0
+    const double span = (topic.last_recv - topic.first_recv).toSec();
+    const double rate =
+        topic.messages >= 2 && span > 0 ? (topic.messages - 1) / span : 0.0;
+    const HistogramSnapshot size = topic.size_bytes.snapshot();
+    out << (i == 0 ? "\n" : ",\n") << "    {\"topic\": ";
+    write_json_string(out, topic.name);
+    out << ", \"transport\": \"" << (topic.compressed ? "compressed" : "raw")
+        << "\",\n     \"messages\": " << topic.messages
+        << ", \"rate_hz\": " << rate << ", \"dropped\": " << topic.dropped
+        << ", \"bytes\": " << topic.bytes << ", \"bandwidth_mb_s\": "
+        << (duration > 0 ? topic.bytes / duration / (1 << 20) : 0.0)
+        << ",\n     \"size_bytes\": {\"mean\": " << size.mean()
+        << ", \"min\": " << size.min << ", \"max\": " << size.max << "}"
+        << ",\n     \"interarrival_ms\": ";
+    write_json_ms(out, topic.interarrival_us.snapshot());
+    out << ",\n     \"latency_ms\": ";
+    write_json_ms(out, topic.latency_us.snapshot());
+    out << ", \"unstamped\": " << topic.unstamped
+        << ", \"negative_latency\": " << topic.negative_latency;
+    out << ",\n     \"decode_ms\": ";
+    if (topic.compressed) {
+      write_json_ms(out, topic.decode_us.snapshot());
+    } else {
+      out << "null";
+    }
+    out << ", \"decode_errors\": " << topic.decode_errors
+        << ",\n     \"format\": ";
+    write_json_string(out, topic.format);
+    out << ", \"format_changes\": [";
+    for (size_t k = 0; k < topic.changes.size(); k++) {
+      const ResolutionChange &change = topic.changes[k];
+      out << (k == 0 ? "" : ", ") << "{\"t\": " << change.t << ", \"from\": ";
+      write_json_string(out, change.from);
+      out << ", \"to\": ";
+      write_json_string(out, change.to);
+      out << "}";
+    }
+    out << "]}";
+  }
+  out << "\n  ]\n}\n";
+  ROS_INFO_STREAM("[ StreamProfiler ] summary saved to " << path);
+  return static_cast<bool>(out);
+}
+
+void StreamProfiler::save_frames(const std::string &dir) const {
+  if (!make_dirs(dir)) {
+    ROS_ERROR_STREAM("[ StreamProfiler ] cannot create " << dir);
+    return;
+  }
+  for (const std::unique_ptr<Topic> &topic : topics_) {
+    cv::Mat img;
+    {
+      std::lock_guard<std::mutex> lock(topic->mutex);
+      if (!topic->last_frame.empty()) {
+        img = topic->last_frame;
+      } else if (topic->last_image) {
+        try {
+          img = cv_bridge::toCvCopy(topic->last_image,
+                                    sensor_msgs::image_encodings::BGR8)
+                    ->image;
+        } catch (cv_bridge::Exception &e) {
+          ROS_ERROR_STREAM("[ StreamProfiler ] cannot convert "
+                           << topic->name << " : " << e.what());
+        }
+      }
+    }
+    if (img.empty()) {
+      continue;
+    }
+    const std::string path = dir + "/" + file_safe_name(topic->name) + ".jpg";
+    if (cv::imwrite(path, img)) {
+      ROS_INFO_STREAM("[ StreamProfiler ] " << topic->name << " saved to "
+                                            << path);
+    }
+  }
+}
@@ -17,6 +17,8 @@
 #include "vector"
 // opencv
 #include "opencv2/opencv.hpp"
+// ros
+#include "ros/time.h"
 // local headers
 #include "base_structure/cr_object.hpp"
 #include "enum/enum.hpp"
@@ -24,4 +26,8 @@
 struct cr_result {
   std::vector<cr_object> object;
   bool someone = false;
-};
\ No newline at end of file
+  // 输入帧的采集时间戳和 CR 按相机分配的帧序号(从1开始), seq 为0表示还没有收到图像
+  ros::Time stamp;
+  uint32_t seq = 0;
+  std::string frame_id;
+};
@@ -0,0 +1,55 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-20 10:12:40
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-20 10:12:40
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/include/cr/batch_select.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/core.hpp"
+
+/**
+ * @description: 不使用调度器时参与检测的相机, 按相机顺序; 已经取走过的旧帧不再检测
+ * @param {bool*} fresh : 每个相机本周期是否取到新帧
+ * @param {int} camera_num : 相机数量
+ * @param {HasImage} has_image : has_image(i) 为 false 时跳过(没有图像或转换失败),
+ *                               只对有新帧的相机调用
+ * @param {std::vector<int>*} selected : 输出, 相机序号
+ */
+template <typename HasImage>
+inline void select_fresh(const bool *fresh, int camera_num, HasImage has_image,
+                         std::vector<int> *selected) {
+  selected->clear();
+  for (int i = 0; i < camera_num; i++) {
+    if (fresh[i] && has_image(i)) {
+      selected->push_back(i);
+    }
+  }
+}
+
+/**
+ * @description: 没有检测的相机(未选中或检测失败)释放本周期的图像并清除 fresh,
+ *               结果沿用上一次的检测, 不在新帧上画旧框
+ * @param {bool*} detected : 每个相机本周期是否检测成功
+ * @param {int} camera_num : 相机数量
+ * @param {std::vector<cv::Mat>*} frames : 本周期取出的图像
+ * @param {bool*} fresh : 输入输出
+ */
+inline void release_undetected(const bool *detected, int camera_num,
+                               std::vector<cv::Mat> *frames, bool *fresh) {
+  for (int i = 0; i < camera_num; i++) {
+    if (!detected[i]) {
+      (*frames)[i].release();
+      fresh[i] = false;
+    }
+  }
+}
@@ -0,0 +1,99 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 20:41:26
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 20:41:26
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/include/cr/camera_health.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+// third party headers
+// ros
+#include "diagnostic_msgs/DiagnosticArray.h"
+#include "ros/ros.h"
+// local headers
+#include "common_utils/metrics.hpp"
+
+enum class CameraState {
+  kWaiting = 0, // 还没有收到过图像
+  kAlive,       // 正常
+  kDegraded,    // 帧率低于预期或解码错误较多, 仍参与检测
+  kStale,       // 超过 health_stale_ms 没有新帧, 不参与检测
+  kDead,        // 超过 health_dead_s 没有新帧, 不参与检测并定期重新订阅
+};
+
+const char *camera_state_name(CameraState state);
+
+/**
+ * @description: 相机健康监测
+ * 回调线程记录每帧的到达时间/解码错误, 检测循环每个周期调用 update 更新状态.
+ * 时间戳与上一帧相同的图像(驱动卡住后重复发布)不算新帧.
+ * 状态变化时以及每个 health_period_s 在 ~camera_health 上发布 DiagnosticArray.
+ */
+class CameraHealth {
+public:
+  CameraHealth(ros::NodeHandle nh, ros::NodeHandle pnh,
+               const std::vector<std::string> &camera_names);
+
+  bool init();
+
+  // 回调线程: 收到一帧
+  void frame_received(int camera, const ros::Time &stamp);
+  // 回调线程: 图像转换/解码失败
+  void decode_error(int camera);
+
+  // 检测循环: 更新所有相机的状态
+  void update(int64_t now_us);
+  // 该相机的图像是否可以参与检测
+  bool usable(int camera) const;
+  CameraState state(int camera) const { return cameras_[camera]->state; }
+  // 相机处于 kDead 时每 health_resubscribe_s 返回一次 true
+  bool take_resubscribe(int camera, int64_t now_us);
+
+private:
+  struct Camera {
+    std::string name;
+    double expected_rate_hz = 0; // 0 为不检查帧率
+    std::atomic<int64_t> last_frame_us{0};
+    std::atomic<int64_t> last_stamp_ns{0};
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> repeated{0};
+    std::atomic<uint64_t> decode_errors{0};
+    // 以下只在检测循环中使用
+    CameraState state = CameraState::kWaiting;
+    uint64_t window_frames = 0;
+    uint64_t window_decode_errors = 0;
+    double rate_hz = 0;
+    uint64_t errors_in_window = 0;
+    int64_t last_resubscribe_us = 0;
+    MetricGauge *state_gauge = nullptr;
+    MetricCounter *decode_error_counter = nullptr;
+    MetricCounter *repeated_counter = nullptr;
+    MetricCounter *excluded_counter = nullptr;
+  };
+
+  CameraState evaluate(const Camera &camera, int64_t now_us) const;
+  void publish_status(int64_t now_us);
+
+  ros::NodeHandle nh_;
+  ros::NodeHandle pnh_;
+  double stale_ms_ = 1000.0;
+  double dead_s_ = 5.0;
+  double period_s_ = 1.0;
+  double min_rate_ratio_ = 0.5;
+  int max_decode_errors_ = 3; // 每个周期内
+  double resubscribe_s_ = 10.0;
+
+  std::vector<std::unique_ptr<Camera>> cameras_;
+  int64_t window_begin_us_ = 0;
+  ros::Publisher status_pub_;
+};
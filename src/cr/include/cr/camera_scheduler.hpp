@@ -0,0 +1,96 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 18:05:26
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 18:05:26
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/include/cr/camera_scheduler.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <string>
+#include <vector>
+// third party headers
+// ros
+#include "ros/ros.h"
+#include "std_msgs/Header.h"
+// local headers
+#include "common_utils/metrics.hpp"
+
+struct CameraSchedule {
+  int priority = 1;         // 0 为最高优先级, 到期时总能分到检测位
+  double rate_hz = 5.0;     // 目标检测频率
+  double deadline_ms = 500; // 从采集到检测完成的期限
+};
+
+/**
+ * @description: 按相机的优先级/目标频率/期限分配每个周期的检测位
+ * 每个相机有新帧且到期时成为候选, 优先级为0的相机先占位,
+ * 其余候选按截止时间(采集时间 + deadline)从早到晚填满剩余的位置.
+ * 检测耗时按 固定开销 + 单帧耗时 x batch 拟合(TensorRT 的固定开销不能平摊到每帧),
+ * 预计超过周期时缩小每周期的检测数(budget), 低优先级相机被跳过并沿用上一次的结果,
+ * 前向相机保持原有频率. budget 小于相机数时每隔 probe 周期试探多检测一路,
+ * 保证拟合有不同 batch 的样本, budget 不会锁死在最小值.
+ */
+class CameraScheduler {
+public:
+  CameraScheduler(ros::NodeHandle pnh,
+                  const std::vector<std::string> &camera_names,
+                  double loop_rate_hz);
+
+  bool init();
+
+  /**
+   * @description: 选出本周期要检测的相机, 优先级为0的在前, 其余按截止时间排列
+   * @param {ros::Time} now : 当前时间
+   * @param {std_msgs::Header*} headers : 每个相机最新一帧的header, seq 为 CR 分配的帧序号
+   * @param {std::vector<int>*} selected : 输出, 相机序号
+   */
+  void select(const ros::Time &now, const std_msgs::Header *headers,
+              std::vector<int> *selected);
+  // 检测完成后调用, 用于拟合检测耗时和调整 budget
+  void detect_done(int64_t latency_us, int batch_size);
+  // 按拟合结果预计 batch_size 个相机的检测耗时
+  double estimate_us(int batch_size) const {
+    return fixed_us_ + per_image_us_ * batch_size;
+  }
+
+  int budget() const { return budget_; }
+
+private:
+  struct Candidate {
+    int camera;
+    ros::Time deadline;
+  };
+  struct CameraState {
+    CameraSchedule schedule;
+    uint32_t served_seq = 0;
+    ros::Time next_due;
+    MetricCounter *skipped = nullptr;
+    MetricCounter *deadline_missed = nullptr;
+  };
+
+  ros::NodeHandle pnh_;
+  std::vector<std::string> camera_names_;
+  double loop_rate_hz_;
+  double load_ratio_ = 0.8; // 检测耗时占周期的目标比例
+  std::vector<CameraState> cameras_;
+  std::vector<Candidate> candidates_;
+
+  void fit();
+
+  int budget_ = 0;
+  int min_budget_ = 1;
+  // 下标为 batch 大小, 该大小检测耗时的滑动平均, 0 为还没有样本
+  std::vector<double> latency_us_;
+  double fixed_us_ = 0;     // 与 batch 大小无关的开销
+  double per_image_us_ = 0; // 每多一帧增加的耗时
+  double probe_s_ = 5.0;    // 试探多检测一路的间隔
+  int probe_interval_ = 1;  // 换算成检测次数
+  int since_probe_ = 0;
+  MetricGauge *budget_gauge_ = nullptr;
+};
@@ -12,7 +12,9 @@
  */
 
 #pragma once
+#include <algorithm>
 #include <mutex>
+#include <sstream>
 
 #include "iostream"
 
@@ -20,6 +22,7 @@
 #include "opencv2/opencv.hpp"
 // ros
 #include "ros/ros.h"
+#include "std_msgs/Header.h"
 #include "std_msgs/String.h"
 // ros img
 #include "cv_bridge/cv_bridge.h"
@@ -29,14 +32,28 @@
 #include "sensor_msgs/image_encodings.h"
 
 // loacl header
+#include "common_utils/async_logger.hpp"
+#include "common_utils/frame_pool.hpp"
 #include "common_utils/split_string.hpp"
+#include "common_utils/trace.hpp"
+#include "batch_select.hpp"
+#include "camera_health.hpp"
+#include "camera_scheduler.hpp"
+#include "cr_metrics.hpp"
+#include "cr_recorder.hpp"
 #include "cr_send_result.hpp"
 #include "enum/enum.hpp"
+#include "event_recorder.hpp"
+#include "frame_sync.hpp"
 #include "postprocess.hpp"
+#include "tld_detector/cascade_detector.hpp"
+#include "tld_detector/roi_mask.hpp"
 #include "tld_detector/tld_detector.hpp"
 #include "wind_zmq/wind_zmq.hpp"
 
-#define BATCH_SIZE 4
+// 订阅的相机数量, 与模型的 batch 无关(见 ModelMetadata)
+constexpr int kCameraNum = 4;
+
 class CR {
 private:
   // ros
@@ -45,10 +62,18 @@ private:
   int loop_rate_hz_ = 5;
   std::string zmq_pub_topic_ = std::string("peddet");
   std::string zmq_pub_port_ = std::string("tcp://0.0.0.0:1973");
+  std::string zmq_send_policy_ = std::string("conflate");
+  ZeroMQPublisherOptions zmq_pub_options_;
   std::unique_ptr<cr_send_result> cr_send_result_ptr_;
   std::unique_ptr<TLDDetector> detector_ptr_;
   std::unique_ptr<CRPostProcess> postprocess_ptr_;
   std::unique_ptr<ZeroMQPublisher> zmq_publish;
+  std::unique_ptr<CRMetrics> metrics_ptr_;
+  std::unique_ptr<CameraScheduler> scheduler_ptr_;
+  std::unique_ptr<FrameSynchronizer> sync_ptr_;
+  std::unique_ptr<CameraHealth> health_ptr_;
+  std::unique_ptr<CRRecorder> recorder_ptr_;
+  std::unique_ptr<EventRecorder> event_ptr_;
 
   // msgs topic
   std::string img_topic_;
@@ -80,8 +105,21 @@ private:
   std::mutex mutex_2;
   std::mutex mutex_3;
 
-  // detector weight path
+  // detector weight path, .wts 时使用 CPU 推理
   std::string cr_detector_weight_path_;
+  int detector_cpu_threads_ = 0;
+  // 非空时为两级检测: 该模型初筛每一帧, 有候选时再用 cr_detector_weight_path 复核
+  std::string cr_screen_weight_path_;
+  CascadeOptions cascade_options_;
+  // 非空时推理交给 cr_infer_server, 多个 cr 进程共用一个 engine
+  std::string inference_server_;
+  int inference_timeout_ms_ = 200;
+  // 每个相机的静态检测区域(camera_config_path 中的 roi_polygons), 按相机顺序
+  bool roi_mask_enabled_ = false;
+  std::string camera_config_path_;
+  std::vector<std::string> camera_ids_;
+  std::vector<RoiMask> roi_masks_;
+  std::vector<const RoiMask *> roi_mask_ptrs_;
 
   std::vector<std::pair<std::string, ros::Subscriber>> topic_list;
 
@@ -89,6 +127,64 @@ private:
   bool *flag[4] = {&img_updated_, &img_updated_1, &img_updated_2,
                    &img_updated_3};
   cv::Mat *img[4] = {&locked_img_, &locked_img_1, &locked_img_2, &locked_img_3};
+  // 原始图像消息, 用于直接生成检测器输入; 压缩图像话题为空
+  sensor_msgs::ImageConstPtr locked_msgs_[kCameraNum];
+  bool fused_preprocess_ = true;
+  // 融合预处理且不做同步时回调只保存消息, 检测循环只转换进入 batch 的帧,
+  // 被覆盖的帧和调度器跳过的帧不再做整帧 BGR 转换
+  bool lazy_convert_ = false;
+  // 回调写入新帧时置位, 检测线程取走后清除; img_updated_ 只表示曾经收到过图像
+  bool img_fresh_[kCameraNum] = {false, false, false, false};
+  // 最新一帧的header, stamp 为采集时间戳, seq 替换为 CR 按相机分配的帧序号
+  std_msgs::Header locked_headers_[kCameraNum];
+  uint32_t frame_seq_[kCameraNum] = {0, 0, 0, 0};
+  // zmq 在 "yes"/"no" 之后追加第三帧:
+  // "<发布时间> <seq0>@<stamp0> <seq1>@<stamp1> ...", 时间格式为 sec.nsec
+  bool zmq_stamp_frame_ = false;
+  // 每个相机一份转换计划, 编码只在第一帧(或编码变化时)解析一次
+  cv_bridge::ConversionPlan plans_[kCameraNum];
+  // 回调先转换到备用缓存, 加锁后与 img[i] 交换, 缓存在两者之间循环复用;
+  // lazy_convert_ 时由检测循环转换到备用缓存, 回调不再使用 plans_ 和备用缓存
+  cv::Mat spare_imgs_[kCameraNum];
+
+  // 耗时追踪, 向 ~dump_trace 发送文件路径(为空时用 trace_dump_path)导出 Chrome trace
+  bool trace_enabled_ = false;
+  int trace_buffer_size_ = 16384;
+  std::string trace_dump_path_ = std::string("/tmp/cr_trace.json");
+  ros::Subscriber trace_dump_sub_;
+
+  // 每个周期复用的容器: begin_cycle 只清空内容不释放容量(按周期回收的 arena),
+  // end_cycle 释放对图像的引用, 让回调可以继续复用备用缓存
+  struct CycleBuffers {
+    std::vector<cr_result> result;
+    std::vector<cv::Mat> frames;
+    std::vector<sensor_msgs::ImageConstPtr> msgs;
+    std_msgs::Header headers[kCameraNum];
+    // 参与检测的相机(调度器选中的或有新帧的)按顺序压到 batch 的前几位
+    std::vector<int> selected;
+    std::vector<cv::Mat> batch_frames;
+    std::vector<sensor_msgs::ImageConstPtr> batch_msgs;
+    std::vector<const RoiMask *> batch_masks;
+    std::vector<std::vector<cr_object>> batch_objects;
+  };
+  CycleBuffers cycle_;
+
+  // 按相机优先级和期限调度检测, 过载时低优先级相机沿用上一次的结果
+  bool schedule_enabled_ = false;
+  cr_result last_result_[kCameraNum];
+
+  // 按采集时间同步四路图像, 关闭时直接取每个相机最新的一帧
+  bool sync_enabled_ = false;
+  // 相机停止发布或卡住时不再参与检测, 也不再输出它的旧结果
+  bool health_enabled_ = false;
+  // 检测结果写入 record_dir 下的 .crlog, 可选保存关键帧
+  bool record_enabled_ = false;
+  // 有人时保存报警前后几秒的缩小图像
+  bool event_enabled_ = false;
+
+  // 热路径的日志走 AsyncLogger, log_to_rosout 为true时由后台线程转发到 rosconsole
+  std::string log_level_ = std::string("info");
+  bool log_to_rosout_ = false;
 
 public:
   CR(ros::NodeHandle nh, ros::NodeHandle pnh) : nh_(nh), pnh_(pnh) {
@@ -99,15 +195,73 @@ public:
     pnh_.param("loop_rate_hz", loop_rate_hz_, static_cast<int>(5));
     pnh_.param("cr_detector_weight_path", cr_detector_weight_path_,
                std::string(""));
+    pnh_.param("detector_cpu_threads", detector_cpu_threads_, 0);
+    pnh_.param("cr_screen_weight_path", cr_screen_weight_path_,
+               std::string(""));
+    pnh_.param("cascade_crop", cascade_options_.crop, cascade_options_.crop);
+    pnh_.param("cascade_crop_margin", cascade_options_.crop_margin,
+               cascade_options_.crop_margin);
+    pnh_.param("inference_server", inference_server_, std::string(""));
+    pnh_.param("inference_timeout_ms", inference_timeout_ms_, 200);
+    pnh_.param("roi_mask_enabled", roi_mask_enabled_, false);
+    pnh_.param("camera_config_path", camera_config_path_, std::string(""));
+    pnh_.param("camera_ids", camera_ids_, std::vector<std::string>());
+    // 直接从原始图像消息生成检测器输入, 跳过 resize_img 和逐像素拷贝
+    pnh_.param("fused_preprocess", fused_preprocess_, true);
+    // zmq发送策略, 订阅端过慢时不能拖慢检测循环
+    pnh_.param("zmq_send_policy", zmq_send_policy_, std::string("conflate"));
+    pnh_.param("zmq_sndhwm", zmq_pub_options_.sndhwm, 10);
+    pnh_.param("zmq_linger_ms", zmq_pub_options_.linger_ms, 0);
+    pnh_.param("zmq_send_timeout_ms", zmq_pub_options_.send_timeout_ms, 5);
+    pnh_.param("zmq_pending_queue_size", zmq_pub_options_.pending_queue_size,
+               4);
+    pnh_.param("zmq_tcp_keepalive", zmq_pub_options_.tcp_keepalive, true);
+    pnh_.param("zmq_stamp_frame", zmq_stamp_frame_, false);
+    pnh_.param("trace_enabled", trace_enabled_, false);
+    pnh_.param("trace_buffer_size", trace_buffer_size_, 16384);
+    pnh_.param("trace_dump_path", trace_dump_path_,
+               std::string("/tmp/cr_trace.json"));
+    pnh_.param("log_level", log_level_, std::string("info"));
+    pnh_.param("log_to_rosout", log_to_rosout_, false);
+    pnh_.param("schedule_enabled", schedule_enabled_, false);
+    pnh_.param("sync_enabled", sync_enabled_, false);
+    pnh_.param("health_enabled", health_enabled_, false);
+    pnh_.param("record_enabled", record_enabled_, false);
+    pnh_.param("event_enabled", event_enabled_, false);
   }
   bool init();
   void start();
 
 private:
   bool msgs_sub_init();
+  void subscribe(int index);
+  // 更新相机健康状态, 排除停止发布的相机, 必要时重新订阅
+  void check_health();
+  bool logger_init();
+  void begin_cycle();
+  void end_cycle();
+  // 取出本周期的图像, 返回 false 表示同步器还在等待缺少的相机
+  bool collect_frames(bool *fresh);
+  // 只检测调度器选中的相机, 其余相机的结果取上一次检测
+  bool detect_scheduled(bool *fresh);
+  // 只检测本周期有新帧的相机, 其余相机的结果取上一次检测
+  bool detect_all(bool *fresh);
+  // lazy_convert_ 时把 cycle_.msgs[i] 转换到 cycle_.frames[i],
+  // 没有图像或转换失败返回 false
+  bool convert_frame(int i);
   void receive_raw_img_callback(const sensor_msgs::ImageConstPtr &img_msg,
-                                cv::Mat *get_img, bool *flag, std::mutex *key);
+                                int index, cv::Mat *get_img,
+                                sensor_msgs::ImageConstPtr *get_msg, bool *flag,
+                                std::mutex *key,
+                                cv_bridge::ConversionPlan *plan,
+                                cv::Mat *spare);
   void receive_compressed_img_callback(
-      const sensor_msgs::CompressedImageConstPtr &img_msg, cv::Mat *get_img,
-      bool *flag, std::mutex *key);
+      const sensor_msgs::CompressedImageConstPtr &img_msg, int index,
+      cv::Mat *get_img, bool *flag, std::mutex *key, cv::Mat *spare);
+  // 回调线程加锁后调用: 保存header并分配帧序号, 返回上一帧是否还没被取走
+  bool store_header(int index, const std_msgs::Header &header);
+  std::string stamp_frame(const std::vector<cr_result> &result) const;
+  void dump_trace_callback(const std_msgs::StringConstPtr &msg);
+  // 备用缓存仍被检测循环引用时不能覆盖, 释放后由转换重新分配
+  static void reclaim_spare(cv::Mat *spare);
 };
@@ -0,0 +1,106 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 15:40:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 15:40:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/include/cr/cr_metrics.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+// third party headers
+// ros
+#include "diagnostic_msgs/DiagnosticArray.h"
+#include "ros/ros.h"
+// local headers
+#include "common_utils/frame_pool.hpp"
+#include "common_utils/metrics.hpp"
+
+// 按4位有效数字追加一个诊断值, CRMetrics 和 CameraHealth 共用
+void add_value(diagnostic_msgs::DiagnosticStatus *status, const std::string &key,
+               double value);
+
+/**
+ * @description: CR 的运行指标
+ * 回调线程和检测线程只更新 MetricsRegistry 中的原子计数和直方图,
+ * 定时器按周期计算每个相机的帧率/帧龄, 发布到 /diagnostics,
+ * 并可选地写 Prometheus 文本文件.
+ */
+class CRMetrics {
+public:
+  // 帧经过的各个阶段, 帧龄 = 到达该阶段的时间 - 采集时间戳
+  enum Stage { kReceived = 0, kDetectorInput, kDetected, kPublished, kNumStages };
+
+  CRMetrics(ros::NodeHandle nh, ros::NodeHandle pnh,
+            const std::vector<std::string> &camera_names);
+
+  bool init();
+
+  // 回调线程: 收到一帧, overwritten 表示上一帧还没被检测线程取走就被覆盖
+  void frame_received(int camera, bool overwritten);
+  // 检测线程: 取走一帧新图像, 记录从采集到进入检测的时间
+  void frame_consumed(int camera, const ros::Time &stamp);
+  // 记录帧到达 stage 时的帧龄(微秒)并返回, 相机未填时间戳时返回-1
+  int64_t frame_age(int camera, Stage stage, const ros::Time &stamp);
+  void detections(int camera, size_t count);
+  void inference_done(int64_t latency_us);
+  void publish_done(int64_t latency_us);
+  void cycle_done(int64_t latency_us);
+
+  static int64_t now_us();
+  static const char *stage_name(Stage stage);
+
+private:
+  struct CameraMetrics {
+    std::string name;
+    MetricCounter *received = nullptr;
+    MetricCounter *overwritten = nullptr;
+    MetricCounter *consumed = nullptr;
+    MetricGauge *rate_hz = nullptr;
+    LatencyHistogram *frame_age_us[kNumStages] = {};
+    LatencyHistogram *detections = nullptr;
+    std::atomic<int64_t> last_frame_us{0};
+    // 以下只在定时器中使用
+    uint64_t last_received = 0;
+    HistogramSnapshot last_frame_age[kNumStages];
+    HistogramSnapshot last_detections;
+  };
+
+  void publish_diagnostics(const ros::WallTimerEvent &event);
+  void add_latency_values(const std::string &prefix,
+                          const HistogramSnapshot &window,
+                          diagnostic_msgs::DiagnosticStatus *status) const;
+
+  ros::NodeHandle nh_;
+  ros::NodeHandle pnh_;
+  double period_s_ = 1.0;
+  double min_rate_hz_ = 5.0;      // 低于该帧率报 WARN
+  double stale_timeout_s_ = 2.0;  // 超过该时间没有新帧报 ERROR
+  double max_frame_age_ms_ = 500; // 帧龄 p99 超过该值报 WARN
+  std::string prometheus_path_;   // 为空时不写文件
+
+  std::vector<std::unique_ptr<CameraMetrics>> cameras_;
+  LatencyHistogram *inference_us_ = nullptr;
+  LatencyHistogram *publish_us_ = nullptr;
+  LatencyHistogram *cycle_us_ = nullptr;
+  HistogramSnapshot last_inference_;
+  HistogramSnapshot last_publish_;
+  HistogramSnapshot last_cycle_;
+  int64_t last_diagnostics_us_ = 0;
+  // 稳定运行后内存池不应再向系统申请内存
+  MetricGauge *pool_allocations_ = nullptr;
+  MetricGauge *pool_in_use_bytes_ = nullptr;
+  MetricGauge *pool_cached_bytes_ = nullptr;
+  uint64_t last_pool_allocations_ = 0;
+
+  ros::Publisher diagnostics_pub_;
+  ros::WallTimer timer_;
+};
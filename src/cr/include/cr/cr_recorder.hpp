@@ -0,0 +1,93 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 21:46:02
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 21:46:02
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/include/cr/cr_recorder.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/core.hpp"
+// ros
+#include "ros/ros.h"
+// local headers
+#include "base_structure/cr_result.hpp"
+#include "common_utils/detection_log.hpp"
+#include "common_utils/metrics.hpp"
+
+/**
+ * @description: 检测结果记录
+ * 每个相机新检测出的结果追加到 record_dir 下的 .crlog(见 detection_log.hpp),
+ * 文件超过 record_max_file_mb 后换新文件. 检测循环里只做按列缓存和 memcpy.
+ * record_keyframes 为true时, 相机有人的上升沿以及每隔 record_keyframe_period_s
+ * 把原图交给后台线程编码成 jpeg, 写入 record_dir/keyframes/<相机>_<stamp_ns>.jpg,
+ * 队列满时丢弃并计数, 不阻塞检测循环.
+ * 用 cr_log_reader 按时间范围导出.
+ */
+class CRRecorder {
+public:
+  CRRecorder(ros::NodeHandle pnh, const std::vector<std::string> &camera_names);
+  ~CRRecorder();
+
+  bool init();
+
+  /**
+   * @description: 检测循环调用, 记录本周期的结果, seq 与上次记录相同的相机跳过
+   * @param {std::vector<cr_result>} result : 每个相机的结果
+   * @param {std::vector<cv::Mat>} frames : 检测用的原图, 为空的相机不保存关键帧
+   */
+  void record(const std::vector<cr_result> &result,
+              const std::vector<cv::Mat> &frames);
+
+private:
+  struct Keyframe {
+    cv::Mat img;
+    std::string path;
+  };
+
+  bool open_file();
+  void keyframe_loop();
+
+  ros::NodeHandle pnh_;
+  std::vector<std::string> camera_names_;
+  std::string dir_ = std::string("/tmp/cr_record");
+  int max_file_mb_ = 256;
+  int rows_per_block_ = 256;
+  int index_interval_ = 16;
+  double flush_period_s_ = 5.0;
+  bool keyframes_ = false;
+  double keyframe_period_s_ = 10.0; // 0 为只在有人的上升沿保存
+  int keyframe_quality_ = 90;
+  int keyframe_queue_size_ = 4;
+
+  DetectionLogWriter writer_;
+  DetectionLogRow row_;
+  ros::WallTime last_flush_;
+  std::vector<uint32_t> last_seq_;
+  std::vector<bool> last_someone_;
+  std::vector<ros::WallTime> last_keyframe_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Keyframe> queue_;
+  bool stop_ = false;
+  std::thread thread_;
+
+  MetricCounter *rows_counter_ = nullptr;
+  MetricCounter *keyframe_counter_ = nullptr;
+  MetricCounter *keyframe_dropped_ = nullptr;
+  MetricCounter *write_errors_ = nullptr;
+};
@@ -14,18 +14,23 @@
 #pragma once
 // c++ system headers
 #include <math.h>
+#include <stdio.h>
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 // third party headers
 // opencv
 #include "opencv2/opencv.hpp"
 // ros
 #include "cv_bridge/cv_bridge.h"
+#include "cv_bridge/msg_pool.h"
 #include "image_transport/image_transport.h"
 #include "ros/ros.h"
 #include "std_msgs/String.h"
 // local headers
 #include "base_structure/cr_result.hpp"
+#include "common_utils/trace.hpp"
 #include "enum/enum.hpp"
 
 class cr_send_result {
@@ -55,6 +60,22 @@ private:
   std::unique_ptr<image_transport::ImageTransport> it_ptr_3;
   image_transport::Publisher img_publisher_3;
 
+  // publish_jpeg 为true时由本类编码jpeg并直接发布 <topic> 和 <topic>/compressed,
+  // 不再经过image_transport, 每帧只编码一次且编码缓存复用
+  bool publish_jpeg_ = false;
+  int jpeg_quality_ = 80;
+  std::vector<ros::Publisher> raw_publishers_;
+  std::vector<ros::Publisher> jpeg_publishers_;
+  // 每个相机独立的消息池和编码器, 可以并行画框和编码
+  std::vector<cv_bridge::ImageMsgPool> img_pools_;
+  std::vector<std::unique_ptr<cv_bridge::JpegEncoder>> jpeg_encoders_;
+  // send_results 每个周期复用, 发布后清空引用, 池中的消息才能再次取出
+  std::vector<sensor_msgs::ImagePtr> raw_msgs_;
+  std::vector<sensor_msgs::CompressedImagePtr> jpeg_msgs_;
+  std_msgs::String someone_msg_;
+  // 每个相机的标签文字缓存, 并行画框时互不干扰
+  std::vector<std::string> labels_;
+
   const std::string class_names_[1] = {"person"};
 
 public:
@@ -69,15 +90,29 @@ public:
                std::string("/perception/pr3"));
     pnh_.param("someone_publish_topic_", someone_publish_topic_,
                std::string("/perception/someone"));
+    pnh_.param("publish_jpeg", publish_jpeg_, false);
+    pnh_.param("jpeg_quality", jpeg_quality_, 80);
   }
 
   bool init();
   void send_result(const cv::Mat &img, const cr_result &result, int i, bool &flag);
+  // 一次发送所有相机的结果, 画框和编码在相机之间并行
+  void send_results(const std::vector<cv::Mat> &imgs,
+                    const std::vector<cr_result> &results, bool &flag);
 
 private:
   bool publish_img_with_bbox(const cv::Mat &img, const cr_result &result,
                              int i);
+  // 在池中的消息上直接画框, 没有订阅者时对应的消息为空
+  void render(const cv::Mat &img, const cr_result &result, int i,
+              sensor_msgs::ImagePtr *raw_msg,
+              sensor_msgs::CompressedImagePtr *jpeg_msg);
+  void publish_rendered(int i, const sensor_msgs::ImagePtr &raw_msg,
+                        const sensor_msgs::CompressedImagePtr &jpeg_msg);
+  image_transport::Publisher *it_publisher(int i);
   int publish_result_people(const cr_result &result, int i);
-  void draw(cv::Mat *img, const cr_result &result);
+  void draw(cv::Mat *img, const cr_result &result, std::string *label);
+  // 以 %f 格式追加深度, 不构造临时字符串
+  static void append_depth(float depth, std::string *out);
   float calculate_depth(float depth);
 };
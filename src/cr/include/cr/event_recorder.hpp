@@ -0,0 +1,112 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 22:31:15
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 22:31:15
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/include/cr/event_recorder.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/core.hpp"
+// ros
+#include "ros/ros.h"
+// local headers
+#include "base_structure/cr_result.hpp"
+#include "common_utils/metrics.hpp"
+
+/**
+ * @description: 有人报警前后的图像快照
+ * 检测循环只把新检测的帧(增加引用)放进有界队列, 后台线程按 event_scale 缩小并编码成 jpeg,
+ * 放进每个相机最近 event_pre_s 秒的环形缓存(同时受 event_ring_max_mb 限制).
+ * 相机判断为有人时触发事件: 缓存中的帧写到 event_dir/<时间>_<相机>/<stamp_ns>.jpg,
+ * 之后 event_post_s 秒内的帧继续写入, 期间再次有人时延长事件.
+ * 相机不再有新帧时, 超过结束时间 event_close_timeout_s 后由后台线程结束事件.
+ * 队列满时丢帧并计数, 不阻塞检测循环.
+ */
+class EventRecorder {
+public:
+  EventRecorder(ros::NodeHandle pnh,
+                const std::vector<std::string> &camera_names);
+  ~EventRecorder();
+
+  bool init();
+
+  /**
+   * @description: 检测循环调用, 本周期新检测的帧进入缓存, 有人时触发事件
+   * @param {std::vector<cr_result>} result : 每个相机的结果
+   * @param {std::vector<cv::Mat>} frames : 检测用的原图
+   * @param {bool*} fresh : 该相机本周期是否取走了新帧
+   */
+  void add(const std::vector<cr_result> &result,
+           const std::vector<cv::Mat> &frames, const bool *fresh);
+
+private:
+  struct Pending {
+    int camera;
+    cv::Mat img;
+    int64_t stamp_ns;
+  };
+  struct Snapshot {
+    int64_t stamp_ns;
+    std::vector<uchar> jpeg;
+  };
+  struct Camera {
+    std::string name;
+    // 以下只在后台线程中使用
+    std::deque<Snapshot> ring;
+    size_t ring_bytes = 0;
+    std::string event_dir; // 为空表示没有进行中的事件
+    int64_t event_until_ns = 0;
+    int64_t written_ns = 0; // 已写盘的最新一帧, 事件重叠时不重复写
+    int event_frames = 0;
+    // 以下只在检测循环中使用
+    uint32_t last_seq = 0;
+    MetricCounter *events = nullptr;
+    MetricCounter *written = nullptr;
+    MetricGauge *ring_bytes_gauge = nullptr;
+  };
+
+  void encode_loop();
+  void push(Camera *camera, Snapshot *snapshot);
+  void trigger(int camera, int64_t stamp_ns);
+  void write(Camera *camera, const Snapshot &snapshot);
+  void finish_event(Camera *camera);
+  // 结束已过期的事件, 返回是否还有进行中的事件
+  bool close_expired_events();
+
+  ros::NodeHandle pnh_;
+  std::string dir_ = std::string("/tmp/cr_events");
+  double pre_s_ = 5.0;
+  double post_s_ = 5.0;
+  double scale_ = 0.5;
+  int jpeg_quality_ = 80;
+  int queue_size_ = 8;
+  double ring_max_mb_ = 16.0; // 每个相机
+  double close_timeout_s_ = 1.0;
+
+  std::vector<Camera> cameras_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Pending> queue_;
+  // 每个相机最新的触发时间, 不经过队列, 队列满时也不会丢
+  std::vector<int64_t> triggers_;
+  bool triggered_ = false;
+  bool stop_ = false;
+  std::thread thread_;
+
+  MetricCounter *dropped_ = nullptr;
+};
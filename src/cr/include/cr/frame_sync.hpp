@@ -0,0 +1,117 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 20:05:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 20:05:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/include/cr/frame_sync.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/core.hpp"
+// ros
+#include "ros/ros.h"
+#include "sensor_msgs/Image.h"
+#include "std_msgs/Header.h"
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "common_utils/metrics.hpp"
+
+// 时间窗口内缺少某个相机的帧时的处理方式
+enum class SyncMissingPolicy {
+  kWait,   // 等待缺少的相机, 超过 sync_max_wait_ms 后按 kDrop 处理
+  kLatest, // 用该相机最新的一帧代替
+  kDrop,   // 该相机本周期不参与检测, 沿用上一次的结果
+};
+
+bool parse_sync_policy(const std::string &name, SyncMissingPolicy *policy);
+
+/**
+ * @description: 多相机近似时间同步, 让一个 batch 中的图像描述同一时刻
+ * 每个相机保留最近几帧(按采集时间戳), 检测循环取帧时在历史中寻找
+ * 时间跨度不超过 sync_window_ms 的一组帧: 覆盖的相机最多的优先, 其次取最新的.
+ * 取走的帧及更早的帧不再参与同步, 同一帧不会被重复检测.
+ */
+class FrameSynchronizer {
+public:
+  FrameSynchronizer(ros::NodeHandle pnh,
+                    const std::vector<std::string> &camera_names);
+
+  bool init();
+
+  /**
+   * @description: 回调线程调用, 加入一帧
+   * @param {int} camera : 相机序号
+   * @param {cv::Mat} img : BGR 图像, 只增加引用不拷贝
+   * @param {sensor_msgs::ImageConstPtr} msg : 原始消息, 压缩图像为空
+   * @param {std_msgs::Header} header : seq 为 CR 分配的帧序号
+   * @return {bool} 是否有未取走的帧因为历史已满被丢弃
+   */
+  bool add(int camera, const cv::Mat &img,
+           const sensor_msgs::ImageConstPtr &msg,
+           const std_msgs::Header &header);
+
+  // 健康监测排除的相机不参与同步, 也不计入是否凑齐
+  void set_enabled(int camera, bool enabled);
+
+  /**
+   * @description: 检测循环调用, 组成本周期的 batch
+   * 缺少的相机按策略填充, 丢弃的位置图像为空且 header.seq 为0
+   * @param {ros::Time} now : 当前时间
+   * @param {std::vector<cv::Mat>*} frames : 输出, 每个相机一帧
+   * @param {std::vector<sensor_msgs::ImageConstPtr>*} msgs : 输出, 可以为空指针
+   * @param {std_msgs::Header*} headers : 输出, 每个相机一个
+   * @param {bool*} fresh : 输出, 该位置是否为第一次取走的帧
+   * @return {bool} false 表示 kWait 策略下还在等待缺少的相机, 本周期没有 batch
+   */
+  bool collect(const ros::Time &now, std::vector<cv::Mat> *frames,
+               std::vector<sensor_msgs::ImageConstPtr> *msgs,
+               std_msgs::Header *headers, bool *fresh);
+
+private:
+  struct Frame {
+    cv::Mat img;
+    sensor_msgs::ImageConstPtr msg;
+    std_msgs::Header header;
+    ros::Time key;     // 同步用的时间, 相机未填时间戳时为到达时间
+    ros::Time arrival; // 到达时间, 用于计算 kWait 的等待时长
+  };
+  struct CameraHistory {
+    std::deque<Frame> frames; // 按到达顺序, 最新的在最后
+    uint32_t consumed_seq = 0;
+    bool enabled = true;
+    MetricCounter *missing = nullptr;
+    MetricCounter *evicted = nullptr;
+  };
+
+  // 在 [anchor, anchor + window] 内找 camera 最接近 anchor 的未取走的帧
+  const Frame *match(const CameraHistory &history, const ros::Time &anchor) const;
+  void fill(int camera, const Frame *frame, bool fresh,
+            std::vector<cv::Mat> *frames,
+            std::vector<sensor_msgs::ImageConstPtr> *msgs,
+            std_msgs::Header *headers, bool *fresh_out);
+
+  ros::NodeHandle pnh_;
+  std::vector<std::string> camera_names_;
+  double window_s_ = 0.05;
+  double max_wait_s_ = 0.03;
+  int history_size_ = 5;
+  std::string policy_name_ = std::string("latest");
+  SyncMissingPolicy policy_ = SyncMissingPolicy::kLatest;
+
+  std::mutex mutex_;
+  std::vector<CameraHistory> cameras_;
+  std::vector<const Frame *> best_;
+  std::vector<const Frame *> candidate_;
+  MetricGauge *spread_gauge_ = nullptr;
+};
@@ -12,6 +12,7 @@
  */
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 // ros
@@ -19,6 +20,7 @@
 // local header
 #include "base_structure/cr_object.hpp"
 #include "base_structure/cr_result.hpp"
+#include "common_utils/camera_undistorter.hpp"
 #include "enum/enum.hpp"
 
 class CRPostProcess {
@@ -27,13 +29,24 @@ private:
   ros::NodeHandle nh_;
   ros::NodeHandle pnh_;
 
+  // 相机发布未去畸变的图像时(undistort_mode: none),只对bbox角点去畸变后再测距
+  bool undistort_bbox_ = false;
+  std::string camera_config_path_;
+  std::vector<std::string> camera_ids_;
+  std::vector<std::unique_ptr<CameraUndistorter>> undistorters_;
+
 public:
   CRPostProcess(ros::NodeHandle &nh, ros::NodeHandle &pnh)
-      : nh_(nh), pnh_(pnh) {}
+      : nh_(nh), pnh_(pnh) {
+    pnh_.param("undistort_bbox", undistort_bbox_, false);
+    pnh_.param("camera_config_path", camera_config_path_, std::string(""));
+    pnh_.param("camera_ids", camera_ids_, std::vector<std::string>());
+  }
   bool init();
   bool process(cr_result *result, int i);
 
 private:
   void Partial_target_processing(cr_result *result, int i);
   float cal_depth(float height, float base);
+  bool undistorter_init();
 };
@@ -0,0 +1,249 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 20:41:26
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 20:41:26
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/src/camera_health.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "cr/camera_health.hpp"
+#include "cr/cr_metrics.hpp"
+
+namespace {
+
+uint8_t state_level(CameraState state) {
+  switch (state) {
+  case CameraState::kAlive:
+    return diagnostic_msgs::DiagnosticStatus::OK;
+  case CameraState::kWaiting:
+  case CameraState::kDegraded:
+    return diagnostic_msgs::DiagnosticStatus::WARN;
+  default:
+    return diagnostic_msgs::DiagnosticStatus::ERROR;
+  }
+}
+
+} // namespace
+
+const char *camera_state_name(CameraState state) {
+  switch (state) {
+  case CameraState::kWaiting:
+    return "waiting";
+  case CameraState::kAlive:
+    return "alive";
+  case CameraState::kDegraded:
+    return "degraded";
+  case CameraState::kStale:
+    return "stale";
+  case CameraState::kDead:
+    return "dead";
+  default:
+    return "unknown";
+  }
+}
+
+CameraHealth::CameraHealth(ros::NodeHandle nh, ros::NodeHandle pnh,
+                           const std::vector<std::string> &camera_names)
+    : nh_(nh), pnh_(pnh) {
+  for (const std::string &name : camera_names) {
+    std::unique_ptr<Camera> camera(new Camera());
+    camera->name = name;
+    cameras_.push_back(std::move(camera));
+  }
+}
+
+bool CameraHealth::init() {
+  const int camera_num = static_cast<int>(cameras_.size());
+  std::vector<double> expected_rate_hz(camera_num, 0.0);
+  pnh_.param("health_stale_ms", stale_ms_, stale_ms_);
+  pnh_.param("health_dead_s", dead_s_, dead_s_);
+  pnh_.param("health_period_s", period_s_, period_s_);
+  pnh_.param("health_expected_rate_hz", expected_rate_hz, expected_rate_hz);
+  pnh_.param("health_min_rate_ratio", min_rate_ratio_, min_rate_ratio_);
+  pnh_.param("health_max_decode_errors", max_decode_errors_,
+             max_decode_errors_);
+  pnh_.param("health_resubscribe_s", resubscribe_s_, resubscribe_s_);
+  if (static_cast<int>(expected_rate_hz.size()) != camera_num) {
+    ROS_ERROR_STREAM("[ CameraHealth ] health_expected_rate_hz needs "
+                     << camera_num << " values");
+    return false;
+  }
+  if (stale_ms_ <= 0 || dead_s_ * 1e3 < stale_ms_ || period_s_ <= 0 ||
+      resubscribe_s_ <= 0) {
+    ROS_ERROR_STREAM("[ CameraHealth ] invalid health_stale_ms/health_dead_s/"
+                     "health_period_s/health_resubscribe_s");
+    return false;
+  }
+
+  MetricsRegistry &registry = MetricsRegistry::instance();
+  for (int i = 0; i < camera_num; i++) {
+    Camera &camera = *cameras_[i];
+    camera.expected_rate_hz = expected_rate_hz[i];
+    const MetricLabels labels = {{"camera", camera.name}};
+    camera.state_gauge = registry.gauge(
+        "cr_camera_state", labels,
+        "0 waiting, 1 alive, 2 degraded, 3 stale, 4 dead");
+    camera.decode_error_counter = registry.counter(
+        "cr_camera_decode_errors_total", labels,
+        "images that failed to convert or decode");
+    camera.repeated_counter = registry.counter(
+        "cr_camera_repeated_frames_total", labels,
+        "frames with the same stamp as the previous one");
+    camera.excluded_counter = registry.counter(
+        "cr_camera_excluded_cycles_total", labels,
+        "cycles the camera was left out of the batch as stale or dead");
+  }
+  status_pub_ =
+      pnh_.advertise<diagnostic_msgs::DiagnosticArray>("camera_health", 1, true);
+  return true;
+}
+
+void CameraHealth::frame_received(int camera, const ros::Time &stamp) {
+  if (camera < 0 || camera >= static_cast<int>(cameras_.size())) {
+    return;
+  }
+  Camera &c = *cameras_[camera];
+  // 驱动卡住时可能反复发布同一帧, 不能让它刷新存活时间
+  const int64_t stamp_ns = static_cast<int64_t>(stamp.toNSec());
+  if (stamp_ns != 0 &&
+      c.last_stamp_ns.exchange(stamp_ns, std::memory_order_relaxed) ==
+          stamp_ns) {
+    c.repeated.fetch_add(1, std::memory_order_relaxed);
+    c.repeated_counter->add();
+    return;
+  }
+  c.frames.fetch_add(1, std::memory_order_relaxed);
+  c.last_frame_us.store(CRMetrics::now_us(), std::memory_order_relaxed);
+}
+
+void CameraHealth::decode_error(int camera) {
+  if (camera < 0 || camera >= static_cast<int>(cameras_.size())) {
+    return;
+  }
+  cameras_[camera]->decode_errors.fetch_add(1, std::memory_order_relaxed);
+  cameras_[camera]->decode_error_counter->add();
+}
+
+CameraState CameraHealth::evaluate(const Camera &camera,
+                                   int64_t now_us) const {
+  const int64_t last_frame_us =
+      camera.last_frame_us.load(std::memory_order_relaxed);
+  if (last_frame_us == 0) {
+    return CameraState::kWaiting;
+  }
+  const double age_ms = (now_us - last_frame_us) / 1e3;
+  if (age_ms > dead_s_ * 1e3) {
+    return CameraState::kDead;
+  }
+  if (age_ms > stale_ms_) {
+    return CameraState::kStale;
+  }
+  if (static_cast<int>(camera.errors_in_window) >= max_decode_errors_) {
+    return CameraState::kDegraded;
+  }
+  // 恢复后的第一个统计周期帧数不完整, 等周期结束后再判断帧率
+  if (camera.expected_rate_hz > 0 && camera.rate_hz > 0 &&
+      camera.rate_hz < min_rate_ratio_ * camera.expected_rate_hz) {
+    return CameraState::kDegraded;
+  }
+  return CameraState::kAlive;
+}
+
+void CameraHealth::update(int64_t now_us) {
+  bool periodic = false;
+  if (window_begin_us_ == 0) {
+    window_begin_us_ = now_us;
+  } else if (now_us - window_begin_us_ >= period_s_ * 1e6) {
+    const double elapsed_s = (now_us - window_begin_us_) / 1e6;
+    for (auto &camera_ptr : cameras_) {
+      Camera &c = *camera_ptr;
+      const uint64_t frames = c.frames.load(std::memory_order_relaxed);
+      const uint64_t errors = c.decode_errors.load(std::memory_order_relaxed);
+      c.rate_hz = (frames - c.window_frames) / elapsed_s;
+      c.errors_in_window = errors - c.window_decode_errors;
+      c.window_frames = frames;
+      c.window_decode_errors = errors;
+    }
+    window_begin_us_ = now_us;
+    periodic = true;
+  }
+
+  bool changed = false;
+  for (auto &camera_ptr : cameras_) {
+    Camera &c = *camera_ptr;
+    const CameraState state = evaluate(c, now_us);
+    if (state != c.state) {
+      const bool was_usable =
+          c.state == CameraState::kAlive || c.state == CameraState::kDegraded;
+      const bool is_usable =
+          state == CameraState::kAlive || state == CameraState::kDegraded;
+      if (was_usable && !is_usable) {
+        ALOG_WARN_STREAM("[ CameraHealth ] " << c.name << " "
+                                             << camera_state_name(c.state)
+                                             << " -> "
+                                             << camera_state_name(state)
+                                             << ", excluded from detection");
+      } else {
+        ALOG_INFO_STREAM("[ CameraHealth ] " << c.name << " "
+                                             << camera_state_name(c.state)
+                                             << " -> "
+                                             << camera_state_name(state));
+      }
+      c.state = state;
+      c.state_gauge->set(static_cast<double>(state));
+      changed = true;
+    }
+    if (state == CameraState::kStale || state == CameraState::kDead) {
+      c.excluded_counter->add();
+    }
+  }
+  if (changed || periodic) {
+    publish_status(now_us);
+  }
+}
+
+bool CameraHealth::usable(int camera) const {
+  const CameraState state = cameras_[camera]->state;
+  return state == CameraState::kAlive || state == CameraState::kDegraded;
+}
+
+bool CameraHealth::take_resubscribe(int camera, int64_t now_us) {
+  Camera &c = *cameras_[camera];
+  if (c.state != CameraState::kDead ||
+      now_us - c.last_resubscribe_us < resubscribe_s_ * 1e6) {
+    return false;
+  }
+  c.last_resubscribe_us = now_us;
+  return true;
+}
+
+void CameraHealth::publish_status(int64_t now_us) {
+  diagnostic_msgs::DiagnosticArray array;
+  array.header.stamp = ros::Time::now();
+  for (const auto &camera_ptr : cameras_) {
+    const Camera &c = *camera_ptr;
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = "cr: camera health " + c.name;
+    status.hardware_id = c.name;
+    status.level = state_level(c.state);
+    status.message = camera_state_name(c.state);
+    const int64_t last_frame_us =
+        c.last_frame_us.load(std::memory_order_relaxed);
+    add_value(&status, "seconds since last frame",
+              last_frame_us > 0 ? (now_us - last_frame_us) / 1e6 : -1.0);
+    add_value(&status, "input rate (Hz)", c.rate_hz);
+    add_value(&status, "expected rate (Hz)", c.expected_rate_hz);
+    add_value(&status, "decode errors in period",
+              static_cast<double>(c.errors_in_window));
+    add_value(&status, "repeated frames",
+              static_cast<double>(c.repeated.load(std::memory_order_relaxed)));
+    array.status.push_back(status);
+  }
+  status_pub_.publish(array);
+}
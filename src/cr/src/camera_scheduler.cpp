@@ -0,0 +1,203 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 18:05:26
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 18:05:26
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/src/camera_scheduler.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <algorithm>
+#include <cmath>
+// local headers
+#include "cr/camera_scheduler.hpp"
+
+CameraScheduler::CameraScheduler(ros::NodeHandle pnh,
+                                 const std::vector<std::string> &camera_names,
+                                 double loop_rate_hz)
+    : pnh_(pnh), camera_names_(camera_names), loop_rate_hz_(loop_rate_hz) {
+  pnh_.param("schedule_load_ratio", load_ratio_, 0.8);
+  pnh_.param("schedule_probe_s", probe_s_, 5.0);
+}
+
+bool CameraScheduler::init() {
+  const int camera_num = static_cast<int>(camera_names_.size());
+  if (camera_num == 0 || loop_rate_hz_ <= 0) {
+    ROS_ERROR_STREAM("[ CameraScheduler ] no camera or invalid loop rate");
+    return false;
+  }
+  // 默认: 前向相机(0)最高优先级, 所有相机按循环频率检测
+  std::vector<int> priority(camera_num, 1);
+  priority[0] = 0;
+  std::vector<double> rate_hz(camera_num, loop_rate_hz_);
+  std::vector<double> deadline_ms(camera_num, 500.0);
+  deadline_ms[0] = 200.0;
+  pnh_.param("schedule_priority", priority, priority);
+  pnh_.param("schedule_rate_hz", rate_hz, rate_hz);
+  pnh_.param("schedule_deadline_ms", deadline_ms, deadline_ms);
+  if (static_cast<int>(priority.size()) != camera_num ||
+      static_cast<int>(rate_hz.size()) != camera_num ||
+      static_cast<int>(deadline_ms.size()) != camera_num) {
+    ROS_ERROR_STREAM("[ CameraScheduler ] schedule_priority/schedule_rate_hz/"
+                     "schedule_deadline_ms need "
+                     << camera_num << " values");
+    return false;
+  }
+  if (probe_s_ <= 0) {
+    ROS_ERROR_STREAM("[ CameraScheduler ] schedule_probe_s must be positive");
+    return false;
+  }
+  if (load_ratio_ <= 0 || load_ratio_ > 1) {
+    ROS_ERROR_STREAM("[ CameraScheduler ] schedule_load_ratio must be in (0, 1]");
+    return false;
+  }
+
+  MetricsRegistry &registry = MetricsRegistry::instance();
+  cameras_.resize(camera_num);
+  min_budget_ = 0;
+  for (int i = 0; i < camera_num; i++) {
+    CameraState &state = cameras_[i];
+    state.schedule.priority = priority[i];
+    state.schedule.rate_hz = rate_hz[i];
+    state.schedule.deadline_ms = deadline_ms[i];
+    if (rate_hz[i] <= 0 || deadline_ms[i] <= 0) {
+      ROS_ERROR_STREAM("[ CameraScheduler ] invalid schedule for camera : "
+                       << camera_names_[i]);
+      return false;
+    }
+    if (priority[i] == 0) {
+      ++min_budget_;
+    }
+    const MetricLabels labels = {{"camera", camera_names_[i]}};
+    state.skipped = registry.counter(
+        "cr_schedule_skipped_total", labels,
+        "due frames skipped because the detector is overloaded");
+    state.deadline_missed = registry.counter(
+        "cr_schedule_deadline_miss_total", labels,
+        "frames expected to finish detection after their deadline");
+  }
+  min_budget_ = std::max(min_budget_, 1);
+  budget_ = camera_num;
+  latency_us_.assign(camera_num + 1, 0.0);
+  probe_interval_ =
+      std::max(1, static_cast<int>(std::lround(probe_s_ * loop_rate_hz_)));
+  candidates_.reserve(camera_num);
+  budget_gauge_ = registry.gauge("cr_schedule_budget", {},
+                                 "cameras detected per cycle");
+  budget_gauge_->set(budget_);
+  return true;
+}
+
+void CameraScheduler::select(const ros::Time &now,
+                             const std_msgs::Header *headers,
+                             std::vector<int> *selected) {
+  selected->clear();
+  candidates_.clear();
+  // 允许半个循环周期的抖动, 否则与循环同频的相机会因为几毫秒的误差被跳过
+  const ros::Duration slack(0.5 / loop_rate_hz_);
+  for (int i = 0; i < static_cast<int>(cameras_.size()); i++) {
+    const CameraState &state = cameras_[i];
+    const std_msgs::Header &header = headers[i];
+    if (header.seq == 0 || header.seq == state.served_seq ||
+        now + slack < state.next_due) {
+      continue;
+    }
+    const ros::Time capture = header.stamp.isZero() ? now : header.stamp;
+    candidates_.push_back(
+        {i, capture + ros::Duration(state.schedule.deadline_ms / 1e3)});
+  }
+  std::sort(candidates_.begin(), candidates_.end(),
+            [this](const Candidate &a, const Candidate &b) {
+              const int pa = cameras_[a.camera].schedule.priority == 0 ? 0 : 1;
+              const int pb = cameras_[b.camera].schedule.priority == 0 ? 0 : 1;
+              if (pa != pb) {
+                return pa < pb;
+              }
+              if (a.deadline != b.deadline) {
+                return a.deadline < b.deadline;
+              }
+              return cameras_[a.camera].schedule.priority <
+                     cameras_[b.camera].schedule.priority;
+            });
+
+  const ros::Duration expected(estimate_us(budget_) / 1e6);
+  for (const Candidate &candidate : candidates_) {
+    CameraState &state = cameras_[candidate.camera];
+    const bool critical = state.schedule.priority == 0;
+    if (!critical && static_cast<int>(selected->size()) >= budget_) {
+      state.skipped->add();
+      continue;
+    }
+    if (now + expected > candidate.deadline) {
+      state.deadline_missed->add();
+    }
+    selected->push_back(candidate.camera);
+    state.served_seq = headers[candidate.camera].seq;
+    // 按目标频率推进, 落后太多时从当前时间重新计算, 不补检
+    const ros::Duration period(1.0 / state.schedule.rate_hz);
+    state.next_due = std::max(state.next_due + period, now);
+  }
+}
+
+void CameraScheduler::detect_done(int64_t latency_us, int batch_size) {
+  const int camera_num = static_cast<int>(cameras_.size());
+  if (batch_size <= 0 || batch_size > camera_num || latency_us <= 0) {
+    return;
+  }
+  double &ema = latency_us_[batch_size];
+  ema = ema == 0 ? static_cast<double>(latency_us)
+                 : 0.8 * ema + 0.2 * static_cast<double>(latency_us);
+  fit();
+
+  const double target_us = load_ratio_ * 1e6 / loop_rate_hz_;
+  int fit_budget = min_budget_;
+  while (fit_budget < camera_num && estimate_us(fit_budget + 1) <= target_us) {
+    ++fit_budget;
+  }
+  budget_ = std::min(fit_budget, camera_num);
+  // 只在 budget 以内检测时, 更大 batch 的耗时只能外推; 定期多检测一路取得真实样本
+  if (budget_ < camera_num && ++since_probe_ >= probe_interval_) {
+    since_probe_ = 0;
+    ++budget_;
+  }
+  budget_gauge_->set(budget_);
+}
+
+void CameraScheduler::fit() {
+  // 对各 batch 大小的平均耗时做最小二乘直线拟合: latency = fixed + per_image * n
+  double sum_n = 0, sum_y = 0, sum_nn = 0, sum_ny = 0;
+  int count = 0;
+  for (int n = 1; n < static_cast<int>(latency_us_.size()); n++) {
+    const double y = latency_us_[n];
+    if (y == 0) {
+      continue;
+    }
+    sum_n += n;
+    sum_y += y;
+    sum_nn += n * n;
+    sum_ny += n * y;
+    ++count;
+  }
+  if (count == 0) {
+    return;
+  }
+  const double mean_n = sum_n / count;
+  const double mean_y = sum_y / count;
+  const double var = sum_nn / count - mean_n * mean_n;
+  if (count == 1 || var <= 0) {
+    // 只有一种 batch 大小时无法区分固定开销, 按单帧平摊估计(对更大的 batch 偏保守)
+    fixed_us_ = 0;
+    per_image_us_ = mean_y / mean_n;
+    return;
+  }
+  per_image_us_ = std::max(0.0, (sum_ny / count - mean_n * mean_y) / var);
+  fixed_us_ = mean_y - per_image_us_ * mean_n;
+  if (fixed_us_ < 0) {
+    fixed_us_ = 0;
+    per_image_us_ = mean_y / mean_n;
+  }
+}
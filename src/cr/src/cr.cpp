@@ -13,24 +13,118 @@
 #include "cr/cr.hpp"
 
 bool CR::init() {
+  if (!logger_init()) {
+    ROS_ERROR_STREAM("[ CR ] logger_init failed");
+    return false;
+  }
+  // 回调中转换/解码的图像在 img[i] 和备用缓存之间循环, 释放后回到内存池
+  for (int i = 0; i < kCameraNum; i++) {
+    use_frame_pool(img[i]);
+    use_frame_pool(&spare_imgs_[i]);
+  }
+
   topic_list.push_back(make_pair(img_topic_, img_sub_));
   topic_list.push_back(make_pair(img_topic_1, img_sub_1));
   topic_list.push_back(make_pair(img_topic_2, img_sub_2));
   topic_list.push_back(make_pair(img_topic_3, img_sub_3));
 
+  TraceRecorder::instance().set_enabled(trace_enabled_);
+  TraceRecorder::instance().set_buffer_capacity(trace_buffer_size_);
+  trace_dump_sub_ =
+      pnh_.subscribe("dump_trace", 1, &CR::dump_trace_callback, this);
+
+  std::vector<std::string> camera_names;
+  for (const auto &topic : topic_list) {
+    camera_names.push_back(topic.first);
+  }
+  metrics_ptr_.reset(new CRMetrics(nh_, pnh_, camera_names));
+  if (!metrics_ptr_->init()) {
+    ROS_ERROR_STREAM("[ CR ] CR_metrics init failed");
+    return false;
+  }
+  if (health_enabled_) {
+    health_ptr_.reset(new CameraHealth(nh_, pnh_, camera_names));
+    if (!health_ptr_->init()) {
+      ROS_ERROR_STREAM("[ CR ] camera_health init failed");
+      return false;
+    }
+  }
+  if (schedule_enabled_) {
+    scheduler_ptr_.reset(
+        new CameraScheduler(pnh_, camera_names, loop_rate_hz_));
+    if (!scheduler_ptr_->init()) {
+      ROS_ERROR_STREAM("[ CR ] camera_scheduler init failed");
+      return false;
+    }
+  }
+  if (sync_enabled_) {
+    sync_ptr_.reset(new FrameSynchronizer(pnh_, camera_names));
+    if (!sync_ptr_->init()) {
+      ROS_ERROR_STREAM("[ CR ] frame_sync init failed");
+      return false;
+    }
+  }
+
+  if (record_enabled_) {
+    recorder_ptr_.reset(new CRRecorder(pnh_, camera_names));
+    if (!recorder_ptr_->init()) {
+      ROS_ERROR_STREAM("[ CR ] cr_recorder init failed");
+      return false;
+    }
+  }
+  if (event_enabled_) {
+    event_ptr_.reset(new EventRecorder(pnh_, camera_names));
+    if (!event_ptr_->init()) {
+      ROS_ERROR_STREAM("[ CR ] event_recorder init failed");
+      return false;
+    }
+  }
+
+  // 同步器缓存的是转换后的历史帧, 同步时仍在回调中转换
+  lazy_convert_ = fused_preprocess_ && !sync_enabled_;
   bool msgs_init_flag = msgs_sub_init();
-  std::cout << "msgs_init_flag: " << msgs_init_flag << std::endl;
+  ALOG_INFO_STREAM("[ CR ] msgs_init_flag : " << msgs_init_flag);
   if (!msgs_init_flag) {
     ROS_ERROR_STREAM("[ CR ] msgs_sub_init failed");
     return false;
   }
 
-  detector_ptr_.reset(new TLDDetector(cr_detector_weight_path_));
+  if (cr_screen_weight_path_.empty()) {
+    detector_ptr_ =
+        TLDDetector::create(cr_detector_weight_path_, detector_cpu_threads_);
+  } else {
+    detector_ptr_ = CascadeDetector::create(
+        cr_screen_weight_path_, cr_detector_weight_path_,
+        detector_cpu_threads_, cascade_options_);
+  }
+  if (!detector_ptr_) {
+    ROS_ERROR_STREAM("[ CR ] no detector for " << cr_detector_weight_path_);
+    return false;
+  }
+  if (!inference_server_.empty()) {
+    detector_ptr_->use_inference_server(inference_server_,
+                                        inference_timeout_ms_);
+  }
   bool cr_detector_flag = detector_ptr_->init();
   if (!cr_detector_flag) {
     ROS_ERROR_STREAM("[ CR ] CR_detector init failed");
     return false;
   }
+  if (roi_mask_enabled_) {
+    if (static_cast<int>(camera_ids_.size()) != kCameraNum) {
+      ROS_ERROR_STREAM("[ CR ] roi_mask_enabled needs " << kCameraNum
+                                                        << " camera_ids");
+      return false;
+    }
+    if (!load_roi_masks(camera_config_path_, camera_ids_, &roi_masks_)) {
+      ROS_ERROR_STREAM("[ CR ] load roi masks failed : "
+                       << camera_config_path_);
+      return false;
+    }
+    for (const RoiMask &mask : roi_masks_) {
+      roi_mask_ptrs_.push_back(&mask);
+    }
+  }
 
   postprocess_ptr_.reset(new CRPostProcess(nh_, pnh_));
   bool postprocess_flag = postprocess_ptr_->init();
@@ -46,7 +140,12 @@ bool CR::init() {
     return false;
   }
 
-  zmq_publish.reset(new ZeroMQPublisher(zmq_pub_topic_, zmq_pub_port_));
+  if (!parse_send_policy(zmq_send_policy_, &zmq_pub_options_.send_policy)) {
+    ROS_ERROR_STREAM("[ CR ] unknown zmq_send_policy : " << zmq_send_policy_);
+    return false;
+  }
+  zmq_publish.reset(
+      new ZeroMQPublisher(zmq_pub_topic_, zmq_pub_port_, zmq_pub_options_));
   bool zmq_publish_flag = zmq_publish->init();
   if (!zmq_publish_flag) {
     ROS_ERROR_STREAM("[ CR ] zmq_publish init failed");
@@ -59,102 +158,499 @@ bool CR::init() {
 void CR::start() {
   ros::Rate loop_rate(loop_rate_hz_);
 
-  bool cr_detector_ret = false;
+  TRACE_THREAD_NAME("cr_loop");
   while (nh_.ok()) {
+    TRACE_SCOPE("cycle");
+    const int64_t cycle_begin_us = CRMetrics::now_us();
     bool someone = false;
-    std::vector<std::vector<cr_object>> detected_objects(BATCH_SIZE);
-    std::vector<cr_result> result(BATCH_SIZE);
-    std::vector<cv::Mat> temp;
-    // cv::Mat img_front = locked_img_.clone();
-    // cv::Mat img_back = locked_img_1.clone();
-    // cv::Mat img_left = locked_img_2.clone();
-    // cv::Mat img_right = locked_img_3.clone();
-    temp.push_back(locked_img_);
-    temp.push_back(locked_img_1);
-    temp.push_back(locked_img_2);
-    temp.push_back(locked_img_3);
-
-    if (img_updated_ || img_updated_1 || img_updated_2 || img_updated_3) {
-      std::cout << img_updated_ << img_updated_1 << img_updated_2
-                << img_updated_3 << std::endl;
-      cr_detector_ret = detector_ptr_->detect(temp, &detected_objects);
-      if (cr_detector_ret) {
-        for (int i = 0; i < BATCH_SIZE; i++) {
-          result[i].object = detected_objects[i];
-          postprocess_ptr_->process(&result[i], i);
-        }
+    begin_cycle();
+    std::vector<cr_result> &result = cycle_.result;
+    std::vector<cv::Mat> &temp = cycle_.frames;
+    bool fresh[kCameraNum];
+    std_msgs::Header *headers = cycle_.headers;
+    if (health_ptr_) {
+      check_health();
+    }
+    const bool collected = collect_frames(fresh);
+    for (int i = 0; i < kCameraNum; i++) {
+      result[i].stamp = headers[i].stamp;
+      result[i].seq = headers[i].seq;
+      result[i].frame_id = headers[i].frame_id;
+      if (fresh[i]) {
+        metrics_ptr_->frame_consumed(i, headers[i].stamp);
+      }
+    }
+
+    if (!collected) {
+      // 等待同步的周期不检测, 沿用上一次的结果
+      for (int i = 0; i < kCameraNum; i++) {
+        result[i] = last_result_[i];
+      }
+    } else if (img_updated_ || img_updated_1 || img_updated_2 ||
+               img_updated_3) {
+      ALOG_DEBUG_STREAM_THROTTLE(1.0, "[ CR ] image updated : "
+                                          << img_updated_ << img_updated_1
+                                          << img_updated_2 << img_updated_3);
+      if (scheduler_ptr_) {
+        detect_scheduled(fresh);
+      } else {
+        detect_all(fresh);
       }
     } else {
-      std::cout << "no image" << std::endl;
+      ALOG_WARN_STREAM_THROTTLE(5.0, "[ CR ] no image");
+    }
+    if (recorder_ptr_) {
+      TRACE_SCOPE("record");
+      recorder_ptr_->record(result, temp);
     }
-    for (int i = 0; i < BATCH_SIZE; i++) {
-      cr_send_result_ptr_->send_result(temp[i], result[i], i, someone);
+    if (event_ptr_) {
+      event_ptr_->add(result, temp, fresh);
+    }
+    const int64_t publish_begin_us = CRMetrics::now_us();
+    {
+      TRACE_SCOPE("send_results");
+      cr_send_result_ptr_->send_results(temp, result, someone);
     }
     std::string people;
-    if (someone) {
-      zmq_publish->publish_str(std::string("yes"));
-    } else {
-      zmq_publish->publish_str(std::string("no"));
+    {
+      TRACE_SCOPE("zmq_publish");
+      const std::string decision = someone ? "yes" : "no";
+      if (zmq_stamp_frame_) {
+        zmq_publish->publish_str(decision, stamp_frame(result));
+      } else {
+        zmq_publish->publish_str(decision);
+      }
+    }
+    // 只统计本周期新取走的帧, 重复使用的旧帧会把帧龄拉长
+    for (int i = 0; i < kCameraNum; i++) {
+      if (fresh[i]) {
+        metrics_ptr_->frame_age(i, CRMetrics::kPublished, headers[i].stamp);
+      }
     }
+    metrics_ptr_->publish_done(CRMetrics::now_us() - publish_begin_us);
+    metrics_ptr_->cycle_done(CRMetrics::now_us() - cycle_begin_us);
+    end_cycle();
     ros::spinOnce();
+    TRACE_SCOPE("sleep");
     loop_rate.sleep();
   }
 
   return;
 }
 
-bool CR::msgs_sub_init() {
-  for (int i = 0; i < BATCH_SIZE; i++) {
-    std::vector<std::string> v;
-    split_string(topic_list[i].first, &v, "/");
-    if (v.back() == "compressed") {
-      topic_list[i].second = nh_.subscribe<sensor_msgs::CompressedImage>(
-          topic_list[i].first, 1,
-          boost::bind(&CR::receive_compressed_img_callback, this, _1, img[i],
-                      flag[i], key[i]));
-    } else {
-      topic_list[i].second = nh_.subscribe<sensor_msgs::Image>(
-          topic_list[i].first, 1,
-          boost::bind(&CR::receive_raw_img_callback, this, _1, img[i], flag[i],
-                      key[i]));
+bool CR::logger_init() {
+  LogLevel level;
+  if (!parse_log_level(log_level_, &level)) {
+    ROS_ERROR_STREAM("[ CR ] unknown log_level : " << log_level_);
+    return false;
+  }
+  AsyncLogger::instance().set_level(level);
+  if (log_to_rosout_) {
+    // rosconsole 自己加时间和级别, 只转发原始文本
+    AsyncLogger::instance().set_sink(
+        [](const LogRecord &record, const std::string &) {
+          switch (record.level) {
+          case LogLevel::kDebug:
+            ROS_DEBUG_STREAM(record.text);
+            break;
+          case LogLevel::kInfo:
+            ROS_INFO_STREAM(record.text);
+            break;
+          case LogLevel::kWarn:
+            ROS_WARN_STREAM(record.text);
+            break;
+          case LogLevel::kError:
+            ROS_ERROR_STREAM(record.text);
+            break;
+          default:
+            ROS_FATAL_STREAM(record.text);
+            break;
+          }
+        });
+  }
+  return true;
+}
+
+bool CR::collect_frames(bool *fresh) {
+  TRACE_SCOPE("collect_frames");
+  std::vector<cv::Mat> &temp = cycle_.frames;
+  std::vector<sensor_msgs::ImageConstPtr> &msgs = cycle_.msgs;
+  std_msgs::Header *headers = cycle_.headers;
+  if (sync_ptr_) {
+    std::fill(fresh, fresh + kCameraNum, false);
+    return sync_ptr_->collect(ros::Time::now(), &temp,
+                              fused_preprocess_ ? &msgs : nullptr, headers,
+                              fresh);
+  }
+  // 图像和对应的原始消息需要在同一次加锁中取出, 保证尺寸一致
+  for (int i = 0; i < kCameraNum; i++) {
+    if (health_ptr_ && !health_ptr_->usable(i)) {
+      temp[i].release();
+      msgs[i].reset();
+      headers[i] = std_msgs::Header();
+      fresh[i] = false;
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(*key[i]);
+    temp[i] = *img[i];
+    if (fused_preprocess_) {
+      msgs[i] = locked_msgs_[i];
+    }
+    fresh[i] = img_fresh_[i];
+    headers[i] = locked_headers_[i];
+    img_fresh_[i] = false;
+  }
+  return true;
+}
+
+void CR::check_health() {
+  const int64_t now_us = CRMetrics::now_us();
+  health_ptr_->update(now_us);
+  for (int i = 0; i < kCameraNum; i++) {
+    const bool usable = health_ptr_->usable(i);
+    if (sync_ptr_) {
+      sync_ptr_->set_enabled(i, usable);
+    }
+    if (!usable) {
+      // 旧帧和旧结果都不再输出, 收到新帧后由回调重新置位
+      {
+        std::lock_guard<std::mutex> lock(*key[i]);
+        *flag[i] = false;
+      }
+      last_result_[i] = cr_result();
+    }
+    if (health_ptr_->take_resubscribe(i, now_us)) {
+      ALOG_WARN_STREAM("[ CR ] no frame from " << topic_list[i].first
+                                               << ", resubscribing");
+      subscribe(i);
+    }
+  }
+}
+
+bool CR::detect_scheduled(bool *fresh) {
+  std::vector<cr_result> &result = cycle_.result;
+  std::vector<int> &selected = cycle_.selected;
+  scheduler_ptr_->select(ros::Time::now(), cycle_.headers, &selected);
+  // 转换失败的相机从 batch 中去掉, 沿用上一次的结果
+  int n = 0;
+  for (size_t k = 0; k < selected.size(); k++) {
+    const int cam = selected[k];
+    if (!convert_frame(cam)) {
+      continue;
+    }
+    selected[n] = cam;
+    cycle_.batch_frames[n] = cycle_.frames[cam];
+    cycle_.batch_msgs[n] = cycle_.msgs[cam];
+    cycle_.batch_masks[n] =
+        roi_mask_ptrs_.empty() ? nullptr : roi_mask_ptrs_[cam];
+    n++;
+  }
+  selected.resize(n);
+
+  bool ret = false;
+  if (n > 0) {
+    TRACE_SCOPE_ARG("detect", n);
+    const int64_t detect_begin_us = CRMetrics::now_us();
+    ret = detector_ptr_->detect(cycle_.batch_frames, cycle_.batch_msgs,
+                                cycle_.batch_masks, &cycle_.batch_objects, n);
+    const int64_t latency_us = CRMetrics::now_us() - detect_begin_us;
+    metrics_ptr_->inference_done(latency_us);
+    scheduler_ptr_->detect_done(latency_us, n);
+  }
+
+  bool detected[kCameraNum] = {false, false, false, false};
+  if (ret) {
+    for (int k = 0; k < n; k++) {
+      const int cam = selected[k];
+      TRACE_SCOPE_ARG("cr_postprocess", cam);
+      metrics_ptr_->frame_age(cam, CRMetrics::kDetected,
+                              cycle_.headers[cam].stamp);
+      metrics_ptr_->detections(cam, cycle_.batch_objects[k].size());
+      result[cam].object = cycle_.batch_objects[k];
+      postprocess_ptr_->process(&result[cam], cam);
+      last_result_[cam] = result[cam];
+      detected[cam] = true;
     }
   }
+  for (int i = 0; i < kCameraNum; i++) {
+    if (!detected[i]) {
+      // 沿用上一次的结果和它的时间戳/帧序号
+      result[i] = last_result_[i];
+    }
+  }
+  release_undetected(detected, kCameraNum, &cycle_.frames, fresh);
+  return ret;
+}
+
+bool CR::detect_all(bool *fresh) {
+  std::vector<cr_result> &result = cycle_.result;
+  // 只检测有新帧的相机, 已经取走过的帧检测结果不会变化
+  std::vector<int> &selected = cycle_.selected;
+  select_fresh(fresh, kCameraNum, [this](int i) { return convert_frame(i); },
+               &selected);
+  const int n = static_cast<int>(selected.size());
+  for (int k = 0; k < n; k++) {
+    const int cam = selected[k];
+    cycle_.batch_frames[k] = cycle_.frames[cam];
+    cycle_.batch_msgs[k] = cycle_.msgs[cam];
+    cycle_.batch_masks[k] =
+        roi_mask_ptrs_.empty() ? nullptr : roi_mask_ptrs_[cam];
+  }
+
+  bool ret = false;
+  if (n > 0) {
+    TRACE_SCOPE_ARG("detect", n);
+    const int64_t detect_begin_us = CRMetrics::now_us();
+    ret = detector_ptr_->detect(cycle_.batch_frames, cycle_.batch_msgs,
+                                cycle_.batch_masks, &cycle_.batch_objects, n);
+    metrics_ptr_->inference_done(CRMetrics::now_us() - detect_begin_us);
+  }
+
+  bool detected[kCameraNum] = {false, false, false, false};
+  if (ret) {
+    for (int k = 0; k < n; k++) {
+      const int cam = selected[k];
+      TRACE_SCOPE_ARG("cr_postprocess", cam);
+      metrics_ptr_->frame_age(cam, CRMetrics::kDetected,
+                              cycle_.headers[cam].stamp);
+      metrics_ptr_->detections(cam, cycle_.batch_objects[k].size());
+      result[cam].object = cycle_.batch_objects[k];
+      postprocess_ptr_->process(&result[cam], cam);
+      last_result_[cam] = result[cam];
+      detected[cam] = true;
+    }
+  }
+  for (int i = 0; i < kCameraNum; i++) {
+    if (!detected[i]) {
+      // 旧帧, 同步器丢弃的相机和检测失败时沿用上一次的结果
+      result[i] = last_result_[i];
+    }
+  }
+  release_undetected(detected, kCameraNum, &cycle_.frames, fresh);
+  return ret;
+}
+
+bool CR::convert_frame(int i) {
+  cv::Mat &frame = cycle_.frames[i];
+  const sensor_msgs::ImageConstPtr &msg = cycle_.msgs[i];
+  if (!lazy_convert_ || !frame.empty() || !msg) {
+    return !frame.empty();
+  }
+  TRACE_SCOPE_ARG("convert", i);
+  try {
+    if (!plans_[i].matches(msg->encoding)) {
+      plans_[i] = cv_bridge::ConversionPlan(msg->encoding,
+                                            sensor_msgs::image_encodings::BGR8);
+    }
+    // 上一周期的帧在 end_cycle 释放, 只有录像/事件还持有时才重新分配
+    reclaim_spare(&spare_imgs_[i]);
+    plans_[i].convert(*msg, spare_imgs_[i]);
+    frame = spare_imgs_[i];
+    return true;
+  } catch (cv_bridge::Exception &e) {
+    ALOG_ERROR_STREAM_THROTTLE(1.0, "[ CR ] cant't get image : " << e.what());
+  } catch (const cv::Exception &e) {
+    ALOG_ERROR_STREAM_THROTTLE(1.0, "[ CR ] convert failed : " << e.what());
+  }
+  if (health_ptr_) {
+    health_ptr_->decode_error(i);
+  }
+  frame.release();
+  return false;
+}
+
+void CR::begin_cycle() {
+  if (cycle_.result.size() != kCameraNum) {
+    cycle_.result.resize(kCameraNum);
+    cycle_.frames.resize(kCameraNum);
+    cycle_.msgs.resize(kCameraNum);
+    cycle_.selected.reserve(kCameraNum);
+    cycle_.batch_frames.resize(kCameraNum);
+    cycle_.batch_msgs.resize(kCameraNum);
+    cycle_.batch_masks.resize(kCameraNum);
+    cycle_.batch_objects.resize(kCameraNum);
+  }
+  for (int i = 0; i < kCameraNum; i++) {
+    cycle_.batch_objects[i].clear();
+  }
+  for (int i = 0; i < kCameraNum; i++) {
+    cr_result &r = cycle_.result[i];
+    r.object.clear();
+    r.someone = false;
+    r.stamp = ros::Time();
+    r.seq = 0;
+    r.frame_id.clear();
+  }
+}
+
+void CR::end_cycle() {
+  // 检测循环持有 img[i] 的引用时, 回调中的备用缓存会被重新分配
+  for (int i = 0; i < kCameraNum; i++) {
+    cycle_.frames[i].release();
+    cycle_.msgs[i].reset();
+    cycle_.batch_frames[i].release();
+    cycle_.batch_msgs[i].reset();
+  }
+}
+
+bool CR::msgs_sub_init() {
+  for (int i = 0; i < kCameraNum; i++) {
+    subscribe(i);
+  }
   ros::AsyncSpinner s(4);
   s.start();
   return true;
 }
 
+void CR::subscribe(int i) {
+  // 先断开旧的订阅, 发布端重启后连接卡住时重新建立
+  topic_list[i].second.shutdown();
+  std::vector<std::string> v;
+  split_string(topic_list[i].first, &v, "/");
+  if (v.back() == "compressed") {
+    topic_list[i].second = nh_.subscribe<sensor_msgs::CompressedImage>(
+        topic_list[i].first, 1,
+        boost::bind(&CR::receive_compressed_img_callback, this, _1, i, img[i],
+                    flag[i], key[i], &spare_imgs_[i]));
+  } else {
+    topic_list[i].second = nh_.subscribe<sensor_msgs::Image>(
+        topic_list[i].first, 1,
+        boost::bind(&CR::receive_raw_img_callback, this, _1, i, img[i],
+                    &locked_msgs_[i], flag[i], key[i], &plans_[i],
+                    &spare_imgs_[i]));
+  }
+}
+
+void CR::reclaim_spare(cv::Mat *spare) {
+  // 检测循环只会从 img[i] 增加引用, 这里读到的引用计数只可能偏大.
+  // 其他线程通过 CV_XADD 修改 refcount, 这里也用原子加 0 读取
+  if (spare->u != nullptr && CV_XADD(&spare->u->refcount, 0) > 1) {
+    spare->release();
+  }
+}
+
 void CR::receive_raw_img_callback(const sensor_msgs::ImageConstPtr &img_msg,
-                                  cv::Mat *get_img, bool *flag,
-                                  std::mutex *key) {
+                                  int index, cv::Mat *get_img,
+                                  sensor_msgs::ImageConstPtr *get_msg,
+                                  bool *flag, std::mutex *key,
+                                  cv_bridge::ConversionPlan *plan,
+                                  cv::Mat *spare) {
+  TRACE_SCOPE_ARG("raw_img_callback", index);
   try {
-    cv_bridge::CvImagePtr cv_ptr_img =
-        cv_bridge::toCvCopy(img_msg, sensor_msgs::image_encodings::BGR8);
+    // lazy_convert_ 时只保存消息, img[i] 保持为空, 由检测循环按需转换
+    if (!lazy_convert_) {
+      if (!plan->matches(img_msg->encoding)) {
+        *plan = cv_bridge::ConversionPlan(img_msg->encoding,
+                                          sensor_msgs::image_encodings::BGR8);
+      }
+      reclaim_spare(spare);
+      plan->convert(*img_msg, *spare);
+    }
     key->lock();
-    *get_img = cv_ptr_img->image;
+    if (!lazy_convert_) {
+      cv::swap(*get_img, *spare);
+    }
+    *get_msg = img_msg;
     *flag = true;
+    bool overwritten = store_header(index, img_msg->header);
+    const cv::Mat frame = *get_img;
+    const std_msgs::Header header = locked_headers_[index];
     key->unlock();
+    // 同步器持有历史帧的引用, 备用缓存会被 reclaim_spare 释放回内存池
+    if (sync_ptr_) {
+      overwritten = sync_ptr_->add(index, frame, img_msg, header);
+    }
+    if (health_ptr_) {
+      health_ptr_->frame_received(index, img_msg->header.stamp);
+    }
+    metrics_ptr_->frame_received(index, overwritten);
+    metrics_ptr_->frame_age(index, CRMetrics::kReceived, img_msg->header.stamp);
 
   } catch (cv_bridge::Exception &e) {
-    std::cout << "cant't get image" << std::endl;
-    ROS_ERROR_STREAM("cant't get image");
+    if (health_ptr_) {
+      health_ptr_->decode_error(index);
+    }
+    ALOG_ERROR_STREAM_THROTTLE(1.0, "[ CR ] cant't get image : " << e.what());
+  } catch (const cv::Exception &e) {
+    if (health_ptr_) {
+      health_ptr_->decode_error(index);
+    }
+    ALOG_ERROR_STREAM_THROTTLE(1.0, "[ CR ] convert failed : " << e.what());
   }
   return;
 }
 
 void CR::receive_compressed_img_callback(
-    const sensor_msgs::CompressedImageConstPtr &img_msg, cv::Mat *get_img,
-    bool *flag, std::mutex *key) {
+    const sensor_msgs::CompressedImageConstPtr &img_msg, int index,
+    cv::Mat *get_img, bool *flag, std::mutex *key, cv::Mat *spare) {
+  TRACE_SCOPE_ARG("compressed_img_callback", index);
+  if (img_msg->data.empty()) {
+    if (health_ptr_) {
+      health_ptr_->decode_error(index);
+    }
+    ALOG_ERROR_STREAM_THROTTLE(
+        1.0, "[ CR ] cant't get image : empty compressed image");
+    return;
+  }
+  reclaim_spare(spare);
+  // 解码结果直接是BGR8, 尺寸不变时复用备用缓存
+  const cv::Mat buf(1, static_cast<int>(img_msg->data.size()), CV_8UC1,
+                    const_cast<uint8_t *>(img_msg->data.data()));
+  // 损坏的 jpeg 可能抛出 cv::Exception, 不能让异常离开 ros 回调
   try {
-    cv_bridge::CvImagePtr cv_ptr_compressed =
-        cv_bridge::toCvCopy(img_msg, sensor_msgs::image_encodings::BGR8);
-    key->lock();
-    *get_img = cv_ptr_compressed->image;
-    *flag = true;
-    key->unlock();
-  } catch (cv_bridge::Exception &e) {
-    std::cout << "cant't get image" << std::endl;
-    ROS_ERROR_STREAM("cant't get image");
+    cv::imdecode(buf, cv::IMREAD_COLOR, spare);
+  } catch (const cv::Exception &e) {
+    spare->release();
+    ALOG_ERROR_STREAM_THROTTLE(1.0, "[ CR ] imdecode failed : " << e.what());
+  }
+  if (spare->empty()) {
+    if (health_ptr_) {
+      health_ptr_->decode_error(index);
+    }
+    ALOG_ERROR_STREAM_THROTTLE(1.0, "[ CR ] cant't get image : decode failed");
+    return;
+  }
+  key->lock();
+  cv::swap(*get_img, *spare);
+  *flag = true;
+  bool overwritten = store_header(index, img_msg->header);
+  const cv::Mat frame = *get_img;
+  const std_msgs::Header header = locked_headers_[index];
+  key->unlock();
+  if (sync_ptr_) {
+    overwritten = sync_ptr_->add(index, frame, nullptr, header);
   }
+  if (health_ptr_) {
+    health_ptr_->frame_received(index, img_msg->header.stamp);
+  }
+  metrics_ptr_->frame_received(index, overwritten);
+  metrics_ptr_->frame_age(index, CRMetrics::kReceived, img_msg->header.stamp);
   return;
-}
\ No newline at end of file
+}
+
+bool CR::store_header(int index, const std_msgs::Header &header) {
+  const bool overwritten = img_fresh_[index];
+  img_fresh_[index] = true;
+  locked_headers_[index] = header;
+  // 相机驱动的seq不可靠(发布端可能不填或重启后归零), 由 CR 统一编号
+  locked_headers_[index].seq = ++frame_seq_[index];
+  return overwritten;
+}
+
+std::string CR::stamp_frame(const std::vector<cr_result> &result) const {
+  std::ostringstream ss;
+  ss << ros::Time::now();
+  for (const auto &r : result) {
+    ss << " " << r.seq << "@" << r.stamp;
+  }
+  return ss.str();
+}
+
+void CR::dump_trace_callback(const std_msgs::StringConstPtr &msg) {
+  const std::string path = msg->data.empty() ? trace_dump_path_ : msg->data;
+  if (!TraceRecorder::instance().dump_chrome_trace(path)) {
+    ROS_ERROR_STREAM("[ CR ] dump trace failed, path : " << path);
+    return;
+  }
+  ROS_INFO_STREAM("[ CR ] trace dumped to " << path);
+}
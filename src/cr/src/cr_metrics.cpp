@@ -0,0 +1,298 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 15:40:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 15:40:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/src/cr_metrics.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+// local headers
+#include "cr/cr_metrics.hpp"
+
+void add_value(diagnostic_msgs::DiagnosticStatus *status, const std::string &key,
+               double value) {
+  diagnostic_msgs::KeyValue kv;
+  kv.key = key;
+  std::ostringstream ss;
+  ss.precision(4);
+  ss << value;
+  kv.value = ss.str();
+  status->values.push_back(kv);
+}
+
+namespace {
+
+void raise_level(diagnostic_msgs::DiagnosticStatus *status, uint8_t level,
+                 const std::string &message) {
+  if (level > status->level) {
+    status->level = level;
+    status->message = message;
+  }
+}
+
+} // namespace
+
+CRMetrics::CRMetrics(ros::NodeHandle nh, ros::NodeHandle pnh,
+                     const std::vector<std::string> &camera_names)
+    : nh_(nh), pnh_(pnh) {
+  pnh_.param("metrics_period_s", period_s_, 1.0);
+  pnh_.param("metrics_min_rate_hz", min_rate_hz_, 5.0);
+  pnh_.param("metrics_stale_timeout_s", stale_timeout_s_, 2.0);
+  pnh_.param("metrics_max_frame_age_ms", max_frame_age_ms_, 500.0);
+  pnh_.param("metrics_prometheus_path", prometheus_path_, std::string(""));
+
+  MetricsRegistry &registry = MetricsRegistry::instance();
+  for (size_t i = 0; i < camera_names.size(); ++i) {
+    const MetricLabels labels = {{"camera", camera_names[i]}};
+    std::unique_ptr<CameraMetrics> camera(new CameraMetrics());
+    camera->name = camera_names[i];
+    camera->received = registry.counter("cr_frames_received_total", labels,
+                                        "frames received from the camera");
+    camera->overwritten =
+        registry.counter("cr_frames_overwritten_total", labels,
+                         "frames replaced before the detector consumed them");
+    camera->consumed = registry.counter("cr_frames_consumed_total", labels,
+                                        "frames passed to the detector");
+    camera->rate_hz = registry.gauge("cr_input_rate_hz", labels,
+                                     "camera input rate over the last period");
+    for (int stage = 0; stage < kNumStages; ++stage) {
+      MetricLabels stage_labels = labels;
+      stage_labels.emplace_back("stage", stage_name(static_cast<Stage>(stage)));
+      camera->frame_age_us[stage] = registry.histogram(
+          "cr_frame_age_us", stage_labels,
+          "capture stamp to each pipeline stage, microseconds");
+    }
+    camera->detections = registry.histogram(
+        "cr_detections_per_frame", labels, "detections per consumed frame");
+    cameras_.push_back(std::move(camera));
+  }
+  inference_us_ = registry.histogram("cr_inference_latency_us", {},
+                                     "detector latency per batch");
+  publish_us_ = registry.histogram("cr_publish_latency_us", {},
+                                   "ROS and ZeroMQ publish latency per cycle");
+  cycle_us_ = registry.histogram("cr_cycle_latency_us", {},
+                                 "detection cycle latency without sleep");
+  pool_allocations_ = registry.gauge("cr_frame_pool_allocations", {},
+                                     "image buffers allocated by the frame pool");
+  pool_in_use_bytes_ = registry.gauge("cr_frame_pool_in_use_bytes", {},
+                                      "frame pool memory held by images");
+  pool_cached_bytes_ = registry.gauge("cr_frame_pool_cached_bytes", {},
+                                      "free memory kept by the frame pool");
+}
+
+bool CRMetrics::init() {
+  if (period_s_ <= 0) {
+    ROS_ERROR_STREAM("[ CRMetrics ] metrics_period_s must be positive");
+    return false;
+  }
+  diagnostics_pub_ =
+      nh_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+  last_diagnostics_us_ = now_us();
+  timer_ = nh_.createWallTimer(ros::WallDuration(period_s_),
+                               &CRMetrics::publish_diagnostics, this);
+  return true;
+}
+
+int64_t CRMetrics::now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+const char *CRMetrics::stage_name(Stage stage) {
+  switch (stage) {
+  case kReceived:
+    return "received";
+  case kDetectorInput:
+    return "detector_input";
+  case kDetected:
+    return "detected";
+  case kPublished:
+    return "published";
+  default:
+    return "unknown";
+  }
+}
+
+void CRMetrics::frame_received(int camera, bool overwritten) {
+  if (camera < 0 || camera >= static_cast<int>(cameras_.size())) {
+    return;
+  }
+  CameraMetrics &c = *cameras_[camera];
+  c.received->add();
+  if (overwritten) {
+    c.overwritten->add();
+  }
+  c.last_frame_us.store(now_us(), std::memory_order_relaxed);
+}
+
+void CRMetrics::frame_consumed(int camera, const ros::Time &stamp) {
+  if (camera < 0 || camera >= static_cast<int>(cameras_.size())) {
+    return;
+  }
+  cameras_[camera]->consumed->add();
+  frame_age(camera, kDetectorInput, stamp);
+}
+
+int64_t CRMetrics::frame_age(int camera, Stage stage, const ros::Time &stamp) {
+  // 相机未填时间戳时无法计算帧龄
+  if (camera < 0 || camera >= static_cast<int>(cameras_.size()) ||
+      stage < 0 || stage >= kNumStages || stamp.isZero()) {
+    return -1;
+  }
+  const double age_s = (ros::Time::now() - stamp).toSec();
+  // 与相机时钟不同步时可能为负, 按0记录
+  const int64_t age_us = age_s > 0 ? static_cast<int64_t>(age_s * 1e6) : 0;
+  cameras_[camera]->frame_age_us[stage]->record(age_us);
+  return age_us;
+}
+
+void CRMetrics::detections(int camera, size_t count) {
+  if (camera < 0 || camera >= static_cast<int>(cameras_.size())) {
+    return;
+  }
+  cameras_[camera]->detections->record(count);
+}
+
+void CRMetrics::inference_done(int64_t latency_us) {
+  inference_us_->record(latency_us > 0 ? latency_us : 0);
+}
+
+void CRMetrics::publish_done(int64_t latency_us) {
+  publish_us_->record(latency_us > 0 ? latency_us : 0);
+}
+
+void CRMetrics::cycle_done(int64_t latency_us) {
+  cycle_us_->record(latency_us > 0 ? latency_us : 0);
+}
+
+void CRMetrics::add_latency_values(
+    const std::string &prefix, const HistogramSnapshot &window,
+    diagnostic_msgs::DiagnosticStatus *status) const {
+  add_value(status, prefix + " p50 (ms)", window.percentile(0.5) / 1e3);
+  add_value(status, prefix + " p95 (ms)", window.percentile(0.95) / 1e3);
+  add_value(status, prefix + " p99 (ms)", window.percentile(0.99) / 1e3);
+  add_value(status, prefix + " max (ms)", window.max / 1e3);
+}
+
+void CRMetrics::publish_diagnostics(const ros::WallTimerEvent &) {
+  const int64_t now = now_us();
+  const double elapsed_s =
+      std::max<int64_t>(now - last_diagnostics_us_, 1) / 1e6;
+  last_diagnostics_us_ = now;
+
+  diagnostic_msgs::DiagnosticArray array;
+  array.header.stamp = ros::Time::now();
+
+  for (auto &camera_ptr : cameras_) {
+    CameraMetrics &c = *camera_ptr;
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = "cr: camera " + c.name;
+    status.hardware_id = c.name;
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+
+    const uint64_t received = c.received->value();
+    const double rate = (received - c.last_received) / elapsed_s;
+    c.last_received = received;
+    c.rate_hz->set(rate);
+
+    HistogramSnapshot age_windows[kNumStages];
+    for (int stage = 0; stage < kNumStages; ++stage) {
+      const HistogramSnapshot age = c.frame_age_us[stage]->snapshot();
+      age_windows[stage] = age.since(c.last_frame_age[stage]);
+      c.last_frame_age[stage] = age;
+    }
+    const HistogramSnapshot &age_window = age_windows[kDetectorInput];
+    const HistogramSnapshot det = c.detections->snapshot();
+    const HistogramSnapshot det_window = det.since(c.last_detections);
+    c.last_detections = det;
+
+    const int64_t last_frame_us = c.last_frame_us.load(std::memory_order_relaxed);
+    const double since_last_s =
+        last_frame_us > 0 ? (now - last_frame_us) / 1e6 : -1.0;
+
+    std::ostringstream message;
+    message.precision(3);
+    message << rate << " Hz";
+    status.message = message.str();
+    if (last_frame_us == 0) {
+      raise_level(&status, diagnostic_msgs::DiagnosticStatus::ERROR,
+                  "no frame received");
+    } else if (since_last_s > stale_timeout_s_) {
+      raise_level(&status, diagnostic_msgs::DiagnosticStatus::ERROR,
+                  "no frame for " + std::to_string(since_last_s) + " s");
+    } else if (rate < min_rate_hz_) {
+      raise_level(&status, diagnostic_msgs::DiagnosticStatus::WARN,
+                  "low rate " + message.str());
+    }
+    if (age_window.count > 0 &&
+        age_window.percentile(0.99) / 1e3 > max_frame_age_ms_) {
+      raise_level(&status, diagnostic_msgs::DiagnosticStatus::WARN,
+                  "frames arrive late at the detector");
+    }
+
+    add_value(&status, "input rate (Hz)", rate);
+    add_value(&status, "seconds since last frame", since_last_s);
+    add_value(&status, "frames received",
+              static_cast<double>(received));
+    add_value(&status, "frames overwritten",
+              static_cast<double>(c.overwritten->value()));
+    add_value(&status, "frames consumed",
+              static_cast<double>(c.consumed->value()));
+    add_latency_values("frame age", age_window, &status);
+    add_latency_values("frame age at publish", age_windows[kPublished],
+                       &status);
+    add_value(&status, "detections per frame", det_window.mean());
+    array.status.push_back(status);
+  }
+
+  diagnostic_msgs::DiagnosticStatus pipeline;
+  pipeline.name = "cr: pipeline";
+  pipeline.hardware_id = "cr";
+  pipeline.level = diagnostic_msgs::DiagnosticStatus::OK;
+  pipeline.message = "OK";
+  const HistogramSnapshot inference = inference_us_->snapshot();
+  const HistogramSnapshot inference_window = inference.since(last_inference_);
+  last_inference_ = inference;
+  const HistogramSnapshot publish = publish_us_->snapshot();
+  const HistogramSnapshot publish_window = publish.since(last_publish_);
+  last_publish_ = publish;
+  const HistogramSnapshot cycle = cycle_us_->snapshot();
+  const HistogramSnapshot cycle_window = cycle.since(last_cycle_);
+  last_cycle_ = cycle;
+  if (inference_window.count == 0) {
+    raise_level(&pipeline, diagnostic_msgs::DiagnosticStatus::WARN,
+                "no inference in the last period");
+  }
+  add_value(&pipeline, "cycles", static_cast<double>(cycle_window.count));
+  add_latency_values("inference", inference_window, &pipeline);
+  add_latency_values("publish", publish_window, &pipeline);
+  add_latency_values("cycle", cycle_window, &pipeline);
+  const FramePoolStats pool = FramePool::instance().stats();
+  pool_allocations_->set(static_cast<double>(pool.allocations));
+  pool_in_use_bytes_->set(static_cast<double>(pool.in_use_bytes));
+  pool_cached_bytes_->set(static_cast<double>(pool.cached_bytes));
+  add_value(&pipeline, "frame pool allocations in period",
+            static_cast<double>(pool.allocations - last_pool_allocations_));
+  add_value(&pipeline, "frame pool reuses", static_cast<double>(pool.reuses));
+  add_value(&pipeline, "frame pool in use (MB)", pool.in_use_bytes / 1048576.0);
+  add_value(&pipeline, "frame pool cached (MB)", pool.cached_bytes / 1048576.0);
+  last_pool_allocations_ = pool.allocations;
+  array.status.push_back(pipeline);
+
+  diagnostics_pub_.publish(array);
+
+  if (!prometheus_path_.empty() &&
+      !MetricsRegistry::instance().write_prometheus(prometheus_path_)) {
+    ROS_WARN_STREAM_THROTTLE(60, "[ CRMetrics ] write prometheus file failed : "
+                                     << prometheus_path_);
+  }
+}
@@ -22,10 +22,10 @@ int main(int argc, char **argv) {
 
   if (cr.init()) {
     cr.start();
-    return 0;
   } else {
     ROS_ERROR_STREAM("[ main ] CR init failed");
-    return 0;
   }
+  // sink 可能转发到 rosout, 必须在 ros 关闭前写完并停止后台线程
+  AsyncLogger::instance().shutdown();
   return 0;
 }
\ No newline at end of file
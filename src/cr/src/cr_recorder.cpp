@@ -0,0 +1,210 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 21:46:02
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 21:46:02
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/src/cr_recorder.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <algorithm>
+#include <ctime>
+#include <limits>
+// third party headers
+// opencv
+#include "opencv2/imgcodecs.hpp"
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "common_utils/read_file_from_dir.hpp"
+#include "cr/cr_recorder.hpp"
+
+namespace {
+
+int16_t clamp_i16(int v) {
+  return static_cast<int16_t>(
+      std::min<int>(std::max<int>(v, std::numeric_limits<int16_t>::min()),
+                    std::numeric_limits<int16_t>::max()));
+}
+
+} // namespace
+
+CRRecorder::CRRecorder(ros::NodeHandle pnh,
+                       const std::vector<std::string> &camera_names)
+    : pnh_(pnh), camera_names_(camera_names) {}
+
+CRRecorder::~CRRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  writer_.close();
+}
+
+bool CRRecorder::init() {
+  pnh_.param("record_dir", dir_, dir_);
+  pnh_.param("record_max_file_mb", max_file_mb_, max_file_mb_);
+  pnh_.param("record_rows_per_block", rows_per_block_, rows_per_block_);
+  pnh_.param("record_index_interval", index_interval_, index_interval_);
+  pnh_.param("record_flush_s", flush_period_s_, flush_period_s_);
+  pnh_.param("record_keyframes", keyframes_, keyframes_);
+  pnh_.param("record_keyframe_period_s", keyframe_period_s_,
+             keyframe_period_s_);
+  pnh_.param("record_keyframe_quality", keyframe_quality_, keyframe_quality_);
+  pnh_.param("record_keyframe_queue_size", keyframe_queue_size_,
+             keyframe_queue_size_);
+  if (camera_names_.size() > std::numeric_limits<uint8_t>::max() ||
+      max_file_mb_ <= 0 || rows_per_block_ <= 0 || index_interval_ <= 0 ||
+      keyframe_queue_size_ <= 0) {
+    ROS_ERROR_STREAM("[ CRRecorder ] invalid record_max_file_mb/"
+                     "record_rows_per_block/record_index_interval/"
+                     "record_keyframe_queue_size");
+    return false;
+  }
+  if (!make_dirs(dir_) || (keyframes_ && !make_dirs(dir_ + "/keyframes"))) {
+    ROS_ERROR_STREAM("[ CRRecorder ] cannot create " << dir_);
+    return false;
+  }
+  if (!open_file()) {
+    return false;
+  }
+
+  const int camera_num = static_cast<int>(camera_names_.size());
+  last_seq_.assign(camera_num, 0);
+  last_someone_.assign(camera_num, false);
+  last_keyframe_.assign(camera_num, ros::WallTime());
+  last_flush_ = ros::WallTime::now();
+
+  MetricsRegistry &registry = MetricsRegistry::instance();
+  rows_counter_ = registry.counter("cr_record_rows_total", MetricLabels(),
+                                   "detection rows written to the record log");
+  write_errors_ = registry.counter("cr_record_write_errors_total",
+                                   MetricLabels(),
+                                   "rows lost because the record log failed");
+  keyframe_counter_ = registry.counter("cr_record_keyframes_total",
+                                       MetricLabels(), "keyframes saved");
+  keyframe_dropped_ = registry.counter(
+      "cr_record_keyframes_dropped_total", MetricLabels(),
+      "keyframes dropped because the encoder queue was full");
+  if (keyframes_) {
+    thread_ = std::thread(&CRRecorder::keyframe_loop, this);
+  }
+  ROS_INFO_STREAM("[ CRRecorder ] recording to " << dir_);
+  return true;
+}
+
+bool CRRecorder::open_file() {
+  char name[64];
+  const std::time_t now = std::time(nullptr);
+  std::tm tm;
+  localtime_r(&now, &tm);
+  strftime(name, sizeof(name), "cr_%Y%m%d_%H%M%S.crlog", &tm);
+  const std::string path = dir_ + "/" + name;
+  if (!writer_.open(path, camera_names_, rows_per_block_, index_interval_)) {
+    ALOG_ERROR_STREAM("[ CRRecorder ] cannot open " << path);
+    return false;
+  }
+  ALOG_INFO_STREAM("[ CRRecorder ] new log " << path);
+  return true;
+}
+
+void CRRecorder::record(const std::vector<cr_result> &result,
+                        const std::vector<cv::Mat> &frames) {
+  const ros::WallTime now = ros::WallTime::now();
+  const int64_t publish_ns = static_cast<int64_t>(ros::Time::now().toNSec());
+  const int camera_num =
+      std::min(static_cast<int>(result.size()),
+               static_cast<int>(camera_names_.size()));
+  for (int i = 0; i < camera_num; i++) {
+    const cr_result &r = result[i];
+    // 沿用上一次结果的相机 seq 不变, 同一帧只记一次
+    if (r.seq == 0 || r.seq == last_seq_[i]) {
+      continue;
+    }
+    last_seq_[i] = r.seq;
+    row_.stamp_ns = static_cast<int64_t>(r.stamp.toNSec());
+    row_.publish_ns = publish_ns;
+    row_.seq = r.seq;
+    row_.camera = static_cast<uint8_t>(i);
+    row_.flags = r.someone ? kDetectionLogSomeone : 0;
+    row_.objects.resize(r.object.size());
+    for (size_t k = 0; k < r.object.size(); k++) {
+      const cr_object &o = r.object[k];
+      DetectionLogObject &out = row_.objects[k];
+      out.x = clamp_i16(o.bbox.x);
+      out.y = clamp_i16(o.bbox.y);
+      out.w = clamp_i16(o.bbox.width);
+      out.h = clamp_i16(o.bbox.height);
+      out.prob = o.prob;
+      out.depth = o.depth;
+      out.cls = static_cast<uint8_t>(o.oblcass);
+    }
+
+    const bool rising = r.someone && !last_someone_[i];
+    last_someone_[i] = r.someone;
+    const bool periodic =
+        keyframe_period_s_ > 0 &&
+        (now - last_keyframe_[i]).toSec() >= keyframe_period_s_;
+    if (keyframes_ && (rising || periodic) &&
+        i < static_cast<int>(frames.size()) && !frames[i].empty()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (static_cast<int>(queue_.size()) >= keyframe_queue_size_) {
+        keyframe_dropped_->add();
+      } else {
+        // 只增加引用, 编码在后台线程中进行
+        const std::string path = dir_ + "/keyframes/" +
+                                 file_safe_name(camera_names_[i]) + "_" +
+                                 std::to_string(row_.stamp_ns) + ".jpg";
+        queue_.push_back(Keyframe{frames[i], path});
+        row_.flags |= kDetectionLogKeyframe;
+        last_keyframe_[i] = now;
+        cv_.notify_one();
+      }
+    }
+
+    if (!writer_.append(row_)) {
+      write_errors_->add();
+      ALOG_ERROR_STREAM_THROTTLE(5.0, "[ CRRecorder ] append failed");
+      continue;
+    }
+    rows_counter_->add();
+  }
+
+  if (writer_.bytes() >= static_cast<uint64_t>(max_file_mb_) << 20) {
+    writer_.close();
+    open_file();
+  } else if ((now - last_flush_).toSec() >= flush_period_s_) {
+    // 行数少时也定期写出, 进程被杀时最多丢一个 flush 周期
+    writer_.flush();
+    last_flush_ = now;
+  }
+}
+
+void CRRecorder::keyframe_loop() {
+  const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, keyframe_quality_};
+  while (true) {
+    Keyframe keyframe;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      keyframe = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    if (!cv::imwrite(keyframe.path, keyframe.img, params)) {
+      ALOG_ERROR_STREAM_THROTTLE(5.0, "[ CRRecorder ] cannot write "
+                                          << keyframe.path);
+      continue;
+    }
+    keyframe_counter_->add();
+  }
+}
@@ -13,6 +13,21 @@
 #include "cr/cr_send_result.hpp"
 
 bool cr_send_result::init() {
+  someone_or_not = nh_.advertise<std_msgs::String>(someone_publish_topic_, 1);
+  img_pools_.resize(4);
+  labels_.resize(4);
+  if (publish_jpeg_) {
+    // 不经过image_transport, 避免与compressed插件广播同名topic
+    const std::string topics[4] = {ros_img_publish_topic_, ros_img_publish_topic_1,
+                                   ros_img_publish_topic_2, ros_img_publish_topic_3};
+    for (int i = 0; i < 4; i++) {
+      raw_publishers_.push_back(nh_.advertise<sensor_msgs::Image>(topics[i], 1));
+      jpeg_publishers_.push_back(nh_.advertise<sensor_msgs::CompressedImage>(
+          topics[i] + "/compressed", 1));
+      jpeg_encoders_.emplace_back(new cv_bridge::JpegEncoder(jpeg_quality_));
+    }
+    return true;
+  }
   it_ptr_.reset(new image_transport::ImageTransport(nh_));
   img_publisher_ = it_ptr_->advertise(ros_img_publish_topic_, 1);
   it_ptr_1.reset(new image_transport::ImageTransport(nh_));
@@ -21,7 +36,6 @@ bool cr_send_result::init() {
   img_publisher_2 = it_ptr_2->advertise(ros_img_publish_topic_2, 1);
   it_ptr_3.reset(new image_transport::ImageTransport(nh_));
   img_publisher_3 = it_ptr_3->advertise(ros_img_publish_topic_3, 1);
-  someone_or_not = nh_.advertise<std_msgs::String>(someone_publish_topic_, 1);
   return true;
 }
 
@@ -42,76 +56,140 @@ void cr_send_result::send_result(const cv::Mat &img, const cr_result &result,
   return;
 }
 
+void cr_send_result::send_results(const std::vector<cv::Mat> &imgs,
+                                  const std::vector<cr_result> &results,
+                                  bool &flag) {
+  int n = static_cast<int>(std::min(imgs.size(), results.size()));
+  n = std::min(n, 4);
+  raw_msgs_.resize(4);
+  jpeg_msgs_.resize(4);
+  cv::parallel_for_(cv::Range(0, n), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; i++) {
+      TRACE_SCOPE_ARG("draw", i);
+      render(imgs[i], results[i], i, &raw_msgs_[i], &jpeg_msgs_[i]);
+    }
+  });
+  for (int i = 0; i < n; i++) {
+    if (publish_result_people(results[i], i) == 1) {
+      flag = true;
+    }
+    publish_rendered(i, raw_msgs_[i], jpeg_msgs_[i]);
+    raw_msgs_[i].reset();
+    jpeg_msgs_[i].reset();
+  }
+}
+
 bool cr_send_result::publish_img_with_bbox(const cv::Mat &img,
                                            const cr_result &result, int i) {
-  cv::Mat publish_img = img.clone();
-  draw(&publish_img, result);
-  sensor_msgs::ImagePtr img_publish_msg_temp =
-      cv_bridge::CvImage(std_msgs::Header(), "bgr8", publish_img).toImageMsg();
+  if (i < 0 || i >= 4) {
+    return false;
+  }
+  sensor_msgs::ImagePtr raw_msg;
+  sensor_msgs::CompressedImagePtr jpeg_msg;
+  render(img, result, i, &raw_msg, &jpeg_msg);
+  publish_rendered(i, raw_msg, jpeg_msg);
+  return true;
+}
+
+void cr_send_result::render(const cv::Mat &img, const cr_result &result, int i,
+                            sensor_msgs::ImagePtr *raw_msg,
+                            sensor_msgs::CompressedImagePtr *jpeg_msg) {
+  if (img.empty() || img.type() != CV_8UC3) {
+    return;
+  }
+  bool need_raw = publish_jpeg_ ? raw_publishers_[i].getNumSubscribers() > 0
+                                : it_publisher(i)->getNumSubscribers() > 0;
+  bool need_jpeg =
+      publish_jpeg_ && jpeg_publishers_[i].getNumSubscribers() > 0;
+  if (!need_raw && !need_jpeg) {
+    return;
+  }
+  // 直接在消息的内存上画框, 省去 clone 和 toImageMsg 的两次整帧拷贝
+  // 输出图像沿用输入帧的时间戳和帧序号, 订阅端可以与输入对应并计算延迟
+  std_msgs::Header header;
+  header.stamp = result.stamp;
+  header.seq = result.seq;
+  header.frame_id = result.frame_id;
+  cv::Mat view;
+  sensor_msgs::ImagePtr msg =
+      img_pools_[i].acquire(header, "bgr8", img.rows, img.cols, &view);
+  img.copyTo(view);
+  draw(&view, result, &labels_[i]);
+  if (need_jpeg) {
+    *jpeg_msg = jpeg_encoders_[i]->encode(view, msg->header);
+  }
+  if (need_raw) {
+    *raw_msg = msg;
+  }
+}
+
+void cr_send_result::publish_rendered(
+    int i, const sensor_msgs::ImagePtr &raw_msg,
+    const sensor_msgs::CompressedImagePtr &jpeg_msg) {
+  TRACE_SCOPE_ARG("ros_publish", i);
+  if (raw_msg) {
+    if (publish_jpeg_) {
+      raw_publishers_[i].publish(raw_msg);
+    } else {
+      it_publisher(i)->publish(raw_msg);
+    }
+  }
+  if (jpeg_msg) {
+    jpeg_publishers_[i].publish(jpeg_msg);
+  }
+}
+
+image_transport::Publisher *cr_send_result::it_publisher(int i) {
   switch (i) {
-  case 0:
-    img_publisher_.publish(img_publish_msg_temp);
-    break;
   case 1:
-    img_publisher_1.publish(img_publish_msg_temp);
-    break;
+    return &img_publisher_1;
   case 2:
-    img_publisher_2.publish(img_publish_msg_temp);
-    break;
+    return &img_publisher_2;
   case 3:
-    img_publisher_3.publish(img_publish_msg_temp);
-    break;
-
+    return &img_publisher_3;
   default:
-    break;
+    return &img_publisher_;
   }
-
-  return true;
 }
 
-void cr_send_result::draw(cv::Mat *img, const cr_result &result) {
-  for (auto ob : result.object) {
-    cv::Rect roi = ob.bbox;
+void cr_send_result::draw(cv::Mat *img, const cr_result &result,
+                          std::string *label) {
+  for (const auto &ob : result.object) {
+    const cv::Rect &roi = ob.bbox;
     if (roi.x < 0 || roi.y < 0 || roi.width < 0 || roi.height < 0) {
       continue;
     }
     // draw bbox
     cv::rectangle(*img, roi, cv::Scalar(0, 0, 255), 3, cv::LINE_8, 0);
-    // draw label and depth
-    std::string class_name_str = class_names_[ob.oblcass];
-    std::string put_txt = class_name_str;
-    // float depth = calculate_depth(roi.height);
-    std::string res = std::to_string(ob.depth);
-    res = res.substr(0, res.find_last_not_of('0') + 1);
-    cv::putText(*img, put_txt + " " + res + "m", cv::Point(roi.x, roi.y - 1),
+    // draw label and depth, 文字写入复用的缓存, 每个框不再构造临时字符串
+    *label = class_names_[ob.oblcass];
+    *label += ' ';
+    append_depth(ob.depth, label);
+    label->erase(label->find_last_not_of('0') + 1);
+    *label += 'm';
+    cv::putText(*img, *label, cv::Point(roi.x, roi.y - 1),
                 cv::FONT_HERSHEY_PLAIN, 4, cv::Scalar(0x00, 0x00, 0x00), 3);
-    // std::cout << ob.bbox.x << ";" << ob.bbox.y << ";"<< ob.bbox.width <<
-    // ";"<< ob.bbox.height <<";" << ob.depth  << std::endl;
-    ROS_DEBUG_STREAM("[ CR ] detected_object class is: " << put_txt);
+    ROS_DEBUG_STREAM("[ CR ] detected_object class is: "
+                     << class_names_[ob.oblcass]);
   }
 }
 
 int cr_send_result::publish_result_people(const cr_result &result, int i) {
-  std::stringstream ss;
-  std_msgs::String msg;
+  // 复用消息的字符串缓存, 不再每个相机构造一次 stringstream
+  std::string &data = someone_msg_.data;
   bool flag = false;
-  for (auto ob : result.object) {
-    if (i != 0 && ob.depth <= 5.0) {
-      ss << "someone   " << std::to_string(ob.depth);
-      flag = true;
-      break;
-    }
-    if (i == 0 && ob.depth <= 20.0) {
-      ss << "someone   " << std::to_string(ob.depth);
+  for (const auto &ob : result.object) {
+    if ((i != 0 && ob.depth <= 5.0) || (i == 0 && ob.depth <= 20.0)) {
+      data = "someone   ";
+      append_depth(ob.depth, &data);
       flag = true;
       break;
     }
   }
   if (!flag) {
-    ss << "no one";
+    data = "no one";
   }
-  msg.data = ss.str();
-  someone_or_not.publish(msg);
+  someone_or_not.publish(someone_msg_);
   if (flag) {
     return 1;
   } else {
@@ -119,6 +197,14 @@ int cr_send_result::publish_result_people(const cr_result &result, int i) {
   }
 }
 
+void cr_send_result::append_depth(float depth, std::string *out) {
+  // 与 std::to_string 相同的 %f 格式, 写入栈上的缓存
+  char buf[32];
+  int n = snprintf(buf, sizeof(buf), "%f", depth);
+  n = std::max(0, std::min(n, static_cast<int>(sizeof(buf)) - 1));
+  out->append(buf, n);
+}
+
 float cr_send_result::calculate_depth(float height) {
   float depth_init = 1620.0 / height;
   float a1 = 1.62 * 0.18 / 0.71;
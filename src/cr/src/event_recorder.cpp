@@ -0,0 +1,281 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 22:31:15
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 22:31:15
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/src/event_recorder.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+// third party headers
+// opencv
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "common_utils/read_file_from_dir.hpp"
+#include "cr/event_recorder.hpp"
+
+EventRecorder::EventRecorder(ros::NodeHandle pnh,
+                             const std::vector<std::string> &camera_names)
+    : pnh_(pnh), cameras_(camera_names.size()),
+      triggers_(camera_names.size(), 0) {
+  for (size_t i = 0; i < camera_names.size(); i++) {
+    cameras_[i].name = camera_names[i];
+  }
+}
+
+EventRecorder::~EventRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool EventRecorder::init() {
+  pnh_.param("event_dir", dir_, dir_);
+  pnh_.param("event_pre_s", pre_s_, pre_s_);
+  pnh_.param("event_post_s", post_s_, post_s_);
+  pnh_.param("event_scale", scale_, scale_);
+  pnh_.param("event_jpeg_quality", jpeg_quality_, jpeg_quality_);
+  pnh_.param("event_queue_size", queue_size_, queue_size_);
+  pnh_.param("event_ring_max_mb", ring_max_mb_, ring_max_mb_);
+  pnh_.param("event_close_timeout_s", close_timeout_s_, close_timeout_s_);
+  if (pre_s_ < 0 || post_s_ < 0 || scale_ <= 0 || scale_ > 1 ||
+      queue_size_ <= 0 || ring_max_mb_ <= 0 || close_timeout_s_ < 0) {
+    ROS_ERROR_STREAM("[ EventRecorder ] invalid event_pre_s/event_post_s/"
+                     "event_scale/event_queue_size/event_ring_max_mb/"
+                     "event_close_timeout_s");
+    return false;
+  }
+  if (!make_dirs(dir_)) {
+    ROS_ERROR_STREAM("[ EventRecorder ] cannot create " << dir_);
+    return false;
+  }
+
+  MetricsRegistry &registry = MetricsRegistry::instance();
+  for (Camera &camera : cameras_) {
+    const MetricLabels labels = {{"camera", camera.name}};
+    camera.events = registry.counter("cr_event_total", labels,
+                                     "presence events saved to disk");
+    camera.written = registry.counter("cr_event_frames_written_total", labels,
+                                      "event frames written to disk");
+    camera.ring_bytes_gauge = registry.gauge(
+        "cr_event_ring_bytes", labels, "encoded frames held before an event");
+  }
+  dropped_ = registry.counter(
+      "cr_event_frames_dropped_total", MetricLabels(),
+      "frames not buffered because the encoder queue was full");
+  thread_ = std::thread(&EventRecorder::encode_loop, this);
+  return true;
+}
+
+void EventRecorder::add(const std::vector<cr_result> &result,
+                        const std::vector<cv::Mat> &frames,
+                        const bool *fresh) {
+  const int camera_num =
+      std::min({static_cast<int>(result.size()),
+                static_cast<int>(frames.size()),
+                static_cast<int>(cameras_.size())});
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < camera_num; i++) {
+      const cr_result &r = result[i];
+      Camera &camera = cameras_[i];
+      // 沿用上一次结果的相机不重复处理
+      if (r.seq == 0 || r.seq == camera.last_seq) {
+        continue;
+      }
+      camera.last_seq = r.seq;
+      const int64_t stamp_ns = static_cast<int64_t>(
+          r.stamp.isZero() ? ros::Time::now().toNSec() : r.stamp.toNSec());
+      if (fresh[i] && !frames[i].empty()) {
+        if (static_cast<int>(queue_.size()) >= queue_size_) {
+          dropped_->add();
+        } else {
+          queue_.push_back(Pending{i, frames[i], stamp_ns});
+          notify = true;
+        }
+      }
+      if (r.someone) {
+        triggers_[i] = stamp_ns;
+        triggered_ = true;
+        notify = true;
+      }
+    }
+  }
+  if (notify) {
+    cv_.notify_one();
+  }
+}
+
+void EventRecorder::encode_loop() {
+  const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, jpeg_quality_};
+  std::vector<int64_t> triggers(cameras_.size(), 0);
+  cv::Mat small;
+  bool open_events = false;
+  while (true) {
+    Pending pending{-1, cv::Mat(), 0};
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto ready = [this] { return stop_ || triggered_ || !queue_.empty(); };
+      if (open_events) {
+        // 有进行中的事件时定期醒来检查是否超时
+        cv_.wait_for(lock, std::chrono::milliseconds(200), ready);
+      } else {
+        cv_.wait(lock, ready);
+      }
+      if (stop_) {
+        break;
+      }
+      if (!queue_.empty()) {
+        pending = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      if (triggered_) {
+        triggers.swap(triggers_);
+        std::fill(triggers_.begin(), triggers_.end(), 0);
+        triggered_ = false;
+      }
+    }
+    if (pending.camera >= 0) {
+      Snapshot snapshot;
+      snapshot.stamp_ns = pending.stamp_ns;
+      if (scale_ < 1) {
+        cv::resize(pending.img, small, cv::Size(), scale_, scale_,
+                   cv::INTER_AREA);
+      } else {
+        small = pending.img;
+      }
+      // 尽早释放原图, 让回调可以复用它的缓存
+      pending.img.release();
+      if (cv::imencode(".jpg", small, snapshot.jpeg, params)) {
+        push(&cameras_[pending.camera], &snapshot);
+      }
+    }
+    for (size_t i = 0; i < triggers.size(); i++) {
+      if (triggers[i] != 0) {
+        trigger(static_cast<int>(i), triggers[i]);
+        triggers[i] = 0;
+      }
+    }
+    open_events = close_expired_events();
+  }
+  for (Camera &camera : cameras_) {
+    finish_event(&camera);
+  }
+}
+
+void EventRecorder::push(Camera *camera, Snapshot *snapshot) {
+  if (!camera->event_dir.empty()) {
+    if (snapshot->stamp_ns <= camera->event_until_ns) {
+      write(camera, *snapshot);
+    } else {
+      finish_event(camera);
+    }
+  }
+  camera->ring_bytes += snapshot->jpeg.size();
+  camera->ring.push_back(std::move(*snapshot));
+  const int64_t pre_ns = static_cast<int64_t>(pre_s_ * 1e9);
+  const size_t max_bytes = static_cast<size_t>(ring_max_mb_ * (1 << 20));
+  while (!camera->ring.empty() &&
+         (camera->ring.back().stamp_ns - camera->ring.front().stamp_ns >
+              pre_ns ||
+          camera->ring_bytes > max_bytes)) {
+    camera->ring_bytes -= camera->ring.front().jpeg.size();
+    camera->ring.pop_front();
+  }
+  camera->ring_bytes_gauge->set(static_cast<double>(camera->ring_bytes));
+}
+
+void EventRecorder::trigger(int index, int64_t stamp_ns) {
+  Camera &camera = cameras_[index];
+  const int64_t until_ns = stamp_ns + static_cast<int64_t>(post_s_ * 1e9);
+  if (!camera.event_dir.empty()) {
+    // 事件进行中再次有人, 延长结束时间
+    camera.event_until_ns = std::max(camera.event_until_ns, until_ns);
+    return;
+  }
+  char name[32];
+  const std::time_t sec = static_cast<std::time_t>(stamp_ns / 1000000000);
+  std::tm tm;
+  localtime_r(&sec, &tm);
+  strftime(name, sizeof(name), "%Y%m%d_%H%M%S", &tm);
+  const std::string dir =
+      dir_ + "/" + name + "_" + file_safe_name(camera.name);
+  if (!make_dirs(dir)) {
+    ALOG_ERROR_STREAM_THROTTLE(5.0, "[ EventRecorder ] cannot create " << dir);
+    return;
+  }
+  camera.event_dir = dir;
+  camera.event_until_ns = until_ns;
+  camera.event_frames = 0;
+  camera.events->add();
+  ALOG_INFO_STREAM("[ EventRecorder ] " << camera.name << " event, saving to "
+                                        << dir);
+  const int64_t begin_ns = stamp_ns - static_cast<int64_t>(pre_s_ * 1e9);
+  for (const Snapshot &snapshot : camera.ring) {
+    if (snapshot.stamp_ns >= begin_ns && snapshot.stamp_ns <= until_ns) {
+      write(&camera, snapshot);
+    }
+  }
+}
+
+void EventRecorder::write(Camera *camera, const Snapshot &snapshot) {
+  if (snapshot.stamp_ns <= camera->written_ns) {
+    return;
+  }
+  const std::string path = camera->event_dir + "/" +
+                           std::to_string(snapshot.stamp_ns) + ".jpg";
+  std::ofstream out(path, std::ios::binary);
+  out.write(reinterpret_cast<const char *>(snapshot.jpeg.data()),
+            static_cast<std::streamsize>(snapshot.jpeg.size()));
+  if (!out) {
+    ALOG_ERROR_STREAM_THROTTLE(5.0, "[ EventRecorder ] cannot write " << path);
+    return;
+  }
+  camera->written_ns = snapshot.stamp_ns;
+  camera->event_frames++;
+  camera->written->add();
+}
+
+void EventRecorder::finish_event(Camera *camera) {
+  if (camera->event_dir.empty()) {
+    return;
+  }
+  ALOG_INFO_STREAM("[ EventRecorder ] " << camera->name << " event saved, "
+                                        << camera->event_frames
+                                        << " frames in " << camera->event_dir);
+  camera->event_dir.clear();
+}
+
+bool EventRecorder::close_expired_events() {
+  // 相机掉线或不再被检测时没有新帧推动 push 结束事件
+  const int64_t now_ns = static_cast<int64_t>(ros::Time::now().toNSec());
+  const int64_t timeout_ns = static_cast<int64_t>(close_timeout_s_ * 1e9);
+  bool open = false;
+  for (Camera &camera : cameras_) {
+    if (camera.event_dir.empty()) {
+      continue;
+    }
+    if (now_ns > camera.event_until_ns + timeout_ns) {
+      finish_event(&camera);
+    } else {
+      open = true;
+    }
+  }
+  return open;
+}
@@ -0,0 +1,243 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 20:05:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 20:05:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/src/frame_sync.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#include "cr/frame_sync.hpp"
+
+bool parse_sync_policy(const std::string &name, SyncMissingPolicy *policy) {
+  if (name == "wait") {
+    *policy = SyncMissingPolicy::kWait;
+  } else if (name == "latest") {
+    *policy = SyncMissingPolicy::kLatest;
+  } else if (name == "drop") {
+    *policy = SyncMissingPolicy::kDrop;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+FrameSynchronizer::FrameSynchronizer(
+    ros::NodeHandle pnh, const std::vector<std::string> &camera_names)
+    : pnh_(pnh), camera_names_(camera_names) {}
+
+bool FrameSynchronizer::init() {
+  double window_ms = window_s_ * 1e3;
+  double max_wait_ms = max_wait_s_ * 1e3;
+  pnh_.param("sync_window_ms", window_ms, window_ms);
+  pnh_.param("sync_max_wait_ms", max_wait_ms, max_wait_ms);
+  pnh_.param("sync_history_size", history_size_, history_size_);
+  pnh_.param("sync_missing_policy", policy_name_, policy_name_);
+  if (!parse_sync_policy(policy_name_, &policy_)) {
+    ROS_ERROR_STREAM("[ FrameSynchronizer ] unknown sync_missing_policy : "
+                     << policy_name_);
+    return false;
+  }
+  if (window_ms <= 0 || max_wait_ms < 0 || history_size_ < 1) {
+    ROS_ERROR_STREAM("[ FrameSynchronizer ] invalid sync_window_ms/"
+                     "sync_max_wait_ms/sync_history_size");
+    return false;
+  }
+  window_s_ = window_ms / 1e3;
+  max_wait_s_ = max_wait_ms / 1e3;
+
+  MetricsRegistry &registry = MetricsRegistry::instance();
+  const int camera_num = static_cast<int>(camera_names_.size());
+  cameras_.resize(camera_num);
+  for (int i = 0; i < camera_num; i++) {
+    const MetricLabels labels = {{"camera", camera_names_[i]}};
+    cameras_[i].missing = registry.counter(
+        "cr_sync_missing_total", labels,
+        "batches without a frame of this camera inside the sync window");
+    cameras_[i].evicted = registry.counter(
+        "cr_sync_evicted_total", labels,
+        "frames dropped from the sync history before being consumed");
+  }
+  best_.reserve(camera_num);
+  candidate_.reserve(camera_num);
+  spread_gauge_ = registry.gauge(
+      "cr_sync_spread_ms", {},
+      "capture time spread of the cameras in the last synchronized batch");
+  ALOG_INFO_STREAM("[ FrameSynchronizer ] window " << window_ms
+                                                   << " ms, policy "
+                                                   << policy_name_);
+  return true;
+}
+
+bool FrameSynchronizer::add(int camera, const cv::Mat &img,
+                            const sensor_msgs::ImageConstPtr &msg,
+                            const std_msgs::Header &header) {
+  const ros::Time now = ros::Time::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  CameraHistory &history = cameras_[camera];
+  if (!history.enabled) {
+    return false;
+  }
+  history.frames.push_back(
+      Frame{img, msg, header, header.stamp.isZero() ? now : header.stamp, now});
+  bool evicted = false;
+  while (static_cast<int>(history.frames.size()) > history_size_) {
+    if (history.frames.front().header.seq > history.consumed_seq) {
+      evicted = true;
+      history.evicted->add();
+    }
+    history.frames.pop_front();
+  }
+  return evicted;
+}
+
+void FrameSynchronizer::set_enabled(int camera, bool enabled) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CameraHistory &history = cameras_[camera];
+  history.enabled = enabled;
+  if (!enabled) {
+    // 不再参与同步的历史帧尽快还给内存池
+    history.frames.clear();
+  }
+}
+
+const FrameSynchronizer::Frame *
+FrameSynchronizer::match(const CameraHistory &history,
+                         const ros::Time &anchor) const {
+  const ros::Time end = anchor + ros::Duration(window_s_);
+  const Frame *found = nullptr;
+  for (const Frame &frame : history.frames) {
+    if (frame.header.seq <= history.consumed_seq || frame.key < anchor ||
+        frame.key > end) {
+      continue;
+    }
+    if (found == nullptr || frame.key < found->key) {
+      found = &frame;
+    }
+  }
+  return found;
+}
+
+bool FrameSynchronizer::collect(const ros::Time &now,
+                                std::vector<cv::Mat> *frames,
+                                std::vector<sensor_msgs::ImageConstPtr> *msgs,
+                                std_msgs::Header *headers, bool *fresh) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int camera_num = static_cast<int>(cameras_.size());
+
+  // 每个未取走的帧都作为窗口的起点尝试一次, 相机数 x 历史长度, 规模很小
+  best_.assign(camera_num, nullptr);
+  int best_count = 0;
+  int enabled_num = 0;
+  ros::Time best_anchor;
+  for (int p = 0; p < camera_num; p++) {
+    if (!cameras_[p].enabled) {
+      continue;
+    }
+    ++enabled_num;
+    for (const Frame &pivot : cameras_[p].frames) {
+      if (pivot.header.seq <= cameras_[p].consumed_seq) {
+        continue;
+      }
+      candidate_.assign(camera_num, nullptr);
+      int count = 0;
+      for (int c = 0; c < camera_num; c++) {
+        if (!cameras_[c].enabled) {
+          continue;
+        }
+        candidate_[c] = c == p ? &pivot : match(cameras_[c], pivot.key);
+        count += candidate_[c] != nullptr ? 1 : 0;
+      }
+      if (count > best_count ||
+          (count == best_count && pivot.key > best_anchor)) {
+        best_.swap(candidate_);
+        best_count = count;
+        best_anchor = pivot.key;
+      }
+    }
+  }
+
+  if (best_count > 0 && best_count < enabled_num &&
+      policy_ == SyncMissingPolicy::kWait) {
+    ros::Time arrival;
+    for (const Frame *frame : best_) {
+      if (frame != nullptr && frame->arrival > arrival) {
+        arrival = frame->arrival;
+      }
+    }
+    if ((now - arrival).toSec() < max_wait_s_) {
+      return false;
+    }
+  }
+
+  ros::Time first;
+  ros::Time last;
+  for (int c = 0; c < camera_num; c++) {
+    CameraHistory &history = cameras_[c];
+    const Frame *frame = best_[c];
+    if (frame != nullptr) {
+      first = first.isZero() || frame->key < first ? frame->key : first;
+      last = frame->key > last ? frame->key : last;
+      fill(c, frame, true, frames, msgs, headers, fresh);
+      history.consumed_seq = frame->header.seq;
+      continue;
+    }
+    if (!history.enabled) {
+      fill(c, nullptr, false, frames, msgs, headers, fresh);
+      continue;
+    }
+    if (best_count > 0) {
+      history.missing->add();
+    }
+    if (policy_ == SyncMissingPolicy::kLatest && !history.frames.empty()) {
+      const Frame &latest = history.frames.back();
+      const bool unseen = latest.header.seq > history.consumed_seq;
+      fill(c, &latest, unseen, frames, msgs, headers, fresh);
+      history.consumed_seq = latest.header.seq;
+    } else {
+      fill(c, nullptr, false, frames, msgs, headers, fresh);
+    }
+  }
+  if (best_count > 0) {
+    spread_gauge_->set((last - first).toSec() * 1e3);
+  }
+
+  // 早于窗口起点的帧以后也不会被匹配, 只保留最新一帧给 kLatest 使用
+  const ros::Time horizon = best_anchor - ros::Duration(window_s_);
+  for (CameraHistory &history : cameras_) {
+    while (history.frames.size() > 1) {
+      const Frame &front = history.frames.front();
+      if (front.header.seq > history.consumed_seq) {
+        if (best_count == 0 || front.key >= horizon) {
+          break;
+        }
+        history.evicted->add();
+      }
+      history.frames.pop_front();
+    }
+  }
+  return true;
+}
+
+void FrameSynchronizer::fill(int camera, const Frame *frame, bool fresh,
+                             std::vector<cv::Mat> *frames,
+                             std::vector<sensor_msgs::ImageConstPtr> *msgs,
+                             std_msgs::Header *headers, bool *fresh_out) {
+  fresh_out[camera] = fresh;
+  if (frame == nullptr) {
+    (*frames)[camera].release();
+    if (msgs != nullptr) {
+      (*msgs)[camera].reset();
+    }
+    headers[camera] = std_msgs::Header();
+    return;
+  }
+  (*frames)[camera] = frame->img;
+  if (msgs != nullptr) {
+    (*msgs)[camera] = frame->msg;
+  }
+  headers[camera] = frame->header;
+}
@@ -10,9 +10,60 @@
  * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
  * @Licensed under the Apache License, Version 2.0 (the License)
  */
+// c system headers
+#include <yaml-cpp/yaml.h>
+
 #include "cr/postprocess.hpp"
 
-bool CRPostProcess::init() { return true; }
+bool CRPostProcess::init() {
+  if (undistort_bbox_) {
+    return undistorter_init();
+  }
+  return true;
+}
+
+bool CRPostProcess::undistorter_init() {
+  if (camera_ids_.empty()) {
+    ROS_ERROR_STREAM("[ CRPostProcess ] undistort_bbox needs camera_ids");
+    return false;
+  }
+  try {
+    YAML::Node config = YAML::LoadFile(camera_config_path_);
+    for (const auto &camera_id : camera_ids_) {
+      YAML::Node camera = config[camera_id];
+      if (!camera || !camera["intrinsics"] || !camera["distortion_coeffs"] ||
+          !camera["img_size"]) {
+        // 没有标定的相机直接用原图 bbox 测距, 不影响其它相机
+        ROS_WARN_STREAM("[ CRPostProcess ] no calibration for camera : "
+                        << camera_id << ", bbox is not undistorted");
+        undistorters_.emplace_back();
+        continue;
+      }
+      std::vector<int> img_size = camera["img_size"].as<std::vector<int>>();
+      if (img_size.size() != 2) {
+        ROS_ERROR_STREAM("[ CRPostProcess ] invalid img_size for camera : "
+                         << camera_id);
+        return false;
+      }
+      // 只需要角点去畸变,不生成整帧映射表
+      std::unique_ptr<CameraUndistorter> undistorter(new CameraUndistorter(
+          camera["intrinsics"].as<std::vector<double>>(),
+          camera["distortion_coeffs"].as<std::vector<double>>(),
+          cv::Size(img_size[0], img_size[1])));
+      if (!undistorter->init(cv::Rect(), cv::Size(), false)) {
+        ROS_ERROR_STREAM("[ CRPostProcess ] undistorter init failed : "
+                         << camera_id);
+        return false;
+      }
+      undistorters_.push_back(std::move(undistorter));
+    }
+  } catch (const YAML::Exception &e) {
+    ROS_ERROR_STREAM("[ CRPostProcess ] load camera config failed : "
+                     << camera_config_path_ << " " << e.what());
+    return false;
+  }
+  return true;
+}
 
 bool CRPostProcess::process(cr_result *result, int i) {
   // 针对部分出现在画面中不优雅的处理及预估距离
@@ -44,11 +95,19 @@ void CRPostProcess::Partial_target_processing(cr_result *result, int i) {
   default:
     break;
   }
+  const CameraUndistorter *undistorter =
+      i < static_cast<int>(undistorters_.size()) ? undistorters_[i].get()
+                                                 : nullptr;
   for (auto &object : result->object) {
-    if (object.bbox.y + object.bbox.height >= base) {
+    // bbox保持原图坐标用于画图,测距使用去畸变后的角点
+    cv::Rect2f rect = object.bbox;
+    if (undistorter != nullptr) {
+      rect = undistorter->undistort_rect(object.bbox);
+    }
+    if (rect.y + rect.height >= base) {
       object.depth = -2.0;
     } else {
-      object.depth = cal_depth(object.bbox.height, base);
+      object.depth = cal_depth(rect.height, base);
     }
     if (object.depth < 5) {
       result->someone = true;
@@ -0,0 +1,67 @@
+#include "cr/batch_select.hpp"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+const int kCameras = 2;
+
+std::vector<cv::Mat> make_frames()
+{
+  std::vector<cv::Mat> frames(kCameras);
+  for (int i = 0; i < kCameras; ++i)
+    frames[i] = cv::Mat::zeros(cv::Size(4, 4), CV_8UC1);
+  return frames;
+}
+}  // namespace
+
+TEST(BatchSelect, onlyFreshCamerasAreDetected)
+{
+  // 相机0 本周期有新帧, 相机1 的帧上个周期已经检测过
+  std::vector<cv::Mat> frames = make_frames();
+  bool fresh[kCameras] = { true, false };
+  std::vector<int> checked;
+  std::vector<int> selected;
+  select_fresh(fresh, kCameras,
+               [&](int i) {
+                 checked.push_back(i);
+                 return !frames[i].empty();
+               },
+               &selected);
+  // 旧帧不转换也不检测
+  EXPECT_EQ(std::vector<int>(1, 0), checked);
+  EXPECT_EQ(std::vector<int>(1, 0), selected);
+
+  bool detected[kCameras] = { true, false };
+  release_undetected(detected, kCameras, &frames, fresh);
+  EXPECT_FALSE(frames[0].empty());
+  EXPECT_TRUE(fresh[0]);
+  // 旧帧释放, 结果沿用上一次的检测
+  EXPECT_TRUE(frames[1].empty());
+  EXPECT_FALSE(fresh[1]);
+}
+
+TEST(BatchSelect, camerasWithoutImageAreSkipped)
+{
+  std::vector<cv::Mat> frames = make_frames();
+  frames[0].release();
+  bool fresh[kCameras] = { true, true };
+  std::vector<int> selected;
+  select_fresh(fresh, kCameras, [&](int i) { return !frames[i].empty(); }, &selected);
+  EXPECT_EQ(std::vector<int>(1, 1), selected);
+}
+
+TEST(BatchSelect, failedDetectionReleasesEveryFrame)
+{
+  std::vector<cv::Mat> frames = make_frames();
+  bool fresh[kCameras] = { true, true };
+  bool detected[kCameras] = { false, false };
+  release_undetected(detected, kCameras, &frames, fresh);
+  for (int i = 0; i < kCameras; ++i)
+  {
+    EXPECT_TRUE(frames[i].empty());
+    EXPECT_FALSE(fresh[i]);
+  }
+}
@@ -0,0 +1,375 @@
+#include "tld_detector/cpu_engine.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+// 朴素实现: 直接卷积, BN 不折叠, 按 common.hpp 的 yolov5 p5 结构逐层计算,
+// 随机生成的权重同时写成 .wts 交给 CpuYoloEngine
+typedef std::vector<float> Floats;
+
+struct Tensor
+{
+  int c, h, w;
+  Floats d;
+  float& at(int ci, int y, int x)
+  {
+    return d[(static_cast<size_t>(ci) * h + y) * w + x];
+  }
+};
+
+Tensor make_tensor(int c, int h, int w)
+{
+  Tensor t = { c, h, w, Floats(static_cast<size_t>(c) * h * w) };
+  return t;
+}
+
+class NaiveYolo
+{
+public:
+  // 最小的 yolov5: 宽度 x0.125, 深度 x0.33
+  NaiveYolo() : rng_(1), gw_(0.125f), gd_(0.33f)
+  {
+  }
+
+  Floats random(size_t n, float lo, float hi)
+  {
+    std::uniform_real_distribution<float> u(lo, hi);
+    Floats v(n);
+    for (size_t i = 0; i < v.size(); ++i)
+      v[i] = u(rng_);
+    return v;
+  }
+
+  void write_wts(const std::string& path) const
+  {
+    std::ofstream out(path.c_str());
+    out << weights_.size() << "\n";
+    for (std::map<std::string, Floats>::const_iterator it = weights_.begin(); it != weights_.end(); ++it)
+    {
+      out << it->first << " " << it->second.size();
+      for (size_t i = 0; i < it->second.size(); ++i)
+      {
+        uint32_t bits;
+        std::memcpy(&bits, &it->second[i], sizeof(bits));
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), " %x", bits);
+        out << buf;
+      }
+      out << "\n";
+    }
+  }
+
+  std::vector<Yolo::Detection> forward(const float* chw, int h, int w)
+  {
+    Tensor x = make_tensor(3, h, w);
+    std::copy(chw, chw + x.d.size(), x.d.begin());
+    // focus: 按 (0,0) (1,0) (0,1) (1,1) 的顺序间隔取样
+    Tensor f = make_tensor(12, h / 2, w / 2);
+    const int off[4][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+    for (int g = 0; g < 4; ++g)
+      for (int c = 0; c < 3; ++c)
+        for (int y = 0; y < h / 2; ++y)
+          for (int xx = 0; xx < w / 2; ++xx)
+            f.at(g * 3 + c, y, xx) = x.at(c, 2 * y + off[g][0], 2 * xx + off[g][1]);
+
+    Tensor focus0 = conv_block(f, width(64), 3, 1, "model.0.conv");
+    Tensor conv1 = conv_block(focus0, width(128), 3, 2, "model.1");
+    Tensor b2 = C3(conv1, width(128), depth(3), true, "model.2");
+    Tensor conv3 = conv_block(b2, width(256), 3, 2, "model.3");
+    Tensor b4 = C3(conv3, width(256), depth(9), true, "model.4");
+    Tensor conv5 = conv_block(b4, width(512), 3, 2, "model.5");
+    Tensor b6 = C3(conv5, width(512), depth(9), true, "model.6");
+    Tensor conv7 = conv_block(b6, width(1024), 3, 2, "model.7");
+    Tensor spp8 = SPP(conv7, width(1024), width(1024), "model.8");
+    Tensor b9 = C3(spp8, width(1024), depth(3), false, "model.9");
+    Tensor conv10 = conv_block(b9, width(512), 1, 1, "model.10");
+    Tensor up11 = upsample(conv10);
+    Tensor cat12 = concat(up11, b6);
+    Tensor b13 = C3(cat12, width(512), depth(3), false, "model.13");
+    Tensor conv14 = conv_block(b13, width(256), 1, 1, "model.14");
+    Tensor up15 = upsample(conv14);
+    Tensor cat16 = concat(up15, b4);
+    Tensor b17 = C3(cat16, width(256), depth(3), false, "model.17");
+    Tensor det0 = detect(b17, "model.24.m.0");
+    Tensor conv18 = conv_block(b17, width(256), 3, 2, "model.18");
+    Tensor cat19 = concat(conv18, conv14);
+    Tensor b20 = C3(cat19, width(512), depth(3), false, "model.20");
+    Tensor det1 = detect(b20, "model.24.m.1");
+    Tensor conv21 = conv_block(b20, width(512), 3, 2, "model.21");
+    Tensor cat22 = concat(conv21, conv10);
+    Tensor b23 = C3(cat22, width(1024), depth(3), false, "model.23");
+    Tensor det2 = detect(b23, "model.24.m.2");
+
+    const float anchors[18] = { 10, 13, 16, 30, 33, 23, 30, 61, 62, 45, 59, 119, 116, 90, 156, 198, 373, 326 };
+    if (!weights_.count("model.24.anchor_grid"))
+      weights_["model.24.anchor_grid"] = Floats(anchors, anchors + 18);
+    const Tensor* dets[3] = { &det0, &det1, &det2 };
+    std::vector<Yolo::Detection> out;
+    for (int l = 0; l < 3; ++l)
+      decode(*dets[l], anchors + l * 6, h, w, &out);
+    return out;
+  }
+
+private:
+  int width(int x) const
+  {
+    return static_cast<int>(std::ceil(x * gw_ / 8)) * 8;
+  }
+
+  int depth(int x) const
+  {
+    return x == 1 ? 1 : std::max(static_cast<int>(std::round(x * gd_)), 1);
+  }
+
+  const Floats& param(const std::string& name, size_t n, float lo, float hi)
+  {
+    if (!weights_.count(name))
+      weights_[name] = random(n, lo, hi);
+    return weights_[name];
+  }
+
+  Tensor conv(const Tensor& x, int oc, int k, int s, const std::string& name, const Floats* bias)
+  {
+    const int p = k / 2;
+    const int oh = (x.h + 2 * p - k) / s + 1;
+    const int ow = (x.w + 2 * p - k) / s + 1;
+    const float r = 1.f / std::sqrt(static_cast<float>(x.c * k * k));
+    const Floats& wt = param(name, static_cast<size_t>(oc) * x.c * k * k, -r, r);
+    Tensor y = make_tensor(oc, oh, ow);
+    for (int o = 0; o < oc; ++o)
+      for (int yy = 0; yy < oh; ++yy)
+        for (int xx = 0; xx < ow; ++xx)
+        {
+          double acc = bias ? (*bias)[o] : 0;
+          for (int c = 0; c < x.c; ++c)
+            for (int ky = 0; ky < k; ++ky)
+              for (int kx = 0; kx < k; ++kx)
+              {
+                const int iy = yy * s - p + ky;
+                const int ix = xx * s - p + kx;
+                if (iy < 0 || ix < 0 || iy >= x.h || ix >= x.w)
+                  continue;
+                acc += wt[((o * x.c + c) * k + ky) * k + kx] * x.d[(c * x.h + iy) * x.w + ix];
+              }
+          y.at(o, yy, xx) = static_cast<float>(acc);
+        }
+    return y;
+  }
+
+  Tensor conv_block(const Tensor& x, int oc, int k, int s, const std::string& name)
+  {
+    Tensor y = conv(x, oc, k, s, name + ".conv.weight", NULL);
+    const Floats& g = param(name + ".bn.weight", oc, 0.5f, 1.5f);
+    const Floats& b = param(name + ".bn.bias", oc, -0.5f, 0.5f);
+    const Floats& m = param(name + ".bn.running_mean", oc, -0.2f, 0.2f);
+    const Floats& v = param(name + ".bn.running_var", oc, 0.5f, 2.f);
+    const size_t plane = static_cast<size_t>(y.h) * y.w;
+    for (int o = 0; o < oc; ++o)
+      for (size_t i = 0; i < plane; ++i)
+      {
+        float& z = y.d[o * plane + i];
+        z = (z - m[o]) / std::sqrt(v[o] + 1e-3f) * g[o] + b[o];
+        z = z / (1 + std::exp(-z));
+      }
+    return y;
+  }
+
+  Tensor concat(const Tensor& a, const Tensor& b) const
+  {
+    Tensor y = make_tensor(a.c + b.c, a.h, a.w);
+    std::copy(a.d.begin(), a.d.end(), y.d.begin());
+    std::copy(b.d.begin(), b.d.end(), y.d.begin() + a.d.size());
+    return y;
+  }
+
+  Tensor bottleneck(const Tensor& x, int c2, bool shortcut, const std::string& name)
+  {
+    Tensor a = conv_block(x, c2, 1, 1, name + ".cv1");
+    Tensor b = conv_block(a, c2, 3, 1, name + ".cv2");
+    if (shortcut && x.c == c2)
+      for (size_t i = 0; i < b.d.size(); ++i)
+        b.d[i] += x.d[i];
+    return b;
+  }
+
+  Tensor C3(const Tensor& x, int c2, int n, bool shortcut, const std::string& name)
+  {
+    const int c_ = c2 / 2;
+    Tensor a = conv_block(x, c_, 1, 1, name + ".cv1");
+    Tensor b = conv_block(x, c_, 1, 1, name + ".cv2");
+    for (int i = 0; i < n; ++i)
+    {
+      char idx[16];
+      std::snprintf(idx, sizeof(idx), ".m.%d", i);
+      a = bottleneck(a, c_, shortcut, name + idx);
+    }
+    return conv_block(concat(a, b), c2, 1, 1, name + ".cv3");
+  }
+
+  Tensor max_pool(const Tensor& x, int k) const
+  {
+    Tensor y = make_tensor(x.c, x.h, x.w);
+    const int r = k / 2;
+    for (int c = 0; c < x.c; ++c)
+      for (int yy = 0; yy < x.h; ++yy)
+        for (int xx = 0; xx < x.w; ++xx)
+        {
+          float m = -1e30f;
+          for (int dy = -r; dy <= r; ++dy)
+            for (int dx = -r; dx <= r; ++dx)
+            {
+              const int iy = yy + dy;
+              const int ix = xx + dx;
+              if (iy >= 0 && ix >= 0 && iy < x.h && ix < x.w)
+                m = std::max(m, x.d[(c * x.h + iy) * x.w + ix]);
+            }
+          y.at(c, yy, xx) = m;
+        }
+    return y;
+  }
+
+  Tensor SPP(const Tensor& x, int c1, int c2, const std::string& name)
+  {
+    Tensor a = conv_block(x, c1 / 2, 1, 1, name + ".cv1");
+    Tensor c = concat(concat(a, max_pool(a, 5)), concat(max_pool(a, 9), max_pool(a, 13)));
+    return conv_block(c, c2, 1, 1, name + ".cv2");
+  }
+
+  Tensor upsample(const Tensor& x) const
+  {
+    Tensor y = make_tensor(x.c, x.h * 2, x.w * 2);
+    for (int c = 0; c < x.c; ++c)
+      for (int yy = 0; yy < y.h; ++yy)
+        for (int xx = 0; xx < y.w; ++xx)
+          y.at(c, yy, xx) = x.d[(c * x.h + yy / 2) * x.w + xx / 2];
+    return y;
+  }
+
+  Tensor detect(const Tensor& x, const std::string& name)
+  {
+    const int oc = Yolo::CHECK_COUNT * (5 + 1);
+    const Floats& bias = param(name + ".bias", oc, -3.f, 1.f);
+    return conv(x, oc, 1, 1, name + ".weight", &bias);
+  }
+
+  // 与 yololayer.cu 的 CalDetection 相同
+  static void decode(const Tensor& t, const float* anchors, int input_h, int input_w,
+                     std::vector<Yolo::Detection>* out)
+  {
+    const int grid = t.h * t.w;
+    const int info = 5 + 1;
+    for (int idx = 0; idx < grid; ++idx)
+      for (int k = 0; k < Yolo::CHECK_COUNT; ++k)
+      {
+        const float* cell = &t.d[k * info * grid + idx];
+        const float box_prob = sigmoid(cell[4 * grid]);
+        if (box_prob < Yolo::IGNORE_THRESH)
+          continue;
+        int class_id = 0;
+        float max_cls = 0;
+        for (int i = 5; i < info; ++i)
+        {
+          const float p = sigmoid(cell[i * grid]);
+          if (p > max_cls)
+          {
+            max_cls = p;
+            class_id = i - 5;
+          }
+        }
+        const int row = idx / t.w;
+        const int col = idx % t.w;
+        Yolo::Detection det;
+        det.bbox[0] = (col - 0.5f + 2 * sigmoid(cell[0])) * input_w / t.w;
+        det.bbox[1] = (row - 0.5f + 2 * sigmoid(cell[grid])) * input_h / t.h;
+        det.bbox[2] = 2 * sigmoid(cell[2 * grid]);
+        det.bbox[2] = det.bbox[2] * det.bbox[2] * anchors[2 * k];
+        det.bbox[3] = 2 * sigmoid(cell[3 * grid]);
+        det.bbox[3] = det.bbox[3] * det.bbox[3] * anchors[2 * k + 1];
+        det.conf = box_prob * max_cls;
+        det.class_id = class_id;
+        out->push_back(det);
+      }
+  }
+
+  static float sigmoid(float v)
+  {
+    return 1.f / (1.f + std::exp(-v));
+  }
+
+  std::mt19937 rng_;
+  float gw_;
+  float gd_;
+  std::map<std::string, Floats> weights_;
+};
+
+std::string temp_path(const char* name)
+{
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "/tmp/%s_%d.wts", name, static_cast<int>(getpid()));
+  return buf;
+}
+}  // namespace
+
+TEST(CpuYoloEngine, matchesNaiveReference)
+{
+  const int h = 128, w = 160, batch = 2;
+  NaiveYolo naive;
+  const Floats input = naive.random(static_cast<size_t>(batch) * 3 * h * w, 0.f, 1.f);
+  std::vector<std::vector<Yolo::Detection> > ref(batch);
+  for (int n = 0; n < batch; ++n)
+    ref[n] = naive.forward(&input[static_cast<size_t>(n) * 3 * h * w], h, w);
+  const std::string path = temp_path("test_cpu_engine");
+  naive.write_wts(path);
+
+  // 单线程和多线程的任务划分不同, 结果都应与朴素实现一致
+  const int threads[2] = { 1, 3 };
+  for (int t = 0; t < 2; ++t)
+  {
+    CpuYoloEngine engine(path, 4, w, h, 1, threads[t]);
+    ASSERT_TRUE(engine.init());
+    EXPECT_FALSE(engine.is_p6());
+    Floats out(static_cast<size_t>(batch) * CpuYoloEngine::output_size());
+    // 第二次推理复用中间缓存, 结果不能受上一次影响
+    for (int it = 0; it < 2; ++it)
+    {
+      std::fill(out.begin(), out.end(), -1.f);
+      engine.infer(input.data(), out.data(), batch);
+      for (int n = 0; n < batch; ++n)
+      {
+        ASSERT_FALSE(ref[n].empty());
+        const float* o = &out[static_cast<size_t>(n) * CpuYoloEngine::output_size()];
+        const size_t expected = std::min<size_t>(ref[n].size(), Yolo::MAX_OUTPUT_BBOX_COUNT);
+        ASSERT_EQ(expected, static_cast<size_t>(o[0])) << "threads " << threads[t] << " image " << n;
+        const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+        for (size_t i = 0; i < expected; ++i)
+        {
+          const float* got = o + 1 + i * det_size;
+          const float* want = reinterpret_cast<const float*>(&ref[n][i]);
+          for (int j = 0; j < det_size; ++j)
+            EXPECT_NEAR(want[j], got[j], 1e-3 * (1 + std::fabs(want[j])))
+                << "threads " << threads[t] << " image " << n << " det " << i << " field " << j;
+        }
+      }
+    }
+  }
+  std::remove(path.c_str());
+}
+
+TEST(CpuYoloEngine, missingWeightsFailInit)
+{
+  CpuYoloEngine engine(temp_path("test_cpu_engine_missing"), 1, 64, 64, 1, 1);
+  EXPECT_FALSE(engine.init());
+}
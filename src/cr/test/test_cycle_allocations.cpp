@@ -0,0 +1,178 @@
+#include "common_utils/frame_pool.hpp"
+#include "tld_detector/common.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <cv_bridge/cv_bridge.h>
+#include <cv_bridge/msg_pool.h>
+#include <gtest/gtest.h>
+#include <sensor_msgs/image_encodings.h>
+
+namespace
+{
+// 只在 g_counting 打开时计数, gtest 自身的分配不计入
+std::atomic<bool> g_counting(false);
+std::atomic<size_t> g_allocations(0);
+
+void* counted_malloc(size_t size)
+{
+  if (g_counting)
+    ++g_allocations;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+const int kCameras = 4;
+const int kRows = 480;
+const int kCols = 752;
+
+// yololayer 格式的输出: 两个重叠的框只保留一个, 低于阈值的框丢弃
+void fill_output(std::vector<float>* output)
+{
+  const float dets[][6] = { { 100, 100, 50, 80, 0.9f, 0 },
+                            { 104, 102, 50, 80, 0.8f, 0 },
+                            { 300, 200, 40, 60, 0.7f, 0 },
+                            { 120, 100, 50, 80, 0.3f, 0 } };
+  const int n = sizeof(dets) / sizeof(dets[0]);
+  output->assign(1, static_cast<float>(n));
+  for (int i = 0; i < n; ++i)
+    output->insert(output->end(), dets[i], dets[i] + 6);
+}
+
+// cr 一个周期中的图像和消息路径, 调用的都是 cr 实际使用的接口:
+// 回调用 ConversionPlan 把原始消息转换到备用缓存再与 slot 交换(检测循环仍持有上一帧时
+// 备用缓存从内存池重新分配), 检测后用 scratch 做 nms, 发布时拷贝到 ImageMsgPool 的消息再编码 jpeg
+struct Cycle
+{
+  sensor_msgs::Image msgs[kCameras];
+  cv_bridge::ConversionPlan plans[kCameras];
+  cv::Mat slots[kCameras];
+  cv::Mat spares[kCameras];
+  cv::Mat frames[kCameras];
+  std::vector<float> output;
+  std::vector<Yolo::Detection> res;
+  std::vector<Yolo::Detection> scratch;
+  cv_bridge::ImageMsgPool img_pools[kCameras];
+  cv_bridge::JpegEncoder jpeg_encoders[kCameras];
+  size_t detections;
+
+  explicit Cycle(bool jpeg) : detections(0), jpeg_(jpeg)
+  {
+    fill_output(&output);
+    for (int i = 0; i < kCameras; ++i)
+    {
+      msgs[i].height = kRows;
+      msgs[i].width = kCols;
+      msgs[i].encoding = sensor_msgs::image_encodings::RGB8;
+      msgs[i].step = kCols * 3;
+      msgs[i].data.assign(static_cast<size_t>(kRows) * kCols * 3, static_cast<uint8_t>(40 * i));
+      plans[i] = cv_bridge::ConversionPlan(msgs[i].encoding, sensor_msgs::image_encodings::BGR8);
+      use_frame_pool(&slots[i]);
+      use_frame_pool(&spares[i]);
+      callback(i);
+    }
+  }
+
+  void callback(int i)
+  {
+    // 与 CR::reclaim_spare 相同
+    if (spares[i].u != NULL && spares[i].u->refcount > 1)
+      spares[i].release();
+    plans[i].convert(msgs[i], spares[i]);
+    cv::swap(slots[i], spares[i]);
+  }
+
+  void run()
+  {
+    for (int i = 0; i < kCameras; ++i)
+      frames[i] = slots[i];
+    // 检测期间每个相机又到了两帧, 第二帧时备用缓存是检测循环持有的那一帧
+    for (int i = 0; i < kCameras; ++i)
+    {
+      callback(i);
+      callback(i);
+    }
+    detections = 0;
+    for (int i = 0; i < kCameras; ++i)
+    {
+      res.clear();
+      nms(res, output.data(), 0.5f, 0.45f, &scratch);
+      detections += res.size();
+
+      cv::Mat view;
+      sensor_msgs::ImagePtr raw = img_pools[i].acquire(msgs[i].header, "bgr8", frames[i].rows, frames[i].cols, &view);
+      frames[i].copyTo(view);
+      if (jpeg_)
+        jpeg_encoders[i].encode(view, raw->header);
+    }
+    for (int i = 0; i < kCameras; ++i)
+      frames[i].release();
+  }
+
+  size_t message_allocations() const
+  {
+    size_t n = 0;
+    for (int i = 0; i < kCameras; ++i)
+      n += img_pools[i].allocations() + jpeg_encoders[i].allocations();
+    return n;
+  }
+
+private:
+  bool jpeg_;
+};
+}  // namespace
+
+void* operator new(size_t size)
+{
+  return counted_malloc(size);
+}
+
+void* operator new[](size_t size)
+{
+  return counted_malloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  std::free(p);
+}
+
+TEST(CycleAllocations, steadyStateCyclesDoNotAllocate)
+{
+  // 单线程执行, 避免 parallel_for_ 的任务对象计入; cv::imencode 每次都会创建编码器, 只测 turbojpeg
+  const int threads = cv::getNumThreads();
+  cv::setNumThreads(0);
+  Cycle cycle(cv_bridge::JpegEncoder::usingTurboJpeg());
+  // 预热: 内存池, 消息池和 scratch 的容量在前几个周期内稳定
+  for (int n = 0; n < 3; ++n)
+    cycle.run();
+
+  const FramePoolStats before = FramePool::instance().stats();
+  const size_t messages = cycle.message_allocations();
+  g_allocations = 0;
+  g_counting = true;
+  for (int n = 0; n < 300; ++n)
+    cycle.run();
+  g_counting = false;
+  const FramePoolStats after = FramePool::instance().stats();
+  cv::setNumThreads(threads);
+
+  EXPECT_EQ(0u, g_allocations.load());
+  EXPECT_EQ(before.allocations, after.allocations);
+  // 每个相机每周期一次: 第二次回调从内存池取回上一周期检测循环释放的缓存
+  EXPECT_EQ(before.reuses + 300u * kCameras, after.reuses);
+  EXPECT_EQ(messages, cycle.message_allocations());
+  EXPECT_EQ(2u * kCameras, cycle.detections);
+  // rgb8 -> bgr8 的常量图像转换后不变
+  EXPECT_EQ(40 * 3, cycle.slots[3].at<cv::Vec3b>(0, 0)[0]);
+}
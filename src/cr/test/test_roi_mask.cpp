@@ -0,0 +1,101 @@
+#include "tld_detector/roi_mask.hpp"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+const cv::Size kImgSize(752, 480);
+
+// 图像下半部分, 贴着左/右/下边缘
+std::vector<std::vector<cv::Point> > lower_half()
+{
+  std::vector<cv::Point> polygon = { cv::Point(0, 240), cv::Point(751, 240), cv::Point(751, 479), cv::Point(0, 479) };
+  return std::vector<std::vector<cv::Point> >(1, polygon);
+}
+}  // namespace
+
+TEST(RoiMask, emptyPolygonsKeepWholeImage)
+{
+  RoiMask mask;
+  ASSERT_TRUE(mask.init(std::vector<std::vector<cv::Point> >(), kImgSize));
+  EXPECT_TRUE(mask.empty());
+  EXPECT_EQ(cv::Rect(cv::Point(0, 0), kImgSize), mask.bounding_rect());
+}
+
+TEST(RoiMask, invalidPolygonsFailInit)
+{
+  RoiMask mask;
+  std::vector<std::vector<cv::Point> > two_points(1, { cv::Point(0, 0), cv::Point(10, 10) });
+  EXPECT_FALSE(mask.init(two_points, kImgSize));
+  std::vector<std::vector<cv::Point> > outside(1, { cv::Point(800, 0), cv::Point(900, 0), cv::Point(900, 100) });
+  EXPECT_FALSE(mask.init(outside, kImgSize));
+  EXPECT_FALSE(mask.init(lower_half(), cv::Size()));
+}
+
+TEST(RoiMask, boundingRectIsClippedToImage)
+{
+  RoiMask mask;
+  std::vector<std::vector<cv::Point> > polygons(1, { cv::Point(-100, 300), cv::Point(900, 300), cv::Point(900, 600), cv::Point(-100, 600) });
+  ASSERT_TRUE(mask.init(polygons, kImgSize));
+  EXPECT_FALSE(mask.empty());
+  EXPECT_EQ(cv::Rect(0, 300, 752, 180), mask.bounding_rect());
+}
+
+TEST(RoiMask, footPointInsideAndOutside)
+{
+  RoiMask mask;
+  ASSERT_TRUE(mask.init(lower_half(), kImgSize));
+  EXPECT_EQ(cv::Rect(0, 240, 752, 240), mask.bounding_rect());
+  // 脚点 (350, 399) 在区域内, 上半身在区域外也算
+  EXPECT_TRUE(mask.contains_foot(cv::Rect(300, 100, 100, 300)));
+  // 脚点 (350, 199) 在区域外
+  EXPECT_FALSE(mask.contains_foot(cv::Rect(300, 50, 100, 150)));
+  EXPECT_TRUE(mask.contains(0, 479));
+  EXPECT_FALSE(mask.contains(0, 480));
+  EXPECT_FALSE(mask.contains(-1, 300));
+}
+
+TEST(RoiMask, edgeBoxesClampFootToImage)
+{
+  RoiMask mask;
+  ASSERT_TRUE(mask.init(lower_half(), kImgSize));
+  // 靠近车辆的人框底边超出图像
+  EXPECT_TRUE(mask.contains_foot(cv::Rect(300, 300, 100, 400)));
+  // 中心在图像左侧/右侧之外
+  EXPECT_TRUE(mask.contains_foot(cv::Rect(-120, 300, 100, 250)));
+  EXPECT_TRUE(mask.contains_foot(cv::Rect(740, 300, 100, 250)));
+  // 整个框在图像下方之外
+  EXPECT_TRUE(mask.contains_foot(cv::Rect(300, 500, 50, 50)));
+  // 框在图像上方之外, 脚点限制到第0行, 仍在区域外
+  EXPECT_FALSE(mask.contains_foot(cv::Rect(300, -200, 50, 100)));
+}
+
+TEST(RoiMask, loadFromCameraConfig)
+{
+  char path[64];
+  std::snprintf(path, sizeof(path), "/tmp/test_roi_mask_%d.yaml", static_cast<int>(getpid()));
+  {
+    std::ofstream out(path);
+    out << "/camera/front:\n"
+           "  img_size: [752, 480]\n"
+           "  roi_polygons: [[[0, 240], [751, 240], [751, 479], [0, 479]]]\n"
+           "/camera/back:\n"
+           "  img_size: [752, 480]\n";
+  }
+  std::vector<RoiMask> masks;
+  ASSERT_TRUE(load_roi_masks(path, { "/camera/front", "/camera/back", "/camera/left" }, &masks));
+  ASSERT_EQ(3u, masks.size());
+  EXPECT_FALSE(masks[0].empty());
+  EXPECT_EQ(kImgSize, masks[0].img_size());
+  EXPECT_TRUE(masks[0].contains_foot(cv::Rect(300, 300, 100, 400)));
+  EXPECT_TRUE(masks[1].empty());
+  EXPECT_TRUE(masks[2].empty());
+  std::remove(path);
+}
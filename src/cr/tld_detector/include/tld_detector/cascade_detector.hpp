@@ -0,0 +1,86 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 23:24:40
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 23:24:40
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/include/tld_detector/cascade_detector.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <memory>
+#include <string>
+#include <vector>
+// local headers
+#include "common_utils/metrics.hpp"
+#include "tld_detector/tld_detector.hpp"
+
+struct CascadeOptions {
+  // 复核模型只处理包含所有候选框的区域, false 时有候选的帧整帧复核
+  bool crop = true;
+  // 候选框向外扩大的比例(相对框的宽高), 给复核模型留出上下文
+  float crop_margin = 0.5f;
+};
+
+/**
+ * @description: 两级检测: 小模型(低分辨率, 阈值偏低保证召回)初筛每一帧,
+ * 只有出现候选的帧交给大模型复核, 输出大模型的结果.
+ * 复核区域不小于大模型的输入尺寸, 原图足够大时候选区域按原分辨率送入大模型.
+ * 场景中大部分帧没有人, 平均只需要小模型的开销.
+ * 推理服务模式下只有复核模型使用推理服务, 初筛模型在本进程推理.
+ */
+class CascadeDetector final : public TLDDetector {
+public:
+  /**
+   * @description: 两个模型各自按自己的 yaml 选择预编译的检测器
+   * @param {std::string} screen_path : 初筛模型的权重
+   * @param {std::string} verifier_path : 复核模型的权重
+   * @return {std::unique_ptr<TLDDetector>} 任一模型没有匹配的检测器时为空
+   */
+  static std::unique_ptr<TLDDetector> create(const std::string &screen_path,
+                                             const std::string &verifier_path,
+                                             int cpu_threads,
+                                             const CascadeOptions &options);
+
+  CascadeDetector(std::unique_ptr<TLDDetector> screen,
+                  std::unique_ptr<TLDDetector> verifier,
+                  const CascadeOptions &options);
+
+  bool init() override;
+  // 原始接口直接使用复核模型
+  float *input_buffer() override { return verifier_->input_buffer(); }
+  const float *output_buffer() const override {
+    return verifier_->output_buffer();
+  }
+  bool infer(int batch_size) override { return verifier_->infer(batch_size); }
+
+private:
+  bool detect_batch(const std::vector<cv::Mat> &frame,
+                    const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+                    std::vector<std::vector<cr_object>> *detected_objects,
+                    int batch_size,
+                    const std::vector<DetectRegion> *regions) override;
+  // 包含所有候选框的复核区域
+  cv::Rect candidate_roi(const cv::Mat &img,
+                         const std::vector<cr_object> &candidates) const;
+
+  std::unique_ptr<TLDDetector> screen_;
+  std::unique_ptr<TLDDetector> verifier_;
+  CascadeOptions options_;
+
+  // 每帧复用
+  std::vector<std::vector<cr_object>> screen_objects_;
+  std::vector<cv::Mat> verify_frames_;
+  std::vector<sensor_msgs::ImageConstPtr> verify_msgs_;
+  std::vector<std::vector<cr_object>> verify_objects_;
+  std::vector<int> verify_index_;
+  std::vector<cv::Point> verify_offset_;
+  std::vector<DetectRegion> verify_regions_;
+
+  MetricCounter *screened_ = nullptr;
+  MetricCounter *verified_ = nullptr;
+};
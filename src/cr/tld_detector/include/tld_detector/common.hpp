@@ -2,6 +2,7 @@
 
 // c system headers
 // cpp system headers
+#include <algorithm>
 #include <fstream>
 #include <map>
 #include <sstream>
@@ -60,6 +61,42 @@ static void nms(std::vector<Yolo::Detection>& res, float* output, float conf_thr
   }
 }
 
+// 与上面的 nms 结果相同, 但不用 std::map 和 erase: 候选框按 (类别, 置信度) 排序后
+// 在 scratch 中原地标记被抑制的框, scratch 和 res 的容量稳定后不再分配内存
+// keep(det) 为 false 的候选框在 NMS 之前丢弃
+template <typename Keep>
+static void nms(std::vector<Yolo::Detection>& res, float* output, float conf_thresh, float nms_thresh,
+                std::vector<Yolo::Detection>* scratch, Keep keep) {
+  int det_size = sizeof(Yolo::Detection) / sizeof(float);
+  auto& dets = *scratch;
+  dets.clear();
+  for (int i = 0; i < output[0] && i < Yolo::MAX_OUTPUT_BBOX_COUNT; i++) {
+    if (output[1 + det_size * i + 4] <= conf_thresh) continue;
+    Yolo::Detection det;
+    memcpy(&det, &output[1 + det_size * i], det_size * sizeof(float));
+    if (!keep(det)) continue;
+    dets.push_back(det);
+  }
+  std::sort(dets.begin(), dets.end(), [](const Yolo::Detection& a, const Yolo::Detection& b) {
+    return a.class_id != b.class_id ? a.class_id < b.class_id : a.conf > b.conf;
+  });
+  for (size_t m = 0; m < dets.size(); ++m) {
+    auto& item = dets[m];
+    if (item.conf < 0) continue;  // 已被抑制
+    res.push_back(item);
+    for (size_t n = m + 1; n < dets.size() && dets[n].class_id == item.class_id; ++n) {
+      if (dets[n].conf >= 0 && iou(item.bbox, dets[n].bbox) > nms_thresh) {
+        dets[n].conf = -1.f;
+      }
+    }
+  }
+}
+
+static void nms(std::vector<Yolo::Detection>& res, float* output, float conf_thresh, float nms_thresh,
+                std::vector<Yolo::Detection>* scratch) {
+  nms(res, output, conf_thresh, nms_thresh, scratch, [](Yolo::Detection&) { return true; });
+}
+
 // TensorRT weight files have a simple space delimited format:
 // [type] [size] <data x size in hex>
 static std::map<std::string, Weights> loadWeights(const std::string file) {
@@ -154,14 +191,14 @@ static ILayer* convBlock(INetworkDefinition* network, std::map<std::string, Weig
 
 static ILayer* focus(INetworkDefinition* network, std::map<std::string, Weights>& weightMap, ITensor& input, int inch,
                      int outch, int ksize, std::string lname) {
-  ISliceLayer* s1 =
-      network->addSlice(input, Dims3{0, 0, 0}, Dims3{inch, Yolo::INPUT_H / 2, Yolo::INPUT_W / 2}, Dims3{1, 2, 2});
-  ISliceLayer* s2 =
-      network->addSlice(input, Dims3{0, 1, 0}, Dims3{inch, Yolo::INPUT_H / 2, Yolo::INPUT_W / 2}, Dims3{1, 2, 2});
-  ISliceLayer* s3 =
-      network->addSlice(input, Dims3{0, 0, 1}, Dims3{inch, Yolo::INPUT_H / 2, Yolo::INPUT_W / 2}, Dims3{1, 2, 2});
-  ISliceLayer* s4 =
-      network->addSlice(input, Dims3{0, 1, 1}, Dims3{inch, Yolo::INPUT_H / 2, Yolo::INPUT_W / 2}, Dims3{1, 2, 2});
+  // 切片尺寸取自网络输入, 不同输入尺寸的模型共用
+  const Dims dims = input.getDimensions();
+  const int h = dims.d[1] / 2;
+  const int w = dims.d[2] / 2;
+  ISliceLayer* s1 = network->addSlice(input, Dims3{0, 0, 0}, Dims3{inch, h, w}, Dims3{1, 2, 2});
+  ISliceLayer* s2 = network->addSlice(input, Dims3{0, 1, 0}, Dims3{inch, h, w}, Dims3{1, 2, 2});
+  ISliceLayer* s3 = network->addSlice(input, Dims3{0, 0, 1}, Dims3{inch, h, w}, Dims3{1, 2, 2});
+  ISliceLayer* s4 = network->addSlice(input, Dims3{0, 1, 1}, Dims3{inch, h, w}, Dims3{1, 2, 2});
   ITensor* inputTensors[] = {s1->getOutput(0), s2->getOutput(0), s3->getOutput(0), s4->getOutput(0)};
   auto cat = network->addConcatenation(inputTensors, 4);
   auto conv = convBlock(network, weightMap, *cat->getOutput(0), outch, ksize, 1, 1, lname + ".conv");
@@ -256,11 +293,12 @@ static std::vector<std::vector<float>> getAnchors(std::map<std::string, Weights>
 }
 
 static IPluginV2Layer* addYoLoLayer(INetworkDefinition* network, std::map<std::string, Weights>& weightMap,
-                                    std::string lname, std::vector<IConvolutionLayer*> dets) {
+                                    std::string lname, std::vector<IConvolutionLayer*> dets, int class_num,
+                                    int input_w, int input_h) {
   auto creator = getPluginRegistry()->getPluginCreator("YoloLayer_TRT", "1");
   auto anchors = getAnchors(weightMap, lname);
   PluginField plugin_fields[2];
-  int netinfo[4] = {Yolo::CLASS_NUM, Yolo::INPUT_W, Yolo::INPUT_H, Yolo::MAX_OUTPUT_BBOX_COUNT};
+  int netinfo[4] = {class_num, input_w, input_h, Yolo::MAX_OUTPUT_BBOX_COUNT};
   plugin_fields[0].data = netinfo;
   plugin_fields[0].length = 4;
   plugin_fields[0].name = "netinfo";
@@ -269,8 +307,8 @@ static IPluginV2Layer* addYoLoLayer(INetworkDefinition* network, std::map<std::s
   std::vector<Yolo::YoloKernel> kernels;
   for (size_t i = 0; i < anchors.size(); i++) {
     Yolo::YoloKernel kernel;
-    kernel.width = Yolo::INPUT_W / scale;
-    kernel.height = Yolo::INPUT_H / scale;
+    kernel.width = input_w / scale;
+    kernel.height = input_h / scale;
     memcpy(kernel.anchors, &anchors[i][0], anchors[i].size() * sizeof(float));
     kernels.push_back(kernel);
     scale *= 2;
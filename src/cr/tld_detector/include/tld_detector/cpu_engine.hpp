@@ -0,0 +1,135 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 18:40:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 18:40:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/include/tld_detector/cpu_engine.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+// local headers
+#include "tld_detector/yolo_config.hpp"
+
+class CpuThreadPool;
+
+/**
+ * @description: 不依赖 TensorRT/CUDA 的 yolov5 CPU 推理
+ * 读取 api_to_model 使用的同一份 .wts, 按 common.hpp 的结构(focus/convBlock/
+ * bottleneck/C3/SPP, build_engine 与 build_engine_p6 两种网络)构建计算图.
+ * 加载时把 BN 折叠进卷积权重, Conv+BN+SiLU(以及 bottleneck 的 shortcut)
+ * 在一次 GEMM 的收尾中完成. 卷积按像素块做 im2col, 再用 8x8 寄存器分块的
+ * GEMM 计算, 任务按 batch/像素块/输出通道块划分到线程池.
+ * 输入输出与 TensorRT engine 的 data/prob 格式相同.
+ * 输入尺寸和类别数在运行时给出, 各层形状由它们和权重推出.
+ */
+class CpuYoloEngine {
+public:
+  // num_threads <= 0 时使用全部核
+  CpuYoloEngine(const std::string &wts_path, int max_batch_size, int input_w,
+                int input_h, int class_num, int num_threads = 0);
+  ~CpuYoloEngine();
+
+  bool init();
+  /**
+   * @description: 推理 batch_size 张图
+   * @param {const float*} input : batch_size * 3 * input_h * input_w, RGB 归一化的 CHW
+   * @param {float*} output : batch_size * output_size(), 每张图为 [数量, Detection...]
+   */
+  void infer(const float *input, float *output, int batch_size);
+
+  static int output_size() {
+    return Yolo::MAX_OUTPUT_BBOX_COUNT * sizeof(Yolo::Detection) /
+               sizeof(float) +
+           1;
+  }
+  bool is_p6() const { return is_p6_; }
+  int num_threads() const;
+
+private:
+  enum OpType { kConv, kFocus, kMaxPool, kUpsample, kConcat, kYolo };
+
+  // 单张图的形状, 数据按 NCHW 存放在 buffer 中, 序号 0 为网络输入
+  struct Tensor {
+    int c;
+    int h;
+    int w;
+    int buffer;
+    size_t size() const { return static_cast<size_t>(c) * h * w; }
+  };
+
+  struct Op {
+    OpType type;
+    std::vector<int> inputs;
+    int output = -1;
+    // kConv: weight 按 8 个输出通道一组打包为 [组][K][8], 不足的通道补0
+    int ksize = 1;
+    int stride = 1;
+    bool silu = true;
+    int residual = -1; // 收尾时加上的 shortcut tensor
+    std::vector<float> weight;
+    std::vector<float> bias;
+    // kMaxPool
+    int pool = 1;
+    // kYolo: 每个输出层 CHECK_COUNT 组 anchor(w, h)
+    std::vector<float> anchors;
+  };
+
+  bool load_weights();
+  const std::vector<float> &weight(const std::string &name);
+  int add_tensor(int c, int h, int w);
+  int add_conv(int input, int outch, int ksize, int s,
+               const std::vector<float> &weight, std::vector<float> bias,
+               bool silu);
+
+  // 与 common.hpp 中同名函数对应, 输出通道数和 C3 的深度从权重中得到
+  int conv_block(int input, int ksize, int s, int g, const std::string &lname);
+  int focus(int input, int ksize, const std::string &lname);
+  int bottleneck(int input, bool shortcut, int g, const std::string &lname);
+  int C3(int input, bool shortcut, int g, const std::string &lname);
+  int SPP(int input, int k1, int k2, int k3, const std::string &lname);
+  int upsample(int input, int like);
+  int concat(const std::vector<int> &inputs);
+  int detect(int input, const std::string &lname);
+  void yolo(const std::vector<int> &dets, const std::string &lname);
+  void build_engine();
+  void build_engine_p6();
+  void plan_buffers();
+
+  // 第 n 张图的数据, tensor_in 可以读取网络输入
+  const float *tensor_in(int tensor, int n) const;
+  float *tensor_out(int tensor, int n);
+  void run_conv(const Op &op, int batch_size);
+  void run_focus(const Op &op, int batch_size);
+  void run_max_pool(const Op &op, int batch_size);
+  void run_upsample(const Op &op, int batch_size);
+  void run_concat(const Op &op, int batch_size);
+  void run_yolo(const Op &op, int batch_size);
+
+  std::string wts_path_;
+  int max_batch_size_;
+  int input_w_;
+  int input_h_;
+  int class_num_;
+  int num_threads_;
+  bool is_p6_ = false;
+  bool weight_error_ = false;
+
+  std::map<std::string, std::vector<float>> weights_; // 只在构建时使用
+  std::vector<Tensor> tensors_;
+  std::vector<Op> ops_;
+  std::vector<std::vector<float>> buffers_;
+  std::vector<std::vector<float>> scratch_; // 每个线程一份 im2col/池化缓存
+  std::unique_ptr<CpuThreadPool> pool_;
+
+  const float *input_ = nullptr;
+  float *output_ = nullptr;
+};
@@ -0,0 +1,59 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 19:32:05
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 19:32:05
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/include/tld_detector/infer_client.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <cstddef>
+#include <cstdint>
+#include <string>
+// local headers
+#include "tld_detector/infer_ipc.hpp"
+
+/**
+ * @description: 推理服务的客户端, TLDDetector 在服务模式下使用
+ * input()/output() 指向共享内存, 预处理直接写入, 服务端推理后原地写回结果.
+ * 每次只有一个请求在途, 超时后在收到迟到的回复(或服务重启)之前
+ * ready() 返回 false, 避免改写服务端正在读取的输入.
+ */
+class InferClient {
+public:
+  // input_floats/output_floats : 每张图的输入/输出大小, 需要与服务端的模型一致
+  InferClient(const std::string &address, int max_batch, size_t input_floats,
+              size_t output_floats, int timeout_ms);
+  ~InferClient();
+
+  bool init();
+  float *input() const { return shm_.input(); }
+  float *output() const { return shm_.output(); }
+  // 没有在途的请求, 可以写入新的输入
+  bool ready();
+  // 推理 input() 中的前 batch_size 张图, 成功时结果在 output() 中
+  bool infer(int batch_size);
+
+private:
+  bool hello();
+  // 等待 seq 的回复, 丢弃更早请求的迟到回复
+  bool wait_reply(uint64_t seq, int timeout_ms, std::string *error);
+
+  std::string address_;
+  int max_batch_;
+  size_t input_floats_;
+  size_t output_floats_;
+  int timeout_ms_;
+  void *context_ = nullptr;
+  void *socket_ = nullptr;
+  infer_ipc::SharedTensors shm_;
+  bool registered_ = false;
+  uint64_t seq_ = 0;
+  bool outstanding_ = false;
+  int64_t outstanding_since_ms_ = 0;
+};
@@ -0,0 +1,91 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 19:32:05
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 19:32:05
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/include/tld_detector/infer_ipc.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * 推理服务与客户端之间的协议, 控制消息走 zmq ROUTER/DEALER(ipc://),
+ * 张量放在客户端创建的共享内存中, 每一帧都是文本:
+ *   客户端 -> 服务: "hello" <共享内存名> <max_batch> <pid> <seq>
+ *                   "infer" <seq> <batch>
+ *                   "bye"
+ *   服务 -> 客户端: "ok" <seq> | "done" <seq> | "error" <seq> <原因>
+ * 客户端的 zmq routing id 设为共享内存名, 服务重启后重新 hello 即可恢复.
+ */
+namespace infer_ipc {
+
+constexpr uint32_t kMagic = 0x43524946; // "CRIF"
+constexpr uint32_t kVersion = 1;
+
+// 每张图的输入为 load_img_to_data 之后的 CHW float, 输出与 prob 的格式相同,
+// 大小由模型决定(ModelMetadata::input_floats/output_floats), 记录在 header 中
+struct SharedTensorHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t max_batch;
+  uint32_t input_floats;
+  uint32_t output_floats;
+};
+
+/**
+ * @description: 一个客户端的共享内存, 布局为 [header | 输入 x max_batch | 输出 x max_batch]
+ * 客户端 create 并在析构时 unlink, 服务端 open 后只 munmap
+ */
+class SharedTensors {
+public:
+  SharedTensors() = default;
+  ~SharedTensors();
+  SharedTensors(const SharedTensors &) = delete;
+  SharedTensors &operator=(const SharedTensors &) = delete;
+
+  bool create(const std::string &name, int max_batch, size_t input_floats,
+              size_t output_floats);
+  // 每张图的大小与 header 不一致时失败
+  bool open(const std::string &name, size_t input_floats,
+            size_t output_floats);
+  void close();
+  // 删除共享内存名, 已经映射的进程不受影响
+  void unlink();
+
+  float *input(int n = 0) const { return input_ + n * input_floats_; }
+  float *output(int n = 0) const { return output_ + n * output_floats_; }
+  int max_batch() const { return max_batch_; }
+  const std::string &name() const { return name_; }
+
+private:
+  bool map(int fd, size_t size);
+  static size_t region_size(int max_batch, size_t input_floats,
+                            size_t output_floats);
+
+  std::string name_;
+  void *addr_ = nullptr;
+  size_t size_ = 0;
+  bool owner_ = false;
+  int max_batch_ = 0;
+  size_t input_floats_ = 0;
+  size_t output_floats_ = 0;
+  float *input_ = nullptr;
+  float *output_ = nullptr;
+};
+
+// 多帧文本消息的收发, flags 为 ZMQ_DONTWAIT 等
+bool send_frames(void *socket, const std::vector<std::string> &frames,
+                 int flags = 0);
+bool recv_frames(void *socket, std::vector<std::string> *frames,
+                 int flags = 0);
+
+} // namespace infer_ipc
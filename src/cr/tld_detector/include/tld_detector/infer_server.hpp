@@ -0,0 +1,97 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 19:32:05
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 19:32:05
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/include/tld_detector/infer_server.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+// local headers
+#include "tld_detector/infer_ipc.hpp"
+
+class TLDDetector;
+
+struct InferServerOptions {
+  std::string address = std::string("ipc:///tmp/cr_infer_server");
+  // 收到第一个请求后最多等待多久凑 batch, batch 满时立即推理
+  int max_wait_us = 2000;
+};
+
+struct InferServerStats {
+  uint64_t batches = 0;
+  uint64_t images = 0;
+  uint64_t requests = 0;
+  uint64_t rejected = 0;
+  int clients = 0;
+};
+
+/**
+ * @description: 推理服务, 一个进程持有 engine, 多个 cr 进程通过 InferClient 共用
+ * 不同客户端的请求合并成一个 batch(动态 batching): 每一轮从轮转的起点开始,
+ * 每个客户端最多取一个请求, 直到 batch 装满或所有队列为空, 下一轮起点后移,
+ * 请求多的客户端不能挤占其它客户端.
+ */
+class InferServer {
+public:
+  // batch 上限和张量大小取自 detector->model()
+  InferServer(TLDDetector *detector, const InferServerOptions &options);
+  ~InferServer();
+
+  bool init();
+  // 处理控制消息, 凑够 batch 或等待超时后推理一次
+  void spin_once(int timeout_ms);
+  InferServerStats stats() const { return stats_; }
+
+private:
+  struct Request {
+    uint64_t seq;
+    int batch;
+    int64_t arrival_us;
+  };
+  struct Client {
+    std::string identity;
+    int pid = 0;
+    infer_ipc::SharedTensors shm;
+    std::deque<Request> queue;
+  };
+
+  void handle(const std::vector<std::string> &frames);
+  void handle_hello(const std::string &identity,
+                    const std::vector<std::string> &frames);
+  void reply(const std::string &identity,
+             const std::vector<std::string> &frames);
+  Client *find_client(const std::string &identity);
+  void remove_client(const std::string &identity);
+  // 回收已经退出的客户端进程的共享内存
+  void reap_clients();
+  bool batch_ready(int64_t now_us) const;
+  void dispatch();
+  int wait_timeout_ms(int timeout_ms, int64_t now_us) const;
+
+  TLDDetector *detector_;
+  int max_batch_;
+  size_t input_floats_;
+  size_t output_floats_;
+  InferServerOptions options_;
+  void *context_ = nullptr;
+  void *socket_ = nullptr;
+
+  std::vector<std::unique_ptr<Client>> clients_;
+  size_t cursor_ = 0; // 下一轮从这个客户端开始取请求
+  int pending_images_ = 0;
+  int64_t oldest_arrival_us_ = 0;
+  int64_t last_reap_us_ = 0;
+  InferServerStats stats_;
+};
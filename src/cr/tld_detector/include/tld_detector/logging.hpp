@@ -1,8 +1,6 @@
 #pragma once
 // cpp system headers
 #include <cassert>
-#include <ctime>
-#include <iomanip>
 #include <iostream>
 #include <ostream>
 #include <sstream>
@@ -11,6 +9,8 @@
 // third party headers
 // tensorrt
 #include "NvInferRuntimeCommon.h"
+// local headers
+#include "common_utils/async_logger.hpp"
 
 #if NV_TENSORRT_MAJOR >= 8
 #define TRT_NOEXCEPT noexcept
@@ -20,12 +20,30 @@
 
 using Severity = nvinfer1::ILogger::Severity;
 
+//!
+//! \brief Maps TensorRT severities onto the async logging backend
+//!
+inline LogLevel toLogLevel(Severity severity) {
+  switch (severity) {
+    case Severity::kINTERNAL_ERROR:
+      return LogLevel::kFatal;
+    case Severity::kERROR:
+      return LogLevel::kError;
+    case Severity::kWARNING:
+      return LogLevel::kWarn;
+    case Severity::kINFO:
+      return LogLevel::kInfo;
+    default:
+      return LogLevel::kDebug;
+  }
+}
+
 class LogStreamConsumerBuffer : public std::stringbuf {
  public:
-  LogStreamConsumerBuffer(std::ostream& stream, const std::string& prefix, bool shouldLog)
-      : mOutput(stream), mPrefix(prefix), mShouldLog(shouldLog) {}
+  LogStreamConsumerBuffer(Severity severity, const std::string& prefix, bool shouldLog)
+      : mSeverity(severity), mPrefix(prefix), mShouldLog(shouldLog) {}
 
-  LogStreamConsumerBuffer(LogStreamConsumerBuffer&& other) : mOutput(other.mOutput) {}
+  LogStreamConsumerBuffer(LogStreamConsumerBuffer&& other) : mSeverity(other.mSeverity) {}
 
   ~LogStreamConsumerBuffer() {
     // std::streambuf::pbase() gives a pointer to the beginning of the buffered part of the output sequence
@@ -38,8 +56,8 @@ class LogStreamConsumerBuffer : public std::stringbuf {
   }
 
   // synchronizes the stream buffer and returns 0 on success
-  // synchronizing the stream buffer consists of inserting the buffer contents into the stream,
-  // resetting the buffer and flushing the stream
+  // synchronizing the stream buffer consists of handing the buffer contents to the async logger
+  // and resetting the buffer
   virtual int sync() {
     putOutput();
     return 0;
@@ -47,30 +65,23 @@ class LogStreamConsumerBuffer : public std::stringbuf {
 
   void putOutput() {
     if (mShouldLog) {
-      // prepend timestamp
-      std::time_t timestamp = std::time(nullptr);
-      tm* tm_local = std::localtime(&timestamp);
-      std::cout << "[";
-      std::cout << std::setw(2) << std::setfill('0') << 1 + tm_local->tm_mon << "/";
-      std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_mday << "/";
-      std::cout << std::setw(4) << std::setfill('0') << 1900 + tm_local->tm_year << "-";
-      std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_hour << ":";
-      std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_min << ":";
-      std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_sec << "] ";
-      // std::stringbuf::str() gets the string contents of the buffer
-      // insert the buffer contents pre-appended by the appropriate prefix into the stream
-      mOutput << mPrefix << str();
-      // set the buffer to empty
-      str("");
-      // flush the stream
-      mOutput.flush();
+      // timestamp and severity tag are added by the logger thread, the caller never touches the console
+      std::string line = mPrefix + str();
+      while (!line.empty() && line.back() == '\n') {
+        line.pop_back();
+      }
+      if (!line.empty()) {
+        AsyncLogger::instance().log(toLogLevel(mSeverity), std::move(line));
+      }
     }
+    // set the buffer to empty
+    str("");
   }
 
   void setShouldLog(bool shouldLog) { mShouldLog = shouldLog; }
 
  private:
-  std::ostream& mOutput;
+  Severity mSeverity;
   std::string mPrefix;
   bool mShouldLog;
 };
@@ -81,8 +92,8 @@ class LogStreamConsumerBuffer : public std::stringbuf {
 //!
 class LogStreamConsumerBase {
  public:
-  LogStreamConsumerBase(std::ostream& stream, const std::string& prefix, bool shouldLog)
-      : mBuffer(stream, prefix, shouldLog) {}
+  LogStreamConsumerBase(Severity severity, const std::string& prefix, bool shouldLog)
+      : mBuffer(severity, prefix, shouldLog) {}
 
  protected:
   LogStreamConsumerBuffer mBuffer;
@@ -102,14 +113,14 @@ class LogStreamConsumer : protected LogStreamConsumerBase, public std::ostream {
   //! \brief Creates a LogStreamConsumer which logs messages with level severity.
   //!  Reportable severity determines if the messages are severe enough to be logged.
   LogStreamConsumer(Severity reportableSeverity, Severity severity)
-      : LogStreamConsumerBase(severityOstream(severity), severityPrefix(severity), severity <= reportableSeverity),
+      : LogStreamConsumerBase(severity, std::string(), severity <= reportableSeverity),
         std::ostream(&mBuffer)  // links the stream buffer with the stream
         ,
         mShouldLog(severity <= reportableSeverity),
         mSeverity(severity) {}
 
   LogStreamConsumer(LogStreamConsumer&& other)
-      : LogStreamConsumerBase(severityOstream(other.mSeverity), severityPrefix(other.mSeverity), other.mShouldLog),
+      : LogStreamConsumerBase(other.mSeverity, std::string(), other.mShouldLog),
         std::ostream(&mBuffer)  // links the stream buffer with the stream
         ,
         mShouldLog(other.mShouldLog),
@@ -121,28 +132,6 @@ class LogStreamConsumer : protected LogStreamConsumerBase, public std::ostream {
   }
 
  private:
-  static std::ostream& severityOstream(Severity severity) {
-    return severity >= Severity::kINFO ? std::cout : std::cerr;
-  }
-
-  static std::string severityPrefix(Severity severity) {
-    switch (severity) {
-      case Severity::kINTERNAL_ERROR:
-        return "[F] ";
-      case Severity::kERROR:
-        return "[E] ";
-      case Severity::kWARNING:
-        return "[W] ";
-      case Severity::kINFO:
-        return "[I] ";
-      case Severity::kVERBOSE:
-        return "[V] ";
-      default:
-        assert(0);
-        return "";
-    }
-  }
-
   bool mShouldLog;
   Severity mSeverity;
 };
@@ -201,8 +190,13 @@ class Logger : public nvinfer1::ILogger {
   //! Note samples should not be calling this function directly; it will eventually go away once we eliminate the
   //! inheritance from nvinfer1::ILogger
   //!
+  //! Called from the inference thread, so the message is only queued; formatting and output happen on the
+  //! AsyncLogger thread.
+  //!
   void log(Severity severity, const char* msg) TRT_NOEXCEPT override {
-    LogStreamConsumer(mReportableSeverity, severity) << "[TRT] " << std::string(msg) << std::endl;
+    if (severity <= mReportableSeverity) {
+      AsyncLogger::instance().log(toLogLevel(severity), std::string("[TRT] ") + msg);
+    }
   }
 
   //!
@@ -0,0 +1,93 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 22:58:20
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 22:58:20
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/include/tld_detector/model_config.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <cstddef>
+#include <string>
+// local headers
+#include "tld_detector/yolo_config.hpp"
+
+enum class ModelPrecision { kFP32, kFP16, kINT8 };
+
+bool parse_model_precision(const std::string &name, ModelPrecision *precision);
+const char *model_precision_name(ModelPrecision precision);
+
+/**
+ * @description: 模型的运行时描述, 从权重旁边同名的 .yaml 读取(best.engine -> best.yaml):
+ *   input_width: 512
+ *   input_height: 512
+ *   max_batch: 4          # engine 构建时的 maxBatchSize
+ *   class_num: 1
+ *   precision: fp16       # fp32/fp16/int8, 由 .wts 构建 engine 时使用
+ *   conf_thresh: 0.6
+ *   nms_thresh: 0.25
+ * 没有 yaml 时为以下默认值. TLDDetector::create 按形状选择预编译的 YoloDetector<Config>.
+ */
+struct ModelMetadata {
+  int input_w = 512;
+  int input_h = 512;
+  int max_batch = 4;
+  int class_num = 1;
+  ModelPrecision precision = ModelPrecision::kFP16;
+  float conf_thresh = 0.6f;
+  float nms_thresh = 0.25f;
+
+  // 每张图的网络输入为 RGB 归一化的 CHW float
+  size_t input_floats() const {
+    return static_cast<size_t>(3) * input_w * input_h;
+  }
+  // 每张图的输出为 [数量, Detection x MAX_OUTPUT_BBOX_COUNT]
+  static size_t output_floats() {
+    return 1 + Yolo::MAX_OUTPUT_BBOX_COUNT * sizeof(Yolo::Detection) /
+                   sizeof(float);
+  }
+  // 例如 "512x512x4 1 class"
+  std::string name() const;
+};
+
+/**
+ * @description: 读取 weight_path 对应的 yaml
+ * @param {std::string} weight_path : .engine 或 .wts 的路径
+ * @param {ModelMetadata*} model : 输出, yaml 中没有的字段保留原值
+ * @return {bool} yaml 不存在时返回 true, 格式错误时返回 false
+ */
+bool load_model_metadata(const std::string &weight_path, ModelMetadata *model);
+
+/**
+ * @description: 编译期的模型形状, 预处理/后处理按它特化, 循环边界都是常量
+ */
+template <int InputW, int InputH, int MaxBatch, int ClassNum = 1>
+struct ModelConfig {
+  static_assert(InputW % 32 == 0 && InputH % 32 == 0,
+                "yolov5's input height and width must be divisible by 32");
+  static_assert(MaxBatch > 0 && ClassNum > 0, "invalid model config");
+  static constexpr int kInputW = InputW;
+  static constexpr int kInputH = InputH;
+  static constexpr int kMaxBatch = MaxBatch;
+  static constexpr int kClassNum = ClassNum;
+  static constexpr size_t kInputFloats = static_cast<size_t>(3) * InputW * InputH;
+  static constexpr size_t kOutputFloats =
+      1 + Yolo::MAX_OUTPUT_BBOX_COUNT * sizeof(Yolo::Detection) / sizeof(float);
+};
+
+template <int W, int H, int B, int C> constexpr int ModelConfig<W, H, B, C>::kInputW;
+template <int W, int H, int B, int C> constexpr int ModelConfig<W, H, B, C>::kInputH;
+template <int W, int H, int B, int C> constexpr int ModelConfig<W, H, B, C>::kMaxBatch;
+template <int W, int H, int B, int C> constexpr int ModelConfig<W, H, B, C>::kClassNum;
+template <int W, int H, int B, int C> constexpr size_t ModelConfig<W, H, B, C>::kInputFloats;
+template <int W, int H, int B, int C> constexpr size_t ModelConfig<W, H, B, C>::kOutputFloats;
+
+// 预编译的模型, 新增时在 tld_detector.cpp 中显式实例化并加入 kModelVariants
+using Yolo512x512x4 = ModelConfig<512, 512, 4>; // 原来的默认模型
+using Yolo640x384x8 = ModelConfig<640, 384, 8>;
+using Yolo320x320x1 = ModelConfig<320, 320, 1>;
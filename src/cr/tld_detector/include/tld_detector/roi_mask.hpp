@@ -0,0 +1,85 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 23:58:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 23:58:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/include/tld_detector/roi_mask.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <algorithm>
+#include <string>
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/core.hpp"
+
+/**
+ * @description: 单个相机的静态检测区域, 多边形以外(车身/天空)不可能出现需要报警的人.
+ * 检测器只把多边形的外接矩形送入网络, 脚点(框底边中点)落在区域外的框在 NMS 之前丢弃.
+ * 多边形在 init 时栅格化为与图像同尺寸的位图, 每个候选框只查一次表.
+ */
+class RoiMask {
+public:
+  /**
+   * @description: 栅格化检测区域
+   * @param {std::vector<std::vector<cv::Point>>} polygons : 原图坐标, 为空时不限制
+   * @param {cv::Size} img_size : 检测器收到的图像尺寸
+   * @return {bool} 多边形少于3个点或完全在图像外时为 false
+   */
+  bool init(const std::vector<std::vector<cv::Point>> &polygons,
+            cv::Size img_size);
+
+  bool empty() const { return bitmap_.empty(); }
+  const cv::Size &img_size() const { return img_size_; }
+  // 送入检测器的区域
+  const cv::Rect &bounding_rect() const { return bounding_rect_; }
+  // 原图坐标, 图像外为 false
+  bool contains(int x, int y) const {
+    return x >= 0 && y >= 0 && x < bitmap_.cols && y < bitmap_.rows &&
+           bitmap_.ptr<uchar>(y)[x] != 0;
+  }
+  // 按脚点判断, 人的上半身可以在区域外(例如越过车身边缘).
+  // 检测框没有裁剪到图像内, 靠近车辆的人脚点常在图像外, 先把脚点限制到图像边缘
+  bool contains_foot(const cv::Rect &box) const {
+    if (bitmap_.empty()) {
+      return false;
+    }
+    const int x =
+        std::min(std::max(box.x + box.width / 2, 0), bitmap_.cols - 1);
+    const int y =
+        std::min(std::max(box.y + box.height - 1, 0), bitmap_.rows - 1);
+    return bitmap_.ptr<uchar>(y)[x] != 0;
+  }
+
+private:
+  cv::Mat bitmap_;
+  cv::Size img_size_;
+  cv::Rect bounding_rect_;
+};
+
+// 检测器输入帧对应的原图区域
+struct DetectRegion {
+  const RoiMask *mask = nullptr;
+  // 输入帧左上角在原图中的坐标
+  cv::Point offset;
+};
+
+/**
+ * @description: 从相机配置(camera_config.yaml)读取每个相机的检测区域:
+ *   /camera/front:
+ *     img_size: [752, 480]
+ *     roi_size: [752, 480]      # 可选, 多边形所在的图像尺寸, 默认 img_size
+ *     roi_polygons: [[[0, 120], [752, 120], [752, 480], [0, 480]]]
+ * 没有 roi_polygons 的相机得到空掩码, 不裁剪也不过滤.
+ * @param {std::vector<std::string>} camera_ids : 与检测的相机顺序一致
+ * @return {bool} 文件或多边形格式错误时为 false
+ */
+bool load_roi_masks(const std::string &config_path,
+                    const std::vector<std::string> &camera_ids,
+                    std::vector<RoiMask> *masks);
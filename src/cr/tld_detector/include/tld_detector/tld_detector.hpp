@@ -15,6 +15,7 @@
 #include <chrono>
 #include <cmath>
 #include <iostream>
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
@@ -22,79 +23,191 @@
 // opencv
 #include "opencv2/dnn/dnn.hpp"
 #include "opencv2/opencv.hpp"
+// ros
+#include "sensor_msgs/Image.h"
 // local headers
+#include "cv_bridge/blob.h"
+#include "common_utils/frame_pool.hpp"
 #include "common_utils/opencv_extension.hpp"
+#include "common_utils/trace.hpp"
 #include "tld_detector/calibrator.hpp"
 #include "tld_detector/common.hpp"
+#include "tld_detector/cpu_engine.hpp"
 #include "tld_detector/cuda_utils.hpp"
+#include "tld_detector/infer_client.hpp"
 #include "tld_detector/logging.hpp"
+#include "tld_detector/model_config.hpp"
+#include "tld_detector/roi_mask.hpp"
 
-#define USE_FP16 // set USE_INT8 or USE_FP16 or USE_FP32
-#define DEVICE 0 // GPU id
-#define NMS_THRESH 0.25
-#define CONF_THRESH 0.6
-#define BATCH_SIZE 4
-
+/**
+ * @description: 检测器接口, 具体实现为按模型形状编译的 YoloDetector<Config>
+ * 通过 create 创建: 读取权重旁边的 yaml(见 ModelMetadata), 在预编译的形状中选择.
+ */
 class TLDDetector {
 public:
-  // yolov5 openvino构造
-  // xml_path ： xml文件路径
-  // cof_threshold ： 框置信度乘以物品种类置信度
-  // nms_area_threshold ： nms最小重叠面积阈值
-  explicit TLDDetector(std::string engine_file_path)
-      : engine_file_path_(engine_file_path) {}
-
-  ~TLDDetector() {
-    // Release stream and buffers
-    cudaStreamDestroy(stream);
-    CUDA_CHECK(cudaFree(buffers[inputIndex]));
-    CUDA_CHECK(cudaFree(buffers[outputIndex]));
-    // Destroy the engine
-    context->destroy();
-    engine->destroy();
-    runtime->destroy();
+  virtual ~TLDDetector() = default;
+
+  /**
+   * @description: 按模型的 yaml 选择预编译的检测器
+   * 优先选择输入尺寸/类别数/batch 完全一致的形状, 否则选择输入尺寸和类别数一致,
+   * batch 不超过 engine maxBatchSize 的最大形状
+   * @param {std::string} engine_file_path : 以 .wts 结尾时使用 CPU 推理
+   * @param {int} cpu_threads : CPU 推理的线程数, <= 0 时使用全部核
+   * @return {std::unique_ptr<TLDDetector>} yaml 格式错误或没有匹配的形状时为空
+   */
+  static std::unique_ptr<TLDDetector> create(const std::string &engine_file_path,
+                                             int cpu_threads = 0);
+  // 预编译的形状, 用于日志
+  static std::vector<std::string> variants();
+
+  const ModelMetadata &model() const { return model_; }
+
+  // 在 init 之前调用, 推理交给 address 上的推理服务(cr_infer_server),
+  // 预处理/后处理仍在本进程, timeout_ms 内没有结果时本次 detect 返回 false
+  void use_inference_server(const std::string &address, int timeout_ms);
+  virtual bool init() = 0;
+  bool detect(const std::vector<cv::Mat> &frame,
+              std::vector<std::vector<cr_object>> *detected_objects) {
+    return detect_batch(frame, std::vector<sensor_msgs::ImageConstPtr>(),
+                        detected_objects, static_cast<int>(frame.size()),
+                        nullptr);
   }
+  // msgs[i] 不为空且编码支持时直接从原始消息生成网络输入(一次融合的并行处理),
+  // 否则使用 frame[i]. frame[i] 只用于把bbox换算回原图, 尺寸需要与 msgs[i] 一致
+  // batch_size : 只检测前 batch_size 帧, 调度器跳过部分相机时缩小 batch,
+  // < 0 时检测全部帧. 超过模型的 max_batch 时分多次推理
+  bool detect(const std::vector<cv::Mat> &frame,
+              const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+              std::vector<std::vector<cr_object>> *detected_objects,
+              int batch_size = -1) {
+    return detect_batch(frame, msgs, detected_objects,
+                        batch_size < 0 ? static_cast<int>(frame.size())
+                                       : batch_size,
+                        nullptr);
+  }
+  // masks[i] 不为空时只检测 frame[i] 中掩码的外接矩形, 结果仍为原图坐标,
+  // 脚点在掩码外的框在 NMS 之前丢弃. 尺寸与掩码不一致的帧不使用掩码
+  bool detect(const std::vector<cv::Mat> &frame,
+              const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+              const std::vector<const RoiMask *> &masks,
+              std::vector<std::vector<cr_object>> *detected_objects,
+              int batch_size = -1);
+
+  // 推理服务直接使用的原始接口: 把预处理后的 CHW float 写入 input_buffer(),
+  // infer 之后从 output_buffer() 读取 yololayer 格式的结果
+  virtual float *input_buffer() = 0;
+  virtual const float *output_buffer() const = 0;
+  // 推理 input_buffer() 中的前 batch_size 帧(<= model().max_batch)
+  virtual bool infer(int batch_size) = 0;
+
+protected:
+  TLDDetector(const std::string &engine_file_path, int cpu_threads,
+              const ModelMetadata &model)
+      : engine_file_path_(engine_file_path), cpu_threads_(cpu_threads),
+        model_(model) {}
+
+  // regions 为空时不过滤, 否则 (*regions)[i] 为 frame[i] 在原图中的位置和掩码
+  virtual bool
+  detect_batch(const std::vector<cv::Mat> &frame,
+               const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+               std::vector<std::vector<cr_object>> *detected_objects,
+               int batch_size, const std::vector<DetectRegion> *regions) = 0;
+  // 组合检测器直接调用内部检测器的 detect_batch, 传递裁剪后的区域
+  friend class CascadeDetector;
 
-  bool init();
-  bool detect(std::vector<cv::Mat> frame, std::vector<std::vector<cr_object>> *detected_objects);
-
-private:
-  bool engine_init();
   static int get_width(int x, float gw, int divisor = 8);
   static int get_depth(int x, float gd);
-  void post_process(const std::vector<cv::Mat> &img,
-                    std::vector<std::vector<cr_object>> *detected_objects);
+  static float calculate_depth(cv::Rect box);
 
-  // load img from cpu memory to gpu memory
-  void load_img_to_data(const std::vector<cv::Mat> &img);
+  std::string engine_file_path_;
+  // .wts 权重直接在 CPU 上推理, 不创建 TensorRT/CUDA 资源
+  int cpu_threads_ = 0;
+  // 阈值和精度在运行时使用, 形状与 Config 一致
+  ModelMetadata model_;
+
+  // 推理服务模式
+  std::string server_address_;
+  int server_timeout_ms_ = 0;
 
 private:
-  std::string engine_file_path_;
+  // 使用掩码时每帧复用
+  std::vector<cv::Mat> masked_frames_;
+  std::vector<sensor_msgs::ImageConstPtr> masked_msgs_;
+  std::vector<DetectRegion> regions_;
+  std::vector<size_t> object_begin_;
+};
+
+/**
+ * @description: 按 Config(ModelConfig<W, H, MaxBatch, ClassNum>)编译的 yolov5 检测器
+ * 预处理/后处理的循环边界和缓存大小都是编译期常量.
+ * 在 tld_detector.cpp 中显式实例化, 新增形状时同时加入 kModelVariants.
+ */
+template <typename Config> class YoloDetector final : public TLDDetector {
+public:
+  YoloDetector(const std::string &engine_file_path, int cpu_threads,
+               const ModelMetadata &model);
+  ~YoloDetector() override;
+
+  bool init() override;
+  float *input_buffer() override { return data; }
+  const float *output_buffer() const override { return prob; }
+  bool infer(int batch_size) override;
+
+private:
+  bool detect_batch(const std::vector<cv::Mat> &frame,
+                    const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+                    std::vector<std::vector<cr_object>> *detected_objects,
+                    int batch_size,
+                    const std::vector<DetectRegion> *regions) override;
+  bool engine_init();
+  bool cpu_engine_init();
+  // 第 begin 帧开始的 batch_size 帧(<= kMaxBatch)
+  void post_process(const std::vector<cv::Mat> &img, int begin,
+                    std::vector<std::vector<cr_object>> *detected_objects,
+                    int batch_size, const std::vector<DetectRegion> *regions);
+
+  // load img from cpu memory to gpu memory
+  void load_img_to_data(const std::vector<cv::Mat> &img,
+                        const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+                        int begin, int batch_size);
 
   // stuff we know about the network and the input/output blobs
-  static const int INPUT_H = Yolo::INPUT_H;
-  static const int INPUT_W = Yolo::INPUT_W;
-  static const int CLASS_NUM = Yolo::CLASS_NUM;
-  static const int OUTPUT_SIZE =
-      Yolo::MAX_OUTPUT_BBOX_COUNT * sizeof(Yolo::Detection) / sizeof(float) +
-      1; // we assume the yololayer outputs no more than MAX_OUTPUT_BBOX_COUNT
-         // boxes that conf >= 0.1
+  static constexpr int INPUT_H = Config::kInputH;
+  static constexpr int INPUT_W = Config::kInputW;
+  static constexpr int CLASS_NUM = Config::kClassNum;
+  static constexpr int MAX_BATCH = Config::kMaxBatch;
+  static constexpr int INPUT_SIZE = static_cast<int>(Config::kInputFloats);
+  // we assume the yololayer outputs no more than MAX_OUTPUT_BBOX_COUNT boxes
+  // that conf >= 0.1
+  static constexpr int OUTPUT_SIZE = static_cast<int>(Config::kOutputFloats);
   const char *INPUT_BLOB_NAME = "data";
   const char *OUTPUT_BLOB_NAME = "prob";
   Logger gLogger;
 
-  float data[BATCH_SIZE * 3 * INPUT_H * INPUT_W];
-  float prob[BATCH_SIZE * OUTPUT_SIZE];
+  // 本进程推理时指向 host_data_/host_prob_, 服务模式下指向共享内存
+  float *data = nullptr;
+  float *prob = nullptr;
+  std::vector<float> host_data_;
+  std::vector<float> host_prob_;
 
-  IRuntime *runtime;
-  ICudaEngine *engine;
-  IExecutionContext *context;
+  IRuntime *runtime = nullptr;
+  ICudaEngine *engine = nullptr;
+  IExecutionContext *context = nullptr;
   cudaStream_t stream;
 
-  void *buffers[2];
+  std::unique_ptr<CpuYoloEngine> cpu_engine_;
+  std::unique_ptr<InferClient> infer_client_;
+
+  void *buffers[2] = {nullptr, nullptr};
   int inputIndex;
   int outputIndex;
 
+  // 每帧复用的中间结果, 稳定运行后不再分配内存
+  std::array<cv::Mat, MAX_BATCH> letterbox_;
+  std::array<cv::Mat, MAX_BATCH> resized_;
+  std::array<std::vector<Yolo::Detection>, MAX_BATCH> batch_res_;
+  std::vector<Yolo::Detection> nms_scratch_;
+
   ICudaEngine *build_engine(unsigned int maxBatchSize, IBuilder *builder,
                             IBuilderConfig *config, DataType dt, float &gd,
                             float &gw, std::string &wts_name);
@@ -103,12 +216,17 @@ private:
                                IBuilderConfig *config, DataType dt, float &gd,
                                float &gw, std::string &wts_name);
 
+  // 按 model_.precision 设置 fp16/int8
+  void set_precision(IBuilder *builder, IBuilderConfig *config);
+
   void api_to_model(unsigned int maxBatchSize, IHostMemory **modelStream,
                     bool &is_p6, float &gd, float &gw, std::string &wts_name);
 
   void _do_inference(IExecutionContext &context, cudaStream_t &stream,
                      void **buffers, float *input, float *output,
                      int batchSize);
-
-  float calculate_depth(cv::Rect box);
 };
+
+extern template class YoloDetector<Yolo512x512x4>;
+extern template class YoloDetector<Yolo640x384x8>;
+extern template class YoloDetector<Yolo320x320x1>;
@@ -0,0 +1,35 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 18:40:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 18:40:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/include/tld_detector/yolo_config.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+
+// 网络和输出格式的常量, 不依赖 TensorRT, CPU 推理也使用
+namespace Yolo {
+static constexpr int CHECK_COUNT = 3;
+static constexpr float IGNORE_THRESH = 0.1f;
+struct YoloKernel {
+  int width;
+  int height;
+  float anchors[CHECK_COUNT * 2];
+};
+static constexpr int MAX_OUTPUT_BBOX_COUNT = 1000;
+// 输入尺寸/类别数/batch 见 model_config.hpp
+
+
+static constexpr int LOCATIONS = 4;
+struct alignas(float) Detection {
+  // center_x center_y w h
+  float bbox[LOCATIONS];
+  float conf;  // bbox_conf * cls_conf
+  float class_id;
+};
+}  // namespace Yolo
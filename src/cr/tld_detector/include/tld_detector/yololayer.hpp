@@ -6,6 +6,8 @@
 // third party headers
 // tensorrt
 #include "NvInfer.h"
+// local headers
+#include "tld_detector/yolo_config.hpp"
 
 #if NV_TENSORRT_MAJOR >= 8
 #define TRT_NOEXCEPT noexcept
@@ -15,29 +17,6 @@
 #define TRT_CONST_ENQUEUE
 #endif
 
-namespace Yolo {
-static constexpr int CHECK_COUNT = 3;
-static constexpr float IGNORE_THRESH = 0.1f;
-struct YoloKernel {
-  int width;
-  int height;
-  float anchors[CHECK_COUNT * 2];
-};
-static constexpr int MAX_OUTPUT_BBOX_COUNT = 1000;
-static constexpr int CLASS_NUM = 1;  // 修改为当前的类别数量
-static constexpr int INPUT_H = 512;  // yolov5's input height and width must be divisible by 32. 默认640
-static constexpr int INPUT_W = 512;
-
-
-static constexpr int LOCATIONS = 4;
-struct alignas(float) Detection {
-  // center_x center_y w h
-  float bbox[LOCATIONS];
-  float conf;  // bbox_conf * cls_conf
-  float class_id;
-};
-}  // namespace Yolo
-
 namespace nvinfer1 {
 class YoloLayerPlugin : public IPluginV2IOExt {
  public:
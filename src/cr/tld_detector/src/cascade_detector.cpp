@@ -0,0 +1,170 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 23:24:40
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 23:24:40
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/src/cascade_detector.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <algorithm>
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "tld_detector/cascade_detector.hpp"
+
+std::unique_ptr<TLDDetector>
+CascadeDetector::create(const std::string &screen_path,
+                        const std::string &verifier_path, int cpu_threads,
+                        const CascadeOptions &options) {
+  std::unique_ptr<TLDDetector> screen =
+      TLDDetector::create(screen_path, cpu_threads);
+  std::unique_ptr<TLDDetector> verifier =
+      TLDDetector::create(verifier_path, cpu_threads);
+  if (!screen || !verifier) {
+    return nullptr;
+  }
+  return std::unique_ptr<TLDDetector>(
+      new CascadeDetector(std::move(screen), std::move(verifier), options));
+}
+
+CascadeDetector::CascadeDetector(std::unique_ptr<TLDDetector> screen,
+                                 std::unique_ptr<TLDDetector> verifier,
+                                 const CascadeOptions &options)
+    : TLDDetector(std::string(), 0, verifier->model()),
+      screen_(std::move(screen)), verifier_(std::move(verifier)),
+      options_(options) {}
+
+bool CascadeDetector::init() {
+  if (!server_address_.empty()) {
+    verifier_->use_inference_server(server_address_, server_timeout_ms_);
+  }
+  if (!screen_->init()) {
+    ALOG_ERROR_STREAM("[ CascadeDetector ] screen model init failed");
+    return false;
+  }
+  if (!verifier_->init()) {
+    ALOG_ERROR_STREAM("[ CascadeDetector ] verifier model init failed");
+    return false;
+  }
+  MetricsRegistry &registry = MetricsRegistry::instance();
+  screened_ = registry.counter("cr_cascade_screened_frames_total",
+                               MetricLabels(),
+                               "frames checked by the screen model");
+  verified_ = registry.counter("cr_cascade_verified_frames_total",
+                               MetricLabels(),
+                               "frames with candidates sent to the verifier");
+  ALOG_INFO_STREAM("[ CascadeDetector ] screen " << screen_->model().name()
+                   << ", verifier " << verifier_->model().name()
+                   << (options_.crop ? ", crop candidates" : ", full frames"));
+  return true;
+}
+
+bool CascadeDetector::detect_batch(
+    const std::vector<cv::Mat> &frame,
+    const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+    std::vector<std::vector<cr_object>> *detected_objects, int batch_size,
+    const std::vector<DetectRegion> *regions) {
+  batch_size = std::min(batch_size, static_cast<int>(frame.size()));
+  if (batch_size <= 0) {
+    return false;
+  }
+  screen_objects_.resize(batch_size);
+  for (int i = 0; i < batch_size; i++) {
+    screen_objects_[i].clear();
+  }
+  {
+    TRACE_SCOPE("cascade_screen");
+    // 初筛已经按掩码过滤, 区域外的候选不会触发复核
+    if (!screen_->detect_batch(frame, msgs, &screen_objects_, batch_size,
+                               regions)) {
+      return false;
+    }
+  }
+  screened_->add(batch_size);
+
+  verify_frames_.clear();
+  verify_msgs_.clear();
+  verify_index_.clear();
+  verify_offset_.clear();
+  verify_regions_.clear();
+  for (int i = 0; i < batch_size; i++) {
+    if (screen_objects_[i].empty() || frame[i].empty()) {
+      continue;
+    }
+    const cv::Rect roi = options_.crop
+                             ? candidate_roi(frame[i], screen_objects_[i])
+                             : cv::Rect(0, 0, frame[i].cols, frame[i].rows);
+    // 只引用原图的区域, 不拷贝
+    verify_frames_.push_back(frame[i](roi));
+    // 整帧复核时仍然可以从原始消息直接生成网络输入
+    const bool full = roi.size() == frame[i].size();
+    verify_msgs_.push_back(full && i < static_cast<int>(msgs.size())
+                               ? msgs[i]
+                               : sensor_msgs::ImageConstPtr());
+    verify_index_.push_back(i);
+    verify_offset_.push_back(roi.tl());
+    if (regions != nullptr) {
+      DetectRegion region = (*regions)[i];
+      region.offset += roi.tl();
+      verify_regions_.push_back(region);
+    }
+  }
+  const int n = static_cast<int>(verify_frames_.size());
+  if (n == 0) {
+    return detected_objects->size() > 0;
+  }
+  verified_->add(n);
+
+  verify_objects_.resize(n);
+  for (int k = 0; k < n; k++) {
+    verify_objects_[k].clear();
+  }
+  bool verified = false;
+  {
+    TRACE_SCOPE_ARG("cascade_verify", n);
+    verified = verifier_->detect_batch(verify_frames_, verify_msgs_,
+                                       &verify_objects_, n,
+                                       regions != nullptr ? &verify_regions_
+                                                          : nullptr);
+  }
+  // 复核后(包括失败时)不再引用原图和原始消息, 否则 cr 回调的备用缓存要重新分配;
+  // clear 保留容量
+  verify_frames_.clear();
+  verify_msgs_.clear();
+  if (!verified) {
+    return false;
+  }
+  for (int k = 0; k < n; k++) {
+    std::vector<cr_object> &out = detected_objects->at(verify_index_[k]);
+    for (cr_object &object : verify_objects_[k]) {
+      object.bbox += verify_offset_[k];
+      out.push_back(object);
+    }
+  }
+  return detected_objects->size() > 0;
+}
+
+cv::Rect CascadeDetector::candidate_roi(
+    const cv::Mat &img, const std::vector<cr_object> &candidates) const {
+  cv::Rect roi;
+  for (const cr_object &object : candidates) {
+    const int dx = static_cast<int>(object.bbox.width * options_.crop_margin);
+    const int dy = static_cast<int>(object.bbox.height * options_.crop_margin);
+    const cv::Rect box(object.bbox.x - dx, object.bbox.y - dy,
+                       object.bbox.width + 2 * dx,
+                       object.bbox.height + 2 * dy);
+    roi = roi.area() == 0 ? box : (roi | box);
+  }
+  // 不小于复核模型的输入, 不放大图像, 小目标按原分辨率复核
+  const int w = std::min(img.cols, std::max(roi.width, model_.input_w));
+  const int h = std::min(img.rows, std::max(roi.height, model_.input_h));
+  const int x = std::min(std::max(roi.x + roi.width / 2 - w / 2, 0),
+                         img.cols - w);
+  const int y = std::min(std::max(roi.y + roi.height / 2 - h / 2, 0),
+                         img.rows - h);
+  return cv::Rect(x, y, w, h);
+}
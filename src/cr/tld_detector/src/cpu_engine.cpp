@@ -0,0 +1,883 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 18:40:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 18:40:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/src/cpu_engine.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "tld_detector/cpu_engine.hpp"
+
+namespace {
+
+constexpr int kMR = 8;     // GEMM 寄存器块: 8 个输出通道
+constexpr int kNR = 8;     //               x 8 个像素
+constexpr int kTileN = 64; // 每个任务处理的像素数, im2col 缓存为 K x kTileN
+constexpr float kBnEps = 1e-3f; // 与 convBlock 中 addBatchNorm2d 的 eps 一致
+
+inline float sigmoid(float x) { return 1.f / (1.f + std::exp(-x)); }
+
+/**
+ * @description: 把输入的一个像素块展开为 K x kTileN 的矩阵, 超出的列补0
+ * @param {int} p0 : 像素块在输出特征图中的起始位置
+ */
+void im2col_tile(const float *x, int channels, int in_h, int in_w, int ksize,
+                 int stride, int out_w, int out_n, int p0, float *b) {
+  const int cols = std::min(kTileN, out_n - p0);
+  const int in_n = in_h * in_w;
+  if (ksize == 1 && stride == 1) {
+    // 1x1 卷积不需要展开, 只是把像素块拷贝成连续的行
+    for (int c = 0; c < channels; c++) {
+      float *row = b + c * kTileN;
+      std::memcpy(row, x + c * in_n + p0, cols * sizeof(float));
+      std::fill(row + cols, row + kTileN, 0.f);
+    }
+    return;
+  }
+  const int pad = ksize / 2;
+  int iy0[kTileN];
+  int ix0[kTileN];
+  for (int j = 0; j < cols; j++) {
+    const int p = p0 + j;
+    iy0[j] = (p / out_w) * stride - pad;
+    ix0[j] = (p % out_w) * stride - pad;
+  }
+  for (int c = 0; c < channels; c++) {
+    const float *plane = x + c * in_n;
+    for (int ky = 0; ky < ksize; ky++) {
+      for (int kx = 0; kx < ksize; kx++) {
+        float *row = b + ((c * ksize + ky) * ksize + kx) * kTileN;
+        for (int j = 0; j < cols; j++) {
+          const int iy = iy0[j] + ky;
+          const int ix = ix0[j] + kx;
+          row[j] = static_cast<unsigned>(iy) < static_cast<unsigned>(in_h) &&
+                           static_cast<unsigned>(ix) <
+                               static_cast<unsigned>(in_w)
+                       ? plane[iy * in_w + ix]
+                       : 0.f;
+        }
+        std::fill(row + cols, row + kTileN, 0.f);
+      }
+    }
+  }
+}
+
+/**
+ * @description: C[8][kNR] = A[K][8]^T * B[K][kNR], 内层循环由编译器向量化
+ * (x86 为 AVX/SSE, ARM 为 NEON), 累加器保持在寄存器中
+ */
+inline void gemm_micro(const float *a, const float *b, int k_dim,
+                       float acc[kMR][kNR]) {
+  for (int r = 0; r < kMR; r++) {
+    for (int c = 0; c < kNR; c++) {
+      acc[r][c] = 0.f;
+    }
+  }
+  for (int k = 0; k < k_dim; k++) {
+    const float *ak = a + k * kMR;
+    const float *bk = b + k * kTileN;
+    for (int r = 0; r < kMR; r++) {
+      const float av = ak[r];
+      for (int c = 0; c < kNR; c++) {
+        acc[r][c] += av * bk[c];
+      }
+    }
+  }
+}
+
+} // namespace
+
+/////////////////////////////// CpuThreadPool ///////////////////////////////
+
+// 常驻线程池, run 在调用线程上也执行任务, 全部完成后返回
+class CpuThreadPool {
+public:
+  explicit CpuThreadPool(int threads) {
+    for (int i = 1; i < threads; i++) {
+      workers_.emplace_back(&CpuThreadPool::worker, this, i);
+    }
+  }
+
+  ~CpuThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+  // fn(task, thread) : thread 为 [0, size()) 内的线程序号, 用于选择缓存
+  void run(int tasks, const std::function<void(int, int)> &fn) {
+    if (tasks <= 0) {
+      return;
+    }
+    if (workers_.empty() || tasks == 1) {
+      for (int i = 0; i < tasks; i++) {
+        fn(i, 0);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      fn_ = &fn;
+      tasks_ = tasks;
+      next_.store(0, std::memory_order_relaxed);
+      active_ = static_cast<int>(workers_.size());
+      ++generation_;
+    }
+    start_cv_.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return active_ == 0; });
+    fn_ = nullptr;
+  }
+
+private:
+  void work(int thread) {
+    for (;;) {
+      const int task = next_.fetch_add(1, std::memory_order_relaxed);
+      if (task >= tasks_) {
+        return;
+      }
+      (*fn_)(task, thread);
+    }
+  }
+
+  void worker(int thread) {
+    uint64_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) {
+          return;
+        }
+        seen = generation_;
+      }
+      work(thread);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--active_ == 0) {
+        done_cv_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(int, int)> *fn_ = nullptr;
+  int tasks_ = 0;
+  std::atomic<int> next_{0};
+  int active_ = 0;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+};
+
+/////////////////////////////// CpuYoloEngine ///////////////////////////////
+
+CpuYoloEngine::CpuYoloEngine(const std::string &wts_path, int max_batch_size,
+                             int input_w, int input_h, int class_num,
+                             int num_threads)
+    : wts_path_(wts_path), max_batch_size_(max_batch_size), input_w_(input_w),
+      input_h_(input_h), class_num_(class_num), num_threads_(num_threads) {
+  if (num_threads_ <= 0) {
+    num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+CpuYoloEngine::~CpuYoloEngine() = default;
+
+int CpuYoloEngine::num_threads() const { return num_threads_; }
+
+bool CpuYoloEngine::init() {
+  if (max_batch_size_ <= 0) {
+    ALOG_ERROR_STREAM("[ CpuYoloEngine ] invalid max batch size : "
+                      << max_batch_size_);
+    return false;
+  }
+  if (!load_weights()) {
+    return false;
+  }
+  tensors_.clear();
+  ops_.clear();
+  add_tensor(3, input_h_, input_w_);
+  // p6 网络的检测层为 model.33, p5 为 model.24
+  is_p6_ = weights_.count("model.33.anchor_grid") > 0;
+  if (is_p6_) {
+    build_engine_p6();
+  } else {
+    build_engine();
+  }
+  weights_.clear();
+  if (weight_error_) {
+    ALOG_ERROR_STREAM("[ CpuYoloEngine ] weights do not match the yolov5"
+                      << (is_p6_ ? " p6" : "") << " network : " << wts_path_);
+    return false;
+  }
+  plan_buffers();
+  pool_.reset(new CpuThreadPool(num_threads_));
+  size_t buffer_bytes = 0;
+  for (const auto &buffer : buffers_) {
+    buffer_bytes += buffer.size() * sizeof(float);
+  }
+  ALOG_INFO_STREAM("[ CpuYoloEngine ] " << ops_.size() << " ops, "
+                                        << buffers_.size() << " buffers ("
+                                        << (buffer_bytes >> 20) << " MB), "
+                                        << num_threads_ << " threads");
+  return true;
+}
+
+// .wts 格式: 第一行为数量, 之后每行 [名字] [数量] <十六进制的 float 位>
+bool CpuYoloEngine::load_weights() {
+  std::ifstream input(wts_path_);
+  if (!input.is_open()) {
+    ALOG_ERROR_STREAM("[ CpuYoloEngine ] unable to open weight file : "
+                      << wts_path_);
+    return false;
+  }
+  int32_t count = 0;
+  input >> count;
+  if (count <= 0) {
+    ALOG_ERROR_STREAM("[ CpuYoloEngine ] invalid weight file : " << wts_path_);
+    return false;
+  }
+  weights_.clear();
+  std::string name;
+  std::string hex;
+  while (count--) {
+    uint32_t size = 0;
+    if (!(input >> name >> std::dec >> size)) {
+      ALOG_ERROR_STREAM("[ CpuYoloEngine ] truncated weight file : "
+                        << wts_path_);
+      return false;
+    }
+    std::vector<float> &values = weights_[name];
+    values.resize(size);
+    for (uint32_t i = 0; i < size && input >> hex; i++) {
+      const uint32_t bits =
+          static_cast<uint32_t>(std::strtoul(hex.c_str(), nullptr, 16));
+      std::memcpy(&values[i], &bits, sizeof(float));
+    }
+    if (!input) {
+      ALOG_ERROR_STREAM("[ CpuYoloEngine ] truncated weight : " << name);
+      return false;
+    }
+  }
+  return true;
+}
+
+const std::vector<float> &CpuYoloEngine::weight(const std::string &name) {
+  static const std::vector<float> empty;
+  auto it = weights_.find(name);
+  if (it == weights_.end()) {
+    ALOG_ERROR_STREAM("[ CpuYoloEngine ] missing weight : " << name);
+    weight_error_ = true;
+    return empty;
+  }
+  return it->second;
+}
+
+int CpuYoloEngine::add_tensor(int c, int h, int w) {
+  tensors_.push_back(Tensor{c, h, w, -1});
+  return static_cast<int>(tensors_.size()) - 1;
+}
+
+int CpuYoloEngine::add_conv(int input, int outch, int ksize, int s,
+                            const std::vector<float> &weight,
+                            std::vector<float> bias, bool silu) {
+  const Tensor in = tensors_[input];
+  const int k_dim = in.c * ksize * ksize;
+  if (outch <= 0 || weight.size() != static_cast<size_t>(outch) * k_dim ||
+      bias.size() != static_cast<size_t>(outch)) {
+    weight_error_ = true;
+    outch = std::max(outch, 1);
+  }
+  const int pad = ksize / 2;
+  const int out_h = (in.h + 2 * pad - ksize) / s + 1;
+  const int out_w = (in.w + 2 * pad - ksize) / s + 1;
+
+  Op op;
+  op.type = kConv;
+  op.inputs.push_back(input);
+  op.output = add_tensor(outch, out_h, out_w);
+  op.ksize = ksize;
+  op.stride = s;
+  op.silu = silu;
+  bias.resize(outch, 0.f);
+  op.bias = std::move(bias);
+  // [oc][K] 打包为 [oc/8][K][8], 微内核每次读取连续的 8 个通道
+  const int blocks = (outch + kMR - 1) / kMR;
+  op.weight.assign(static_cast<size_t>(blocks) * k_dim * kMR, 0.f);
+  if (!weight_error_) {
+    for (int oc = 0; oc < outch; oc++) {
+      float *dst = op.weight.data() + (oc / kMR) * k_dim * kMR + oc % kMR;
+      const float *src = weight.data() + static_cast<size_t>(oc) * k_dim;
+      for (int k = 0; k < k_dim; k++) {
+        dst[k * kMR] = src[k];
+      }
+    }
+  }
+  ops_.push_back(std::move(op));
+  return ops_.back().output;
+}
+
+int CpuYoloEngine::conv_block(int input, int ksize, int s, int g,
+                              const std::string &lname) {
+  if (g != 1) {
+    ALOG_ERROR_STREAM("[ CpuYoloEngine ] grouped conv is not supported : "
+                      << lname);
+    weight_error_ = true;
+  }
+  const std::vector<float> &w = weight(lname + ".conv.weight");
+  const std::vector<float> &gamma = weight(lname + ".bn.weight");
+  const std::vector<float> &beta = weight(lname + ".bn.bias");
+  const std::vector<float> &mean = weight(lname + ".bn.running_mean");
+  const std::vector<float> &var = weight(lname + ".bn.running_var");
+  const int outch = static_cast<int>(var.size());
+  if (gamma.size() != var.size() || beta.size() != var.size() ||
+      mean.size() != var.size() || outch == 0 ||
+      w.size() % static_cast<size_t>(outch) != 0) {
+    weight_error_ = true;
+    return add_conv(input, 0, ksize, s, w, {}, true);
+  }
+  // BN 折叠进卷积: w' = w * gamma / sqrt(var + eps), b' = beta - mean * 同一系数
+  const size_t k_dim = w.size() / outch;
+  std::vector<float> folded(w.size());
+  std::vector<float> bias(outch);
+  for (int oc = 0; oc < outch; oc++) {
+    const float scale = gamma[oc] / std::sqrt(var[oc] + kBnEps);
+    for (size_t k = 0; k < k_dim; k++) {
+      folded[oc * k_dim + k] = w[oc * k_dim + k] * scale;
+    }
+    bias[oc] = beta[oc] - mean[oc] * scale;
+  }
+  return add_conv(input, outch, ksize, s, folded, std::move(bias), true);
+}
+
+int CpuYoloEngine::focus(int input, int ksize, const std::string &lname) {
+  const Tensor in = tensors_[input];
+  Op op;
+  op.type = kFocus;
+  op.inputs.push_back(input);
+  op.output = add_tensor(in.c * 4, in.h / 2, in.w / 2);
+  ops_.push_back(std::move(op));
+  return conv_block(ops_.back().output, ksize, 1, 1, lname + ".conv");
+}
+
+int CpuYoloEngine::bottleneck(int input, bool shortcut, int g,
+                              const std::string &lname) {
+  const int cv1 = conv_block(input, 1, 1, 1, lname + ".cv1");
+  const int cv2 = conv_block(cv1, 3, 1, g, lname + ".cv2");
+  if (shortcut && tensors_[input].c == tensors_[cv2].c) {
+    // shortcut 在 cv2 的收尾中相加, 不单独生成 tensor
+    ops_.back().residual = input;
+  }
+  return cv2;
+}
+
+int CpuYoloEngine::C3(int input, bool shortcut, int g,
+                      const std::string &lname) {
+  const int cv1 = conv_block(input, 1, 1, 1, lname + ".cv1");
+  const int cv2 = conv_block(input, 1, 1, 1, lname + ".cv2");
+  int y1 = cv1;
+  // 深度由 get_depth(n, gd) 决定, .wts 中有几个 m.i 就是几层
+  for (int i = 0;
+       weights_.count(lname + ".m." + std::to_string(i) + ".cv1.conv.weight");
+       i++) {
+    y1 = bottleneck(y1, shortcut, g, lname + ".m." + std::to_string(i));
+  }
+  const int cat = concat({y1, cv2});
+  return conv_block(cat, 1, 1, 1, lname + ".cv3");
+}
+
+int CpuYoloEngine::SPP(int input, int k1, int k2, int k3,
+                       const std::string &lname) {
+  const int cv1 = conv_block(input, 1, 1, 1, lname + ".cv1");
+  std::vector<int> cat_inputs = {cv1};
+  for (int k : {k1, k2, k3}) {
+    const Tensor t = tensors_[cv1];
+    Op op;
+    op.type = kMaxPool;
+    op.inputs.push_back(cv1);
+    op.output = add_tensor(t.c, t.h, t.w);
+    op.pool = k;
+    ops_.push_back(std::move(op));
+    cat_inputs.push_back(ops_.back().output);
+  }
+  const int cat = concat(cat_inputs);
+  return conv_block(cat, 1, 1, 1, lname + ".cv2");
+}
+
+int CpuYoloEngine::upsample(int input, int like) {
+  const Tensor in = tensors_[input];
+  const Tensor target = tensors_[like];
+  if (target.h % in.h != 0 || target.w % in.w != 0) {
+    weight_error_ = true;
+  }
+  Op op;
+  op.type = kUpsample;
+  op.inputs.push_back(input);
+  op.output = add_tensor(in.c, target.h, target.w);
+  ops_.push_back(std::move(op));
+  return ops_.back().output;
+}
+
+int CpuYoloEngine::concat(const std::vector<int> &inputs) {
+  const Tensor first = tensors_[inputs[0]];
+  int channels = 0;
+  for (int input : inputs) {
+    const Tensor &t = tensors_[input];
+    if (t.h != first.h || t.w != first.w) {
+      weight_error_ = true;
+    }
+    channels += t.c;
+  }
+  Op op;
+  op.type = kConcat;
+  op.inputs = inputs;
+  op.output = add_tensor(channels, first.h, first.w);
+  ops_.push_back(std::move(op));
+  return ops_.back().output;
+}
+
+int CpuYoloEngine::detect(int input, const std::string &lname) {
+  const std::vector<float> &w = weight(lname + ".weight");
+  const std::vector<float> &b = weight(lname + ".bias");
+  const int outch = static_cast<int>(b.size());
+  if (outch != Yolo::CHECK_COUNT * (class_num_ + 5)) {
+    ALOG_ERROR_STREAM("[ CpuYoloEngine ] " << lname << " has " << outch
+                                           << " outputs, class_num is "
+                                           << class_num_);
+    weight_error_ = true;
+  }
+  return add_conv(input, outch, 1, 1, w, b, false);
+}
+
+void CpuYoloEngine::yolo(const std::vector<int> &dets,
+                         const std::string &lname) {
+  Op op;
+  op.type = kYolo;
+  op.inputs = dets;
+  op.anchors = weight(lname + ".anchor_grid");
+  if (op.anchors.size() != dets.size() * Yolo::CHECK_COUNT * 2) {
+    weight_error_ = true;
+  }
+  ops_.push_back(std::move(op));
+}
+
+// 与 TLDDetector::build_engine 相同的 yolov5 p5 网络
+void CpuYoloEngine::build_engine() {
+  /* ------ yolov5 backbone------ */
+  const int focus0 = focus(0, 3, "model.0");
+  const int conv1 = conv_block(focus0, 3, 2, 1, "model.1");
+  const int bottleneck_csp2 = C3(conv1, true, 1, "model.2");
+  const int conv3 = conv_block(bottleneck_csp2, 3, 2, 1, "model.3");
+  const int bottleneck_csp4 = C3(conv3, true, 1, "model.4");
+  const int conv5 = conv_block(bottleneck_csp4, 3, 2, 1, "model.5");
+  const int bottleneck_csp6 = C3(conv5, true, 1, "model.6");
+  const int conv7 = conv_block(bottleneck_csp6, 3, 2, 1, "model.7");
+  const int spp8 = SPP(conv7, 5, 9, 13, "model.8");
+
+  /* ------ yolov5 head ------ */
+  const int bottleneck_csp9 = C3(spp8, false, 1, "model.9");
+  const int conv10 = conv_block(bottleneck_csp9, 1, 1, 1, "model.10");
+  const int upsample11 = upsample(conv10, bottleneck_csp6);
+  const int cat12 = concat({upsample11, bottleneck_csp6});
+  const int bottleneck_csp13 = C3(cat12, false, 1, "model.13");
+  const int conv14 = conv_block(bottleneck_csp13, 1, 1, 1, "model.14");
+  const int upsample15 = upsample(conv14, bottleneck_csp4);
+  const int cat16 = concat({upsample15, bottleneck_csp4});
+  const int bottleneck_csp17 = C3(cat16, false, 1, "model.17");
+
+  /* ------ detect ------ */
+  const int det0 = detect(bottleneck_csp17, "model.24.m.0");
+  const int conv18 = conv_block(bottleneck_csp17, 3, 2, 1, "model.18");
+  const int cat19 = concat({conv18, conv14});
+  const int bottleneck_csp20 = C3(cat19, false, 1, "model.20");
+  const int det1 = detect(bottleneck_csp20, "model.24.m.1");
+  const int conv21 = conv_block(bottleneck_csp20, 3, 2, 1, "model.21");
+  const int cat22 = concat({conv21, conv10});
+  const int bottleneck_csp23 = C3(cat22, false, 1, "model.23");
+  const int det2 = detect(bottleneck_csp23, "model.24.m.2");
+  yolo({det0, det1, det2}, "model.24");
+}
+
+// 与 TLDDetector::build_engine_p6 相同的 yolov5 p6 网络
+void CpuYoloEngine::build_engine_p6() {
+  /* ------ yolov5 backbone------ */
+  const int focus0 = focus(0, 3, "model.0");
+  const int conv1 = conv_block(focus0, 3, 2, 1, "model.1");
+  const int c3_2 = C3(conv1, true, 1, "model.2");
+  const int conv3 = conv_block(c3_2, 3, 2, 1, "model.3");
+  const int c3_4 = C3(conv3, true, 1, "model.4");
+  const int conv5 = conv_block(c3_4, 3, 2, 1, "model.5");
+  const int c3_6 = C3(conv5, true, 1, "model.6");
+  const int conv7 = conv_block(c3_6, 3, 2, 1, "model.7");
+  const int c3_8 = C3(conv7, true, 1, "model.8");
+  const int conv9 = conv_block(c3_8, 3, 2, 1, "model.9");
+  const int spp10 = SPP(conv9, 3, 5, 7, "model.10");
+  const int c3_11 = C3(spp10, false, 1, "model.11");
+
+  /* ------ yolov5 head ------ */
+  const int conv12 = conv_block(c3_11, 1, 1, 1, "model.12");
+  const int upsample13 = upsample(conv12, c3_8);
+  const int cat14 = concat({upsample13, c3_8});
+  const int c3_15 = C3(cat14, false, 1, "model.15");
+
+  const int conv16 = conv_block(c3_15, 1, 1, 1, "model.16");
+  const int upsample17 = upsample(conv16, c3_6);
+  const int cat18 = concat({upsample17, c3_6});
+  const int c3_19 = C3(cat18, false, 1, "model.19");
+
+  const int conv20 = conv_block(c3_19, 1, 1, 1, "model.20");
+  const int upsample21 = upsample(conv20, c3_4);
+  const int cat22 = concat({upsample21, c3_4});
+  const int c3_23 = C3(cat22, false, 1, "model.23");
+
+  const int conv24 = conv_block(c3_23, 3, 2, 1, "model.24");
+  const int cat25 = concat({conv24, conv20});
+  const int c3_26 = C3(cat25, false, 1, "model.26");
+
+  const int conv27 = conv_block(c3_26, 3, 2, 1, "model.27");
+  const int cat28 = concat({conv27, conv16});
+  const int c3_29 = C3(cat28, false, 1, "model.29");
+
+  const int conv30 = conv_block(c3_29, 3, 2, 1, "model.30");
+  const int cat31 = concat({conv30, conv12});
+  const int c3_32 = C3(cat31, false, 1, "model.32");
+
+  /* ------ detect ------ */
+  const int det0 = detect(c3_23, "model.33.m.0");
+  const int det1 = detect(c3_26, "model.33.m.1");
+  const int det2 = detect(c3_29, "model.33.m.2");
+  const int det3 = detect(c3_32, "model.33.m.3");
+  yolo({det0, det1, det2, det3}, "model.33");
+}
+
+// 按最后一次使用的位置回收中间结果, 之后的 op 复用同一块内存
+void CpuYoloEngine::plan_buffers() {
+  std::vector<int> last_use(tensors_.size(), -1);
+  for (int i = 0; i < static_cast<int>(ops_.size()); i++) {
+    for (int input : ops_[i].inputs) {
+      last_use[input] = i;
+    }
+    if (ops_[i].residual >= 0) {
+      last_use[ops_[i].residual] = i;
+    }
+  }
+  std::vector<size_t> sizes;
+  std::vector<int> free_buffers;
+  size_t scratch_size = 0;
+  for (int i = 0; i < static_cast<int>(ops_.size()); i++) {
+    const Op &op = ops_[i];
+    if (op.output >= 0) {
+      Tensor &out = tensors_[op.output];
+      const size_t need = out.size() * max_batch_size_;
+      // 优先选够大的里面最小的, 都不够时扩大最大的一块
+      auto best = free_buffers.end();
+      for (auto it = free_buffers.begin(); it != free_buffers.end(); ++it) {
+        const bool fits = sizes[*it] >= need;
+        if (best == free_buffers.end()) {
+          best = it;
+        } else if (fits && (sizes[*best] < need || sizes[*it] < sizes[*best])) {
+          best = it;
+        } else if (!fits && sizes[*best] < need && sizes[*it] > sizes[*best]) {
+          best = it;
+        }
+      }
+      if (best == free_buffers.end()) {
+        out.buffer = static_cast<int>(sizes.size());
+        sizes.push_back(need);
+      } else {
+        out.buffer = *best;
+        sizes[*best] = std::max(sizes[*best], need);
+        free_buffers.erase(best);
+      }
+    }
+    if (op.type == kConv) {
+      const Tensor &in = tensors_[op.inputs[0]];
+      scratch_size = std::max(scratch_size, static_cast<size_t>(in.c) *
+                                                op.ksize * op.ksize * kTileN);
+    } else if (op.type == kMaxPool) {
+      scratch_size = std::max(scratch_size, tensors_[op.output].size());
+    }
+    for (int t = 1; t < static_cast<int>(tensors_.size()); t++) {
+      if (last_use[t] == i && tensors_[t].buffer >= 0) {
+        free_buffers.push_back(tensors_[t].buffer);
+      }
+    }
+  }
+  buffers_.clear();
+  for (size_t size : sizes) {
+    buffers_.emplace_back(size);
+  }
+  scratch_.assign(num_threads_, std::vector<float>(scratch_size));
+}
+
+const float *CpuYoloEngine::tensor_in(int tensor, int n) const {
+  const Tensor &t = tensors_[tensor];
+  if (t.buffer < 0) {
+    return input_ + n * t.size();
+  }
+  return buffers_[t.buffer].data() + n * t.size();
+}
+
+float *CpuYoloEngine::tensor_out(int tensor, int n) {
+  const Tensor &t = tensors_[tensor];
+  return buffers_[t.buffer].data() + n * t.size();
+}
+
+void CpuYoloEngine::infer(const float *input, float *output, int batch_size) {
+  batch_size = std::min(batch_size, max_batch_size_);
+  if (batch_size <= 0 || ops_.empty()) {
+    return;
+  }
+  input_ = input;
+  output_ = output;
+  for (const Op &op : ops_) {
+    switch (op.type) {
+    case kConv:
+      run_conv(op, batch_size);
+      break;
+    case kFocus:
+      run_focus(op, batch_size);
+      break;
+    case kMaxPool:
+      run_max_pool(op, batch_size);
+      break;
+    case kUpsample:
+      run_upsample(op, batch_size);
+      break;
+    case kConcat:
+      run_concat(op, batch_size);
+      break;
+    case kYolo:
+      run_yolo(op, batch_size);
+      break;
+    }
+  }
+}
+
+void CpuYoloEngine::run_conv(const Op &op, int batch_size) {
+  const Tensor &in = tensors_[op.inputs[0]];
+  const Tensor &out = tensors_[op.output];
+  const int out_n = out.h * out.w;
+  const int k_dim = in.c * op.ksize * op.ksize;
+  const int tiles = (out_n + kTileN - 1) / kTileN;
+  const int blocks = (out.c + kMR - 1) / kMR;
+  // 深层特征图小, 只按像素块划分时任务数不够, 再按输出通道块划分
+  const int base = batch_size * tiles;
+  const int want = 4 * pool_->size();
+  const int groups =
+      base >= want ? 1 : std::min(blocks, (want + base - 1) / base);
+  const int blocks_per_group = (blocks + groups - 1) / groups;
+
+  pool_->run(base * groups, [&](int task, int thread) {
+    const int group = task % groups;
+    const int tile = (task / groups) % tiles;
+    const int n = task / groups / tiles;
+    const int p0 = tile * kTileN;
+    const int cols = std::min(kTileN, out_n - p0);
+    float *b = scratch_[thread].data();
+    im2col_tile(tensor_in(op.inputs[0], n), in.c, in.h, in.w, op.ksize,
+                op.stride, out.w, out_n, p0, b);
+
+    float *y = tensor_out(op.output, n);
+    const float *res =
+        op.residual >= 0 ? tensor_in(op.residual, n) : nullptr;
+    const int block_end = std::min(blocks, (group + 1) * blocks_per_group);
+    float acc[kMR][kNR];
+    for (int block = group * blocks_per_group; block < block_end; block++) {
+      const float *a = op.weight.data() + static_cast<size_t>(block) * k_dim * kMR;
+      const int rows = std::min(kMR, out.c - block * kMR);
+      for (int j0 = 0; j0 < cols; j0 += kNR) {
+        gemm_micro(a, b + j0, k_dim, acc);
+        // 收尾: bias(折叠后的BN) + SiLU + shortcut, 只写回有效的通道和像素
+        const int width = std::min(kNR, cols - j0);
+        for (int r = 0; r < rows; r++) {
+          const int oc = block * kMR + r;
+          const size_t offset = static_cast<size_t>(oc) * out_n + p0 + j0;
+          float *dst = y + offset;
+          for (int c = 0; c < width; c++) {
+            float v = acc[r][c] + op.bias[oc];
+            if (op.silu) {
+              v = v / (1.f + std::exp(-v));
+            }
+            if (res) {
+              v += res[offset + c];
+            }
+            dst[c] = v;
+          }
+        }
+      }
+    }
+  });
+}
+
+// 与 focus 中的 4 个 slice + concat 相同: 偏移 (0,0) (1,0) (0,1) (1,1), 格式 (行, 列)
+void CpuYoloEngine::run_focus(const Op &op, int batch_size) {
+  const Tensor &in = tensors_[op.inputs[0]];
+  const Tensor &out = tensors_[op.output];
+  static const int kOffsets[4][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
+  pool_->run(batch_size * 4 * in.c, [&](int task, int) {
+    const int c = task % in.c;
+    const int g = (task / in.c) % 4;
+    const int n = task / in.c / 4;
+    const float *src = tensor_in(op.inputs[0], n) +
+                       static_cast<size_t>(c) * in.h * in.w;
+    float *dst = tensor_out(op.output, n) +
+                 static_cast<size_t>(g * in.c + c) * out.h * out.w;
+    for (int y = 0; y < out.h; y++) {
+      const float *row = src + (2 * y + kOffsets[g][0]) * in.w + kOffsets[g][1];
+      for (int x = 0; x < out.w; x++) {
+        dst[y * out.w + x] = row[2 * x];
+      }
+    }
+  });
+}
+
+// stride 1, padding k/2 的最大池化, 拆成水平和竖直两次一维池化
+void CpuYoloEngine::run_max_pool(const Op &op, int batch_size) {
+  const Tensor &t = tensors_[op.output];
+  const int r = op.pool / 2;
+  pool_->run(batch_size * t.c, [&](int task, int thread) {
+    const int c = task % t.c;
+    const int n = task / t.c;
+    const size_t plane = static_cast<size_t>(t.h) * t.w;
+    const float *src = tensor_in(op.inputs[0], n) + c * plane;
+    float *dst = tensor_out(op.output, n) + c * plane;
+    float *tmp = scratch_[thread].data();
+    for (int y = 0; y < t.h; y++) {
+      for (int x = 0; x < t.w; x++) {
+        float v = -std::numeric_limits<float>::infinity();
+        for (int i = std::max(0, x - r); i <= std::min(t.w - 1, x + r); i++) {
+          v = std::max(v, src[y * t.w + i]);
+        }
+        tmp[y * t.w + x] = v;
+      }
+    }
+    for (int y = 0; y < t.h; y++) {
+      for (int x = 0; x < t.w; x++) {
+        float v = -std::numeric_limits<float>::infinity();
+        for (int i = std::max(0, y - r); i <= std::min(t.h - 1, y + r); i++) {
+          v = std::max(v, tmp[i * t.w + x]);
+        }
+        dst[y * t.w + x] = v;
+      }
+    }
+  });
+}
+
+void CpuYoloEngine::run_upsample(const Op &op, int batch_size) {
+  const Tensor &in = tensors_[op.inputs[0]];
+  const Tensor &out = tensors_[op.output];
+  const int sy = out.h / in.h;
+  const int sx = out.w / in.w;
+  pool_->run(batch_size * out.c, [&](int task, int) {
+    const int c = task % out.c;
+    const int n = task / out.c;
+    const float *src =
+        tensor_in(op.inputs[0], n) + static_cast<size_t>(c) * in.h * in.w;
+    float *dst =
+        tensor_out(op.output, n) + static_cast<size_t>(c) * out.h * out.w;
+    for (int y = 0; y < out.h; y++) {
+      const float *row = src + (y / sy) * in.w;
+      for (int x = 0; x < out.w; x++) {
+        dst[y * out.w + x] = row[x / sx];
+      }
+    }
+  });
+}
+
+void CpuYoloEngine::run_concat(const Op &op, int batch_size) {
+  const int count = static_cast<int>(op.inputs.size());
+  pool_->run(batch_size * count, [&](int task, int) {
+    const int i = task % count;
+    const int n = task / count;
+    // NCHW 中每张图的每个输入都是一段连续内存
+    size_t offset = 0;
+    for (int j = 0; j < i; j++) {
+      offset += tensors_[op.inputs[j]].size();
+    }
+    const Tensor &t = tensors_[op.inputs[i]];
+    std::memcpy(tensor_out(op.output, n) + offset, tensor_in(op.inputs[i], n),
+                t.size() * sizeof(float));
+  });
+}
+
+// 与 yololayer.cu 中 CalDetection 的解码相同, 输出顺序固定(按层/位置/anchor)
+void CpuYoloEngine::run_yolo(const Op &op, int batch_size) {
+  const int info_len = 5 + class_num_;
+  const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+  pool_->run(batch_size, [&](int n, int) {
+    float *out = output_ + static_cast<size_t>(n) * output_size();
+    int count = 0;
+    for (size_t level = 0; level < op.inputs.size(); level++) {
+      const Tensor &t = tensors_[op.inputs[level]];
+      const float *x = tensor_in(op.inputs[level], n);
+      const float *anchors = op.anchors.data() + level * Yolo::CHECK_COUNT * 2;
+      const int grid = t.h * t.w;
+      for (int idx = 0; idx < grid; idx++) {
+        for (int k = 0; k < Yolo::CHECK_COUNT; k++) {
+          const float *cell = x + k * info_len * grid + idx;
+          const float box_prob = sigmoid(cell[4 * grid]);
+          if (box_prob < Yolo::IGNORE_THRESH) {
+            continue;
+          }
+          if (count >= Yolo::MAX_OUTPUT_BBOX_COUNT) {
+            break;
+          }
+          int class_id = 0;
+          float max_cls_prob = 0.f;
+          for (int i = 5; i < info_len; i++) {
+            const float p = sigmoid(cell[i * grid]);
+            if (p > max_cls_prob) {
+              max_cls_prob = p;
+              class_id = i - 5;
+            }
+          }
+          Yolo::Detection det;
+          const int row = idx / t.w;
+          const int col = idx % t.w;
+          det.bbox[0] = (col - 0.5f + 2.f * sigmoid(cell[0])) *
+                        input_w_ / t.w;
+          det.bbox[1] = (row - 0.5f + 2.f * sigmoid(cell[grid])) *
+                        input_h_ / t.h;
+          det.bbox[2] = 2.f * sigmoid(cell[2 * grid]);
+          det.bbox[2] = det.bbox[2] * det.bbox[2] * anchors[2 * k];
+          det.bbox[3] = 2.f * sigmoid(cell[3 * grid]);
+          det.bbox[3] = det.bbox[3] * det.bbox[3] * anchors[2 * k + 1];
+          det.conf = box_prob * max_cls_prob;
+          det.class_id = class_id;
+          std::memcpy(out + 1 + count * det_size, &det, sizeof(det));
+          ++count;
+        }
+      }
+    }
+    out[0] = count;
+  });
+}
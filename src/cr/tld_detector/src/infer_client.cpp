@@ -0,0 +1,180 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 19:32:05
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 19:32:05
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/src/infer_client.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <unistd.h>
+#include <zmq.h>
+// cpp system headers
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "tld_detector/infer_client.hpp"
+
+namespace {
+
+int64_t steady_now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// 服务端没有回复的请求超过该时间后认为服务已经重启, 不再等待
+constexpr int kAbandonTimeoutMs = 5000;
+
+} // namespace
+
+InferClient::InferClient(const std::string &address, int max_batch,
+                         size_t input_floats, size_t output_floats,
+                         int timeout_ms)
+    : address_(address), max_batch_(max_batch), input_floats_(input_floats),
+      output_floats_(output_floats), timeout_ms_(timeout_ms) {}
+
+InferClient::~InferClient() {
+  if (socket_ != nullptr) {
+    if (registered_) {
+      infer_ipc::send_frames(socket_, {"bye"}, ZMQ_DONTWAIT);
+    }
+    zmq_close(socket_);
+  }
+  if (context_ != nullptr) {
+    zmq_ctx_term(context_);
+  }
+}
+
+bool InferClient::init() {
+  // 同一进程内可以有多个检测器, 名字中加上序号
+  static std::atomic<int> instance_count{0};
+  const std::string name = "/cr_infer_" + std::to_string(getpid()) + "_" +
+                           std::to_string(instance_count++);
+  if (!shm_.create(name, max_batch_, input_floats_, output_floats_)) {
+    return false;
+  }
+  context_ = zmq_ctx_new();
+  socket_ = zmq_socket(context_, ZMQ_DEALER);
+  const int linger_ms = 0;
+  zmq_setsockopt(socket_, ZMQ_LINGER, &linger_ms, sizeof(linger_ms));
+  zmq_setsockopt(socket_, ZMQ_IDENTITY, name.data(), name.size());
+  if (zmq_connect(socket_, address_.c_str()) != 0) {
+    ALOG_ERROR_STREAM("[ InferClient ] connect " << address_ << " failed : "
+                                                 << zmq_strerror(zmq_errno()));
+    return false;
+  }
+  // 服务可能比客户端晚启动, 第一次 hello 失败时在 infer 中重试
+  if (!hello()) {
+    ALOG_WARN_STREAM("[ InferClient ] inference server " << address_
+                                                         << " not ready yet");
+  }
+  return true;
+}
+
+bool InferClient::hello() {
+  const uint64_t seq = ++seq_;
+  if (!infer_ipc::send_frames(socket_,
+                              {"hello", shm_.name(), std::to_string(max_batch_),
+                               std::to_string(getpid()), std::to_string(seq)},
+                              ZMQ_DONTWAIT)) {
+    return false;
+  }
+  std::string error;
+  // 服务端第一次映射共享内存需要一些时间, 至少等 1 秒
+  registered_ = wait_reply(seq, std::max(timeout_ms_, 1000), &error);
+  if (!registered_ && !error.empty()) {
+    ALOG_ERROR_STREAM("[ InferClient ] inference server rejected "
+                      << shm_.name() << " : " << error);
+  }
+  return registered_;
+}
+
+bool InferClient::ready() {
+  if (!outstanding_) {
+    return true;
+  }
+  std::string error;
+  if (wait_reply(seq_, 0, &error)) {
+    return true;
+  }
+  if (steady_now_ms() - outstanding_since_ms_ > kAbandonTimeoutMs) {
+    ALOG_WARN_STREAM_THROTTLE(
+        5.0, "[ InferClient ] no reply from inference server, re-registering");
+    outstanding_ = false;
+    registered_ = false;
+    return true;
+  }
+  return false;
+}
+
+bool InferClient::infer(int batch_size) {
+  if (socket_ == nullptr || batch_size <= 0 || !ready()) {
+    return false;
+  }
+  batch_size = std::min(batch_size, max_batch_);
+  if (!registered_ && !hello()) {
+    return false;
+  }
+  const uint64_t seq = ++seq_;
+  if (!infer_ipc::send_frames(
+          socket_, {"infer", std::to_string(seq), std::to_string(batch_size)},
+          ZMQ_DONTWAIT)) {
+    ALOG_WARN_STREAM_THROTTLE(1.0, "[ InferClient ] send failed : "
+                                       << zmq_strerror(zmq_errno()));
+    return false;
+  }
+  outstanding_ = true;
+  outstanding_since_ms_ = steady_now_ms();
+  std::string error;
+  if (wait_reply(seq, timeout_ms_, &error)) {
+    return true;
+  }
+  if (error == "unknown client") {
+    // 服务重启过, 下一次推理前重新 hello
+    registered_ = false;
+  } else if (!error.empty()) {
+    ALOG_WARN_STREAM_THROTTLE(1.0, "[ InferClient ] inference failed : "
+                                       << error);
+  } else {
+    ALOG_WARN_STREAM_THROTTLE(1.0, "[ InferClient ] inference timed out after "
+                                       << timeout_ms_ << " ms");
+  }
+  return false;
+}
+
+bool InferClient::wait_reply(uint64_t seq, int timeout_ms, std::string *error) {
+  error->clear();
+  const int64_t deadline = steady_now_ms() + timeout_ms;
+  std::vector<std::string> frames;
+  for (;;) {
+    zmq_pollitem_t item = {socket_, 0, ZMQ_POLLIN, 0};
+    const int wait_ms =
+        static_cast<int>(std::max<int64_t>(0, deadline - steady_now_ms()));
+    if (zmq_poll(&item, 1, wait_ms) <= 0) {
+      return false;
+    }
+    while (infer_ipc::recv_frames(socket_, &frames, ZMQ_DONTWAIT)) {
+      if (frames.size() < 2 ||
+          std::strtoull(frames[1].c_str(), nullptr, 10) != seq) {
+        continue; // 超时请求的迟到回复
+      }
+      outstanding_ = false;
+      if (frames[0] == "ok" || frames[0] == "done") {
+        return true;
+      }
+      *error = frames.size() > 2 ? frames[2] : frames[0];
+      return false;
+    }
+    if (steady_now_ms() >= deadline) {
+      return false;
+    }
+  }
+}
@@ -0,0 +1,189 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 19:32:05
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 19:32:05
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/src/infer_ipc.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zmq.h>
+// cpp system headers
+#include <cerrno>
+#include <cstring>
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "tld_detector/infer_ipc.hpp"
+
+namespace infer_ipc {
+
+namespace {
+// 张量从 64 字节对齐的位置开始
+constexpr size_t kHeaderBytes = 64;
+static_assert(sizeof(SharedTensorHeader) <= kHeaderBytes,
+              "SharedTensorHeader must fit in the header block");
+} // namespace
+
+SharedTensors::~SharedTensors() {
+  if (owner_) {
+    unlink();
+  }
+  close();
+}
+
+size_t SharedTensors::region_size(int max_batch, size_t input_floats,
+                                  size_t output_floats) {
+  return kHeaderBytes + static_cast<size_t>(max_batch) *
+                            (input_floats + output_floats) * sizeof(float);
+}
+
+bool SharedTensors::map(int fd, size_t size) {
+  void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    ALOG_ERROR_STREAM("[ SharedTensors ] mmap " << name_
+                                                << " failed : " << strerror(errno));
+    return false;
+  }
+  addr_ = addr;
+  size_ = size;
+  return true;
+}
+
+bool SharedTensors::create(const std::string &name, int max_batch,
+                           size_t input_floats, size_t output_floats) {
+  close();
+  name_ = name;
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+  if (fd < 0) {
+    ALOG_ERROR_STREAM("[ SharedTensors ] shm_open " << name
+                                                    << " failed : " << strerror(errno));
+    return false;
+  }
+  owner_ = true;
+  const size_t size = region_size(max_batch, input_floats, output_floats);
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    ALOG_ERROR_STREAM("[ SharedTensors ] ftruncate " << name
+                                                     << " failed : " << strerror(errno));
+    ::close(fd);
+    return false;
+  }
+  if (!map(fd, size)) {
+    return false;
+  }
+  SharedTensorHeader *header = static_cast<SharedTensorHeader *>(addr_);
+  header->magic = kMagic;
+  header->version = kVersion;
+  header->max_batch = static_cast<uint32_t>(max_batch);
+  header->input_floats = static_cast<uint32_t>(input_floats);
+  header->output_floats = static_cast<uint32_t>(output_floats);
+  max_batch_ = max_batch;
+  input_floats_ = input_floats;
+  output_floats_ = output_floats;
+  input_ = reinterpret_cast<float *>(static_cast<char *>(addr_) + kHeaderBytes);
+  output_ = input_ + max_batch * input_floats;
+  return true;
+}
+
+bool SharedTensors::open(const std::string &name, size_t input_floats,
+                         size_t output_floats) {
+  close();
+  name_ = name;
+  owner_ = false;
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    ALOG_ERROR_STREAM("[ SharedTensors ] shm_open " << name
+                                                    << " failed : " << strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < kHeaderBytes) {
+    ALOG_ERROR_STREAM("[ SharedTensors ] invalid shared memory : " << name);
+    ::close(fd);
+    return false;
+  }
+  if (!map(fd, static_cast<size_t>(st.st_size))) {
+    return false;
+  }
+  // 网络输入尺寸/类别数不同的客户端不能共用同一个 engine
+  const SharedTensorHeader *header =
+      static_cast<const SharedTensorHeader *>(addr_);
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->input_floats != input_floats ||
+      header->output_floats != output_floats ||
+      size_ < region_size(static_cast<int>(header->max_batch), input_floats,
+                          output_floats)) {
+    ALOG_ERROR_STREAM("[ SharedTensors ] " << name
+                                           << " does not match this engine");
+    close();
+    return false;
+  }
+  max_batch_ = static_cast<int>(header->max_batch);
+  input_floats_ = input_floats;
+  output_floats_ = output_floats;
+  input_ = reinterpret_cast<float *>(static_cast<char *>(addr_) + kHeaderBytes);
+  output_ = input_ + max_batch_ * input_floats;
+  return true;
+}
+
+void SharedTensors::close() {
+  if (addr_ != nullptr) {
+    munmap(addr_, size_);
+  }
+  addr_ = nullptr;
+  size_ = 0;
+  max_batch_ = 0;
+  input_floats_ = 0;
+  output_floats_ = 0;
+  input_ = nullptr;
+  output_ = nullptr;
+}
+
+void SharedTensors::unlink() {
+  if (!name_.empty()) {
+    shm_unlink(name_.c_str());
+  }
+  owner_ = false;
+}
+
+bool send_frames(void *socket, const std::vector<std::string> &frames,
+                 int flags) {
+  for (size_t i = 0; i < frames.size(); i++) {
+    const int more = i + 1 < frames.size() ? ZMQ_SNDMORE : 0;
+    if (zmq_send(socket, frames[i].data(), frames[i].size(), flags | more) <
+        0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool recv_frames(void *socket, std::vector<std::string> *frames, int flags) {
+  frames->clear();
+  int more = 1;
+  while (more) {
+    zmq_msg_t frame;
+    zmq_msg_init(&frame);
+    // 第一帧可以非阻塞, 后续帧属于同一条多帧消息, 已经全部到达
+    if (zmq_msg_recv(&frame, socket, frames->empty() ? flags : 0) < 0) {
+      zmq_msg_close(&frame);
+      return false;
+    }
+    frames->emplace_back(static_cast<const char *>(zmq_msg_data(&frame)),
+                         zmq_msg_size(&frame));
+    more = zmq_msg_more(&frame);
+    zmq_msg_close(&frame);
+  }
+  return true;
+}
+
+} // namespace infer_ipc
@@ -0,0 +1,286 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 19:32:05
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 19:32:05
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/src/infer_server.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <signal.h>
+#include <zmq.h>
+// cpp system headers
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "tld_detector/infer_server.hpp"
+#include "tld_detector/tld_detector.hpp"
+
+namespace {
+
+int64_t steady_now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+constexpr int64_t kReapPeriodUs = 1000000;
+
+} // namespace
+
+InferServer::InferServer(TLDDetector *detector,
+                         const InferServerOptions &options)
+    : detector_(detector), max_batch_(detector->model().max_batch),
+      input_floats_(detector->model().input_floats()),
+      output_floats_(detector->model().output_floats()), options_(options) {}
+
+InferServer::~InferServer() {
+  clients_.clear();
+  if (socket_ != nullptr) {
+    zmq_close(socket_);
+  }
+  if (context_ != nullptr) {
+    zmq_ctx_term(context_);
+  }
+}
+
+bool InferServer::init() {
+  context_ = zmq_ctx_new();
+  socket_ = zmq_socket(context_, ZMQ_ROUTER);
+  const int linger_ms = 0;
+  zmq_setsockopt(socket_, ZMQ_LINGER, &linger_ms, sizeof(linger_ms));
+  // 客户端重连时用新连接替换同名的旧连接
+  const int handover = 1;
+  zmq_setsockopt(socket_, ZMQ_ROUTER_HANDOVER, &handover, sizeof(handover));
+  if (zmq_bind(socket_, options_.address.c_str()) != 0) {
+    ALOG_ERROR_STREAM("[ InferServer ] bind " << options_.address
+                                              << " failed : "
+                                              << zmq_strerror(zmq_errno()));
+    return false;
+  }
+  ALOG_INFO_STREAM("[ InferServer ] listening on "
+                   << options_.address << ", max batch " << max_batch_
+                   << ", max wait " << options_.max_wait_us << " us");
+  return true;
+}
+
+void InferServer::spin_once(int timeout_ms) {
+  zmq_pollitem_t item = {socket_, 0, ZMQ_POLLIN, 0};
+  const int64_t now_us = steady_now_us();
+  if (!batch_ready(now_us)) {
+    zmq_poll(&item, 1, wait_timeout_ms(timeout_ms, now_us));
+  }
+  // 一次取完排队的消息, 同时到达的请求才能进入同一个 batch
+  std::vector<std::string> frames;
+  while (infer_ipc::recv_frames(socket_, &frames, ZMQ_DONTWAIT)) {
+    handle(frames);
+  }
+  if (batch_ready(steady_now_us())) {
+    dispatch();
+  }
+  if (steady_now_us() - last_reap_us_ > kReapPeriodUs) {
+    reap_clients();
+    last_reap_us_ = steady_now_us();
+  }
+}
+
+int InferServer::wait_timeout_ms(int timeout_ms, int64_t now_us) const {
+  if (pending_images_ == 0) {
+    return timeout_ms;
+  }
+  const int64_t left_us =
+      oldest_arrival_us_ + options_.max_wait_us - now_us;
+  return static_cast<int>(
+      std::min<int64_t>(timeout_ms, std::max<int64_t>(0, (left_us + 999) / 1000)));
+}
+
+bool InferServer::batch_ready(int64_t now_us) const {
+  return pending_images_ > 0 &&
+         (pending_images_ >= max_batch_ ||
+          now_us - oldest_arrival_us_ >= options_.max_wait_us);
+}
+
+void InferServer::handle(const std::vector<std::string> &frames) {
+  if (frames.size() < 2) {
+    return;
+  }
+  const std::string &identity = frames[0];
+  const std::string &verb = frames[1];
+  if (verb == "hello") {
+    handle_hello(identity, frames);
+    return;
+  }
+  if (verb == "bye") {
+    remove_client(identity);
+    return;
+  }
+  if (verb != "infer" || frames.size() < 4) {
+    return;
+  }
+  const std::string &seq = frames[2];
+  Client *client = find_client(identity);
+  if (client == nullptr) {
+    ++stats_.rejected;
+    reply(identity, {"error", seq, "unknown client"});
+    return;
+  }
+  const int batch = std::atoi(frames[3].c_str());
+  if (batch <= 0 || batch > max_batch_ || batch > client->shm.max_batch()) {
+    ++stats_.rejected;
+    reply(identity, {"error", seq, "invalid batch " + frames[3]});
+    return;
+  }
+  const int64_t now_us = steady_now_us();
+  if (pending_images_ == 0) {
+    oldest_arrival_us_ = now_us;
+  }
+  client->queue.push_back(
+      Request{std::strtoull(seq.c_str(), nullptr, 10), batch, now_us});
+  pending_images_ += batch;
+  ++stats_.requests;
+}
+
+void InferServer::handle_hello(const std::string &identity,
+                               const std::vector<std::string> &frames) {
+  const std::string seq = frames.size() > 5 ? frames[5] : std::string("0");
+  if (frames.size() < 6) {
+    reply(identity, {"error", seq, "malformed hello"});
+    return;
+  }
+  // 同一客户端重新 hello(服务或客户端重启过), 先丢弃旧的映射和排队的请求
+  remove_client(identity);
+  std::unique_ptr<Client> client(new Client());
+  client->identity = identity;
+  client->pid = std::atoi(frames[4].c_str());
+  if (!client->shm.open(frames[2], input_floats_, output_floats_)) {
+    reply(identity, {"error", seq, "cannot map " + frames[2]});
+    return;
+  }
+  ALOG_INFO_STREAM("[ InferServer ] client " << identity << " (pid "
+                                             << client->pid << ", max batch "
+                                             << client->shm.max_batch()
+                                             << ") connected");
+  clients_.push_back(std::move(client));
+  stats_.clients = static_cast<int>(clients_.size());
+  reply(identity, {"ok", seq});
+}
+
+void InferServer::reply(const std::string &identity,
+                        const std::vector<std::string> &frames) {
+  std::vector<std::string> message;
+  message.reserve(frames.size() + 1);
+  message.push_back(identity);
+  message.insert(message.end(), frames.begin(), frames.end());
+  // 客户端已经断开时 ROUTER 直接丢弃, 不阻塞推理循环
+  infer_ipc::send_frames(socket_, message, ZMQ_DONTWAIT);
+}
+
+InferServer::Client *InferServer::find_client(const std::string &identity) {
+  for (auto &client : clients_) {
+    if (client->identity == identity) {
+      return client.get();
+    }
+  }
+  return nullptr;
+}
+
+void InferServer::remove_client(const std::string &identity) {
+  for (auto it = clients_.begin(); it != clients_.end(); ++it) {
+    if ((*it)->identity != identity) {
+      continue;
+    }
+    for (const Request &request : (*it)->queue) {
+      pending_images_ -= request.batch;
+    }
+    ALOG_INFO_STREAM("[ InferServer ] client " << identity << " removed");
+    clients_.erase(it);
+    stats_.clients = static_cast<int>(clients_.size());
+    cursor_ = clients_.empty() ? 0 : cursor_ % clients_.size();
+    return;
+  }
+}
+
+void InferServer::reap_clients() {
+  std::vector<std::string> dead;
+  for (const auto &client : clients_) {
+    if (client->pid > 0 && kill(client->pid, 0) != 0 && errno == ESRCH) {
+      dead.push_back(client->identity);
+    }
+  }
+  for (const std::string &identity : dead) {
+    // 客户端异常退出时没有 unlink, 由服务端删除
+    Client *client = find_client(identity);
+    client->shm.unlink();
+    remove_client(identity);
+  }
+}
+
+void InferServer::dispatch() {
+  struct Slot {
+    Client *client;
+    Request request;
+    int offset;
+  };
+  std::vector<Slot> slots;
+  int capacity = max_batch_;
+  const size_t client_count = clients_.size();
+  bool progress = true;
+  while (progress && capacity > 0) {
+    progress = false;
+    for (size_t k = 0; k < client_count && capacity > 0; k++) {
+      Client *client = clients_[(cursor_ + k) % client_count].get();
+      if (client->queue.empty() || client->queue.front().batch > capacity) {
+        continue;
+      }
+      const Request request = client->queue.front();
+      client->queue.pop_front();
+      slots.push_back(Slot{client, request, max_batch_ - capacity});
+      capacity -= request.batch;
+      pending_images_ -= request.batch;
+      progress = true;
+    }
+  }
+  cursor_ = client_count == 0 ? 0 : (cursor_ + 1) % client_count;
+  if (slots.empty()) {
+    return;
+  }
+  const int batch = max_batch_ - capacity;
+
+  float *input = detector_->input_buffer();
+  for (const Slot &slot : slots) {
+    std::memcpy(input + slot.offset * input_floats_, slot.client->shm.input(),
+                slot.request.batch * input_floats_ * sizeof(float));
+  }
+  const bool ok = detector_->infer(batch);
+  const float *output = detector_->output_buffer();
+  for (const Slot &slot : slots) {
+    const std::string seq = std::to_string(slot.request.seq);
+    if (!ok) {
+      reply(slot.client->identity, {"error", seq, "inference failed"});
+      continue;
+    }
+    std::memcpy(slot.client->shm.output(),
+                output + slot.offset * output_floats_,
+                slot.request.batch * output_floats_ * sizeof(float));
+    reply(slot.client->identity, {"done", seq});
+  }
+  ++stats_.batches;
+  stats_.images += batch;
+
+  // 剩余的请求从最早到达的开始计时
+  oldest_arrival_us_ = steady_now_us();
+  for (const auto &client : clients_) {
+    if (!client->queue.empty()) {
+      oldest_arrival_us_ =
+          std::min(oldest_arrival_us_, client->queue.front().arrival_us);
+    }
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 22:58:20
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 22:58:20
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/src/model_config.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <fstream>
+#include <sstream>
+// third party headers
+#include "yaml-cpp/yaml.h"
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "tld_detector/model_config.hpp"
+
+bool parse_model_precision(const std::string &name, ModelPrecision *precision) {
+  if (name == "fp32") {
+    *precision = ModelPrecision::kFP32;
+  } else if (name == "fp16") {
+    *precision = ModelPrecision::kFP16;
+  } else if (name == "int8") {
+    *precision = ModelPrecision::kINT8;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *model_precision_name(ModelPrecision precision) {
+  switch (precision) {
+  case ModelPrecision::kFP32:
+    return "fp32";
+  case ModelPrecision::kFP16:
+    return "fp16";
+  case ModelPrecision::kINT8:
+    return "int8";
+  default:
+    return "unknown";
+  }
+}
+
+std::string ModelMetadata::name() const {
+  std::ostringstream ss;
+  ss << input_w << "x" << input_h << "x" << max_batch << " " << class_num
+     << (class_num == 1 ? " class" : " classes");
+  return ss.str();
+}
+
+bool load_model_metadata(const std::string &weight_path,
+                         ModelMetadata *model) {
+  // best.engine -> best.yaml
+  const size_t dot = weight_path.find_last_of('.');
+  const size_t slash = weight_path.find_last_of('/');
+  const std::string base =
+      dot != std::string::npos && (slash == std::string::npos || dot > slash)
+          ? weight_path.substr(0, dot)
+          : weight_path;
+  const std::string path = base + ".yaml";
+  if (!std::ifstream(path).good()) {
+    return true;
+  }
+  try {
+    const YAML::Node config = YAML::LoadFile(path);
+    if (config["input_width"]) {
+      model->input_w = config["input_width"].as<int>();
+    }
+    if (config["input_height"]) {
+      model->input_h = config["input_height"].as<int>();
+    }
+    if (config["max_batch"]) {
+      model->max_batch = config["max_batch"].as<int>();
+    }
+    if (config["class_num"]) {
+      model->class_num = config["class_num"].as<int>();
+    }
+    if (config["precision"] &&
+        !parse_model_precision(config["precision"].as<std::string>(),
+                               &model->precision)) {
+      ALOG_ERROR_STREAM("[ ModelMetadata ] unknown precision in " << path);
+      return false;
+    }
+    if (config["conf_thresh"]) {
+      model->conf_thresh = config["conf_thresh"].as<float>();
+    }
+    if (config["nms_thresh"]) {
+      model->nms_thresh = config["nms_thresh"].as<float>();
+    }
+  } catch (const YAML::Exception &e) {
+    ALOG_ERROR_STREAM("[ ModelMetadata ] cannot parse " << path << " : "
+                                                        << e.what());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,95 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 23:58:12
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 23:58:12
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tld_detector/src/roi_mask.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// third party headers
+#include "yaml-cpp/yaml.h"
+// opencv
+#include "opencv2/imgproc.hpp"
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "tld_detector/roi_mask.hpp"
+
+bool RoiMask::init(const std::vector<std::vector<cv::Point>> &polygons,
+                   cv::Size img_size) {
+  bitmap_.release();
+  img_size_ = img_size;
+  bounding_rect_ = cv::Rect(cv::Point(0, 0), img_size);
+  if (polygons.empty()) {
+    return true;
+  }
+  if (img_size.area() <= 0) {
+    return false;
+  }
+  std::vector<cv::Point> points;
+  for (const std::vector<cv::Point> &polygon : polygons) {
+    if (polygon.size() < 3) {
+      return false;
+    }
+    points.insert(points.end(), polygon.begin(), polygon.end());
+  }
+  cv::Mat bitmap = cv::Mat::zeros(img_size, CV_8UC1);
+  cv::fillPoly(bitmap, polygons, cv::Scalar(255));
+  const cv::Rect rect =
+      cv::boundingRect(points) & cv::Rect(cv::Point(0, 0), img_size);
+  if (rect.area() == 0) {
+    return false;
+  }
+  bitmap_ = bitmap;
+  bounding_rect_ = rect;
+  return true;
+}
+
+bool load_roi_masks(const std::string &config_path,
+                    const std::vector<std::string> &camera_ids,
+                    std::vector<RoiMask> *masks) {
+  masks->assign(camera_ids.size(), RoiMask());
+  try {
+    const YAML::Node config = YAML::LoadFile(config_path);
+    for (size_t i = 0; i < camera_ids.size(); i++) {
+      const YAML::Node camera = config[camera_ids[i]];
+      if (!camera || !camera["roi_polygons"]) {
+        continue;
+      }
+      const std::vector<int> size =
+          camera["roi_size"] ? camera["roi_size"].as<std::vector<int>>()
+          : camera["img_size"] ? camera["img_size"].as<std::vector<int>>()
+                               : std::vector<int>();
+      std::vector<std::vector<cv::Point>> polygons;
+      for (const YAML::Node &polygon : camera["roi_polygons"]) {
+        polygons.emplace_back();
+        for (const YAML::Node &point : polygon) {
+          const std::vector<int> xy = point.as<std::vector<int>>();
+          if (xy.size() != 2) {
+            ALOG_ERROR_STREAM("[ RoiMask ] point is not [x, y] for camera : "
+                              << camera_ids[i]);
+            return false;
+          }
+          polygons.back().emplace_back(xy[0], xy[1]);
+        }
+      }
+      if (size.size() != 2 ||
+          !masks->at(i).init(polygons, cv::Size(size[0], size[1]))) {
+        ALOG_ERROR_STREAM("[ RoiMask ] invalid roi_polygons/roi_size for "
+                          "camera : "
+                          << camera_ids[i]);
+        return false;
+      }
+      ALOG_INFO_STREAM("[ RoiMask ] " << camera_ids[i] << " detects in "
+                                      << masks->at(i).bounding_rect());
+    }
+  } catch (const YAML::Exception &e) {
+    ALOG_ERROR_STREAM("[ RoiMask ] load camera config failed : "
+                      << config_path << " " << e.what());
+    return false;
+  }
+  return true;
+}
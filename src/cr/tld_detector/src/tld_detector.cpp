@@ -1,18 +1,283 @@
+// cpp system headers
+#include <algorithm>
+// local headers
 #include "tld_detector/tld_detector.hpp"
 
-bool TLDDetector::init() {
+namespace {
+
+// 预编译的形状, 按顺序匹配
+struct ModelVariant {
+  int input_w;
+  int input_h;
+  int max_batch;
+  int class_num;
+  std::unique_ptr<TLDDetector> (*make)(const std::string &engine_file_path,
+                                       int cpu_threads,
+                                       const ModelMetadata &model);
+};
+
+template <typename Config>
+std::unique_ptr<TLDDetector> make_detector(const std::string &engine_file_path,
+                                           int cpu_threads,
+                                           const ModelMetadata &model) {
+  return std::unique_ptr<TLDDetector>(
+      new YoloDetector<Config>(engine_file_path, cpu_threads, model));
+}
+
+template <typename Config> ModelVariant model_variant() {
+  return ModelVariant{Config::kInputW, Config::kInputH, Config::kMaxBatch,
+                      Config::kClassNum, &make_detector<Config>};
+}
+
+const ModelVariant kModelVariants[] = {
+    model_variant<Yolo512x512x4>(),
+    model_variant<Yolo640x384x8>(),
+    model_variant<Yolo320x320x1>(),
+};
+
+std::string variant_name(const ModelVariant &variant) {
+  ModelMetadata model;
+  model.input_w = variant.input_w;
+  model.input_h = variant.input_h;
+  model.max_batch = variant.max_batch;
+  model.class_num = variant.class_num;
+  return model.name();
+}
+
+} // namespace
+
+std::unique_ptr<TLDDetector>
+TLDDetector::create(const std::string &engine_file_path, int cpu_threads) {
+  ModelMetadata model;
+  if (!load_model_metadata(engine_file_path, &model)) {
+    return nullptr;
+  }
+  const ModelVariant *selected = nullptr;
+  for (const ModelVariant &variant : kModelVariants) {
+    if (variant.input_w != model.input_w || variant.input_h != model.input_h ||
+        variant.class_num != model.class_num ||
+        variant.max_batch > model.max_batch) {
+      continue;
+    }
+    // engine 的 maxBatchSize 更大时也可以用较小的 batch 推理
+    if (selected == nullptr || variant.max_batch > selected->max_batch) {
+      selected = &variant;
+    }
+  }
+  if (selected == nullptr) {
+    std::string names;
+    for (const std::string &name : variants()) {
+      names += (names.empty() ? "" : ", ") + name;
+    }
+    ALOG_ERROR_STREAM("[ TLDDetector ] no compiled detector for "
+                      << model.name() << ", available : " << names);
+    return nullptr;
+  }
+  if (selected->max_batch != model.max_batch) {
+    ALOG_WARN_STREAM("[ TLDDetector ] model max batch " << model.max_batch
+                     << ", using compiled batch " << selected->max_batch);
+  }
+  model.max_batch = selected->max_batch;
+  ALOG_INFO_STREAM("[ TLDDetector ] model " << model.name() << ", "
+                   << model_precision_name(model.precision) << ", conf "
+                   << model.conf_thresh << ", nms " << model.nms_thresh);
+  return selected->make(engine_file_path, cpu_threads, model);
+}
+
+std::vector<std::string> TLDDetector::variants() {
+  std::vector<std::string> names;
+  for (const ModelVariant &variant : kModelVariants) {
+    names.push_back(variant_name(variant));
+  }
+  return names;
+}
+
+bool TLDDetector::detect(const std::vector<cv::Mat> &frame,
+                         const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+                         const std::vector<const RoiMask *> &masks,
+                         std::vector<std::vector<cr_object>> *detected_objects,
+                         int batch_size) {
+  batch_size = std::min(batch_size < 0 ? static_cast<int>(frame.size())
+                                       : batch_size,
+                        static_cast<int>(frame.size()));
+  if (batch_size <= 0) {
+    return false;
+  }
+  masked_frames_.resize(batch_size);
+  masked_msgs_.resize(batch_size);
+  regions_.resize(batch_size);
+  object_begin_.resize(batch_size);
+  for (int i = 0; i < batch_size; i++) {
+    const RoiMask *mask = i < static_cast<int>(masks.size()) ? masks[i]
+                                                            : nullptr;
+    const sensor_msgs::ImageConstPtr msg =
+        i < static_cast<int>(msgs.size()) ? msgs[i] : nullptr;
+    if (mask != nullptr && mask->img_size() != frame[i].size()) {
+      if (!mask->empty() && !frame[i].empty()) {
+        ALOG_WARN_STREAM_THROTTLE(10.0, "[ TLDDetector ] frame size "
+                                            << frame[i].size()
+                                            << " does not match roi mask "
+                                            << mask->img_size());
+      }
+      mask = nullptr;
+    }
+    if (mask == nullptr || mask->empty()) {
+      masked_frames_[i] = frame[i];
+      masked_msgs_[i] = msg;
+      regions_[i] = DetectRegion();
+    } else {
+      const cv::Rect &roi = mask->bounding_rect();
+      // 只引用原图的区域, 裁剪后的帧走 Mat 预处理
+      masked_frames_[i] = frame[i](roi);
+      masked_msgs_[i] = roi.size() == frame[i].size()
+                            ? msg
+                            : sensor_msgs::ImageConstPtr();
+      regions_[i].mask = mask;
+      regions_[i].offset = roi.tl();
+    }
+    object_begin_[i] =
+        i < static_cast<int>(detected_objects->size())
+            ? detected_objects->at(i).size()
+            : 0;
+  }
+  const bool ret = detect_batch(masked_frames_, masked_msgs_,
+                                detected_objects, batch_size, &regions_);
+  for (int i = 0; i < batch_size; i++) {
+    // 引用不能留到下一帧, 否则回调无法复用图像缓存
+    masked_frames_[i].release();
+    masked_msgs_[i].reset();
+    if (!ret || regions_[i].offset == cv::Point() ||
+        i >= static_cast<int>(detected_objects->size())) {
+      continue;
+    }
+    std::vector<cr_object> &objects = detected_objects->at(i);
+    for (size_t k = object_begin_[i]; k < objects.size(); k++) {
+      objects[k].bbox += regions_[i].offset;
+    }
+  }
+  return ret;
+}
+
+void TLDDetector::use_inference_server(const std::string &address,
+                                       int timeout_ms) {
+  server_address_ = address;
+  server_timeout_ms_ = timeout_ms;
+}
+
+int TLDDetector::get_width(int x, float gw, int divisor) {
+  return static_cast<int>(ceil((x * gw) / divisor)) * divisor;
+}
+
+int TLDDetector::get_depth(int x, float gd) {
+  if (x == 1)
+    return 1;
+  int r = round(x * gd);
+  if (x * gd - static_cast<int>(x * gd) == 0.5 &&
+      (static_cast<int>(x * gd) % 2) == 0) {
+    --r;
+  }
+  return std::max(r, 1);
+}
+
+float TLDDetector::calculate_depth(cv::Rect box) {
+  float depth_init = 1650.0/ box.height;
+  float a1 = 1.62 * 0.18 / 0.71;
+  float c1 = 0.18;
+
+  float a = 1.0;
+  float b = -(c1 + depth_init);
+  float c = depth_init + c1 - depth_init + a1;
+  float temp = (-b + sqrt(b * b - 4 * a * c)) / (2 * a);
+  return round(temp * 100) / 100;
+}
+
+template <typename Config>
+constexpr int YoloDetector<Config>::INPUT_H;
+template <typename Config>
+constexpr int YoloDetector<Config>::INPUT_W;
+template <typename Config>
+constexpr int YoloDetector<Config>::CLASS_NUM;
+template <typename Config>
+constexpr int YoloDetector<Config>::MAX_BATCH;
+template <typename Config>
+constexpr int YoloDetector<Config>::INPUT_SIZE;
+template <typename Config>
+constexpr int YoloDetector<Config>::OUTPUT_SIZE;
+
+template <typename Config>
+YoloDetector<Config>::YoloDetector(const std::string &engine_file_path,
+                                   int cpu_threads, const ModelMetadata &model)
+    : TLDDetector(engine_file_path, cpu_threads, model) {
+  model_.max_batch = MAX_BATCH;
+  for (int i = 0; i < MAX_BATCH; i++) {
+    use_frame_pool(&letterbox_[i]);
+    use_frame_pool(&resized_[i]);
+  }
+}
+
+template <typename Config> YoloDetector<Config>::~YoloDetector() {
+  // CPU 推理和推理服务模式下没有创建 TensorRT/CUDA 资源
+  if (context != nullptr) {
+    // Release stream and buffers
+    cudaStreamDestroy(stream);
+    CUDA_CHECK(cudaFree(buffers[inputIndex]));
+    CUDA_CHECK(cudaFree(buffers[outputIndex]));
+    context->destroy();
+  }
+  // Destroy the engine, engine 与模型不一致时只创建到这一步
+  if (engine != nullptr) {
+    engine->destroy();
+  }
+  if (runtime != nullptr) {
+    runtime->destroy();
+  }
+}
+
+template <typename Config> bool YoloDetector<Config>::init() {
+  if (!server_address_.empty()) {
+    infer_client_.reset(new InferClient(server_address_, MAX_BATCH,
+                                        Config::kInputFloats,
+                                        Config::kOutputFloats,
+                                        server_timeout_ms_));
+    if (!infer_client_->init()) {
+      ALOG_ERROR_STREAM("[ TLDDetector ] Could not connect inference server : "
+                        << server_address_);
+      infer_client_.reset();
+      return false;
+    }
+    data = infer_client_->input();
+    prob = infer_client_->output();
+    ALOG_INFO_STREAM("[ TLDDetector ] using inference server "
+                     << server_address_);
+    return true;
+  }
+  host_data_.assign(MAX_BATCH * Config::kInputFloats, 0.0f);
+  host_prob_.assign(MAX_BATCH * Config::kOutputFloats, 0.0f);
+  data = host_data_.data();
+  prob = host_prob_.data();
+
+  const std::string wts_suffix = ".wts";
+  if (engine_file_path_.size() >= wts_suffix.size() &&
+      engine_file_path_.compare(engine_file_path_.size() - wts_suffix.size(),
+                                wts_suffix.size(), wts_suffix) == 0) {
+    return cpu_engine_init();
+  }
+  return engine_init();
+}
+
+template <typename Config> bool YoloDetector<Config>::engine_init() {
   // 从engine文件中读取其内容至 trtModelStream
   std::ifstream file(engine_file_path_, std::ios::binary);
   if (!file.good()) {
-    // ROS_ERROR_STREAM("[ TLDDetector ] Could not read engine file: " <<
-    // engine_file_path_);
+    ALOG_ERROR_STREAM("[ TLDDetector ] Could not read engine file: "
+                      << engine_file_path_);
     return false;
   }
   char *trtModelStream = nullptr;
   size_t size = 0;
   file.seekg(0, file.end);
   size = file.tellg();
-  std::cout << size << std::endl;
+  ALOG_INFO_STREAM("[ TLDDetector ] engine size : " << size << " bytes");
   file.seekg(0, file.beg);
   trtModelStream = new char[size];
   assert(trtModelStream);
@@ -23,11 +288,12 @@ bool TLDDetector::init() {
   runtime = createInferRuntime(gLogger);
   assert(runtime != nullptr);
   engine = runtime->deserializeCudaEngine(trtModelStream, size);
-  assert(engine != nullptr);
-  // IExecutionContext* context = engine->createExecutionContext();
-  context = engine->createExecutionContext();
-  assert(context != nullptr);
   delete[] trtModelStream;
+  if (engine == nullptr) {
+    ALOG_ERROR_STREAM("[ TLDDetector ] Could not deserialize engine : "
+                      << engine_file_path_);
+    return false;
+  }
   assert(engine->getNbBindings() == 2);
 
   // In order to bind the buffers, we need to know the names of the input and
@@ -37,11 +303,24 @@ bool TLDDetector::init() {
   outputIndex = engine->getBindingIndex(OUTPUT_BLOB_NAME);
   assert(inputIndex == 0);
   assert(outputIndex == 1);
+  // yaml 与 engine 不一致时按错误的形状读写缓存, 在这里拒绝
+  const Dims input_dims = engine->getBindingDimensions(inputIndex);
+  if (engine->getMaxBatchSize() < MAX_BATCH || input_dims.nbDims != 3 ||
+      input_dims.d[1] != INPUT_H || input_dims.d[2] != INPUT_W) {
+    ALOG_ERROR_STREAM("[ TLDDetector ] engine (max batch "
+                      << engine->getMaxBatchSize() << ", input "
+                      << input_dims.d[2] << "x" << input_dims.d[1]
+                      << ") does not match model " << model_.name());
+    return false;
+  }
+  // IExecutionContext* context = engine->createExecutionContext();
+  context = engine->createExecutionContext();
+  assert(context != nullptr);
   // Create GPU buffers on device
   CUDA_CHECK(cudaMalloc(&buffers[inputIndex],
-                        BATCH_SIZE * 3 * INPUT_H * INPUT_W * sizeof(float)));
+                        MAX_BATCH * INPUT_SIZE * sizeof(float)));
   CUDA_CHECK(cudaMalloc(&buffers[outputIndex],
-                        BATCH_SIZE * OUTPUT_SIZE * sizeof(float)));
+                        MAX_BATCH * OUTPUT_SIZE * sizeof(float)));
   // Create stream
   // cudaStream_t stream;
   CUDA_CHECK(cudaStreamCreate(&stream));
@@ -49,39 +328,72 @@ bool TLDDetector::init() {
   return true;
 }
 
-bool TLDDetector::detect(std::vector<cv::Mat> frame,
-                         std::vector<std::vector<cr_object>>  *detected_objects) {
-  load_img_to_data(frame);
-  _do_inference(*context, stream, buffers, data, prob, BATCH_SIZE);
-  post_process(frame, detected_objects);
-  if (detected_objects->size() > 0) {
-    return true;
-  } else {
+template <typename Config> bool YoloDetector<Config>::cpu_engine_init() {
+  static_assert(OUTPUT_SIZE == 1 + Yolo::MAX_OUTPUT_BBOX_COUNT *
+                                       sizeof(Yolo::Detection) / sizeof(float),
+                "CpuYoloEngine output layout must match the TensorRT engine");
+  cpu_engine_.reset(new CpuYoloEngine(engine_file_path_, MAX_BATCH, INPUT_W,
+                                      INPUT_H, CLASS_NUM, cpu_threads_));
+  if (!cpu_engine_->init()) {
+    ALOG_ERROR_STREAM("[ TLDDetector ] Could not build cpu engine from : "
+                      << engine_file_path_);
+    cpu_engine_.reset();
     return false;
   }
+  ALOG_INFO_STREAM("[ TLDDetector ] cpu engine"
+                   << (cpu_engine_->is_p6() ? " (p6)" : "") << ", "
+                   << cpu_engine_->num_threads() << " threads");
   return true;
 }
 
-int TLDDetector::get_width(int x, float gw, int divisor) {
-  return static_cast<int>(ceil((x * gw) / divisor)) * divisor;
+template <typename Config> bool YoloDetector<Config>::infer(int batch_size) {
+  if (infer_client_) {
+    TRACE_SCOPE("inference");
+    return infer_client_->infer(batch_size);
+  }
+  if (cpu_engine_) {
+    TRACE_SCOPE("inference");
+    cpu_engine_->infer(data, prob, batch_size);
+    return true;
+  }
+  _do_inference(*context, stream, buffers, data, prob, batch_size);
+  return true;
 }
 
-int TLDDetector::get_depth(int x, float gd) {
-  if (x == 1)
-    return 1;
-  int r = round(x * gd);
-  if (x * gd - static_cast<int>(x * gd) == 0.5 &&
-      (static_cast<int>(x * gd) % 2) == 0) {
-    --r;
+template <typename Config>
+bool YoloDetector<Config>::detect_batch(
+    const std::vector<cv::Mat> &frame,
+    const std::vector<sensor_msgs::ImageConstPtr> &msgs,
+    std::vector<std::vector<cr_object>> *detected_objects, int batch_size,
+    const std::vector<DetectRegion> *regions) {
+  batch_size = std::min(batch_size, static_cast<int>(frame.size()));
+  if (batch_size <= 0) {
+    return false;
   }
-  return std::max(r, 1);
+  // 帧数超过模型的 batch 时分多次推理
+  for (int begin = 0; begin < batch_size; begin += MAX_BATCH) {
+    const int n = std::min<int>(MAX_BATCH, batch_size - begin);
+    // 上一次请求还在服务端处理, 不能改写共享内存中的输入
+    if (infer_client_ && !infer_client_->ready()) {
+      return false;
+    }
+    load_img_to_data(frame, msgs, begin, n);
+    // engine 以 maxBatchSize 构建, 更小的 batch 只拷贝/推理前 n 帧
+    if (!infer(n)) {
+      return false;
+    }
+    post_process(frame, begin, detected_objects, n, regions);
+  }
+  return detected_objects->size() > 0;
 }
 
-ICudaEngine *TLDDetector::build_engine(unsigned int maxBatchSize,
-                                       IBuilder *builder,
-                                       IBuilderConfig *config, DataType dt,
-                                       float &gd, float &gw,
-                                       std::string &wts_name) {
+template <typename Config>
+ICudaEngine *YoloDetector<Config>::build_engine(unsigned int maxBatchSize,
+                                                IBuilder *builder,
+                                                IBuilderConfig *config,
+                                                DataType dt, float &gd,
+                                                float &gw,
+                                                std::string &wts_name) {
   INetworkDefinition *network = builder->createNetworkV2(0U);
 
   // Create input tensor of shape {3, INPUT_H, INPUT_W} with name
@@ -153,7 +465,7 @@ ICudaEngine *TLDDetector::build_engine(unsigned int maxBatchSize,
 
   /* ------ detect ------ */
   IConvolutionLayer *det0 = network->addConvolutionNd(
-      *bottleneck_csp17->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{1, 1},
+      *bottleneck_csp17->getOutput(0), 3 * (CLASS_NUM + 5), DimsHW{1, 1},
       weightMap["model.24.m.0.weight"], weightMap["model.24.m.0.bias"]);
   auto conv18 = convBlock(network, weightMap, *bottleneck_csp17->getOutput(0),
                           get_width(256, gw), 3, 2, 1, "model.18");
@@ -163,7 +475,7 @@ ICudaEngine *TLDDetector::build_engine(unsigned int maxBatchSize,
       C3(network, weightMap, *cat19->getOutput(0), get_width(512, gw),
          get_width(512, gw), get_depth(3, gd), false, 1, 0.5, "model.20");
   IConvolutionLayer *det1 = network->addConvolutionNd(
-      *bottleneck_csp20->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{1, 1},
+      *bottleneck_csp20->getOutput(0), 3 * (CLASS_NUM + 5), DimsHW{1, 1},
       weightMap["model.24.m.1.weight"], weightMap["model.24.m.1.bias"]);
   auto conv21 = convBlock(network, weightMap, *bottleneck_csp20->getOutput(0),
                           get_width(512, gw), 3, 2, 1, "model.21");
@@ -173,32 +485,23 @@ ICudaEngine *TLDDetector::build_engine(unsigned int maxBatchSize,
       C3(network, weightMap, *cat22->getOutput(0), get_width(1024, gw),
          get_width(1024, gw), get_depth(3, gd), false, 1, 0.5, "model.23");
   IConvolutionLayer *det2 = network->addConvolutionNd(
-      *bottleneck_csp23->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{1, 1},
+      *bottleneck_csp23->getOutput(0), 3 * (CLASS_NUM + 5), DimsHW{1, 1},
       weightMap["model.24.m.2.weight"], weightMap["model.24.m.2.bias"]);
 
   auto yolo = addYoLoLayer(network, weightMap, "model.24",
-                           std::vector<IConvolutionLayer *>{det0, det1, det2});
+                           std::vector<IConvolutionLayer *>{det0, det1, det2},
+                           CLASS_NUM, INPUT_W, INPUT_H);
   yolo->getOutput(0)->setName(OUTPUT_BLOB_NAME);
   network->markOutput(*yolo->getOutput(0));
 
   // Build engine
   builder->setMaxBatchSize(maxBatchSize);
   config->setMaxWorkspaceSize(16 * (1 << 20)); // 16MB
-#if defined(USE_FP16)
-  config->setFlag(BuilderFlag::kFP16);
-#elif defined(USE_INT8)
-  std::cout << "Your platform support int8: "
-            << (builder->platformHasFastInt8() ? "true" : "false") << std::endl;
-  assert(builder->platformHasFastInt8());
-  config->setFlag(BuilderFlag::kINT8);
-  Int8EntropyCalibrator2 *calibrator = new Int8EntropyCalibrator2(
-      1, INPUT_W, INPUT_H, "./coco_calib/", "int8calib.table", INPUT_BLOB_NAME);
-  config->setInt8Calibrator(calibrator);
-#endif
-
-  std::cout << "Building engine, please wait for a while..." << std::endl;
+  set_precision(builder, config);
+
+  ALOG_INFO_STREAM("[ TLDDetector ] Building engine, please wait for a while...");
   ICudaEngine *engine = builder->buildEngineWithConfig(*network, *config);
-  std::cout << "Build engine successfully!" << std::endl;
+  ALOG_INFO_STREAM("[ TLDDetector ] Build engine successfully!");
 
   // Don't need the network any more
   network->destroy();
@@ -211,11 +514,13 @@ ICudaEngine *TLDDetector::build_engine(unsigned int maxBatchSize,
   return engine;
 }
 
-ICudaEngine *TLDDetector::build_engine_p6(unsigned int maxBatchSize,
-                                          IBuilder *builder,
-                                          IBuilderConfig *config, DataType dt,
-                                          float &gd, float &gw,
-                                          std::string &wts_name) {
+template <typename Config>
+ICudaEngine *YoloDetector<Config>::build_engine_p6(unsigned int maxBatchSize,
+                                                   IBuilder *builder,
+                                                   IBuilderConfig *config,
+                                                   DataType dt, float &gd,
+                                                   float &gw,
+                                                   std::string &wts_name) {
   INetworkDefinition *network = builder->createNetworkV2(0U);
 
   // Create input tensor of shape {3, INPUT_H, INPUT_W} with name
@@ -317,42 +622,33 @@ ICudaEngine *TLDDetector::build_engine_p6(unsigned int maxBatchSize,
 
   /* ------ detect ------ */
   IConvolutionLayer *det0 = network->addConvolutionNd(
-      *c3_23->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{1, 1},
+      *c3_23->getOutput(0), 3 * (CLASS_NUM + 5), DimsHW{1, 1},
       weightMap["model.33.m.0.weight"], weightMap["model.33.m.0.bias"]);
   IConvolutionLayer *det1 = network->addConvolutionNd(
-      *c3_26->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{1, 1},
+      *c3_26->getOutput(0), 3 * (CLASS_NUM + 5), DimsHW{1, 1},
       weightMap["model.33.m.1.weight"], weightMap["model.33.m.1.bias"]);
   IConvolutionLayer *det2 = network->addConvolutionNd(
-      *c3_29->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{1, 1},
+      *c3_29->getOutput(0), 3 * (CLASS_NUM + 5), DimsHW{1, 1},
       weightMap["model.33.m.2.weight"], weightMap["model.33.m.2.bias"]);
   IConvolutionLayer *det3 = network->addConvolutionNd(
-      *c3_32->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{1, 1},
+      *c3_32->getOutput(0), 3 * (CLASS_NUM + 5), DimsHW{1, 1},
       weightMap["model.33.m.3.weight"], weightMap["model.33.m.3.bias"]);
 
-  auto yolo =
-      addYoLoLayer(network, weightMap, "model.33",
-                   std::vector<IConvolutionLayer *>{det0, det1, det2, det3});
+  auto yolo = addYoLoLayer(
+      network, weightMap, "model.33",
+      std::vector<IConvolutionLayer *>{det0, det1, det2, det3}, CLASS_NUM,
+      INPUT_W, INPUT_H);
   yolo->getOutput(0)->setName(OUTPUT_BLOB_NAME);
   network->markOutput(*yolo->getOutput(0));
 
   // Build engine
   builder->setMaxBatchSize(maxBatchSize);
   config->setMaxWorkspaceSize(16 * (1 << 20)); // 16MB
-#if defined(USE_FP16)
-  config->setFlag(BuilderFlag::kFP16);
-#elif defined(USE_INT8)
-  std::cout << "Your platform support int8: "
-            << (builder->platformHasFastInt8() ? "true" : "false") << std::endl;
-  assert(builder->platformHasFastInt8());
-  config->setFlag(BuilderFlag::kINT8);
-  Int8EntropyCalibrator2 *calibrator = new Int8EntropyCalibrator2(
-      1, INPUT_W, INPUT_H, "./coco_calib/", "int8calib.table", INPUT_BLOB_NAME);
-  config->setInt8Calibrator(calibrator);
-#endif
-
-  std::cout << "Building engine, please wait for a while..." << std::endl;
+  set_precision(builder, config);
+
+  ALOG_INFO_STREAM("[ TLDDetector ] Building engine, please wait for a while...");
   ICudaEngine *engine = builder->buildEngineWithConfig(*network, *config);
-  std::cout << "Build engine successfully!" << std::endl;
+  ALOG_INFO_STREAM("[ TLDDetector ] Build engine successfully!");
 
   // Don't need the network any more
   network->destroy();
@@ -365,9 +661,28 @@ ICudaEngine *TLDDetector::build_engine_p6(unsigned int maxBatchSize,
   return engine;
 }
 
-void TLDDetector::api_to_model(unsigned int maxBatchSize,
-                               IHostMemory **modelStream, bool &is_p6,
-                               float &gd, float &gw, std::string &wts_name) {
+template <typename Config>
+void YoloDetector<Config>::set_precision(IBuilder *builder,
+                                         IBuilderConfig *config) {
+  if (model_.precision == ModelPrecision::kFP16) {
+    config->setFlag(BuilderFlag::kFP16);
+  } else if (model_.precision == ModelPrecision::kINT8) {
+    ALOG_INFO_STREAM("[ TLDDetector ] Your platform support int8: "
+                     << (builder->platformHasFastInt8() ? "true" : "false"));
+    assert(builder->platformHasFastInt8());
+    config->setFlag(BuilderFlag::kINT8);
+    Int8EntropyCalibrator2 *calibrator =
+        new Int8EntropyCalibrator2(1, INPUT_W, INPUT_H, "./coco_calib/",
+                                   "int8calib.table", INPUT_BLOB_NAME);
+    config->setInt8Calibrator(calibrator);
+  }
+}
+
+template <typename Config>
+void YoloDetector<Config>::api_to_model(unsigned int maxBatchSize,
+                                        IHostMemory **modelStream, bool &is_p6,
+                                        float &gd, float &gw,
+                                        std::string &wts_name) {
   // Create builder
   IBuilder *builder = createInferBuilder(gLogger);
   IBuilderConfig *config = builder->createBuilderConfig();
@@ -393,21 +708,37 @@ void TLDDetector::api_to_model(unsigned int maxBatchSize,
   config->destroy();
 }
 
-void TLDDetector::load_img_to_data(const std::vector<cv::Mat> &img) {
-  // if (img.empty()) {
-  //   // ROS_ERROR_STREAM("[ TLDDetector ] load_img_to_data: image is empty!");
-  //   return;
-  // }
-  for(int j = 0; j < img.size(); j++){
-    if (img[j].empty()) continue;
-    cv::Mat pr_img = resize_img(img[j], INPUT_W, INPUT_H); // letterbox BGR to RGB and resize to target size
+template <typename Config>
+void YoloDetector<Config>::load_img_to_data(
+    const std::vector<cv::Mat> &img,
+    const std::vector<sensor_msgs::ImageConstPtr> &msgs, int begin,
+    int batch_size) {
+  TRACE_SCOPE("preprocess");
+  for (int j = 0; j < batch_size && begin + j < static_cast<int>(img.size());
+       j++) {
+    const int k = begin + j;
+    float *blob = data + j * INPUT_SIZE;
+    const sensor_msgs::ImageConstPtr msg =
+        k < static_cast<int>(msgs.size()) ? msgs[k] : nullptr;
+    if (msg && cv_bridge::isBlobEncodingSupported(msg->encoding)) {
+      // 颜色转换 + letterbox + 归一化一次完成, 不生成中间图像
+      cv_bridge::toBlob(*msg, blob, INPUT_W, INPUT_H);
+      continue;
+    }
+    if (img[k].empty()) {
+      // 不能留下上一次的输入, 否则空位会重复输出旧的检测框
+      std::fill(blob, blob + INPUT_SIZE, 0.f);
+      continue;
+    }
+    resize_img(img[k], INPUT_W, INPUT_H, &letterbox_[j], &resized_[j]);
+    const cv::Mat &pr_img = letterbox_[j];
     int i = 0;
     for (int row = 0; row < INPUT_H; ++row) {
       uchar *uc_pixel = pr_img.data + row * pr_img.step;
       for (int col = 0; col < INPUT_W; ++col) {
-        data[j * 3 * INPUT_H * INPUT_W+i] = static_cast<float>(uc_pixel[2]) / 255.0;
-        data[j * 3 * INPUT_H * INPUT_W+i + INPUT_H * INPUT_W] = static_cast<float>(uc_pixel[1]) / 255.0;
-        data[j * 3 * INPUT_H * INPUT_W+i + 2 * INPUT_H * INPUT_W] = static_cast<float>(uc_pixel[0]) / 255.0;
+        blob[i] = static_cast<float>(uc_pixel[2]) / 255.0;
+        blob[i + INPUT_H * INPUT_W] = static_cast<float>(uc_pixel[1]) / 255.0;
+        blob[i + 2 * INPUT_H * INPUT_W] = static_cast<float>(uc_pixel[0]) / 255.0;
         uc_pixel += 3;
         ++i;
       }
@@ -415,13 +746,16 @@ void TLDDetector::load_img_to_data(const std::vector<cv::Mat> &img) {
   }
 }
 
-void TLDDetector::_do_inference(IExecutionContext &context,
-                                cudaStream_t &stream, void **buffers,
-                                float *input, float *output, int batchSize) {
+template <typename Config>
+void YoloDetector<Config>::_do_inference(IExecutionContext &context,
+                                         cudaStream_t &stream, void **buffers,
+                                         float *input, float *output,
+                                         int batchSize) {
+  TRACE_SCOPE("inference");
   // DMA input batch data to device, infer on the batch asynchronously, and DMA
   // output back to host
   CUDA_CHECK(cudaMemcpyAsync(buffers[0], input,
-                             batchSize * 3 * INPUT_H * INPUT_W * sizeof(float),
+                             batchSize * INPUT_SIZE * sizeof(float),
                              cudaMemcpyHostToDevice, stream));
   context.enqueue(batchSize, buffers, stream, nullptr);
   CUDA_CHECK(cudaMemcpyAsync(output, buffers[1],
@@ -430,17 +764,37 @@ void TLDDetector::_do_inference(IExecutionContext &context,
   cudaStreamSynchronize(stream);
 }
 
-void TLDDetector::post_process(const std::vector<cv::Mat> &img,
-                               std::vector<std::vector<cr_object>> *detected_objects) {
-  std::vector<std::vector<Yolo::Detection>> batch_res(BATCH_SIZE);
-  
-  for (int b = 0; b < BATCH_SIZE; b++) {
-    auto& res = batch_res[b];
-    nms(res, &prob[b * OUTPUT_SIZE], CONF_THRESH, NMS_THRESH);
+template <typename Config>
+void YoloDetector<Config>::post_process(
+    const std::vector<cv::Mat> &img, int begin,
+    std::vector<std::vector<cr_object>> *detected_objects, int batch_size,
+    const std::vector<DetectRegion> *regions) {
+  TRACE_SCOPE("detector_postprocess");
+  for (int b = 0; b < batch_size; b++) {
+    TRACE_SCOPE_ARG("nms", begin + b);
+    auto& res = batch_res_[b];
+    res.clear();
+    if (img[begin + b].empty()) {
+      continue;
+    }
+    const DetectRegion *region =
+        regions != nullptr ? &(*regions)[begin + b] : nullptr;
+    if (region == nullptr || region->mask == nullptr) {
+      nms(res, &prob[b * OUTPUT_SIZE], model_.conf_thresh, model_.nms_thresh,
+          &nms_scratch_);
+      continue;
+    }
+    // 脚点在掩码外的框不参与 NMS, 也不会抑制区域内的框
+    const cv::Mat &frame = img[begin + b];
+    nms(res, &prob[b * OUTPUT_SIZE], model_.conf_thresh, model_.nms_thresh,
+        &nms_scratch_, [&](Yolo::Detection &det) {
+          const cv::Rect rect = get_rect(frame, det.bbox, INPUT_W, INPUT_H);
+          return region->mask->contains_foot(rect + region->offset);
+        });
   }
-  
-  for (int b = 0; b < BATCH_SIZE; b++){
-    auto& res = batch_res[b];
+
+  for (int b = 0; b < batch_size; b++){
+    auto& res = batch_res_[b];
     for (size_t j = 0; j < res.size(); j++) {
     // 构造 cr_Object
       float prob = res[j].conf;
@@ -448,22 +802,14 @@ void TLDDetector::post_process(const std::vector<cv::Mat> &img,
       // debug
       // std::cout << "class id :" << res[j].class_id << std::endl;
 
-      cv::Rect rect = get_rect(img[b], res[j].bbox, INPUT_W,
+      cv::Rect rect = get_rect(img[begin + b], res[j].bbox, INPUT_W,
                               INPUT_H); // 得到相对于输入detector的img尺寸的bbox
       // float depth = calculate_depth(rect);
-      detected_objects->at(b).push_back(cr_object{prob, tl_class, -1, rect});
+      detected_objects->at(begin + b).push_back(cr_object{prob, tl_class, -1, rect});
     }
   }
 }
 
-float TLDDetector::calculate_depth(cv::Rect box){
-  float depth_init = 1650.0/ box.height;
-  float a1 = 1.62 * 0.18 / 0.71;
-  float c1 = 0.18;
-
-  float a = 1.0;
-  float b = -(c1 + depth_init);
-  float c = depth_init + c1 - depth_init + a1;
-  float temp = (-b + sqrt(b * b - 4 * a * c)) / (2 * a);
-  return round(temp * 100) / 100;
-}
+template class YoloDetector<Yolo512x512x4>;
+template class YoloDetector<Yolo640x384x8>;
+template class YoloDetector<Yolo320x320x1>;
@@ -0,0 +1,81 @@
+/*
+ * @Description: 推理服务节点, 持有检测 engine, 多个 cr 进程通过共享内存共用
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 19:32:05
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 19:32:05
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tools/cr_infer_server.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <memory>
+#include <string>
+// ros
+#include "ros/ros.h"
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "tld_detector/infer_server.hpp"
+#include "tld_detector/tld_detector.hpp"
+
+int main(int argc, char **argv) {
+  ros::init(argc, argv, "cr_infer_server");
+  ros::NodeHandle pnh("~");
+
+  std::string weight_path;
+  int cpu_threads = 0;
+  std::string log_level;
+  InferServerOptions options;
+  pnh.param("cr_detector_weight_path", weight_path, std::string(""));
+  pnh.param("detector_cpu_threads", cpu_threads, 0);
+  pnh.param("inference_server", options.address, options.address);
+  pnh.param("batch_max_wait_us", options.max_wait_us, options.max_wait_us);
+  pnh.param("log_level", log_level, std::string("info"));
+
+  LogLevel level;
+  if (parse_log_level(log_level, &level)) {
+    AsyncLogger::instance().set_level(level);
+  } else {
+    ROS_ERROR_STREAM("[ main ] unknown log_level : " << log_level);
+  }
+
+  // 按模型的 yaml 选择预编译的检测器, batch 上限和张量大小也由模型决定
+  std::unique_ptr<TLDDetector> detector =
+      TLDDetector::create(weight_path, cpu_threads);
+  if (!detector || !detector->init()) {
+    ROS_ERROR_STREAM("[ main ] detector init failed : " << weight_path);
+    AsyncLogger::instance().shutdown();
+    return 1;
+  }
+  InferServer server(detector.get(), options);
+  if (!server.init()) {
+    ROS_ERROR_STREAM("[ main ] inference server init failed");
+    AsyncLogger::instance().shutdown();
+    return 1;
+  }
+  ros::Time last_report = ros::Time::now();
+  InferServerStats last_stats;
+  while (ros::ok()) {
+    server.spin_once(100);
+    ros::spinOnce();
+    if ((ros::Time::now() - last_report).toSec() < 10.0) {
+      continue;
+    }
+    // 平均 batch 反映跨客户端合并的效果
+    const InferServerStats stats = server.stats();
+    const uint64_t batches = stats.batches - last_stats.batches;
+    ALOG_INFO_STREAM("[ main ] clients " << stats.clients << ", batches "
+                     << batches << ", avg batch "
+                     << (batches > 0 ? static_cast<double>(stats.images -
+                                                           last_stats.images) /
+                                           batches
+                                     : 0.0)
+                     << ", rejected " << stats.rejected - last_stats.rejected);
+    last_stats = stats;
+    last_report = ros::Time::now();
+  }
+  AsyncLogger::instance().shutdown();
+  return 0;
+}
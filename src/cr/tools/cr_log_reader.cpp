@@ -0,0 +1,189 @@
+/*
+ * @Description: 按时间范围导出 cr 记录的 .crlog
+ *   cr_log_reader <文件或目录>... [--from 秒] [--to 秒] [--camera 序号或话题] [--someone] [--summary]
+ *   时间为 unix 秒, 输出 csv, 每个目标一行, 没有目标的行 x/y/w/h 为空
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 22:10:37
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 22:10:37
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tools/cr_log_reader.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <sys/stat.h>
+// cpp system headers
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+// local headers
+#include "common_utils/detection_log.hpp"
+#include "common_utils/read_file_from_dir.hpp"
+
+namespace {
+
+void usage() {
+  std::cerr << "usage: cr_log_reader <file or dir>... [--from sec] [--to sec] "
+               "[--camera index|topic] [--someone] [--summary]"
+            << std::endl;
+}
+
+bool ends_with(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// 目录展开为其中的 .crlog, 文件名带时间, 按名字排序即按时间排序
+void expand(const std::string &path, std::vector<std::string> *files) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    files->push_back(path);
+    return;
+  }
+  std::vector<std::string> names;
+  read_file_from_dir(path.c_str(), &names);
+  std::sort(names.begin(), names.end());
+  for (const std::string &name : names) {
+    if (ends_with(name, ".crlog")) {
+      files->push_back(path + "/" + name);
+    }
+  }
+}
+
+int64_t to_ns(const char *sec) {
+  return static_cast<int64_t>(std::strtod(sec, nullptr) * 1e9);
+}
+
+// 整个参数都是非负整数时才作为相机序号
+bool parse_index(const std::string &s, int *index) {
+  if (s.empty()) {
+    return false;
+  }
+  char *end = nullptr;
+  const long value = std::strtol(s.c_str(), &end, 10);
+  if (*end != '\0' || value < 0 || value > 255) {
+    return false;
+  }
+  *index = static_cast<int>(value);
+  return true;
+}
+
+void print_ns(int64_t ns) {
+  std::printf("%ld.%09ld", static_cast<long>(ns / 1000000000),
+              static_cast<long>(ns % 1000000000));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> files;
+  int64_t begin_ns = std::numeric_limits<int64_t>::min();
+  int64_t end_ns = std::numeric_limits<int64_t>::max();
+  std::string camera;
+  bool someone_only = false;
+  bool summary = false;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--from" && i + 1 < argc) {
+      begin_ns = to_ns(argv[++i]);
+    } else if (arg == "--to" && i + 1 < argc) {
+      end_ns = to_ns(argv[++i]);
+    } else if (arg == "--camera" && i + 1 < argc) {
+      camera = argv[++i];
+    } else if (arg == "--someone") {
+      someone_only = true;
+    } else if (arg == "--summary") {
+      summary = true;
+    } else if (arg.compare(0, 2, "--") == 0) {
+      usage();
+      return 1;
+    } else {
+      expand(arg, &files);
+    }
+  }
+  if (files.empty()) {
+    usage();
+    return 1;
+  }
+  int camera_number = -1;
+  const bool camera_is_number = parse_index(camera, &camera_number);
+  bool camera_found = camera.empty() || summary;
+
+  if (!summary) {
+    std::printf("stamp,publish,camera,seq,someone,keyframe,x,y,w,h,prob,depth,"
+                "class\n");
+  }
+  for (const std::string &file : files) {
+    DetectionLogReader reader;
+    if (!reader.open(file)) {
+      std::cerr << "cannot read " << file << std::endl;
+      continue;
+    }
+    const std::vector<std::string> &names = reader.camera_names();
+    if (summary) {
+      std::printf("%s: %lu rows in %zu blocks, cameras", file.c_str(),
+                  static_cast<unsigned long>(reader.rows()), reader.blocks());
+      for (const std::string &name : names) {
+        std::printf(" %s", name.c_str());
+      }
+      std::printf(", stamp ");
+      print_ns(reader.min_stamp_ns());
+      std::printf(" - ");
+      print_ns(reader.max_stamp_ns());
+      std::printf("\n");
+      continue;
+    }
+    // --camera 可以是序号或话题名, 既不是文件中的话题也不是序号时跳过该文件
+    int camera_index = -1;
+    if (!camera.empty()) {
+      auto it = std::find(names.begin(), names.end(), camera);
+      if (it != names.end()) {
+        camera_index = static_cast<int>(it - names.begin());
+      } else if (camera_is_number) {
+        camera_index = camera_number;
+      } else {
+        std::cerr << file << " has no camera " << camera << std::endl;
+        continue;
+      }
+      camera_found = true;
+    }
+    reader.scan(begin_ns, end_ns, [&](const DetectionLogRow &row) {
+      if ((camera_index >= 0 && row.camera != camera_index) ||
+          (someone_only && !(row.flags & kDetectionLogSomeone))) {
+        return true;
+      }
+      const char *name =
+          row.camera < names.size() ? names[row.camera].c_str() : "?";
+      auto prefix = [&]() {
+        print_ns(row.stamp_ns);
+        std::printf(",");
+        print_ns(row.publish_ns);
+        std::printf(",%s,%u,%d,%d", name, row.seq,
+                    (row.flags & kDetectionLogSomeone) ? 1 : 0,
+                    (row.flags & kDetectionLogKeyframe) ? 1 : 0);
+      };
+      if (row.objects.empty()) {
+        prefix();
+        std::printf(",,,,,,,\n");
+      }
+      for (const DetectionLogObject &o : row.objects) {
+        prefix();
+        std::printf(",%d,%d,%d,%d,%.3f,%.2f,%d\n", o.x, o.y, o.w, o.h, o.prob,
+                    o.depth, o.cls);
+      }
+      return true;
+    });
+  }
+  if (!camera_found) {
+    std::cerr << "unknown camera : " << camera << std::endl;
+    return 1;
+  }
+  return 0;
+}
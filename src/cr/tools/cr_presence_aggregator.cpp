@@ -0,0 +1,158 @@
+/*
+ * @Description: 汇总多个 cr 实例的有人/无人状态
+ *   cr_presence_aggregator <地址>... [--topic peddet] [--stale-ms 1000] [--rate 10] [--pub 地址]
+ *   所有订阅共用一个 ZeroMQPoller(一个 context 和一个I/O线程),
+ *   任一未过期的实例为 yes 时汇总为 yes, 状态变化时输出一行, --pub 时按 rate 发布汇总结果
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-20 10:12:05
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-20 10:12:05
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/cr/tools/cr_presence_aggregator.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <signal.h>
+// cpp system headers
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// local headers
+#include "wind_zmq/wind_zmq.hpp"
+#include "wind_zmq/zmq_poller.hpp"
+
+namespace {
+
+std::atomic<bool> g_running(true);
+
+void on_signal(int) { g_running = false; }
+
+void usage() {
+  std::cerr << "usage: cr_presence_aggregator <endpoint>... [--topic peddet] "
+               "[--stale-ms 1000] [--rate 10] [--pub endpoint]"
+            << std::endl;
+}
+
+struct Feed {
+  std::string endpoint;
+  std::mutex mutex;
+  std::string state; // 最近一条消息 yes/no
+  std::chrono::steady_clock::time_point last;
+  uint64_t received = 0;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> endpoints;
+  std::string topic = "peddet";
+  int stale_ms = 1000;
+  double rate_hz = 10.0;
+  std::string pub_endpoint;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--topic" && i + 1 < argc) {
+      topic = argv[++i];
+    } else if (arg == "--stale-ms" && i + 1 < argc) {
+      stale_ms = std::atoi(argv[++i]);
+    } else if (arg == "--rate" && i + 1 < argc) {
+      rate_hz = std::atof(argv[++i]);
+    } else if (arg == "--pub" && i + 1 < argc) {
+      pub_endpoint = argv[++i];
+    } else if (arg.compare(0, 2, "--") == 0) {
+      usage();
+      return 1;
+    } else {
+      endpoints.push_back(arg);
+    }
+  }
+  if (endpoints.empty() || rate_hz <= 0 || stale_ms <= 0) {
+    usage();
+    return 1;
+  }
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  ZeroMQPoller poller;
+  if (!poller.init()) {
+    return 1;
+  }
+  std::vector<std::unique_ptr<Feed>> feeds;
+  for (const std::string &endpoint : endpoints) {
+    std::unique_ptr<Feed> feed(new Feed());
+    feed->endpoint = endpoint;
+    Feed *f = feed.get();
+    // 只取数据帧, cr 的时间戳帧(zmq_stamp_frame)忽略
+    const int id = poller.add_subscription(
+        topic, endpoint,
+        [f](const std::string &, const std::string &msg,
+            const std::vector<std::string> &) {
+          std::lock_guard<std::mutex> lock(f->mutex);
+          f->state = msg;
+          f->last = std::chrono::steady_clock::now();
+          ++f->received;
+        });
+    if (id < 0) {
+      return 1;
+    }
+    feeds.push_back(std::move(feed));
+  }
+  // 与订阅共用 context, 需要在 poller.stop() 之前析构
+  std::unique_ptr<ZeroMQPublisher> publisher;
+  if (!pub_endpoint.empty()) {
+    ZeroMQPublisherOptions options;
+    options.send_policy = ZeroMQSendPolicy::kConflate;
+    publisher.reset(
+        new ZeroMQPublisher(topic, pub_endpoint, poller.context(), options));
+    if (!publisher->init()) {
+      return 1;
+    }
+  }
+  if (!poller.start()) {
+    return 1;
+  }
+
+  const std::chrono::microseconds period(
+      static_cast<int64_t>(1e6 / rate_hz));
+  std::string last_line;
+  while (g_running) {
+    const auto now = std::chrono::steady_clock::now();
+    bool someone = false;
+    std::string line;
+    for (const auto &feed : feeds) {
+      std::string state;
+      {
+        std::lock_guard<std::mutex> lock(feed->mutex);
+        const bool stale =
+            feed->received == 0 ||
+            now - feed->last > std::chrono::milliseconds(stale_ms);
+        state = stale ? "stale" : feed->state;
+      }
+      someone = someone || state == "yes";
+      line += " " + feed->endpoint + "=" + state;
+    }
+    line = std::string(someone ? "yes" : "no") + line;
+    if (line != last_line) {
+      std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count()
+                << " " << line << std::endl;
+      last_line = line;
+    }
+    if (publisher) {
+      publisher->publish_str(someone ? "yes" : "no");
+    }
+    std::this_thread::sleep_for(period);
+  }
+  publisher.reset();
+  poller.stop();
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2022, plusgo Company Limited.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef CV_BRIDGE_BLOB_H
+#define CV_BRIDGE_BLOB_H
+
+#include <sensor_msgs/Image.h>
+#include <opencv2/core/core.hpp>
+#include <string>
+
+namespace cv_bridge {
+
+/**
+ * \brief Where the source image ended up inside a letterboxed blob.
+ *
+ * The source is scaled by \a scale_x / \a scale_y to \a width x \a height and placed at
+ * (\a offset_x, \a offset_y); the rest of the blob is padding.
+ */
+struct LetterboxTransform
+{
+  float scale_x;
+  float scale_y;
+  int offset_x;
+  int offset_y;
+  int width;
+  int height;
+
+  /**
+   * \brief Map a rectangle in blob coordinates back to source image coordinates.
+   */
+  cv::Rect2f toSource(const cv::Rect2f& rect) const;
+};
+
+/**
+ * \brief Compute the letterbox placement used by toBlob().
+ *
+ * Matches the aspect-preserving, centered letterbox the detectors have always used, so
+ * boxes can be mapped back without the converted image.
+ */
+LetterboxTransform getLetterboxTransform(int src_width, int src_height,
+                                         int dst_width, int dst_height);
+
+/**
+ * \brief Return true if toBlob() can read \a encoding directly.
+ *
+ * Supported: \c "bgr8", \c "rgb8", \c "mono8", \c "yuv422" and the four 8 bit Bayer patterns.
+ */
+bool isBlobEncodingSupported(const std::string& encoding);
+
+/**
+ * \brief Convert a sensor_msgs::Image straight into a detector input tensor.
+ *
+ * Color conversion (including demosaicing), bilinear letterbox resize and normalization
+ * are fused into one parallel pass over the message data; no intermediate cv::Mat is
+ * allocated. The result is written as planar RGB float (3 x \a dst_height x \a dst_width,
+ * values in [0, \a scale * 255]) to \a dst, which must hold 3 * dst_width * dst_height floats.
+ *
+ * \param source     The image message, in one of the encodings accepted by isBlobEncodingSupported()
+ * \param dst        Caller-owned output buffer, e.g. one batch slot of the detector input
+ * \param dst_width  Blob width
+ * \param dst_height Blob height
+ * \param scale      Factor applied to the 0-255 pixel values
+ * \param pad_value  Value written to the letterbox border (before \a scale)
+ * \return The letterbox placement, for mapping detections back to the source image.
+ */
+LetterboxTransform toBlob(const sensor_msgs::Image& source, float* dst,
+                          int dst_width, int dst_height,
+                          float scale = 1.0f / 255.0f, float pad_value = 128.0f);
+
+} // namespace cv_bridge
+
+#endif
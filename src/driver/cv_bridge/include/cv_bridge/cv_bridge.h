@@ -247,6 +247,64 @@ CvImageConstPtr toCvShare(const sensor_msgs::Image& source,
 CvImagePtr cvtColor(const CvImageConstPtr& source,
                     const std::string& encoding);
 
+/**
+ * \brief A source/destination encoding pair resolved once into the steps needed to convert.
+ *
+ * toCvCopy() and cvtColor() parse both encoding strings and look up the conversion codes on
+ * every call, and allocate the destination and any intermediate images each time. A plan does
+ * the parsing in its constructor; convert() then only runs the precomputed cvtColor/convertTo
+ * steps, reusing the caller's destination and the plan's intermediate buffers when sizes do not
+ * change. Follows the same conversion rules as toCvCopy().
+ *
+ * A plan is not thread safe (it owns intermediate buffers); use one per subscriber callback.
+ */
+class ConversionPlan
+{
+public:
+  ConversionPlan() : src_type_(-1), dst_type_(-1), src_byte_depth_(0), src_channels_(0) {}
+
+  /**
+   * \brief Resolve the conversion. Throws cv_bridge::Exception if it is not supported.
+   *
+   * An empty \a dst_encoding keeps the source encoding.
+   */
+  ConversionPlan(const std::string& src_encoding, const std::string& dst_encoding);
+
+  //! True if the plan was built for \a src_encoding (a plain string compare).
+  bool matches(const std::string& src_encoding) const { return src_type_ >= 0 && src_encoding == src_encoding_; }
+
+  const std::string& srcEncoding() const { return src_encoding_; }
+  const std::string& dstEncoding() const { return dst_encoding_; }
+  int dstType() const { return dst_type_; }
+
+  /**
+   * \brief Convert \a source into \a dst, which is only reallocated when its size or type differs.
+   */
+  void convert(const cv::Mat& source, cv::Mat& dst);
+
+  /**
+   * \brief Convert an image message into \a dst. The message encoding must match the plan.
+   */
+  void convert(const sensor_msgs::Image& source, cv::Mat& dst);
+
+private:
+  struct Step
+  {
+    int code;      // cv::ColorConversionCodes, or -1 for a depth conversion
+    int dst_depth; // depth conversion target
+    double scale;  // depth conversion scale
+  };
+
+  std::string src_encoding_;
+  std::string dst_encoding_;
+  int src_type_;
+  int dst_type_;
+  int src_byte_depth_;
+  int src_channels_;
+  std::vector<Step> steps_;
+  std::vector<cv::Mat> intermediates_;
+};
+
 struct CvtColorForDisplayOptions {
   CvtColorForDisplayOptions() :
     do_dynamic_scaling(false),
@@ -0,0 +1,162 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2022, plusgo Company Limited.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef CV_BRIDGE_MSG_POOL_H
+#define CV_BRIDGE_MSG_POOL_H
+
+#include <cv_bridge/cv_bridge.h>
+#include <sensor_msgs/CompressedImage.h>
+#include <sensor_msgs/Image.h>
+#include <boost/make_shared.hpp>
+#include <string>
+#include <vector>
+
+namespace cv_bridge {
+
+/**
+ * \brief Small pool of messages whose data vectors keep their capacity across frames.
+ *
+ * A pooled message is only handed out again once no one else holds a reference to it
+ * (publisher queues, intra-process subscribers), so reuse never touches data that is
+ * still in flight. When every pooled message is busy a fresh one is returned instead.
+ * Not thread safe; use one pool per publishing thread.
+ */
+template <class M>
+class MessagePool
+{
+public:
+  typedef boost::shared_ptr<M> MPtr;
+
+  explicit MessagePool(size_t capacity = 4) : capacity_(capacity), allocations_(0) {}
+
+  MPtr acquire()
+  {
+    for (size_t i = 0; i < pool_.size(); ++i)
+    {
+      if (pool_[i].unique())
+        return pool_[i];
+    }
+    ++allocations_;
+    MPtr msg = boost::make_shared<M>();
+    if (pool_.size() < capacity_)
+      pool_.push_back(msg);
+    return msg;
+  }
+
+  //! Number of messages created so far; stays constant in steady state.
+  size_t allocations() const { return allocations_; }
+
+private:
+  std::vector<MPtr> pool_;
+  size_t capacity_;
+  size_t allocations_;
+};
+
+/**
+ * \brief Pool of sensor_msgs::Image that lets callers render straight into the message.
+ */
+class ImageMsgPool
+{
+public:
+  explicit ImageMsgPool(size_t capacity = 4) : pool_(capacity) {}
+
+  /**
+   * \brief Get a message sized for \a rows x \a cols of \a encoding, and a cv::Mat view of its data.
+   *
+   * Draw or cv::remap/copyTo into \a view directly; the message is then ready to publish
+   * without a further copy.
+   */
+  sensor_msgs::ImagePtr acquire(const std_msgs::Header& header, const std::string& encoding,
+                                int rows, int cols, cv::Mat* view);
+
+  /**
+   * \brief Same as CvImage::toImageMsg(), but into a pooled message.
+   */
+  sensor_msgs::ImagePtr toImageMsg(const CvImage& image);
+
+  size_t allocations() const { return pool_.allocations(); }
+
+private:
+  MessagePool<sensor_msgs::Image> pool_;
+};
+
+/**
+ * \brief JPEG encoder writing into pooled sensor_msgs::CompressedImage buffers.
+ *
+ * Uses libjpeg-turbo's TurboJPEG API when cv_bridge was built with it
+ * (CV_BRIDGE_HAVE_TURBOJPEG), encoding into a preallocated buffer. Otherwise falls back to
+ * cv::imencode writing into the reused message vector. One encoder per thread; encoders
+ * for different cameras can run in parallel.
+ */
+class JpegEncoder
+{
+public:
+  explicit JpegEncoder(int quality = 90, size_t pool_capacity = 4);
+  ~JpegEncoder();
+
+  void setQuality(int quality);
+  int quality() const { return quality_; }
+
+  /**
+   * \brief Encode a bgr8 or mono8 image.
+   *
+   * \a msg.data keeps its capacity between calls. Throws cv_bridge::Exception for other
+   * image types or when the encoder fails.
+   */
+  void encode(const cv::Mat& image, const std_msgs::Header& header,
+              sensor_msgs::CompressedImage& msg);
+
+  //! Encode into a pooled message.
+  sensor_msgs::CompressedImagePtr encode(const cv::Mat& image, const std_msgs::Header& header);
+
+  //! True if libjpeg-turbo is used.
+  static bool usingTurboJpeg();
+
+  size_t allocations() const { return pool_.allocations(); }
+
+private:
+  JpegEncoder(const JpegEncoder&);
+  JpegEncoder& operator=(const JpegEncoder&);
+
+  int quality_;
+  void* tj_handle_;
+  std::vector<int> imencode_params_;
+  // turbojpeg output, kept at the worst case size for the last image size
+  std::vector<unsigned char> scratch_;
+  MessagePool<sensor_msgs::CompressedImage> pool_;
+};
+
+} // namespace cv_bridge
+
+#endif
@@ -3,6 +3,6 @@ from .core import CvBridge, CvBridgeError
 # python bindings
 try:
     # This try is just to satisfy doc jobs that are built differently.
-    from cv_bridge.boost.cv_bridge_boost import cvtColorForDisplay, getCvType
+    from cv_bridge.boost.cv_bridge_boost import ConversionPlan, cvtColorForDisplay, getCvType
 except ImportError:
     pass
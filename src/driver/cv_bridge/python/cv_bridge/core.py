@@ -32,7 +32,6 @@
 # POSSIBILITY OF SUCH DAMAGE.
 
 import sensor_msgs.msg
-import sys
 
 
 class CvBridgeError(TypeError):
@@ -79,6 +78,8 @@ class CvBridge(object):
                                         'int16': '16S', 'int32': '32S', 'float32': '32F',
                                         'float64': '64F'}
         self.numpy_type_to_cvtype.update(dict((v, k) for (k, v) in self.numpy_type_to_cvtype.items()))
+        # (src_encoding, dst_encoding) -> ConversionPlan
+        self._conversion_plans = {}
 
     def dtype_with_channels_to_cvtype2(self, dtype, n_channels):
         return '%sC%d' % (self.numpy_type_to_cvtype[dtype.name], n_channels)
@@ -157,33 +158,55 @@ class CvBridge(object):
         This function returns an OpenCV :cpp:type:`cv::Mat` message on success, or raises :exc:`cv_bridge.CvBridgeError` on failure.
 
         If the image only has one channel, the shape has size 2 (width and height)
+
+        With ``"passthrough"`` the returned array shares memory with ``img_msg.data`` unless the byte
+        order has to be swapped; it is read only when the data is ``bytes``.
         """
-        import cv2
-        import numpy as np
-        dtype, n_channels = self.encoding_to_dtype_with_channels(img_msg.encoding)
-        dtype = np.dtype(dtype)
-        dtype = dtype.newbyteorder('>' if img_msg.is_bigendian else '<')
-        if n_channels == 1:
-            im = np.ndarray(shape=(img_msg.height, img_msg.width),
-                           dtype=dtype, buffer=img_msg.data)
-        else:
-            im = np.ndarray(shape=(img_msg.height, img_msg.width, n_channels),
-                           dtype=dtype, buffer=img_msg.data)
-        # If the byt order is different between the message and the system.
-        if img_msg.is_bigendian == (sys.byteorder == 'little'):
-            im = im.byteswap().newbyteorder()
+        from cv_bridge.boost.cv_bridge_boost import imgmsgToArray
+
+        try:
+            im = imgmsgToArray(img_msg.data, img_msg.height, img_msg.width, img_msg.step,
+                               img_msg.encoding, img_msg.is_bigendian)
+        except RuntimeError as e:
+            raise CvBridgeError(e)
 
         if desired_encoding == "passthrough":
             return im
 
-        from cv_bridge.boost.cv_bridge_boost import cvtColor2
+        try:
+            return self._conversion_plan(img_msg.encoding, desired_encoding).convert(im)
+        except RuntimeError as e:
+            raise CvBridgeError(e)
+
+    def imgmsgs_to_cv2(self, img_msgs, desired_encoding = "passthrough"):
+        """
+        Convert a list of sensor_msgs::Image messages to OpenCV :cpp:type:`cv::Mat` images.
+
+        :param img_msgs:  A sequence of :cpp:type:`sensor_msgs::Image` messages
+        :param desired_encoding:  The encoding of the output images, as in :meth:`imgmsg_to_cv2`
+
+        :rtype: list of :cpp:type:`cv::Mat`
+        :raises CvBridgeError: when the conversion is not possible for one of the messages.
+
+        Equivalent to calling :meth:`imgmsg_to_cv2` on every message, but the conversions run in
+        parallel without holding the GIL, with each encoding pair resolved only once.
+        """
+        from cv_bridge.boost.cv_bridge_boost import imgmsgsToArrays
 
         try:
-            res = cvtColor2(im, img_msg.encoding, desired_encoding)
+            return imgmsgsToArrays(list(img_msgs), desired_encoding)
         except RuntimeError as e:
             raise CvBridgeError(e)
 
-        return res
+    def _conversion_plan(self, src_encoding, dst_encoding):
+        from cv_bridge.boost.cv_bridge_boost import ConversionPlan
+
+        key = (src_encoding, dst_encoding)
+        plan = self._conversion_plans.get(key)
+        if plan is None:
+            plan = ConversionPlan(src_encoding, dst_encoding)
+            self._conversion_plans[key] = plan
+        return plan
 
     def cv2_to_compressed_imgmsg(self, cvim, dst_format = "jpg"):
         """
@@ -0,0 +1,304 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2022, plusgo Company Limited.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <cv_bridge/blob.h>
+#include <cv_bridge/cv_bridge.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core/utility.hpp>
+#include <sensor_msgs/image_encodings.h>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace cv_bridge {
+
+namespace {
+
+inline float clampByte(float v)
+{
+  return std::min(std::max(v, 0.0f), 255.0f);
+}
+
+// Each sampler decodes one source pixel to RGB. They are instantiated into the resize
+// loop as template parameters so the per-pixel encoding dispatch compiles away.
+
+struct SamplerBGR8
+{
+  const uint8_t* data; size_t step; int cols; int rows;
+  inline void operator()(int x, int y, float* rgb) const
+  {
+    const uint8_t* p = data + y * step + x * 3;
+    rgb[0] = p[2]; rgb[1] = p[1]; rgb[2] = p[0];
+  }
+};
+
+struct SamplerRGB8
+{
+  const uint8_t* data; size_t step; int cols; int rows;
+  inline void operator()(int x, int y, float* rgb) const
+  {
+    const uint8_t* p = data + y * step + x * 3;
+    rgb[0] = p[0]; rgb[1] = p[1]; rgb[2] = p[2];
+  }
+};
+
+struct SamplerMono8
+{
+  const uint8_t* data; size_t step; int cols; int rows;
+  inline void operator()(int x, int y, float* rgb) const
+  {
+    rgb[0] = rgb[1] = rgb[2] = data[y * step + x];
+  }
+};
+
+// yuv422 is UYVY: [U Y0 V Y1] per pixel pair. Same BT.601 video-range coefficients as
+// cv::COLOR_YUV2RGB_UYVY.
+struct SamplerUYVY
+{
+  const uint8_t* data; size_t step; int cols; int rows;
+  inline void operator()(int x, int y, float* rgb) const
+  {
+    const uint8_t* p = data + y * step + (x & ~1) * 2;
+    float u = p[0] - 128.0f;
+    float v = p[2] - 128.0f;
+    float yy = 1.164f * std::max(p[1 + (x & 1) * 2] - 16.0f, 0.0f);
+    rgb[0] = clampByte(yy + 1.596f * v);
+    rgb[1] = clampByte(yy - 0.813f * v - 0.391f * u);
+    rgb[2] = clampByte(yy + 2.018f * u);
+  }
+};
+
+// Bilinear demosaic of a single pixel. (red_x, red_y) is the position of the red sample
+// inside the 2x2 Bayer tile.
+struct SamplerBayer
+{
+  const uint8_t* data; size_t step; int cols; int rows;
+  int red_x; int red_y;
+
+  inline float at(int x, int y) const
+  {
+    x = std::min(std::max(x, 0), cols - 1);
+    y = std::min(std::max(y, 0), rows - 1);
+    return data[y * step + x];
+  }
+
+  inline void operator()(int x, int y, float* rgb) const
+  {
+    bool red_row = ((y & 1) == red_y);
+    bool red_col = ((x & 1) == red_x);
+    float c = at(x, y);
+    float cross = 0.25f * (at(x - 1, y) + at(x + 1, y) + at(x, y - 1) + at(x, y + 1));
+    float diag = 0.25f * (at(x - 1, y - 1) + at(x + 1, y - 1) + at(x - 1, y + 1) + at(x + 1, y + 1));
+    float horiz = 0.5f * (at(x - 1, y) + at(x + 1, y));
+    float vert = 0.5f * (at(x, y - 1) + at(x, y + 1));
+    if (red_row && red_col) {
+      rgb[0] = c; rgb[1] = cross; rgb[2] = diag;
+    } else if (!red_row && !red_col) {
+      rgb[0] = diag; rgb[1] = cross; rgb[2] = c;
+    } else if (red_row) {
+      rgb[0] = horiz; rgb[1] = c; rgb[2] = vert;
+    } else {
+      rgb[0] = vert; rgb[1] = c; rgb[2] = horiz;
+    }
+  }
+};
+
+struct AxisTap
+{
+  int i0;
+  int i1;
+  float w1;
+};
+
+// Same source coordinate convention as cv::resize with INTER_LINEAR.
+void computeTaps(int src_size, int dst_size, std::vector<AxisTap>* taps)
+{
+  taps->resize(dst_size);
+  double inv_scale = static_cast<double>(src_size) / dst_size;
+  for (int i = 0; i < dst_size; ++i) {
+    double s = (i + 0.5) * inv_scale - 0.5;
+    int i0 = static_cast<int>(std::floor(s));
+    float w1 = static_cast<float>(s - i0);
+    if (i0 < 0) {
+      i0 = 0;
+      w1 = 0.0f;
+    }
+    if (i0 >= src_size - 1) {
+      i0 = src_size - 1;
+      w1 = 0.0f;
+    }
+    (*taps)[i] = AxisTap{i0, std::min(i0 + 1, src_size - 1), w1};
+  }
+}
+
+template <typename Sampler>
+void fillBlob(const Sampler& sampler, const LetterboxTransform& lb,
+              float* dst, int dst_width, int dst_height, float scale, float pad_value)
+{
+  std::vector<AxisTap> x_taps, y_taps;
+  computeTaps(sampler.cols, lb.width, &x_taps);
+  computeTaps(sampler.rows, lb.height, &y_taps);
+
+  const size_t plane = static_cast<size_t>(dst_width) * dst_height;
+  const float pad = pad_value * scale;
+
+  cv::parallel_for_(cv::Range(0, dst_height), [&](const cv::Range& range) {
+    for (int dy = range.start; dy < range.end; ++dy) {
+      float* r_row = dst + static_cast<size_t>(dy) * dst_width;
+      float* g_row = r_row + plane;
+      float* b_row = g_row + plane;
+
+      int cy = dy - lb.offset_y;
+      if (cy < 0 || cy >= lb.height) {
+        std::fill(r_row, r_row + dst_width, pad);
+        std::fill(g_row, g_row + dst_width, pad);
+        std::fill(b_row, b_row + dst_width, pad);
+        continue;
+      }
+      std::fill(r_row, r_row + lb.offset_x, pad);
+      std::fill(g_row, g_row + lb.offset_x, pad);
+      std::fill(b_row, b_row + lb.offset_x, pad);
+      std::fill(r_row + lb.offset_x + lb.width, r_row + dst_width, pad);
+      std::fill(g_row + lb.offset_x + lb.width, g_row + dst_width, pad);
+      std::fill(b_row + lb.offset_x + lb.width, b_row + dst_width, pad);
+
+      const AxisTap& ty = y_taps[cy];
+      const float wy1 = ty.w1 * scale;
+      const float wy0 = scale - wy1;
+      for (int cx = 0; cx < lb.width; ++cx) {
+        const AxisTap& tx = x_taps[cx];
+        float p00[3], p01[3], p10[3], p11[3];
+        sampler(tx.i0, ty.i0, p00);
+        sampler(tx.i1, ty.i0, p01);
+        sampler(tx.i0, ty.i1, p10);
+        sampler(tx.i1, ty.i1, p11);
+        const float wx1 = tx.w1;
+        const float wx0 = 1.0f - wx1;
+        const int ox = lb.offset_x + cx;
+        r_row[ox] = wy0 * (wx0 * p00[0] + wx1 * p01[0]) + wy1 * (wx0 * p10[0] + wx1 * p11[0]);
+        g_row[ox] = wy0 * (wx0 * p00[1] + wx1 * p01[1]) + wy1 * (wx0 * p10[1] + wx1 * p11[1]);
+        b_row[ox] = wy0 * (wx0 * p00[2] + wx1 * p01[2]) + wy1 * (wx0 * p10[2] + wx1 * p11[2]);
+      }
+    }
+  });
+}
+
+} // namespace
+
+cv::Rect2f LetterboxTransform::toSource(const cv::Rect2f& rect) const
+{
+  return cv::Rect2f((rect.x - offset_x) / scale_x, (rect.y - offset_y) / scale_y,
+                    rect.width / scale_x, rect.height / scale_y);
+}
+
+LetterboxTransform getLetterboxTransform(int src_width, int src_height,
+                                         int dst_width, int dst_height)
+{
+  LetterboxTransform lb;
+  float r_w = dst_width / (src_width * 1.0f);
+  float r_h = dst_height / (src_height * 1.0f);
+  if (r_h > r_w) {
+    lb.width = dst_width;
+    lb.height = static_cast<int>(r_w * src_height);
+    lb.offset_x = 0;
+    lb.offset_y = (dst_height - lb.height) / 2;
+  } else {
+    lb.width = static_cast<int>(r_h * src_width);
+    lb.height = dst_height;
+    lb.offset_x = (dst_width - lb.width) / 2;
+    lb.offset_y = 0;
+  }
+  lb.scale_x = lb.width / (src_width * 1.0f);
+  lb.scale_y = lb.height / (src_height * 1.0f);
+  return lb;
+}
+
+bool isBlobEncodingSupported(const std::string& encoding)
+{
+  return encoding == enc::BGR8 || encoding == enc::RGB8 || encoding == enc::MONO8 ||
+         encoding == enc::YUV422 ||
+         encoding == enc::BAYER_RGGB8 || encoding == enc::BAYER_BGGR8 ||
+         encoding == enc::BAYER_GBRG8 || encoding == enc::BAYER_GRBG8;
+}
+
+LetterboxTransform toBlob(const sensor_msgs::Image& source, float* dst,
+                          int dst_width, int dst_height, float scale, float pad_value)
+{
+  if (dst == NULL || dst_width <= 0 || dst_height <= 0)
+    throw Exception("toBlob: invalid destination buffer");
+  if (source.width == 0 || source.height == 0)
+    throw Exception("toBlob: empty source image");
+  if (!isBlobEncodingSupported(source.encoding))
+    throw Exception("toBlob: unsupported encoding [" + source.encoding + "]");
+
+  const std::string& e = source.encoding;
+  size_t bytes_per_pixel = (e == enc::BGR8 || e == enc::RGB8) ? 3 : (e == enc::YUV422 ? 2 : 1);
+  if (source.step < source.width * bytes_per_pixel ||
+      source.data.size() < static_cast<size_t>(source.step) * source.height)
+    throw Exception("toBlob: image data is smaller than width/height/step describe");
+  if (e == enc::YUV422 && (source.width & 1))
+    throw Exception("toBlob: yuv422 requires an even width");
+
+  const int cols = source.width;
+  const int rows = source.height;
+  const uint8_t* data = &source.data[0];
+  const size_t step = source.step;
+  LetterboxTransform lb = getLetterboxTransform(cols, rows, dst_width, dst_height);
+
+  if (e == enc::BGR8) {
+    fillBlob(SamplerBGR8{data, step, cols, rows}, lb, dst, dst_width, dst_height, scale, pad_value);
+  } else if (e == enc::RGB8) {
+    fillBlob(SamplerRGB8{data, step, cols, rows}, lb, dst, dst_width, dst_height, scale, pad_value);
+  } else if (e == enc::MONO8) {
+    fillBlob(SamplerMono8{data, step, cols, rows}, lb, dst, dst_width, dst_height, scale, pad_value);
+  } else if (e == enc::YUV422) {
+    fillBlob(SamplerUYVY{data, step, cols, rows}, lb, dst, dst_width, dst_height, scale, pad_value);
+  } else {
+    SamplerBayer bayer{data, step, cols, rows, 0, 0};
+    if (e == enc::BAYER_BGGR8) {
+      bayer.red_x = 1; bayer.red_y = 1;
+    } else if (e == enc::BAYER_GBRG8) {
+      bayer.red_x = 0; bayer.red_y = 1;
+    } else if (e == enc::BAYER_GRBG8) {
+      bayer.red_x = 1; bayer.red_y = 0;
+    }
+    fillBlob(bayer, lb, dst, dst_width, dst_height, scale, pad_value);
+  }
+  return lb;
+}
+
+} // namespace cv_bridge
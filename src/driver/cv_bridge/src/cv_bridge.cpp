@@ -352,6 +352,88 @@ CvImagePtr toCvCopyImpl(const cv::Mat& source,
 
 /// @endcond
 
+/////////////////////////////////////// ConversionPlan ///////////////////////////////////////////
+
+ConversionPlan::ConversionPlan(const std::string& src_encoding, const std::string& dst_encoding)
+  : src_encoding_(src_encoding),
+    dst_encoding_(dst_encoding.empty() ? src_encoding : dst_encoding),
+    src_type_(getCvType(src_encoding)),
+    dst_type_(getCvType(dst_encoding_)),
+    src_byte_depth_(enc::bitDepth(src_encoding) / 8),
+    src_channels_(enc::numChannels(src_encoding))
+{
+  if (dst_encoding_ == src_encoding_)
+    return;
+
+  const std::vector<int> codes = getConversionCode(src_encoding_, dst_encoding_);
+  const int src_depth = enc::bitDepth(src_encoding_);
+  const int dst_depth = enc::bitDepth(dst_encoding_);
+  for (size_t i = 0; i < codes.size(); ++i)
+  {
+    Step step;
+    step.code = codes[i];
+    step.dst_depth = CV_MAT_DEPTH(dst_type_);
+    step.scale = 1.0;
+    if (step.code == SAME_FORMAT)
+    {
+      // Same scaling between CV_8U [0,255] and CV_16U [0,65535] as toCvCopyImpl
+      if (src_depth == 8 && dst_depth == 16)
+        step.scale = 65535. / 255.;
+      else if (src_depth == 16 && dst_depth == 8)
+        step.scale = 255. / 65535.;
+    }
+    steps_.push_back(step);
+  }
+  if (steps_.size() > 1)
+    intermediates_.resize(steps_.size() - 1);
+}
+
+void ConversionPlan::convert(const cv::Mat& source, cv::Mat& dst)
+{
+  if (src_type_ < 0)
+    throw Exception("ConversionPlan::convert called on an empty plan");
+  if (steps_.empty())
+  {
+    source.copyTo(dst);
+    return;
+  }
+
+  const cv::Mat* in = &source;
+  for (size_t i = 0; i < steps_.size(); ++i)
+  {
+    const Step& step = steps_[i];
+    cv::Mat& out = (i + 1 == steps_.size()) ? dst : intermediates_[i];
+    if (step.code == SAME_FORMAT)
+    {
+      // Keep the number of channels, change to the final depth
+      in->convertTo(out, CV_MAKETYPE(step.dst_depth, in->channels()), step.scale);
+    }
+    else
+    {
+      cv::cvtColor(*in, out, step.code);
+    }
+    in = &out;
+  }
+}
+
+void ConversionPlan::convert(const sensor_msgs::Image& source, cv::Mat& dst)
+{
+  if (!matches(source.encoding))
+    throw Exception("ConversionPlan for [" + src_encoding_ + "] used with [" + source.encoding + "]");
+
+  const bool native_order = src_byte_depth_ == 1 ||
+      (boost::endian::order::native == boost::endian::order::big) == static_cast<bool>(source.is_bigendian);
+  if (!native_order || source.step < source.width * src_byte_depth_ * src_channels_ ||
+      source.height * source.step != source.data.size() || source.data.empty())
+  {
+    // Byte swapping and the detailed error messages live in matFromImage
+    convert(matFromImage(source), dst);
+    return;
+  }
+  cv::Mat mat(source.height, source.width, src_type_, const_cast<uchar*>(&source.data[0]), source.step);
+  convert(mat, dst);
+}
+
 sensor_msgs::ImagePtr CvImage::toImageMsg() const
 {
   sensor_msgs::ImagePtr ptr = boost::make_shared<sensor_msgs::Image>();
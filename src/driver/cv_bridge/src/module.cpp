@@ -34,20 +34,285 @@
 
 #include "module.hpp"
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+#include <opencv2/core/utility.hpp>
+
 PyObject *mod_opencv;
 
+namespace {
+
+int npyTypeFromDepth(int depth)
+{
+  switch (depth)
+  {
+    case CV_8U: return NPY_UBYTE;
+    case CV_8S: return NPY_BYTE;
+    case CV_16U: return NPY_USHORT;
+    case CV_16S: return NPY_SHORT;
+    case CV_32S: return NPY_INT;
+    case CV_32F: return NPY_FLOAT;
+    case CV_64F: return NPY_DOUBLE;
+  }
+  throw cv_bridge::Exception("Unsupported OpenCV depth");
+}
+
+/// Pixels of an image message seen as a cv::Mat, together with the Python object keeping them alive.
+struct ImageView
+{
+  bp::object owner;  // memoryview over the message data
+  cv::Mat mat;       // points into owner, unless the bytes had to be swapped
+  bool shared;
+  bool readonly;
+};
+
+void byteSwapInPlace(cv::Mat& mat)
+{
+  const size_t elem = mat.elemSize1();
+  for (int y = 0; y < mat.rows; ++y)
+  {
+    uchar* p = mat.ptr(y);
+    uchar* end = p + mat.cols * mat.elemSize();
+    for (; p < end; p += elem)
+      std::reverse(p, p + elem);
+  }
+}
+
+ImageView viewFromData(const bp::object& data, int height, int width, size_t step,
+                       const std::string& encoding, bool is_bigendian)
+{
+  PyObject* memview = PyMemoryView_FromObject(data.ptr());
+  if (!memview)
+  {
+    // Not a bytes-like object, e.g. a list of ints in a hand built message
+    PyErr_Clear();
+    bp::object bytes(bp::handle<>(PyByteArray_FromObject(data.ptr())));
+    memview = PyMemoryView_FromObject(bytes.ptr());
+    if (!memview)
+      bp::throw_error_already_set();
+  }
+
+  ImageView view;
+  view.owner = bp::object(bp::handle<>(memview));
+  const Py_buffer* buffer = PyMemoryView_GET_BUFFER(memview);
+  const int type = cv_bridge::getCvType(encoding);
+  const size_t row_bytes = width * CV_ELEM_SIZE(type);
+  if (step == 0)
+    step = row_bytes;
+  if (step < row_bytes || static_cast<size_t>(buffer->len) < step * height ||
+      !PyBuffer_IsContiguous(const_cast<Py_buffer*>(buffer), 'C'))
+    throw cv_bridge::Exception("Image data does not hold height * step bytes");
+
+  view.mat = cv::Mat(height, width, type, buffer->buf, step);
+  view.shared = true;
+  view.readonly = buffer->readonly;
+  const bool native_big = boost::endian::order::native == boost::endian::order::big;
+  if (CV_ELEM_SIZE1(type) > 1 && is_bigendian != native_big)
+  {
+    // Swap into a numpy backed buffer so that it can still be returned without another copy
+    cv::Mat swapped;
+    swapped.allocator = numpy_allocator();
+    view.mat.copyTo(swapped);
+    byteSwapInPlace(swapped);
+    view.mat = swapped;
+    view.shared = false;
+    view.readonly = false;
+  }
+  return view;
+}
+
+/// Returns the view as an ndarray, sharing the message memory when possible.
+bp::object arrayFromView(const ImageView& view)
+{
+  if (!view.shared)
+    return bp::object(bp::handle<>(pyopencv_from(view.mat)));
+
+  const int cn = view.mat.channels();
+  npy_intp dims[3] = {view.mat.rows, view.mat.cols, cn};
+  npy_intp strides[3] = {static_cast<npy_intp>(view.mat.step[0]),
+                         static_cast<npy_intp>(view.mat.elemSize()),
+                         static_cast<npy_intp>(view.mat.elemSize1())};
+  PyObject* array = PyArray_New(&PyArray_Type, cn == 1 ? 2 : 3, dims, npyTypeFromDepth(view.mat.depth()),
+                                strides, view.mat.data, 0, view.readonly ? 0 : NPY_ARRAY_WRITEABLE, NULL);
+  bp::object result(bp::handle<>(array));
+  // The array keeps the memoryview, and through it the message data, alive
+  Py_INCREF(view.owner.ptr());
+  if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(array), view.owner.ptr()) != 0)
+    bp::throw_error_already_set();
+  return result;
+}
+
+/// Wraps a caller supplied output array, which must already have the final shape and type.
+cv::Mat matFromOutputArray(const bp::object& dst, int rows, int cols, int type)
+{
+  if (!PyArray_Check(dst.ptr()))
+  {
+    PyErr_SetString(PyExc_TypeError, "dst must be a numpy.ndarray");
+    bp::throw_error_already_set();
+  }
+  PyArrayObject* array = reinterpret_cast<PyArrayObject*>(dst.ptr());
+  const int cn = CV_MAT_CN(type);
+  const int ndim = PyArray_NDIM(array);
+  bool ok = PyArray_ISCARRAY(array) && PyArray_ISNOTSWAPPED(array) &&
+            PyArray_TYPE(array) == npyTypeFromDepth(CV_MAT_DEPTH(type)) &&
+            ndim >= 2 && PyArray_DIM(array, 0) == rows && PyArray_DIM(array, 1) == cols;
+  if (ok)
+    ok = (ndim == 2 && cn == 1) || (ndim == 3 && PyArray_DIM(array, 2) == cn);
+  if (!ok)
+  {
+    PyErr_Format(PyExc_ValueError,
+                 "dst must be a writeable C-contiguous array of %d x %d x %d elements of numpy type %d",
+                 rows, cols, cn, npyTypeFromDepth(CV_MAT_DEPTH(type)));
+    bp::throw_error_already_set();
+  }
+  return cv::Mat(rows, cols, type, PyArray_DATA(array));
+}
+
+/// Runs a plan into dst, or into a new numpy backed array when dst is None.
+/// The plan is used without the GIL, so a shared plan needs its mutex.
+bp::object convertWithPlan(cv_bridge::ConversionPlan& plan, const cv::Mat& in, const bp::object& dst,
+                           cv::Mutex* plan_mutex = NULL)
+{
+  const bool allocate = dst.ptr() == Py_None;
+  cv::Mat out;
+  if (allocate)
+    out.allocator = numpy_allocator();
+  else
+    out = matFromOutputArray(dst, in.rows, in.cols, plan.dstType());
+  const uchar* data = out.data;
+  {
+    PyAllowThreads allow;
+    if (plan_mutex)
+    {
+      cv::AutoLock lock(*plan_mutex);
+      plan.convert(in, out);
+    }
+    else
+    {
+      plan.convert(in, out);
+    }
+  }
+  if (allocate)
+    return bp::object(bp::handle<>(pyopencv_from(out)));
+  if (out.data != data)
+    throw cv_bridge::Exception("Conversion did not fit into dst");
+  return dst;
+}
+
+class ConversionPlanWrap
+{
+public:
+  ConversionPlanWrap(const std::string& src_encoding, const std::string& dst_encoding)
+    : plan_(src_encoding, dst_encoding) {}
+
+  bp::object convert(bp::object src, bp::object dst)
+  {
+    cv::Mat mat_in;
+    convert_to_CvMat2(src.ptr(), mat_in);
+    // Python threads (e.g. rospy subscribers) commonly share one CvBridge and its plans
+    return convertWithPlan(plan_, mat_in, dst, &mutex_);
+  }
+
+  std::string srcEncoding() const { return plan_.srcEncoding(); }
+  std::string dstEncoding() const { return plan_.dstEncoding(); }
+
+private:
+  cv_bridge::ConversionPlan plan_;
+  cv::Mutex mutex_;
+};
+
+} // namespace
+
 bp::object
-cvtColor2Wrap(bp::object obj_in, const std::string & encoding_in, const std::string & encoding_out) {
+cvtColor2Wrap(bp::object obj_in, const std::string & encoding_in, const std::string & encoding_out,
+              bp::object dst = bp::object()) {
   // Convert the Python input to an image
   cv::Mat mat_in;
   convert_to_CvMat2(obj_in.ptr(), mat_in);
 
-  // Call cv_bridge for color conversion
-  cv_bridge::CvImagePtr cv_image(new cv_bridge::CvImage(std_msgs::Header(), encoding_in, mat_in));
+  // Same rules as cv_bridge::cvtColor, but the result goes straight into a numpy array
+  cv_bridge::ConversionPlan plan(encoding_in, encoding_out);
+  return convertWithPlan(plan, mat_in, dst);
+}
 
-  cv::Mat mat = cv_bridge::cvtColor(cv_image, encoding_out)->image;
+BOOST_PYTHON_FUNCTION_OVERLOADS(cvtColor2Wrap_overloads, cvtColor2Wrap, 3, 4)
 
-  return bp::object(boost::python::handle<>(pyopencv_from(mat)));
+bp::object
+imgmsgToArrayWrap(bp::object data, int height, int width, size_t step,
+                  const std::string & encoding, bool is_bigendian) {
+  return arrayFromView(viewFromData(data, height, width, step, encoding, is_bigendian));
+}
+
+bp::list
+imgmsgsToArraysWrap(bp::object msgs, const std::string & desired_encoding) {
+  struct Job
+  {
+    ImageView view;
+    cv::Mat out;
+    cv_bridge::ConversionPlan plan;
+  };
+  const bool passthrough = desired_encoding.empty() || desired_encoding == "passthrough";
+
+  // Everything touching Python objects happens here, with the GIL held
+  std::map<std::string, cv_bridge::ConversionPlan> plans;
+  std::vector<Job> jobs;
+  bp::list result;
+  const int count = bp::len(msgs);
+  jobs.reserve(count);
+  for (int i = 0; i < count; ++i)
+  {
+    bp::object msg = msgs[i];
+    const std::string encoding = bp::extract<std::string>(msg.attr("encoding"));
+    ImageView view = viewFromData(msg.attr("data"),
+                                  bp::extract<int>(msg.attr("height")),
+                                  bp::extract<int>(msg.attr("width")),
+                                  bp::extract<size_t>(msg.attr("step")),
+                                  encoding,
+                                  bp::extract<bool>(msg.attr("is_bigendian")));
+    if (passthrough)
+    {
+      result.append(arrayFromView(view));
+      continue;
+    }
+    std::map<std::string, cv_bridge::ConversionPlan>::iterator plan = plans.find(encoding);
+    if (plan == plans.end())
+      plan = plans.insert(std::make_pair(encoding, cv_bridge::ConversionPlan(encoding, desired_encoding))).first;
+
+    Job job;
+    job.view = view;
+    job.plan = plan->second;
+    job.out.allocator = numpy_allocator();
+    job.out.create(view.mat.size(), plan->second.dstType());
+    result.append(bp::object(bp::handle<>(pyopencv_from(job.out))));
+    jobs.push_back(job);
+  }
+
+  // Pixel work only, spread over the messages
+  std::string error;
+  {
+    PyAllowThreads allow;
+    cv::Mutex error_mutex;
+    cv::parallel_for_(cv::Range(0, static_cast<int>(jobs.size())), [&](const cv::Range& range) {
+      for (int i = range.start; i < range.end; ++i)
+      {
+        try
+        {
+          jobs[i].plan.convert(jobs[i].view.mat, jobs[i].out);
+        }
+        catch (const std::exception& e)
+        {
+          cv::AutoLock lock(error_mutex);
+          error = e.what();
+        }
+      }
+    });
+  }
+  if (!error.empty())
+    throw cv_bridge::Exception(error);
+  return result;
 }
 
 bp::object
@@ -91,7 +356,28 @@ BOOST_PYTHON_MODULE(cv_bridge_boost)
 
   // Wrap the function to get encodings as OpenCV types
   boost::python::def("getCvType", cv_bridge::getCvType);
-  boost::python::def("cvtColor2", cvtColor2Wrap);
+  boost::python::def("cvtColor2", cvtColor2Wrap,
+                     cvtColor2Wrap_overloads(
+                       boost::python::args("source", "encoding_in", "encoding_out", "dst"),
+                       "Convert an image between encodings, writing into dst when given.\n\n"
+                       "dst must be a C-contiguous numpy array with the output shape and dtype."
+                     ));
+  boost::python::def("imgmsgToArray", imgmsgToArrayWrap,
+                     boost::python::args("data", "height", "width", "step", "encoding", "is_bigendian"),
+                     "Wrap image message data in a numpy array without copying.\n\n"
+                     "The array shares memory with data (read only for bytes) unless the byte order\n"
+                     "has to be swapped, in which case it is a swapped copy.");
+  boost::python::def("imgmsgsToArrays", imgmsgsToArraysWrap,
+                     boost::python::args("msgs", "desired_encoding"),
+                     "Convert a list of image messages, in parallel and without holding the GIL.");
+  boost::python::class_<ConversionPlanWrap, boost::noncopyable>("ConversionPlan",
+                     "Conversion between two encodings, resolved once and reused for every image.",
+                     boost::python::init<std::string, std::string>(
+                       boost::python::args("src_encoding", "dst_encoding")))
+    .def("convert", &ConversionPlanWrap::convert,
+         (boost::python::arg("source"), boost::python::arg("dst") = boost::python::object()))
+    .add_property("src_encoding", &ConversionPlanWrap::srcEncoding)
+    .add_property("dst_encoding", &ConversionPlanWrap::dstEncoding);
   boost::python::def("CV_MAT_CNWrap", CV_MAT_CNWrap);
   boost::python::def("CV_MAT_DEPTHWrap", CV_MAT_DEPTHWrap);
   boost::python::def("cvtColorForDisplay", cvtColorForDisplayWrap,
@@ -33,6 +33,33 @@ int convert_to_CvMat2(const PyObject* o, cv::Mat& m);
 
 PyObject* pyopencv_from(const cv::Mat& m);
 
+// Allocator whose buffers are numpy arrays, so pyopencv_from() returns them without a copy
+cv::MatAllocator* numpy_allocator();
+
+class PyAllowThreads
+{
+public:
+    PyAllowThreads() : _state(PyEval_SaveThread()) {}
+    ~PyAllowThreads()
+    {
+        PyEval_RestoreThread(_state);
+    }
+private:
+    PyThreadState* _state;
+};
+
+class PyEnsureGIL
+{
+public:
+    PyEnsureGIL() : _state(PyGILState_Ensure()) {}
+    ~PyEnsureGIL()
+    {
+        PyGILState_Release(_state);
+    }
+private:
+    PyGILState_STATE _state;
+};
+
 #if PYTHON3
 static int do_numpy_import( )
 {
@@ -37,30 +37,6 @@ struct ArgInfo
     operator const char *() const { return name; }
 };
 
-class PyAllowThreads
-{
-public:
-    PyAllowThreads() : _state(PyEval_SaveThread()) {}
-    ~PyAllowThreads()
-    {
-        PyEval_RestoreThread(_state);
-    }
-private:
-    PyThreadState* _state;
-};
-
-class PyEnsureGIL
-{
-public:
-    PyEnsureGIL() : _state(PyGILState_Ensure()) {}
-    ~PyEnsureGIL()
-    {
-        PyGILState_Release(_state);
-    }
-private:
-    PyGILState_STATE _state;
-};
-
 #define ERRWRAP2(expr) \
 try \
 { \
@@ -360,6 +336,11 @@ PyObject* pyopencv_from(const Mat& m)
     return o;
 }
 
+cv::MatAllocator* numpy_allocator()
+{
+    return &g_numpyAllocator;
+}
+
 int convert_to_CvMat2(const PyObject* o, cv::Mat& m)
 {
     pyopencv_to(const_cast<PyObject*>(o), m, "unknown");
@@ -0,0 +1,162 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2022, plusgo Company Limited.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <cv_bridge/msg_pool.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/endian/conversion.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <sensor_msgs/image_encodings.h>
+
+#ifdef CV_BRIDGE_HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace cv_bridge {
+
+sensor_msgs::ImagePtr ImageMsgPool::acquire(const std_msgs::Header& header,
+                                            const std::string& encoding,
+                                            int rows, int cols, cv::Mat* view)
+{
+  sensor_msgs::ImagePtr msg = pool_.acquire();
+  int type = getCvType(encoding);
+  msg->header = header;
+  msg->height = rows;
+  msg->width = cols;
+  msg->encoding = encoding;
+  msg->is_bigendian = (boost::endian::order::native == boost::endian::order::big);
+  msg->step = cols * CV_ELEM_SIZE(type);
+  // resize() keeps the capacity, so this only allocates the first time or when the size grows
+  msg->data.resize(static_cast<size_t>(msg->step) * rows);
+  if (view)
+    *view = cv::Mat(rows, cols, type, msg->data.empty() ? NULL : &msg->data[0], msg->step);
+  return msg;
+}
+
+sensor_msgs::ImagePtr ImageMsgPool::toImageMsg(const CvImage& image)
+{
+  cv::Mat view;
+  sensor_msgs::ImagePtr msg = acquire(image.header, image.encoding,
+                                      image.image.rows, image.image.cols, &view);
+  if (image.image.type() != view.type())
+    throw Exception("ImageMsgPool: image type does not match encoding [" + image.encoding + "]");
+  image.image.copyTo(view);
+  return msg;
+}
+
+JpegEncoder::JpegEncoder(int quality, size_t pool_capacity)
+  : quality_(quality), tj_handle_(NULL), pool_(pool_capacity)
+{
+#ifdef CV_BRIDGE_HAVE_TURBOJPEG
+  tj_handle_ = tjInitCompress();
+#endif
+  setQuality(quality);
+}
+
+JpegEncoder::~JpegEncoder()
+{
+#ifdef CV_BRIDGE_HAVE_TURBOJPEG
+  if (tj_handle_)
+    tjDestroy(static_cast<tjhandle>(tj_handle_));
+#endif
+}
+
+void JpegEncoder::setQuality(int quality)
+{
+  quality_ = std::min(std::max(quality, 1), 100);
+  imencode_params_.clear();
+  imencode_params_.push_back(cv::IMWRITE_JPEG_QUALITY);
+  imencode_params_.push_back(quality_);
+}
+
+bool JpegEncoder::usingTurboJpeg()
+{
+#ifdef CV_BRIDGE_HAVE_TURBOJPEG
+  return true;
+#else
+  return false;
+#endif
+}
+
+void JpegEncoder::encode(const cv::Mat& image, const std_msgs::Header& header,
+                         sensor_msgs::CompressedImage& msg)
+{
+  if (image.empty() || image.depth() != CV_8U ||
+      (image.channels() != 3 && image.channels() != 1))
+    throw Exception("JpegEncoder: only bgr8 and mono8 images are supported");
+
+  msg.header = header;
+  msg.format = "jpeg";
+
+#ifdef CV_BRIDGE_HAVE_TURBOJPEG
+  if (tj_handle_)
+  {
+    const bool gray = image.channels() == 1;
+    const int subsamp = gray ? TJSAMP_GRAY : TJSAMP_420;
+    // Worst case size; with TJFLAG_NOREALLOC turbojpeg writes into our buffer as is.
+    // The scratch buffer keeps that size, so only a size change zero-fills it
+    const size_t buf_size = tjBufSize(image.cols, image.rows, subsamp);
+    if (scratch_.size() != buf_size)
+      scratch_.resize(buf_size);
+    unsigned char* out = &scratch_[0];
+    unsigned long out_size = scratch_.size();
+    int ret = tjCompress2(static_cast<tjhandle>(tj_handle_), image.data, image.cols,
+                          static_cast<int>(image.step), image.rows,
+                          gray ? TJPF_GRAY : TJPF_BGR, &out, &out_size, subsamp, quality_,
+                          TJFLAG_NOREALLOC | TJFLAG_FASTDCT);
+    if (ret != 0)
+      throw Exception(std::string("JpegEncoder: ") + tjGetErrorStr());
+    // Only the encoded bytes are copied; msg.data keeps its capacity between frames
+    msg.data.assign(scratch_.begin(), scratch_.begin() + out_size);
+    return;
+  }
+#endif
+  // imencode resizes the destination vector, whose capacity survives between frames
+  if (!cv::imencode(".jpg", image, msg.data, imencode_params_))
+    throw Exception("JpegEncoder: cv::imencode failed");
+}
+
+sensor_msgs::CompressedImagePtr JpegEncoder::encode(const cv::Mat& image,
+                                                    const std_msgs::Header& header)
+{
+  sensor_msgs::CompressedImagePtr msg = pool_.acquire();
+  encode(image, header, *msg);
+  return msg;
+}
+
+} // namespace cv_bridge
@@ -0,0 +1,53 @@
+// Compares toCvCopy with a precompiled ConversionPlan on the encodings our cameras publish.
+// Not a unit test: run it by hand, e.g. rosrun cv_bridge cv_bridge-benchmark_conversion_plan [iterations]
+
+#include "cv_bridge/cv_bridge.h"
+#include <sensor_msgs/image_encodings.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+template <typename Func>
+static double runUs(Func func, int iterations)
+{
+  func();
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i)
+    func();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - begin).count() / iterations;
+}
+
+static void benchmark(const std::string& src, const std::string& dst, const cv::Size& size, int iterations)
+{
+  cv::Mat frame(size, cv_bridge::getCvType(src));
+  cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+  sensor_msgs::ImagePtr msg = cv_bridge::CvImage(std_msgs::Header(), src, frame).toImageMsg();
+
+  cv_bridge::ConversionPlan plan(src, dst);
+  cv::Mat out;
+  double copy = runUs([&]() { cv_bridge::toCvCopy(msg, dst); }, iterations);
+  double planned = runUs([&]() { plan.convert(*msg, out); }, iterations);
+  // Only the encoding parsing and code lookup, without touching pixels
+  double lookup = runUs([&]() { cv_bridge::ConversionPlan(src, dst); }, iterations);
+
+  std::printf("%-12s -> %-6s %4dx%-4d  toCvCopy %9.2f us  plan %9.2f us  plan build %6.2f us\n",
+              src.c_str(), dst.c_str(), size.width, size.height, copy, planned, lookup);
+}
+
+int main(int argc, char** argv)
+{
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+  const cv::Size sizes[] = {cv::Size(64, 48), cv::Size(320, 240), cv::Size(752, 480)};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+  {
+    benchmark("mono8", "bgr8", sizes[i], iterations);
+    benchmark("mono8", "mono8", sizes[i], iterations);
+    benchmark("bayer_rggb8", "bgr8", sizes[i], iterations);
+    benchmark("bayer_grbg8", "mono8", sizes[i], iterations);
+    benchmark("rgb8", "bgr8", sizes[i], iterations);
+  }
+  return 0;
+}
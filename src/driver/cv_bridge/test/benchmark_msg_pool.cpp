@@ -0,0 +1,82 @@
+// Compares the per-frame publishing conversions with their pooled counterparts.
+// Not a unit test: run it by hand, e.g. rosrun cv_bridge cv_bridge-benchmark_msg_pool [iterations]
+
+#include "cv_bridge/msg_pool.h"
+#include "cv_bridge/cv_bridge.h"
+#include <sensor_msgs/image_encodings.h>
+#include <opencv2/core/utility.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+template <typename Func>
+static double runMs(Func func, int iterations)
+{
+  func();
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i)
+    func();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - begin).count() / iterations;
+}
+
+static void benchmark(const cv::Size& size, int iterations)
+{
+  cv::Mat frame(size, CV_8UC3);
+  cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::GaussianBlur(frame, frame, cv::Size(7, 7), 0);  // closer to camera content for JPEG
+  cv_bridge::CvImage image(std_msgs::Header(), sensor_msgs::image_encodings::BGR8, frame);
+
+  cv_bridge::ImageMsgPool image_pool;
+  cv_bridge::JpegEncoder encoder(80);
+  std::vector<cv_bridge::JpegEncoder*> encoders;
+  for (int i = 0; i < 4; ++i)
+    encoders.push_back(new cv_bridge::JpegEncoder(80));
+
+  double to_image = runMs([&]() { image.toImageMsg(); }, iterations);
+  double pooled_image = runMs([&]() { image_pool.toImageMsg(image); }, iterations);
+  // clone + draw + toImageMsg, as cr_send_result used to do, against drawing into the pooled message
+  double clone_publish = runMs([&]() {
+    cv::Mat publish = frame.clone();
+    cv::rectangle(publish, cv::Rect(10, 10, 100, 200), cv::Scalar(0, 0, 255), 3);
+    cv_bridge::CvImage(std_msgs::Header(), "bgr8", publish).toImageMsg();
+  }, iterations);
+  double render_pooled = runMs([&]() {
+    cv::Mat view;
+    image_pool.acquire(std_msgs::Header(), "bgr8", frame.rows, frame.cols, &view);
+    frame.copyTo(view);
+    cv::rectangle(view, cv::Rect(10, 10, 100, 200), cv::Scalar(0, 0, 255), 3);
+  }, iterations);
+  double to_compressed = runMs([&]() { image.toCompressedImageMsg(cv_bridge::JPG); }, iterations);
+  double jpeg_pooled = runMs([&]() { encoder.encode(frame, std_msgs::Header()); }, iterations);
+  // four cameras per cycle, one encoder each
+  double jpeg_parallel = runMs([&]() {
+    cv::parallel_for_(cv::Range(0, 4), [&](const cv::Range& r) {
+      for (int i = r.start; i < r.end; ++i)
+        encoders[i]->encode(frame, std_msgs::Header());
+    });
+  }, iterations) / 4;
+
+  std::printf("%dx%d (turbojpeg %s, %d threads)\n", size.width, size.height,
+              cv_bridge::JpegEncoder::usingTurboJpeg() ? "on" : "off", cv::getNumThreads());
+  std::printf("  toImageMsg                    %8.3f ms\n", to_image);
+  std::printf("  ImageMsgPool::toImageMsg      %8.3f ms\n", pooled_image);
+  std::printf("  clone + draw + toImageMsg     %8.3f ms\n", clone_publish);
+  std::printf("  draw into pooled message      %8.3f ms\n", render_pooled);
+  std::printf("  toCompressedImageMsg(JPG)     %8.3f ms\n", to_compressed);
+  std::printf("  JpegEncoder q80               %8.3f ms\n", jpeg_pooled);
+  std::printf("  JpegEncoder x4 parallel/frame %8.3f ms\n", jpeg_parallel);
+
+  for (size_t i = 0; i < encoders.size(); ++i)
+    delete encoders[i];
+}
+
+int main(int argc, char** argv)
+{
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 100;
+  benchmark(cv::Size(752, 480), iterations);
+  benchmark(cv::Size(1920, 1080), iterations);
+  return 0;
+}
@@ -83,5 +83,50 @@ class TestConversions(unittest.TestCase):
         self.assert_(msg.is_bigendian == True)
         self.assert_((br.imgmsg_to_cv2(msg) == img).all())
 
+    def test_passthrough_shares_data(self):
+        br = CvBridge()
+        img = np.uint8(np.random.randint(0, 255, size=(30, 40, 3)))
+        msg = br.cv2_to_imgmsg(img, "bgr8")
+        msg.data = bytearray(msg.data)
+        im = br.imgmsg_to_cv2(msg)
+        self.assert_((im == img).all())
+        # Writing through the array changes the message
+        im[0, 0, 0] = 255 - im[0, 0, 0]
+        self.assert_(msg.data[0] == im[0, 0, 0])
+
+    def test_padded_step(self):
+        br = CvBridge()
+        img = np.uint8(np.random.randint(0, 255, size=(30, 40)))
+        msg = br.cv2_to_imgmsg(img, "mono8")
+        padded = np.zeros((30, 48), dtype=np.uint8)
+        padded[:, :40] = img
+        msg.data = padded.tostring()
+        msg.step = 48
+        self.assert_((br.imgmsg_to_cv2(msg) == img).all())
+        self.assert_((br.imgmsg_to_cv2(msg, "bgr8")[:, :, 1] == img).all())
+
+    def test_batched_conversion(self):
+        br = CvBridge()
+        msgs = []
+        for encoding in ["mono8", "bgr8", "rgb8", "mono8"]:
+            channels = 1 if encoding == "mono8" else 3
+            img = np.uint8(np.random.randint(0, 255, size=(30, 40, channels)))
+            msgs.append(br.cv2_to_imgmsg(img.squeeze(), encoding))
+        for desired in ["passthrough", "bgr8", "mono8"]:
+            batch = br.imgmsgs_to_cv2(msgs, desired)
+            self.assert_(len(batch) == len(msgs))
+            for msg, im in zip(msgs, batch):
+                self.assert_((br.imgmsg_to_cv2(msg, desired) == im).all())
+        self.assertRaises(CvBridgeError, lambda: br.imgmsgs_to_cv2(msgs, "mono16_bad"))
+
+    def test_cvtColor2_into_dst(self):
+        from cv_bridge.boost.cv_bridge_boost import cvtColor2
+        img = np.uint8(np.random.randint(0, 255, size=(30, 40)))
+        dst = np.empty((30, 40, 3), dtype=np.uint8)
+        res = cvtColor2(img, "mono8", "bgr8", dst)
+        self.assert_(res is dst)
+        self.assert_((dst[:, :, 2] == img).all())
+        self.assertRaises(ValueError, lambda: cvtColor2(img, "mono8", "bgr8", np.empty((30, 40), dtype=np.uint8)))
+
 if __name__ == '__main__':
     rosunit.unitrun('opencv_tests', 'conversions', TestConversions)
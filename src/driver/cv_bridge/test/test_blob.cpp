@@ -0,0 +1,146 @@
+#include "cv_bridge/blob.h"
+#include "cv_bridge/cv_bridge.h"
+#include <sensor_msgs/image_encodings.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+namespace enc = sensor_msgs::image_encodings;
+
+namespace {
+
+const int kBlobW = 320;
+const int kBlobH = 320;
+
+// Reference: the detector's old path, letterbox an RGB image with cv::resize and split it
+// into float planes.
+std::vector<float> referenceBlob(const cv::Mat& rgb)
+{
+  cv_bridge::LetterboxTransform lb =
+      cv_bridge::getLetterboxTransform(rgb.cols, rgb.rows, kBlobW, kBlobH);
+  cv::Mat resized;
+  cv::resize(rgb, resized, cv::Size(lb.width, lb.height), 0, 0, cv::INTER_LINEAR);
+  cv::Mat out(kBlobH, kBlobW, CV_8UC3, cv::Scalar(128, 128, 128));
+  resized.copyTo(out(cv::Rect(lb.offset_x, lb.offset_y, lb.width, lb.height)));
+
+  std::vector<float> blob(3 * kBlobW * kBlobH);
+  for (int y = 0; y < kBlobH; ++y) {
+    for (int x = 0; x < kBlobW; ++x) {
+      const cv::Vec3b& p = out.at<cv::Vec3b>(y, x);
+      for (int c = 0; c < 3; ++c)
+        blob[c * kBlobW * kBlobH + y * kBlobW + x] = p[c] / 255.0f;
+    }
+  }
+  return blob;
+}
+
+cv::Mat smoothImage(int rows, int cols)
+{
+  // Smooth content, so demosaicing and resampling differences stay small.
+  cv::Mat rgb(rows, cols, CV_8UC3);
+  for (int y = 0; y < rows; ++y)
+    for (int x = 0; x < cols; ++x)
+      rgb.at<cv::Vec3b>(y, x) = cv::Vec3b(x * 255 / cols, y * 255 / rows, (x + y) * 127 / (rows + cols) + 64);
+  return rgb;
+}
+
+double meanAbsDiff(const std::vector<float>& a, const std::vector<float>& b)
+{
+  double sum = 0;
+  for (size_t i = 0; i < a.size(); ++i)
+    sum += std::fabs(a[i] - b[i]);
+  return sum / a.size();
+}
+
+}  // namespace
+
+TEST(CvBridgeBlob, bgr8MatchesResizePath)
+{
+  cv::Mat rgb = smoothImage(480, 752);
+  cv::Mat bgr;
+  cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
+  sensor_msgs::ImagePtr msg = cv_bridge::CvImage(std_msgs::Header(), enc::BGR8, bgr).toImageMsg();
+
+  std::vector<float> blob(3 * kBlobW * kBlobH);
+  cv_bridge::LetterboxTransform lb = cv_bridge::toBlob(*msg, blob.data(), kBlobW, kBlobH);
+  std::vector<float> expected = referenceBlob(rgb);
+
+  EXPECT_EQ(kBlobW, lb.width);
+  EXPECT_EQ(0, lb.offset_x);
+  EXPECT_GT(lb.offset_y, 0);
+  for (size_t i = 0; i < blob.size(); ++i)
+    ASSERT_NEAR(expected[i], blob[i], 1.5 / 255.0) << "at " << i;
+}
+
+TEST(CvBridgeBlob, rgb8AndMono8)
+{
+  cv::Mat rgb = smoothImage(240, 320);
+  sensor_msgs::ImagePtr msg = cv_bridge::CvImage(std_msgs::Header(), enc::RGB8, rgb).toImageMsg();
+  std::vector<float> blob(3 * kBlobW * kBlobH);
+  cv_bridge::toBlob(*msg, blob.data(), kBlobW, kBlobH);
+  EXPECT_LT(meanAbsDiff(referenceBlob(rgb), blob), 0.5 / 255.0);
+
+  cv::Mat gray, gray_rgb;
+  cv::cvtColor(rgb, gray, cv::COLOR_RGB2GRAY);
+  cv::cvtColor(gray, gray_rgb, cv::COLOR_GRAY2RGB);
+  msg = cv_bridge::CvImage(std_msgs::Header(), enc::MONO8, gray).toImageMsg();
+  cv_bridge::toBlob(*msg, blob.data(), kBlobW, kBlobH);
+  EXPECT_LT(meanAbsDiff(referenceBlob(gray_rgb), blob), 0.5 / 255.0);
+}
+
+TEST(CvBridgeBlob, yuv422MatchesCvtColor)
+{
+  cv::Mat rgb = smoothImage(480, 640);
+  // Build a UYVY frame with constant chroma per pixel pair.
+  cv::Mat uyvy(rgb.rows, rgb.cols, CV_8UC2);
+  for (int y = 0; y < rgb.rows; ++y) {
+    for (int x = 0; x < rgb.cols; x += 2) {
+      uint8_t* p = uyvy.ptr<uint8_t>(y) + x * 2;
+      p[0] = 100 + x % 50;
+      p[1] = 16 + x * 200 / rgb.cols;
+      p[2] = 150 - y % 40;
+      p[3] = 16 + (x + 1) * 200 / rgb.cols;
+    }
+  }
+  cv::Mat converted;
+  cv::cvtColor(uyvy, converted, cv::COLOR_YUV2RGB_UYVY);
+  sensor_msgs::ImagePtr msg = cv_bridge::CvImage(std_msgs::Header(), enc::YUV422, uyvy).toImageMsg();
+  std::vector<float> blob(3 * kBlobW * kBlobH);
+  cv_bridge::toBlob(*msg, blob.data(), kBlobW, kBlobH);
+  EXPECT_LT(meanAbsDiff(referenceBlob(converted), blob), 1.5 / 255.0);
+}
+
+TEST(CvBridgeBlob, bayerPatterns)
+{
+  cv::Mat rgb = smoothImage(480, 752);
+  const char* encodings[] = {"bayer_rggb8", "bayer_bggr8", "bayer_gbrg8", "bayer_grbg8"};
+  // Position of the red sample in the 2x2 tile for each pattern above.
+  const int red_x[] = {0, 1, 0, 1};
+  const int red_y[] = {0, 1, 1, 0};
+  for (int k = 0; k < 4; ++k) {
+    cv::Mat raw(rgb.rows, rgb.cols, CV_8UC1);
+    for (int y = 0; y < rgb.rows; ++y) {
+      for (int x = 0; x < rgb.cols; ++x) {
+        bool red_row = (y & 1) == red_y[k];
+        bool red_col = (x & 1) == red_x[k];
+        int c = (red_row && red_col) ? 0 : (!red_row && !red_col ? 2 : 1);
+        raw.at<uint8_t>(y, x) = rgb.at<cv::Vec3b>(y, x)[c];
+      }
+    }
+    sensor_msgs::ImagePtr msg = cv_bridge::CvImage(std_msgs::Header(), encodings[k], raw).toImageMsg();
+    std::vector<float> blob(3 * kBlobW * kBlobH);
+    cv_bridge::toBlob(*msg, blob.data(), kBlobW, kBlobH);
+    EXPECT_LT(meanAbsDiff(referenceBlob(rgb), blob), 2.0 / 255.0) << encodings[k];
+  }
+}
+
+TEST(CvBridgeBlob, rejectsUnsupportedEncoding)
+{
+  cv::Mat bgra(10, 10, CV_8UC4, cv::Scalar::all(0));
+  sensor_msgs::ImagePtr msg = cv_bridge::CvImage(std_msgs::Header(), enc::BGRA8, bgra).toImageMsg();
+  std::vector<float> blob(3 * kBlobW * kBlobH);
+  EXPECT_FALSE(cv_bridge::isBlobEncodingSupported(enc::BGRA8));
+  EXPECT_THROW(cv_bridge::toBlob(*msg, blob.data(), kBlobW, kBlobH), cv_bridge::Exception);
+}
@@ -0,0 +1,101 @@
+#include "cv_bridge/cv_bridge.h"
+#include <sensor_msgs/image_encodings.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace enc = sensor_msgs::image_encodings;
+
+static sensor_msgs::ImagePtr makeImage(const std::string& encoding, int rows, int cols)
+{
+  cv::Mat mat(rows, cols, cv_bridge::getCvType(encoding));
+  if (enc::bitDepth(encoding) == 16)
+    cv::randu(mat, cv::Scalar::all(0), cv::Scalar::all(65535));
+  else
+    cv::randu(mat, cv::Scalar::all(0), cv::Scalar::all(255));
+  return cv_bridge::CvImage(std_msgs::Header(), encoding, mat).toImageMsg();
+}
+
+TEST(CvBridgeConversionPlan, matchesToCvCopy)
+{
+  const char* pairs[][2] = {
+    {"mono8", "bgr8"}, {"mono8", "rgb8"}, {"mono8", "mono16"},
+    {"mono16", "mono8"}, {"mono16", "bgr8"}, {"bgr8", "mono8"},
+    {"rgb8", "bgr8"}, {"bgra8", "bgr8"}, {"bgr8", "bgr8"},
+    {"bayer_rggb8", "bgr8"}, {"bayer_grbg8", "mono8"}, {"bayer_bggr8", "rgb8"},
+    {"yuv422", "bgr8"}, {"yuv422", "mono8"}, {"bgr8", "rgb16"},
+  };
+  for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i)
+  {
+    const std::string src = pairs[i][0];
+    const std::string dst = pairs[i][1];
+    sensor_msgs::ImagePtr msg = makeImage(src, 48, 64);
+    cv_bridge::CvImagePtr expected = cv_bridge::toCvCopy(msg, dst);
+
+    cv_bridge::ConversionPlan plan(src, dst);
+    EXPECT_TRUE(plan.matches(src));
+    EXPECT_EQ(dst, plan.dstEncoding());
+    cv::Mat out;
+    plan.convert(*msg, out);
+    ASSERT_EQ(expected->image.type(), out.type()) << src << " -> " << dst;
+    ASSERT_EQ(expected->image.size(), out.size()) << src << " -> " << dst;
+    EXPECT_EQ(0, cv::norm(expected->image, out, cv::NORM_INF)) << src << " -> " << dst;
+  }
+}
+
+TEST(CvBridgeConversionPlan, reusesDestination)
+{
+  cv_bridge::ConversionPlan plan("bayer_rggb8", "bgr8");
+  cv::Mat out;
+  const uchar* data = NULL;
+  for (int i = 0; i < 3; ++i)
+  {
+    sensor_msgs::ImagePtr msg = makeImage("bayer_rggb8", 48, 64);
+    plan.convert(*msg, out);
+    if (i == 0)
+      data = out.data;
+    EXPECT_EQ(data, out.data);
+  }
+}
+
+TEST(CvBridgeConversionPlan, emptyDestinationKeepsEncoding)
+{
+  cv_bridge::ConversionPlan plan("mono16", "");
+  EXPECT_EQ("mono16", plan.dstEncoding());
+  EXPECT_EQ(CV_16UC1, plan.dstType());
+  sensor_msgs::ImagePtr msg = makeImage("mono16", 8, 8);
+  cv::Mat out;
+  plan.convert(*msg, out);
+  EXPECT_EQ(0, cv::norm(cv_bridge::toCvShare(msg)->image, out, cv::NORM_INF));
+}
+
+TEST(CvBridgeConversionPlan, swappedEndianness)
+{
+  sensor_msgs::ImagePtr msg = makeImage("mono16", 8, 8);
+  cv_bridge::CvImagePtr native = cv_bridge::toCvCopy(msg);
+  // Byte swap the payload and flag it as the other order
+  for (size_t i = 0; i + 1 < msg->data.size(); i += 2)
+    std::swap(msg->data[i], msg->data[i + 1]);
+  msg->is_bigendian = !msg->is_bigendian;
+
+  cv_bridge::ConversionPlan plan("mono16", "mono16");
+  cv::Mat out;
+  plan.convert(*msg, out);
+  EXPECT_EQ(0, cv::norm(native->image, out, cv::NORM_INF));
+}
+
+TEST(CvBridgeConversionPlan, rejectsBadInput)
+{
+  EXPECT_THROW(cv_bridge::ConversionPlan("mono8", "bayer_rggb8"), cv_bridge::Exception);
+
+  cv_bridge::ConversionPlan plan("mono8", "bgr8");
+  EXPECT_FALSE(plan.matches("rgb8"));
+  sensor_msgs::ImagePtr msg = makeImage("rgb8", 4, 4);
+  cv::Mat out;
+  EXPECT_THROW(plan.convert(*msg, out), cv_bridge::Exception);
+
+  cv_bridge::ConversionPlan empty;
+  EXPECT_FALSE(empty.matches("mono8"));
+  EXPECT_THROW(empty.convert(cv::Mat(4, 4, CV_8UC1), out), cv_bridge::Exception);
+}
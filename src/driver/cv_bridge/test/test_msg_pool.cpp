@@ -0,0 +1,64 @@
+#include "cv_bridge/msg_pool.h"
+#include "cv_bridge/cv_bridge.h"
+#include <sensor_msgs/image_encodings.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <gtest/gtest.h>
+
+TEST(CvBridgeMsgPool, imageMsgReusesBuffers)
+{
+  cv_bridge::ImageMsgPool pool(2);
+  cv::Mat in(480, 752, CV_8UC3);
+  cv::randu(in, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv_bridge::CvImage image(std_msgs::Header(), sensor_msgs::image_encodings::BGR8, in);
+
+  const uint8_t* first_data = NULL;
+  for (int i = 0; i < 10; ++i)
+  {
+    sensor_msgs::ImagePtr msg = pool.toImageMsg(image);
+    if (i == 0)
+      first_data = &msg->data[0];
+    // The previous message was released, so the same buffer comes back
+    EXPECT_EQ(first_data, &msg->data[0]);
+    cv_bridge::CvImageConstPtr out = cv_bridge::toCvShare(msg);
+    EXPECT_EQ(0, cv::norm(out->image, in, cv::NORM_INF));
+  }
+  EXPECT_EQ(1u, pool.allocations());
+}
+
+TEST(CvBridgeMsgPool, busyMessagesAreNotReused)
+{
+  cv_bridge::ImageMsgPool pool(2);
+  cv::Mat view;
+  sensor_msgs::ImagePtr a = pool.acquire(std_msgs::Header(), "mono8", 4, 4, &view);
+  view.setTo(1);
+  sensor_msgs::ImagePtr b = pool.acquire(std_msgs::Header(), "mono8", 4, 4, &view);
+  view.setTo(2);
+  sensor_msgs::ImagePtr c = pool.acquire(std_msgs::Header(), "mono8", 4, 4, &view);
+  EXPECT_NE(a.get(), b.get());
+  EXPECT_NE(b.get(), c.get());
+  EXPECT_EQ(1, a->data[0]);
+  EXPECT_EQ(2, b->data[0]);
+  EXPECT_EQ(3u, pool.allocations());
+}
+
+TEST(CvBridgeMsgPool, jpegRoundTrip)
+{
+  cv::Mat in(480, 752, CV_8UC3);
+  for (int y = 0; y < in.rows; ++y)
+    for (int x = 0; x < in.cols; ++x)
+      in.at<cv::Vec3b>(y, x) = cv::Vec3b(x % 256, y % 256, 128);
+
+  cv_bridge::JpegEncoder encoder(95);
+  for (int i = 0; i < 3; ++i)
+  {
+    sensor_msgs::CompressedImagePtr msg = encoder.encode(in, std_msgs::Header());
+    EXPECT_EQ("jpeg", msg->format);
+    cv_bridge::CvImagePtr out = cv_bridge::toCvCopy(msg, sensor_msgs::image_encodings::BGR8);
+    ASSERT_EQ(in.size(), out->image.size());
+    EXPECT_LT(cv::norm(out->image, in, cv::NORM_L1) / in.total() / 3, 3.0);
+  }
+  EXPECT_EQ(1u, encoder.allocations());
+
+  cv::Mat bgra(4, 4, CV_8UC4);
+  EXPECT_THROW(encoder.encode(bgra, std_msgs::Header()), cv_bridge::Exception);
+}
@@ -0,0 +1,87 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-20 10:40:22
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-20 10:40:22
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/driver/usb_camera_node/include/usb_camera_node/slot_compressed_image.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <cstdint>
+#include <cstring>
+#include <string>
+// third party headers
+// ros
+#include "ros/message_traits.h"
+#include "ros/serialization.h"
+#include "sensor_msgs/CompressedImage.h"
+#include "std_msgs/Header.h"
+
+/**
+ * @description: 与 sensor_msgs/CompressedImage 的类型和序列化格式相同, data 直接引用
+ * ring slot 中的 jpeg 数据(v4l2 后端为驱动的 mmap 缓存), 订阅端按 CompressedImage 接收.
+ * 只能以 const 引用 publish: roscpp 在 publish 返回前把 data 序列化到发送缓存,
+ * 之后 slot 就可以还给驱动; 以 shared_ptr 发布时进程内订阅者会持有悬空的 data.
+ */
+struct SlotCompressedImage {
+  std_msgs::Header header;
+  std::string format;
+  const uint8_t *data = nullptr;
+  uint32_t size = 0;
+};
+
+namespace ros {
+namespace message_traits {
+
+template <> struct IsMessage<SlotCompressedImage> : TrueType {};
+template <> struct HasHeader<SlotCompressedImage> : TrueType {};
+
+template <> struct MD5Sum<SlotCompressedImage> {
+  static const char *value() {
+    return MD5Sum<sensor_msgs::CompressedImage>::value();
+  }
+  static const char *value(const SlotCompressedImage &) { return value(); }
+};
+
+template <> struct DataType<SlotCompressedImage> {
+  static const char *value() {
+    return DataType<sensor_msgs::CompressedImage>::value();
+  }
+  static const char *value(const SlotCompressedImage &) { return value(); }
+};
+
+template <> struct Definition<SlotCompressedImage> {
+  static const char *value() {
+    return Definition<sensor_msgs::CompressedImage>::value();
+  }
+  static const char *value(const SlotCompressedImage &) { return value(); }
+};
+
+} // namespace message_traits
+
+namespace serialization {
+
+template <> struct Serializer<SlotCompressedImage> {
+  template <typename Stream>
+  inline static void write(Stream &stream, const SlotCompressedImage &m) {
+    stream.next(m.header);
+    stream.next(m.format);
+    stream.next(m.size);
+    if (m.size > 0) {
+      std::memcpy(stream.advance(m.size), m.data, m.size);
+    }
+  }
+
+  inline static uint32_t serializedLength(const SlotCompressedImage &m) {
+    return serializationLength(m.header) + serializationLength(m.format) +
+           4 + m.size;
+  }
+};
+
+} // namespace serialization
+} // namespace ros
@@ -0,0 +1,115 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 10:05:17
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 10:05:17
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/driver/usb_camera_node/include/usb_camera_node/usb_camera_capture.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/opencv.hpp"
+// ros
+#include "ros/ros.h"
+// local headers
+#include "usb_camera_node/v4l2_capture.hpp"
+
+struct CapturedFrame {
+  cv::Mat image;           // 解码后的BGR图像, mjpeg直通模式下为空
+  cv::Mat raw;             // mjpeg直通模式下的原始压缩数据(1xN CV_8UC1)
+                           // v4l2后端下直接指向驱动的mmap缓存
+  ros::Time stamp;         // 采集时间, v4l2后端为驱动时间戳, 否则为grab返回的时刻
+  ros::Time grab_stamp;    // 用户态拿到这一帧的时间, 与stamp之差为驱动到用户态的延迟
+  uint32_t seq = 0;
+};
+
+struct UsbCameraCaptureOptions {
+  std::string device_name;
+  cv::Size img_size;
+  int fps = 30;
+  std::string pixel_format = "yuyv"; // yuyv 或 mjpeg
+  bool mjpeg_passthrough = false;    // 不解码,直接输出相机的mjpeg数据
+  int ring_size = 4;                 // 复用的帧缓存数量, 至少为2
+  std::string capture_backend = "v4l2"; // v4l2 或 opencv, v4l2失败时退回opencv
+  int v4l2_queue_depth = 4;             // 驱动队列中的mmap缓存数量
+};
+
+/**
+ * @description: 独立采集线程 + 可复用的帧缓存环
+ * 采集线程只负责grab/retrieve并打上采集时间,发布线程通过 acquire_latest
+ * 取最新一帧,处理完后 release. 发布线程卡顿时只会跳过旧帧,不会影响采集.
+ */
+class UsbCameraCapture {
+public:
+  explicit UsbCameraCapture(const UsbCameraCaptureOptions &options)
+      : options_(options) {}
+  ~UsbCameraCapture() { stop(); }
+
+  bool init();
+  bool start();
+  void stop();
+
+  /**
+   * @description: 等待并占用最新的一帧
+   * @param {double} timeout_s : 最长等待时间
+   * @return {CapturedFrame*} : 超时返回nullptr, 使用完后必须调用 release
+   */
+  CapturedFrame *acquire_latest(double timeout_s);
+  void release(CapturedFrame *frame);
+
+  // 发布线程来不及处理而被覆盖的帧数
+  uint64_t dropped_frames() const { return dropped_frames_; }
+  // 采集失败的次数
+  uint64_t capture_errors() const { return capture_errors_; }
+  // 驱动内部丢掉的帧数(驱动帧序号不连续), 只有v4l2后端可以统计
+  uint64_t driver_dropped_frames() const { return driver_dropped_frames_; }
+  // 实际使用的后端
+  bool using_v4l2() const { return v4l2_ != nullptr; }
+
+private:
+  // kWriting : 采集线程正在写入, kInUse : 发布线程正在使用
+  enum SlotState { kFree, kWriting, kReady, kInUse };
+  struct Slot {
+    CapturedFrame frame;
+    SlotState state = kFree;
+    int v4l2_index = -1; // mjpeg直通时slot占用的驱动缓存, 释放slot时归还
+  };
+
+  bool init_opencv();
+  bool init_v4l2();
+  void capture_loop();
+  bool capture_opencv(CapturedFrame *frame);
+  bool capture_v4l2(Slot *slot, const V4L2Frame &v4l2_frame);
+  int pick_write_slot();
+  void free_slot(Slot *slot);
+
+  UsbCameraCaptureOptions options_;
+  cv::VideoCapture cap_;
+  std::unique_ptr<V4L2Capture> v4l2_;
+  std::thread capture_thread_;
+  std::atomic<bool> running_{false};
+
+  std::mutex mutex_;
+  std::condition_variable frame_ready_;
+  std::vector<Slot> slots_;
+  uint32_t next_seq_ = 0;
+  uint32_t next_driver_sequence_ = 0;
+
+  std::atomic<uint64_t> dropped_frames_{0};
+  std::atomic<uint64_t> capture_errors_{0};
+  std::atomic<uint64_t> driver_dropped_frames_{0};
+};
@@ -0,0 +1,90 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 11:48:20
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 11:48:20
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/driver/usb_camera_node/include/usb_camera_node/v4l2_capture.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// c system headers
+#include <linux/videodev2.h>
+// cpp system headers
+#include <string>
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/opencv.hpp"
+// ros
+#include "ros/ros.h"
+
+struct V4L2CaptureOptions {
+  std::string device_name;
+  cv::Size img_size;
+  int fps = 30;
+  std::string pixel_format = "yuyv"; // yuyv 或 mjpeg
+  int queue_depth = 4;               // 向驱动申请的mmap缓存数量
+};
+
+// 从驱动队列中取出的一帧, view 直接指向mmap内存, enqueue 之后失效
+struct V4L2Frame {
+  int index = -1;
+  cv::Mat view;            // yuyv : CV_8UC2, mjpeg : 1 x bytesused CV_8UC1
+  ros::Time stamp;         // 驱动打的采集时间, 已转换到ros时间
+  ros::Time dequeue_stamp; // 用户态拿到这一帧的时间
+  uint32_t sequence = 0;   // 驱动的帧序号, 不连续说明驱动内部丢帧
+};
+
+/**
+ * @description: V4L2 mmap 流式采集
+ * 直接使用 VIDIOC_REQBUFS/QBUF/DQBUF, 帧数据不做拷贝, 时间戳使用驱动的采集时间.
+ * 没有真实相机时可以用 vivid 虚拟驱动测试: sudo modprobe vivid
+ */
+class V4L2Capture {
+public:
+  explicit V4L2Capture(const V4L2CaptureOptions &options)
+      : options_(options) {}
+  ~V4L2Capture() { close(); }
+
+  bool init();
+  bool start();
+  void stop();
+  void close();
+
+  /**
+   * @description: 等待并取出一帧
+   * @param {V4L2Frame*} frame : 输出,使用完后必须调用 enqueue 还给驱动
+   * @param {int} timeout_ms : 最长等待时间
+   * @return {bool} : 超时或出错返回false
+   */
+  bool dequeue(V4L2Frame *frame, int timeout_ms);
+  bool enqueue(int index);
+
+  // 驱动协商后的实际尺寸和帧率
+  cv::Size img_size() const { return img_size_; }
+  int buffer_count() const { return static_cast<int>(buffers_.size()); }
+  bool is_mjpeg() const { return pixel_format_ == V4L2_PIX_FMT_MJPEG; }
+
+private:
+  struct Buffer {
+    void *start = nullptr;
+    size_t length = 0;
+  };
+
+  bool xioctl(unsigned long request, void *arg, const char *name);
+  bool set_format();
+  bool request_buffers();
+  ros::Time to_ros_time(const struct v4l2_buffer &buf, ros::Time now) const;
+
+  V4L2CaptureOptions options_;
+  int fd_ = -1;
+  bool streaming_ = false;
+  uint32_t pixel_format_ = 0;
+  uint32_t bytes_per_line_ = 0;
+  cv::Size img_size_;
+  std::vector<Buffer> buffers_;
+};
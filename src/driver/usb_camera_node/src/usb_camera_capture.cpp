@@ -0,0 +1,293 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 10:05:17
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 10:05:17
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/driver/usb_camera_node/src/usb_camera_capture.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#include "usb_camera_node/usb_camera_capture.hpp"
+
+bool UsbCameraCapture::init() {
+  if (options_.ring_size < 2) {
+    ROS_WARN_STREAM("[ UsbCameraCapture ] ring_size must be at least 2, use 2");
+    options_.ring_size = 2;
+  }
+  slots_.resize(options_.ring_size);
+
+  if (options_.mjpeg_passthrough && options_.pixel_format != "mjpeg") {
+    ROS_ERROR_STREAM(
+        "[ UsbCameraCapture ] mjpeg_passthrough requires pixel_format mjpeg");
+    return false;
+  }
+
+  if (options_.capture_backend == "v4l2") {
+    if (init_v4l2()) {
+      return true;
+    }
+    ROS_WARN_STREAM("[ UsbCameraCapture ] v4l2 backend init failed , fall "
+                    "back to opencv VideoCapture");
+    v4l2_.reset();
+  } else if (options_.capture_backend != "opencv") {
+    ROS_WARN_STREAM("[ UsbCameraCapture ] unknown capture_backend : "
+                    << options_.capture_backend << " , use opencv");
+  }
+  return init_opencv();
+}
+
+bool UsbCameraCapture::init_v4l2() {
+  V4L2CaptureOptions v4l2_options;
+  v4l2_options.device_name = options_.device_name;
+  v4l2_options.img_size = options_.img_size;
+  v4l2_options.fps = options_.fps;
+  v4l2_options.pixel_format = options_.pixel_format;
+  v4l2_options.queue_depth = options_.v4l2_queue_depth;
+  // mjpeg直通时缓存环中的帧直接占用驱动缓存, 驱动队列中至少还要留两个
+  if (options_.mjpeg_passthrough &&
+      v4l2_options.queue_depth < options_.ring_size + 2) {
+    v4l2_options.queue_depth = options_.ring_size + 2;
+    ROS_WARN_STREAM("[ UsbCameraCapture ] v4l2_queue_depth raised to "
+                    << v4l2_options.queue_depth << " for mjpeg_passthrough");
+  }
+  v4l2_.reset(new V4L2Capture(v4l2_options));
+  return v4l2_->init();
+}
+
+bool UsbCameraCapture::init_opencv() {
+  if (!cap_.open(options_.device_name, cv::CAP_V4L2)) {
+    ROS_ERROR_STREAM("[ UsbCameraCapture ] open camera failed , device_name : "
+                     << options_.device_name);
+    return false;
+  }
+
+  if (options_.pixel_format == "mjpeg") {
+    cap_.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'));
+  } else if (options_.pixel_format == "yuyv") {
+    cap_.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V'));
+  } else {
+    ROS_WARN_STREAM("[ UsbCameraCapture ] unknown pixel_format : "
+                    << options_.pixel_format << " , use driver default");
+  }
+  if (options_.img_size.area() > 0) {
+    cap_.set(cv::CAP_PROP_FRAME_WIDTH, options_.img_size.width);
+    cap_.set(cv::CAP_PROP_FRAME_HEIGHT, options_.img_size.height);
+  }
+  if (options_.fps > 0) {
+    cap_.set(cv::CAP_PROP_FPS, options_.fps);
+  }
+  // 驱动内部只保留最新的帧,旧帧由本类的缓存环负责丢弃
+  cap_.set(cv::CAP_PROP_BUFFERSIZE, 1);
+
+  if (options_.mjpeg_passthrough) {
+    // 关闭转换后retrieve返回相机输出的原始mjpeg数据
+    if (!cap_.set(cv::CAP_PROP_CONVERT_RGB, 0)) {
+      ROS_ERROR_STREAM("[ UsbCameraCapture ] backend does not support raw "
+                       "mjpeg output");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool UsbCameraCapture::start() {
+  if (!v4l2_ && !cap_.isOpened()) {
+    ROS_ERROR_STREAM("[ UsbCameraCapture ] start before init");
+    return false;
+  }
+  if (running_) {
+    return true;
+  }
+  if (v4l2_ && !v4l2_->start()) {
+    return false;
+  }
+  running_ = true;
+  capture_thread_ = std::thread(&UsbCameraCapture::capture_loop, this);
+  return true;
+}
+
+void UsbCameraCapture::stop() {
+  running_ = false;
+  frame_ready_.notify_all();
+  if (capture_thread_.joinable()) {
+    capture_thread_.join();
+  }
+  if (v4l2_) {
+    // 关闭后mmap内存失效, slot中指向驱动缓存的数据一并清空
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &slot : slots_) {
+      slot.v4l2_index = -1;
+      slot.frame.raw.release();
+    }
+    v4l2_->close();
+  }
+  if (cap_.isOpened()) {
+    cap_.release();
+  }
+}
+
+CapturedFrame *UsbCameraCapture::acquire_latest(double timeout_s) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  int latest = -1;
+  auto has_ready = [&]() {
+    latest = -1;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      if (slots_[i].state == kReady &&
+          (latest < 0 || slots_[i].frame.seq > slots_[latest].frame.seq)) {
+        latest = static_cast<int>(i);
+      }
+    }
+    return latest >= 0 || !running_;
+  };
+  if (!frame_ready_.wait_for(
+          lock, std::chrono::duration<double>(timeout_s), has_ready) ||
+      latest < 0) {
+    return nullptr;
+  }
+
+  // 比最新帧旧的帧已经没有发布的意义
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].state == kReady && static_cast<int>(i) != latest) {
+      free_slot(&slots_[i]);
+      ++dropped_frames_;
+    }
+  }
+  slots_[latest].state = kInUse;
+  return &slots_[latest].frame;
+}
+
+void UsbCameraCapture::release(CapturedFrame *frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &slot : slots_) {
+    if (&slot.frame == frame) {
+      free_slot(&slot);
+      return;
+    }
+  }
+}
+
+int UsbCameraCapture::pick_write_slot() {
+  int oldest_ready = -1;
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].state == kFree) {
+      return static_cast<int>(i);
+    }
+    if (slots_[i].state == kReady &&
+        (oldest_ready < 0 ||
+         slots_[i].frame.seq < slots_[oldest_ready].frame.seq)) {
+      oldest_ready = static_cast<int>(i);
+    }
+  }
+  if (oldest_ready >= 0) {
+    free_slot(&slots_[oldest_ready]);
+    ++dropped_frames_;
+  }
+  return oldest_ready;
+}
+
+void UsbCameraCapture::free_slot(Slot *slot) {
+  slot->state = kFree;
+  if (slot->v4l2_index >= 0) {
+    slot->frame.raw.release();
+    v4l2_->enqueue(slot->v4l2_index);
+    slot->v4l2_index = -1;
+  }
+}
+
+void UsbCameraCapture::capture_loop() {
+  while (running_) {
+    V4L2Frame v4l2_frame;
+    ros::Time stamp;
+    ros::Time grab_stamp;
+    if (v4l2_) {
+      if (!v4l2_->dequeue(&v4l2_frame, 100)) {
+        continue;
+      }
+      if (v4l2_frame.sequence > next_driver_sequence_ &&
+          next_driver_sequence_ > 0) {
+        driver_dropped_frames_ += v4l2_frame.sequence - next_driver_sequence_;
+      }
+      next_driver_sequence_ = v4l2_frame.sequence + 1;
+      stamp = v4l2_frame.stamp;
+      grab_stamp = v4l2_frame.dequeue_stamp;
+    } else {
+      if (!cap_.grab()) {
+        ++capture_errors_;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+      // grab返回时帧已经采集完成,以此作为采集时间
+      stamp = ros::Time::now();
+      grab_stamp = stamp;
+    }
+
+    int index = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      index = pick_write_slot();
+      if (index >= 0) {
+        slots_[index].state = kWriting;
+      } else if (v4l2_) {
+        v4l2_->enqueue(v4l2_frame.index);
+      }
+    }
+    if (index < 0) {
+      continue;
+    }
+
+    Slot &slot = slots_[index];
+    bool ok = v4l2_ ? capture_v4l2(&slot, v4l2_frame)
+                    : capture_opencv(&slot.frame);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!ok) {
+        ++capture_errors_;
+        free_slot(&slot);
+        continue;
+      }
+      slot.frame.stamp = stamp;
+      slot.frame.grab_stamp = grab_stamp;
+      slot.frame.seq = next_seq_++;
+      slot.state = kReady;
+    }
+    frame_ready_.notify_one();
+  }
+}
+
+bool UsbCameraCapture::capture_opencv(CapturedFrame *frame) {
+  // retrieve 在尺寸不变时复用slot中已有的内存
+  if (options_.mjpeg_passthrough) {
+    return cap_.retrieve(frame->raw) && !frame->raw.empty();
+  }
+  return cap_.retrieve(frame->image) && !frame->image.empty();
+}
+
+bool UsbCameraCapture::capture_v4l2(Slot *slot, const V4L2Frame &v4l2_frame) {
+  if (options_.mjpeg_passthrough) {
+    // 不拷贝, slot直接占用驱动缓存, 在 free_slot 时归还
+    slot->frame.raw = v4l2_frame.view;
+    slot->v4l2_index = v4l2_frame.index;
+    return true;
+  }
+  // 直接从mmap内存解码/转换到slot中复用的图像, 之后立即归还驱动缓存
+  bool ok = true;
+  try {
+    if (v4l2_->is_mjpeg()) {
+      cv::imdecode(v4l2_frame.view, cv::IMREAD_COLOR, &slot->frame.image);
+    } else {
+      cv::cvtColor(v4l2_frame.view, slot->frame.image, cv::COLOR_YUV2BGR_YUYV);
+    }
+  } catch (const cv::Exception &e) {
+    // 损坏的jpeg可能让 imdecode 抛异常, 计入 capture_errors_, 不能让采集线程退出
+    ROS_WARN_STREAM_THROTTLE(5, "[ UsbCameraCapture ] decode failed : "
+                                    << e.what());
+    ok = false;
+  }
+  // 无论成功与否都要归还驱动缓存
+  v4l2_->enqueue(v4l2_frame.index);
+  return ok && !slot->frame.image.empty();
+}
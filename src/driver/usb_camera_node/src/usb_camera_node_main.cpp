@@ -1,8 +1,8 @@
 /*
  * @Author: windzu
  * @Date: 2022-02-24 18:56:19
- * @LastEditTime: 2022-04-16 20:43:59
- * @LastEditors: windzu
+ * @LastEditTime: 2026-10-19 10:05:17
+ * @LastEditors: ls
  * @Description:
  * @FilePath: /windzu_ws/src/driver/usb_camera_node/src/usb_camera_node_main.cpp
  * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
@@ -14,12 +14,14 @@
 
 // cpp system headers
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 // third party headers
 // ros
 #include "cv_bridge/cv_bridge.h"
+#include "cv_bridge/msg_pool.h"
 #include "image_transport/image_transport.h"
 #include "ros/console.h"
 #include "ros/ros.h"
@@ -29,7 +31,77 @@
 
 // local headers
 #include "common_utils/parse_camera_config.hpp"
-#include "correct_img/correct_img.hpp"
+#include "common_utils/camera_undistorter.hpp"
+#include "usb_camera_node/slot_compressed_image.hpp"
+#include "usb_camera_node/usb_camera_capture.hpp"
+
+// 读取采集相关的可选配置,配置文件中没有时使用默认值
+static void parse_capture_options(const std::string &camera_config_path, const std::string &camera_id,
+                                  UsbCameraCaptureOptions *options, bool *publish_raw) {
+  try {
+    YAML::Node camera = YAML::LoadFile(camera_config_path)[camera_id];
+    if (camera["pixel_format"]) {
+      options->pixel_format = camera["pixel_format"].as<std::string>();
+    }
+    if (camera["mjpeg_passthrough"]) {
+      options->mjpeg_passthrough = camera["mjpeg_passthrough"].as<bool>();
+    }
+    if (camera["ring_size"]) {
+      options->ring_size = camera["ring_size"].as<int>();
+    }
+    if (camera["capture_backend"]) {
+      options->capture_backend = camera["capture_backend"].as<std::string>();
+    }
+    if (camera["v4l2_queue_depth"]) {
+      options->v4l2_queue_depth = camera["v4l2_queue_depth"].as<int>();
+    }
+    if (camera["publish_raw"]) {
+      *publish_raw = camera["publish_raw"].as<bool>();
+    }
+  } catch (const YAML::Exception &e) {
+    ROS_WARN_STREAM("[ USB_CAMERA_NODE ] parse capture options failed : " << e.what());
+  }
+}
+
+// 读取去畸变配置, undistort_mode 为 none 或缺少标定参数时返回nullptr
+static std::unique_ptr<CameraUndistorter> create_undistorter(const std::string &camera_config_path,
+                                                             const std::string &camera_id, cv::Size img_size) {
+  try {
+    YAML::Node camera = YAML::LoadFile(camera_config_path)[camera_id];
+    std::string undistort_mode = camera["undistort_mode"] ? camera["undistort_mode"].as<std::string>() : "full";
+    if (undistort_mode == "none") {
+      return nullptr;
+    }
+    if (!camera["intrinsics"] || !camera["distortion_coeffs"]) {
+      ROS_WARN_STREAM("[ USB_CAMERA_NODE ] no intrinsics or distortion_coeffs for " << camera_id);
+      return nullptr;
+    }
+    cv::Rect crop;
+    if (camera["undistort_crop"]) {
+      std::vector<int> c = camera["undistort_crop"].as<std::vector<int>>();
+      if (c.size() == 4) {
+        crop = cv::Rect(c[0], c[1], c[2], c[3]);
+      }
+    }
+    cv::Size output_size;
+    if (camera["undistort_output_size"]) {
+      std::vector<int> o = camera["undistort_output_size"].as<std::vector<int>>();
+      if (o.size() == 2) {
+        output_size = cv::Size(o[0], o[1]);
+      }
+    }
+    std::unique_ptr<CameraUndistorter> undistorter(
+        new CameraUndistorter(camera["intrinsics"].as<std::vector<double>>(),
+                              camera["distortion_coeffs"].as<std::vector<double>>(), img_size));
+    if (!undistorter->init(crop, output_size)) {
+      return nullptr;
+    }
+    return undistorter;
+  } catch (const YAML::Exception &e) {
+    ROS_WARN_STREAM("[ USB_CAMERA_NODE ] parse undistort options failed : " << e.what());
+  }
+  return nullptr;
+}
 
 int main(int argc, char **argv) {
   ros::init(argc, argv, "usb_camera");
@@ -52,42 +124,111 @@ int main(int argc, char **argv) {
                      << camera_config_path << " camera_id : " << camera_id);
     return -1;
   }
+  UsbCameraCaptureOptions capture_options;
+  capture_options.device_name = device_name;
+  capture_options.img_size = img_size;
+  capture_options.fps = fps;
+  bool publish_raw = true;
+  parse_capture_options(camera_config_path, camera_id, &capture_options, &publish_raw);
 
-  // correct img init
-  CorrectImg correct_img(camera_config_path, camera_id);
-  bool correct_img_ret = correct_img.init();
-  if (!correct_img_ret) {
-    ROS_WARN_STREAM("[ USB_CAMERA_NODE ] correct_img init failed , will publish raw image");
+  // undistorter init, 映射表只在这里生成一次
+  std::unique_ptr<CameraUndistorter> undistorter = create_undistorter(camera_config_path, camera_id, img_size);
+  if (!undistorter) {
+    ROS_WARN_STREAM("[ USB_CAMERA_NODE ] undistort disabled , will publish raw image");
   }
 
   // video init
-  cv::VideoCapture cap(device_name);
-  if (!cap.isOpened()) {
+  UsbCameraCapture capture(capture_options);
+  if (!capture.init()) {
     ROS_ERROR_STREAM("[ USB_CAMERA_NODE ] open camera failed , camera_device_name is : " << device_name);
     return -1;
   }
+  ROS_INFO_STREAM("[ USB_CAMERA_NODE ] " << device_name << " capture backend : "
+                                         << (capture.using_v4l2() ? "v4l2" : "opencv"));
 
   // img publisher init
+  // mjpeg直通时 /compressed 由本节点直接发布,raw图像不再经过image_transport,
+  // 避免与compressed插件广播同名topic
   image_transport::ImageTransport it(nh);
-  image_transport::Publisher img_publisher = it.advertise(publish_topic, 1);
-  cv::Mat frame;
-  sensor_msgs::ImagePtr img_msg;
+  image_transport::Publisher img_publisher;
+  ros::Publisher raw_publisher;
+  ros::Publisher compressed_publisher;
+  if (capture_options.mjpeg_passthrough) {
+    compressed_publisher = nh.advertise<SlotCompressedImage>(publish_topic + "/compressed", 1);
+    if (publish_raw) {
+      raw_publisher = nh.advertise<sensor_msgs::Image>(publish_topic, 1);
+    }
+  } else {
+    img_publisher = it.advertise(publish_topic, 1);
+  }
+
+  if (!capture.start()) {
+    return -1;
+  }
 
-  ros::Rate loop_rate(fps);
+  cv::Mat frame;
+  // 去畸变结果直接写入池中消息的内存, 发布时不再拷贝
+  cv_bridge::ImageMsgPool img_pool;
+  SlotCompressedImage compressed_msg;
+  compressed_msg.format = "jpeg";
+  cv::Mat view;
+  std_msgs::Header header;
+  header.frame_id = camera_id;
   while (nh.ok()) {
-    cap >> frame;
-    if (!frame.empty()) {
-      if (correct_img_ret) {
-        correct_img.correct(&frame);
-      }
+    CapturedFrame *captured = capture.acquire_latest(1.0);
+    if (captured == nullptr) {
+      ROS_WARN_STREAM_THROTTLE(5, "[ USB_CAMERA_NODE ] no frame from camera " << device_name);
+      ros::spinOnce();
+      continue;
+    }
+    header.stamp = captured->stamp;
+    header.seq = captured->seq;
 
-      img_msg = cv_bridge::CvImage(std_msgs::Header(), "bgr8", frame).toImageMsg();
-      img_publisher.publish(img_msg);
-      cv::waitKey(1);
+    if (capture_options.mjpeg_passthrough) {
+      // 直接发布相机输出的jpeg数据,不做解码和重新编码;
+      // slot 中的数据只在 roscpp 序列化时拷贝一次, publish 返回后 slot 才释放
+      compressed_msg.header = header;
+      compressed_msg.data = captured->raw.datastart;
+      compressed_msg.size = static_cast<uint32_t>(captured->raw.dataend - captured->raw.datastart);
+      compressed_publisher.publish(compressed_msg);
+
+      if (publish_raw && raw_publisher.getNumSubscribers() > 0) {
+        try {
+          cv::imdecode(captured->raw, cv::IMREAD_COLOR, &frame);
+        } catch (const cv::Exception &e) {
+          // 损坏的jpeg: 压缩图已经发布, 只跳过本帧的raw图像
+          ROS_WARN_STREAM_THROTTLE(5, "[ USB_CAMERA_NODE ] decode failed : " << e.what());
+          frame.release();
+        }
+        if (!frame.empty()) {
+          cv::Size out_size = undistorter ? undistorter->output_size() : frame.size();
+          sensor_msgs::ImagePtr msg = img_pool.acquire(header, "bgr8", out_size.height, out_size.width, &view);
+          if (undistorter) {
+            undistorter->correct(frame, &view);
+          } else {
+            frame.copyTo(view);
+          }
+          raw_publisher.publish(msg);
+        }
+      }
+    } else {
+      cv::Size out_size = undistorter ? undistorter->output_size() : captured->image.size();
+      sensor_msgs::ImagePtr msg = img_pool.acquire(header, "bgr8", out_size.height, out_size.width, &view);
+      if (undistorter) {
+        undistorter->correct(captured->image, &view);
+      } else {
+        captured->image.copyTo(view);
+      }
+      img_publisher.publish(msg);
     }
+    capture.release(captured);
 
     ros::spinOnce();
-    loop_rate.sleep();
   }
+  capture.stop();
+  ROS_INFO_STREAM("[ USB_CAMERA_NODE ] dropped frames : " << capture.dropped_frames()
+                                                          << " capture errors : " << capture.capture_errors()
+                                                          << " driver dropped frames : "
+                                                          << capture.driver_dropped_frames());
   return 0;
-}
\ No newline at end of file
+}
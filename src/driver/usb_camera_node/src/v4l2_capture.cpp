@@ -0,0 +1,285 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 11:48:20
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 11:48:20
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/driver/usb_camera_node/src/v4l2_capture.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#include "usb_camera_node/v4l2_capture.hpp"
+
+// c system headers
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+// cpp system headers
+#include <algorithm>
+
+bool V4L2Capture::xioctl(unsigned long request, void *arg, const char *name) {
+  int ret = -1;
+  do {
+    ret = ioctl(fd_, request, arg);
+  } while (ret == -1 && errno == EINTR);
+  if (ret == -1) {
+    ROS_ERROR_STREAM("[ V4L2Capture ] " << name << " failed : "
+                                        << strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool V4L2Capture::init() {
+  fd_ = ::open(options_.device_name.c_str(), O_RDWR | O_NONBLOCK);
+  if (fd_ < 0) {
+    ROS_ERROR_STREAM("[ V4L2Capture ] open failed , device_name : "
+                     << options_.device_name << " " << strerror(errno));
+    return false;
+  }
+
+  struct v4l2_capability cap;
+  memset(&cap, 0, sizeof(cap));
+  if (!xioctl(VIDIOC_QUERYCAP, &cap, "VIDIOC_QUERYCAP")) {
+    return false;
+  }
+  uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps
+                                                            : cap.capabilities;
+  if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+    ROS_ERROR_STREAM("[ V4L2Capture ] " << options_.device_name
+                                        << " does not support streaming "
+                                           "video capture");
+    return false;
+  }
+
+  if (!set_format()) {
+    return false;
+  }
+  return request_buffers();
+}
+
+bool V4L2Capture::set_format() {
+  if (options_.pixel_format == "mjpeg") {
+    pixel_format_ = V4L2_PIX_FMT_MJPEG;
+  } else if (options_.pixel_format == "yuyv") {
+    pixel_format_ = V4L2_PIX_FMT_YUYV;
+  } else {
+    ROS_ERROR_STREAM("[ V4L2Capture ] unsupported pixel_format : "
+                     << options_.pixel_format);
+    return false;
+  }
+
+  struct v4l2_format fmt;
+  memset(&fmt, 0, sizeof(fmt));
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (!xioctl(VIDIOC_G_FMT, &fmt, "VIDIOC_G_FMT")) {
+    return false;
+  }
+  if (options_.img_size.area() > 0) {
+    fmt.fmt.pix.width = options_.img_size.width;
+    fmt.fmt.pix.height = options_.img_size.height;
+  }
+  fmt.fmt.pix.pixelformat = pixel_format_;
+  fmt.fmt.pix.field = V4L2_FIELD_NONE;
+  if (!xioctl(VIDIOC_S_FMT, &fmt, "VIDIOC_S_FMT")) {
+    return false;
+  }
+  // 驱动可能调整尺寸,以协商后的结果为准
+  if (fmt.fmt.pix.pixelformat != pixel_format_) {
+    ROS_ERROR_STREAM("[ V4L2Capture ] driver rejected pixel_format : "
+                     << options_.pixel_format);
+    return false;
+  }
+  img_size_ = cv::Size(fmt.fmt.pix.width, fmt.fmt.pix.height);
+  bytes_per_line_ = fmt.fmt.pix.bytesperline;
+  if (bytes_per_line_ == 0) {
+    bytes_per_line_ = img_size_.width * 2;
+  }
+  if (options_.img_size.area() > 0 && img_size_ != options_.img_size) {
+    ROS_WARN_STREAM("[ V4L2Capture ] driver changed img_size from "
+                    << options_.img_size << " to " << img_size_);
+  }
+
+  if (options_.fps > 0) {
+    struct v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = options_.fps;
+    // 部分驱动不支持设置帧率,不作为错误
+    if (ioctl(fd_, VIDIOC_S_PARM, &parm) == -1) {
+      ROS_WARN_STREAM("[ V4L2Capture ] VIDIOC_S_PARM failed , use driver "
+                      "default fps");
+    }
+  }
+  return true;
+}
+
+bool V4L2Capture::request_buffers() {
+  struct v4l2_requestbuffers req;
+  memset(&req, 0, sizeof(req));
+  req.count = std::max(options_.queue_depth, 2);
+  req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  req.memory = V4L2_MEMORY_MMAP;
+  if (!xioctl(VIDIOC_REQBUFS, &req, "VIDIOC_REQBUFS")) {
+    return false;
+  }
+  if (req.count < 2) {
+    ROS_ERROR_STREAM("[ V4L2Capture ] insufficient buffer memory");
+    return false;
+  }
+
+  buffers_.resize(req.count);
+  for (uint32_t i = 0; i < req.count; ++i) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = i;
+    if (!xioctl(VIDIOC_QUERYBUF, &buf, "VIDIOC_QUERYBUF")) {
+      return false;
+    }
+    void *start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       fd_, buf.m.offset);
+    if (start == MAP_FAILED) {
+      ROS_ERROR_STREAM("[ V4L2Capture ] mmap failed : " << strerror(errno));
+      return false;
+    }
+    buffers_[i].start = start;
+    buffers_[i].length = buf.length;
+  }
+  return true;
+}
+
+bool V4L2Capture::start() {
+  if (fd_ < 0 || buffers_.empty()) {
+    ROS_ERROR_STREAM("[ V4L2Capture ] start before init");
+    return false;
+  }
+  if (streaming_) {
+    return true;
+  }
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    if (!enqueue(static_cast<int>(i))) {
+      return false;
+    }
+  }
+  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (!xioctl(VIDIOC_STREAMON, &type, "VIDIOC_STREAMON")) {
+    return false;
+  }
+  streaming_ = true;
+  return true;
+}
+
+void V4L2Capture::stop() {
+  if (!streaming_) {
+    return;
+  }
+  // STREAMOFF 会把所有缓存从驱动队列中移除
+  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  xioctl(VIDIOC_STREAMOFF, &type, "VIDIOC_STREAMOFF");
+  streaming_ = false;
+}
+
+void V4L2Capture::close() {
+  stop();
+  for (auto &buffer : buffers_) {
+    if (buffer.start != nullptr) {
+      munmap(buffer.start, buffer.length);
+    }
+  }
+  buffers_.clear();
+  if (fd_ >= 0) {
+    // 释放驱动中的缓存
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = 0;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    ioctl(fd_, VIDIOC_REQBUFS, &req);
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+bool V4L2Capture::enqueue(int index) {
+  if (index < 0 || index >= static_cast<int>(buffers_.size())) {
+    return false;
+  }
+  struct v4l2_buffer buf;
+  memset(&buf, 0, sizeof(buf));
+  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_MMAP;
+  buf.index = index;
+  return xioctl(VIDIOC_QBUF, &buf, "VIDIOC_QBUF");
+}
+
+bool V4L2Capture::dequeue(V4L2Frame *frame, int timeout_ms) {
+  struct pollfd pfd;
+  pfd.fd = fd_;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int ret = poll(&pfd, 1, timeout_ms);
+  if (ret <= 0) {
+    return false;
+  }
+
+  struct v4l2_buffer buf;
+  memset(&buf, 0, sizeof(buf));
+  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_MMAP;
+  if (ioctl(fd_, VIDIOC_DQBUF, &buf) == -1) {
+    if (errno != EAGAIN) {
+      ROS_ERROR_STREAM_THROTTLE(5, "[ V4L2Capture ] VIDIOC_DQBUF failed : "
+                                       << strerror(errno));
+    }
+    return false;
+  }
+  frame->dequeue_stamp = ros::Time::now();
+  frame->index = buf.index;
+  frame->sequence = buf.sequence;
+  frame->stamp = to_ros_time(buf, frame->dequeue_stamp);
+
+  uint8_t *data = static_cast<uint8_t *>(buffers_[buf.index].start);
+  if ((buf.flags & V4L2_BUF_FLAG_ERROR) || buf.bytesused == 0) {
+    enqueue(buf.index);
+    frame->index = -1;
+    return false;
+  }
+  if (is_mjpeg()) {
+    frame->view = cv::Mat(1, buf.bytesused, CV_8UC1, data);
+  } else {
+    frame->view = cv::Mat(img_size_, CV_8UC2, data, bytes_per_line_);
+  }
+  return true;
+}
+
+ros::Time V4L2Capture::to_ros_time(const struct v4l2_buffer &buf,
+                                   ros::Time now) const {
+  // 只有单调时钟的时间戳可以换算,其他情况退回到取帧时间
+  if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) !=
+      V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+    return now;
+  }
+  struct timespec mono;
+  clock_gettime(CLOCK_MONOTONIC, &mono);
+  int64_t mono_ns = static_cast<int64_t>(mono.tv_sec) * 1000000000LL +
+                    mono.tv_nsec;
+  int64_t frame_ns = static_cast<int64_t>(buf.timestamp.tv_sec) * 1000000000LL +
+                     static_cast<int64_t>(buf.timestamp.tv_usec) * 1000LL;
+  int64_t age_ns = mono_ns - frame_ns;
+  if (age_ns < 0 || age_ns > 1000000000LL) {
+    return now;
+  }
+  ros::Time stamp;
+  stamp.fromNSec(now.toNSec() - age_ns);
+  return stamp;
+}
@@ -0,0 +1,95 @@
+/*
+ * @Description: CameraUndistorter 与逐帧 cv::undistort 的耗时对比
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 11:02:36
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 11:02:36
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/benchmark/undistort_benchmark.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/opencv.hpp"
+// local headers
+#include "common_utils/camera_undistorter.hpp"
+
+template <typename Func> static double run_ms(Func func, int iterations) {
+  func(); // warm up
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - begin).count() /
+         iterations;
+}
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 200;
+
+  // 与 usb_camera_node/config/camera_config.yaml 中的前视相机一致
+  std::vector<double> intrinsics = {459.3801391263343, 458.3358524061085,
+                                    369.28412125423023, 247.4643914606113};
+  std::vector<double> distortion_coeffs = {-0.2827194127325638,
+                                           0.07433133599948077,
+                                           0.0004437263089959797,
+                                           -0.0005373178971205249, 0};
+  cv::Size img_size(752, 480);
+
+  cv::Mat src(img_size, CV_8UC3);
+  cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::Mat k = (cv::Mat_<double>(3, 3) << intrinsics[0], 0, intrinsics[2], 0,
+               intrinsics[1], intrinsics[3], 0, 0, 1);
+  cv::Mat d = cv::Mat(distortion_coeffs, true).reshape(1, 1);
+  cv::Mat dst;
+
+  double undistort_ms =
+      run_ms([&]() { cv::undistort(src, dst, k, d); }, iterations);
+
+  CameraUndistorter full(intrinsics, distortion_coeffs, img_size);
+  full.init();
+  double remap_1_ms = run_ms([&]() { full.correct(src, &dst, 1); }, iterations);
+  double remap_n_ms = run_ms([&]() { full.correct(src, &dst); }, iterations);
+
+  // 去畸变 + 缩放到检测器输入宽度
+  CameraUndistorter fused(intrinsics, distortion_coeffs, img_size);
+  fused.init(cv::Rect(), cv::Size(512, 327));
+  double fused_ms = run_ms([&]() { fused.correct(src, &dst); }, iterations);
+  cv::Mat resized;
+  double separate_ms = run_ms(
+      [&]() {
+        full.correct(src, &dst);
+        cv::resize(dst, resized, cv::Size(512, 327));
+      },
+      iterations);
+
+  CameraUndistorter points_only(intrinsics, distortion_coeffs, img_size);
+  points_only.init(cv::Rect(), cv::Size(), false);
+  cv::Rect bbox(300, 100, 60, 180);
+  double rect_ms = run_ms([&]() { points_only.undistort_rect(bbox); },
+                          iterations * 100);
+
+  std::cout << "img_size " << img_size << " threads " << cv::getNumThreads()
+            << " iterations " << iterations << std::endl;
+  std::cout << "cv::undistort per frame      : " << undistort_ms << " ms"
+            << std::endl;
+  std::cout << "remap 16SC2, 1 stripe        : " << remap_1_ms << " ms"
+            << std::endl;
+  std::cout << "remap 16SC2, parallel        : " << remap_n_ms << " ms"
+            << std::endl;
+  std::cout << "undistort + resize separately: " << separate_ms << " ms"
+            << std::endl;
+  std::cout << "undistort + resize fused     : " << fused_ms << " ms"
+            << std::endl;
+  std::cout << "bbox corners only            : " << rect_ms * 1000.0 << " us"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 16:35:18
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 16:35:18
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/include/common_utils/async_logger.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+enum class LogLevel : int { kDebug = 0, kInfo, kWarn, kError, kFatal };
+
+/**
+ * @description: 解析日志级别名称 debug/info/warn/error/fatal
+ * @return {bool} : 名称无法识别时返回false
+ */
+bool parse_log_level(const std::string &name, LogLevel *level);
+const char *log_level_name(LogLevel level);
+
+struct LogRecord {
+  LogLevel level = LogLevel::kInfo;
+  int64_t wall_ns = 0; // system_clock, 提交时刻
+  int tid = 0;
+  std::string text;
+};
+
+/**
+ * @description: 单个调用点的限频, 每 period_s 秒最多放行一条
+ * 只用原子操作, 被抑制的条数会在下一次放行时一起报告.
+ */
+class LogRateLimiter {
+public:
+  explicit LogRateLimiter(double period_s)
+      : period_ns_(static_cast<int64_t>(period_s * 1e9)) {}
+
+  // 返回true时可以输出, *suppressed 为上次输出以来被抑制的条数
+  bool allow(uint64_t *suppressed);
+
+private:
+  const int64_t period_ns_;
+  std::atomic<int64_t> next_ns_{0};
+  std::atomic<uint64_t> suppressed_{0};
+};
+
+/**
+ * @description: 异步日志
+ * 调用线程只把消息放进有界的无锁 MPSC 队列(Vyukov 环形队列), 不做任何 IO;
+ * 后台线程负责加时间戳/级别前缀并写到 sink. 队列满时直接丢弃并计数,
+ * 控制台或 journald 再慢也不会阻塞检测循环.
+ */
+class AsyncLogger {
+public:
+  // 在后台线程中调用, line 是已经加好前缀、不带换行的整行
+  typedef std::function<void(const LogRecord &record, const std::string &line)>
+      Sink;
+
+  static const size_t kQueueCapacity = 8192; // 必须是2的幂
+
+  static AsyncLogger &instance();
+
+  void set_level(LogLevel level) {
+    level_.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+  bool enabled(LogLevel level) const {
+    return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+  }
+  // 为空时恢复默认 sink: warn 及以上写 stderr, 其余写 stdout
+  void set_sink(Sink sink);
+
+  // 不阻塞, 队列满或已经关闭时丢弃
+  void log(LogLevel level, std::string text);
+
+  /**
+   * @description: 等待调用之前提交的日志全部写出, 例如进程退出或 fatal 之前
+   * @param {int} timeout_ms : 最长等待时间
+   * @return {bool} : 超时返回false
+   */
+  bool flush(int timeout_ms = 1000);
+  // 写出剩余日志并结束后台线程, 之后的日志被丢弃
+  void shutdown();
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence{0};
+    LogRecord record;
+  };
+
+  AsyncLogger();
+  ~AsyncLogger();
+  AsyncLogger(const AsyncLogger &) = delete;
+  AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+  bool try_push(LogRecord &&record);
+  bool try_pop(LogRecord *record);
+  void run();
+  size_t drain();
+  void write(const LogRecord &record);
+
+  std::unique_ptr<Cell[]> cells_;
+  // 生产者之间只竞争 enqueue_pos_, 消费者只有后台线程
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) size_t dequeue_pos_ = 0;
+
+  std::atomic<int> level_{static_cast<int>(LogLevel::kInfo)};
+  std::atomic<uint64_t> submitted_{0};
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> dropped_{0};
+  uint64_t reported_dropped_ = 0;
+
+  std::mutex sink_mutex_;
+  Sink sink_;
+
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cv_;
+  std::atomic<bool> waiting_{false};
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+#define ALOG_STREAM(level, args)                                               \
+  do {                                                                         \
+    if (AsyncLogger::instance().enabled(level)) {                              \
+      std::ostringstream alog_ss_;                                             \
+      alog_ss_ << args;                                                        \
+      AsyncLogger::instance().log(level, alog_ss_.str());                      \
+    }                                                                          \
+  } while (0)
+
+// 同一调用点每 period_s 秒最多输出一条
+#define ALOG_STREAM_THROTTLE(level, period_s, args)                            \
+  do {                                                                         \
+    static LogRateLimiter alog_limiter_(period_s);                             \
+    uint64_t alog_suppressed_ = 0;                                             \
+    if (AsyncLogger::instance().enabled(level) &&                              \
+        alog_limiter_.allow(&alog_suppressed_)) {                              \
+      std::ostringstream alog_ss_;                                             \
+      alog_ss_ << args;                                                        \
+      if (alog_suppressed_ > 0) {                                              \
+        alog_ss_ << " (" << alog_suppressed_ << " similar messages suppressed)"; \
+      }                                                                        \
+      AsyncLogger::instance().log(level, alog_ss_.str());                      \
+    }                                                                          \
+  } while (0)
+
+#define ALOG_DEBUG_STREAM(args) ALOG_STREAM(LogLevel::kDebug, args)
+#define ALOG_INFO_STREAM(args) ALOG_STREAM(LogLevel::kInfo, args)
+#define ALOG_WARN_STREAM(args) ALOG_STREAM(LogLevel::kWarn, args)
+#define ALOG_ERROR_STREAM(args) ALOG_STREAM(LogLevel::kError, args)
+#define ALOG_DEBUG_STREAM_THROTTLE(period_s, args)                             \
+  ALOG_STREAM_THROTTLE(LogLevel::kDebug, period_s, args)
+#define ALOG_INFO_STREAM_THROTTLE(period_s, args)                              \
+  ALOG_STREAM_THROTTLE(LogLevel::kInfo, period_s, args)
+#define ALOG_WARN_STREAM_THROTTLE(period_s, args)                              \
+  ALOG_STREAM_THROTTLE(LogLevel::kWarn, period_s, args)
+#define ALOG_ERROR_STREAM_THROTTLE(period_s, args)                             \
+  ALOG_STREAM_THROTTLE(LogLevel::kError, period_s, args)
@@ -0,0 +1,80 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 11:02:36
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 11:02:36
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/include/common_utils/camera_undistorter.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// c++ system headers
+#include <vector>
+// third party header
+// opencv
+#include "opencv2/opencv.hpp"
+
+/**
+ * @description: pinhole + radtan 去畸变
+ * 在 init 时一次性生成 CV_16SC2 定点格式的映射表(可以同时完成裁剪和缩放),
+ * 之后每帧只需要按行分块并行的 remap. 只需要bbox角点时可以不做整帧去畸变,
+ * 直接使用 undistort_points / undistort_rect.
+ */
+class CameraUndistorter {
+public:
+  /**
+   * @param {std::vector<double>} intrinsics : fx fy cx cy
+   * @param {std::vector<double>} distortion_coeffs : k1 k2 p1 p2 [k3]
+   * @param {cv::Size} img_size : 原始图像尺寸
+   */
+  CameraUndistorter(const std::vector<double> &intrinsics,
+                    const std::vector<double> &distortion_coeffs,
+                    cv::Size img_size)
+      : intrinsics_(intrinsics), distortion_coeffs_(distortion_coeffs),
+        img_size_(img_size) {}
+
+  /**
+   * @description: 生成映射表
+   * @param {cv::Rect} crop : 去畸变后保留的区域(原图坐标), 为空时保留整幅图像
+   * @param {cv::Size} output_size : 输出尺寸, 为空时与crop相同, 否则在remap中同时缩放
+   * @param {bool} build_maps : 为false时只用于点的去畸变, 不生成整帧映射表
+   * @return {bool} : 参数错误时返回false
+   */
+  bool init(cv::Rect crop = cv::Rect(), cv::Size output_size = cv::Size(),
+            bool build_maps = true);
+
+  /**
+   * @description: 整帧去畸变, dst 的内存在尺寸不变时会被复用
+   * @param {int} stripes : 按行分块的数量, <=0 时使用 cv::getNumThreads()
+   */
+  void correct(const cv::Mat &src, cv::Mat *dst, int stripes = 0) const;
+
+  /**
+   * @description: 原图中的像素点 -> 去畸变后输出图像中的像素点
+   */
+  void undistort_points(const std::vector<cv::Point2f> &src,
+                        std::vector<cv::Point2f> *dst) const;
+
+  /**
+   * @description: 对bbox的四个角点去畸变, 返回包围它们的矩形(输出图像坐标)
+   */
+  cv::Rect2f undistort_rect(const cv::Rect &rect) const;
+
+  cv::Size output_size() const { return output_size_; }
+  const cv::Mat &output_camera_matrix() const { return output_k_; }
+
+private:
+  std::vector<double> intrinsics_;
+  std::vector<double> distortion_coeffs_;
+  cv::Size img_size_;
+  cv::Size output_size_;
+
+  cv::Mat k_;        // 原始内参
+  cv::Mat d_;        // 畸变系数
+  cv::Mat output_k_; // 包含裁剪和缩放的输出内参
+  cv::Mat map1_;     // CV_16SC2, 整数坐标
+  cv::Mat map2_;     // CV_16UC1, 插值系数索引
+};
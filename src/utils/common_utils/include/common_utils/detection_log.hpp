@@ -0,0 +1,194 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 21:18:40
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 21:18:40
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/include/common_utils/detection_log.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * 检测结果日志(.crlog), 只追加, 写入和读取都通过 mmap
+ *   [文件头 | 相机名] [块] [块] ...
+ * 每个块以 DetectionLogBlockHeader 开头:
+ *   数据块: 最多 rows_per_block 行, 按列存放
+ *           行: stamp_ns(i64) publish_ns(i64) seq(u32) camera(u8) flags(u8) object_count(u16)
+ *           目标: x y w h(i16) prob(f32) depth(f32) class(u8)
+ *           每列按 8 字节对齐, 块头记录块内 stamp 的最小/最大值
+ *   索引块: 前面若干个数据块的 {偏移, 最小/最大 stamp, 行数} 和上一个索引块的偏移,
+ *           文件头中的 last_index_offset 指向最新的索引块
+ * 进程异常退出时文件末尾是预分配的 0, 读取时遇到无效的块头即停止,
+ * 最后一个索引块之后的数据块通过顺序遍历块头找到.
+ */
+
+constexpr uint64_t kDetectionLogMagic = 0x31474f4c52432e; // ".CRLOG1"
+constexpr uint32_t kDetectionLogVersion = 1;
+
+enum DetectionLogBlockType : uint32_t {
+  kDetectionLogDataBlock = 0x41544144,  // "DATA"
+  kDetectionLogIndexBlock = 0x58444e49, // "INDX"
+};
+
+enum DetectionLogFlags : uint8_t {
+  kDetectionLogSomeone = 1,  // 该相机判断为有人
+  kDetectionLogKeyframe = 2, // 保存了关键帧图像
+};
+
+struct DetectionLogFileHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t header_bytes; // 文件头 + 相机名, 第一个块的偏移
+  uint32_t camera_count;
+  uint32_t names_bytes; // 相机名以 '\n' 分隔
+  int64_t created_ns;
+  uint64_t last_index_offset; // 0 表示还没有索引块
+};
+
+struct DetectionLogBlockHeader {
+  uint32_t type;
+  uint32_t rows;
+  uint64_t payload_bytes; // 不含块头
+  int64_t min_stamp_ns;
+  int64_t max_stamp_ns;
+};
+
+// 索引块中的一项, 写入和读取共用同一个结构, 文件中为 32 字节
+struct DetectionLogIndexEntry {
+  uint64_t offset; // 数据块块头的偏移
+  int64_t min_stamp_ns;
+  int64_t max_stamp_ns;
+  uint32_t rows;
+  uint32_t reserved;
+};
+static_assert(sizeof(DetectionLogIndexEntry) == 32,
+              "DetectionLogIndexEntry is part of the .crlog format");
+
+struct DetectionLogObject {
+  int16_t x = 0;
+  int16_t y = 0;
+  int16_t w = 0;
+  int16_t h = 0;
+  float prob = 0;
+  float depth = -1;
+  uint8_t cls = 0;
+};
+
+struct DetectionLogRow {
+  int64_t stamp_ns = 0;   // 图像采集时间
+  int64_t publish_ns = 0; // 结果发布时间
+  uint32_t seq = 0;       // CR 按相机分配的帧序号
+  uint8_t camera = 0;
+  uint8_t flags = 0;
+  std::vector<DetectionLogObject> objects;
+};
+
+class DetectionLogWriter {
+public:
+  DetectionLogWriter() = default;
+  ~DetectionLogWriter();
+  DetectionLogWriter(const DetectionLogWriter &) = delete;
+  DetectionLogWriter &operator=(const DetectionLogWriter &) = delete;
+
+  /**
+   * @description: 新建日志文件, 已存在时覆盖
+   * @param {string} path : 文件路径
+   * @param {std::vector<std::string>} camera_names : 相机名, 行中的 camera 为下标
+   * @param {int} rows_per_block : 每个数据块的行数
+   * @param {int} index_interval : 每隔多少个数据块写一个索引块
+   */
+  bool open(const std::string &path,
+            const std::vector<std::string> &camera_names,
+            int rows_per_block = 256, int index_interval = 16);
+  // 追加一行, 攒满一个块时写入文件
+  bool append(const DetectionLogRow &row);
+  // 写出未满的数据块和索引块, 数据对其它进程的 mmap 立即可见
+  bool flush();
+  // flush 后截掉预分配的部分
+  void close();
+
+  bool is_open() const { return fd_ >= 0; }
+  // 已写入文件的字节数(不含缓存中的行)
+  uint64_t bytes() const { return size_; }
+
+private:
+  bool write_block(uint32_t type, uint32_t rows, int64_t min_stamp_ns,
+                   int64_t max_stamp_ns, const std::vector<uint8_t> &payload);
+  bool reserve(uint64_t bytes);
+  bool write_data_block();
+  bool write_index_block();
+
+  int fd_ = -1;
+  uint8_t *map_ = nullptr;
+  uint64_t capacity_ = 0;
+  uint64_t size_ = 0;
+  int rows_per_block_ = 256;
+  int index_interval_ = 16;
+
+  // 当前数据块的各列, 写入后清空内容保留容量
+  std::vector<int64_t> stamp_ns_;
+  std::vector<int64_t> publish_ns_;
+  std::vector<uint32_t> seq_;
+  std::vector<uint8_t> camera_;
+  std::vector<uint8_t> flags_;
+  std::vector<uint16_t> object_count_;
+  std::vector<DetectionLogObject> objects_;
+  std::vector<uint8_t> payload_;
+
+  std::vector<DetectionLogIndexEntry> pending_index_;
+  uint64_t last_index_offset_ = 0;
+};
+
+class DetectionLogReader {
+public:
+  DetectionLogReader() = default;
+  ~DetectionLogReader();
+  DetectionLogReader(const DetectionLogReader &) = delete;
+  DetectionLogReader &operator=(const DetectionLogReader &) = delete;
+
+  bool open(const std::string &path);
+  void close();
+
+  const std::vector<std::string> &camera_names() const { return camera_names_; }
+  int64_t created_ns() const { return created_ns_; }
+  // 文件中所有行的 stamp 范围, 没有数据时均为0
+  int64_t min_stamp_ns() const { return min_stamp_ns_; }
+  int64_t max_stamp_ns() const { return max_stamp_ns_; }
+  uint64_t rows() const { return rows_; }
+  size_t blocks() const { return blocks_.size(); }
+
+  /**
+   * @description: 按块遍历 stamp 在 [begin_ns, end_ns] 内的行, 范围不相交的块直接跳过
+   * @param {function} fn : 每行调用一次, 返回 false 时停止
+   * @return {uint64_t} 遍历的行数
+   */
+  uint64_t scan(int64_t begin_ns, int64_t end_ns,
+                const std::function<bool(const DetectionLogRow &)> &fn) const;
+
+private:
+  typedef DetectionLogIndexEntry Block;
+
+  const DetectionLogBlockHeader *block_at(uint64_t offset) const;
+  bool load_index(uint64_t index_offset, uint64_t *tail_offset);
+  void walk_blocks(uint64_t offset);
+
+  int fd_ = -1;
+  const uint8_t *map_ = nullptr;
+  uint64_t size_ = 0;
+  std::vector<std::string> camera_names_;
+  int64_t created_ns_ = 0;
+  std::vector<Block> blocks_;
+  int64_t min_stamp_ns_ = 0;
+  int64_t max_stamp_ns_ = 0;
+  uint64_t rows_ = 0;
+};
@@ -0,0 +1,82 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 17:20:41
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 17:20:41
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/include/common_utils/frame_pool.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+// third party headers
+// opencv
+#include "opencv2/core.hpp"
+
+struct FramePoolStats {
+  uint64_t allocations = 0; // 向系统申请新内存的次数, 稳定运行后不再增长
+  uint64_t reuses = 0;      // 直接复用池中内存的次数
+  uint64_t releases = 0;    // 超出缓存上限而真正释放的次数
+  size_t cached_bytes = 0;  // 池中空闲内存
+  size_t in_use_bytes = 0;  // 正在被 Mat 使用的内存
+};
+
+/**
+ * @description: 图像内存池, 作为 cv::Mat 的 allocator 使用
+ * Mat 释放时内存(连同 UMatData)按字节数放回池中, 下一次相同大小的 create
+ * 直接取出, 固定分辨率的多路相机稳定运行后不再有图像大小的堆分配.
+ * 用法: 在 Mat 为空时设置 mat.allocator = &FramePool::instance(), 之后的
+ * create/copyTo/swap 都会沿用该 allocator.
+ */
+class FramePool : public cv::MatAllocator {
+public:
+#if CV_VERSION_MAJOR >= 4
+  typedef cv::AccessFlag AccessFlags;
+#else
+  typedef int AccessFlags;
+#endif
+
+  static FramePool &instance();
+
+  // 空闲内存超过该值时, 多余的块直接释放
+  void set_max_cached_bytes(size_t bytes);
+  FramePoolStats stats() const;
+  // 释放全部空闲内存
+  void trim();
+
+  cv::UMatData *allocate(int dims, const int *sizes, int type, void *data,
+                         size_t *step, AccessFlags flags,
+                         cv::UMatUsageFlags usage_flags) const override;
+  bool allocate(cv::UMatData *data, AccessFlags access_flags,
+                cv::UMatUsageFlags usage_flags) const override;
+  void deallocate(cv::UMatData *data) const override;
+
+private:
+  FramePool() = default;
+  ~FramePool();
+
+  struct Block {
+    void *header; // 已析构的 UMatData 的内存, 复用时原地构造
+    uchar *data;
+  };
+
+  mutable std::mutex mutex_;
+  mutable std::map<size_t, std::vector<Block>> free_blocks_; // key : 字节数
+  mutable FramePoolStats stats_;
+  size_t max_cached_bytes_ = 256u << 20;
+};
+
+/**
+ * @description: 让空的 Mat 使用内存池, 已经分配的 Mat 在下一次重新分配时生效
+ * @param {cv::Mat*} mat : 需要使用内存池的图像
+ */
+inline void use_frame_pool(cv::Mat *mat) {
+  mat->allocator = &FramePool::instance();
+}
@@ -0,0 +1,139 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 15:02:44
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 15:02:44
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/include/common_utils/metrics.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef std::vector<std::pair<std::string, std::string>> MetricLabels;
+
+class MetricCounter {
+public:
+  void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value_{0};
+};
+
+class MetricGauge {
+public:
+  void set(double value) { value_.store(value, std::memory_order_relaxed); }
+  double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<double> value_{0.0};
+};
+
+struct HistogramSnapshot {
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t min = 0;
+  uint64_t max = 0;
+  std::vector<uint64_t> buckets;
+
+  double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0.0; }
+  // q 取 [0, 1], 返回所在桶的中间值, 相对误差不超过 1/16
+  double percentile(double q) const;
+  // 两次快照之间新增的部分, 用于计算最近一个周期的分位数
+  HistogramSnapshot since(const HistogramSnapshot &earlier) const;
+};
+
+/**
+ * @description: HDR风格的对数-线性直方图, 只记录非负整数(例如微秒)
+ * 每个2的幂区间再均分为8个桶, 任意量级的相对误差都在12.5%以内.
+ * record 只有几次 relaxed 原子操作, 可以在任意线程中调用.
+ */
+class LatencyHistogram {
+public:
+  static const int kSubBucketBits = 3;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  static const int kMaxExponent = 40; // 2^40 us 约 12 天, 更大的值记在最后一个桶
+  static const int kNumBuckets =
+      kSubBuckets + (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram();
+
+  void record(uint64_t value);
+  HistogramSnapshot snapshot() const;
+
+  static int bucket_index(uint64_t value);
+  static uint64_t bucket_lower(int index);
+  static uint64_t bucket_upper(int index); // 不包含
+
+private:
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> min_{UINT64_MAX};
+  std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * @description: 进程内的指标注册表
+ * 按 名字+标签 注册, 返回的指针在进程生命周期内有效, 调用方应缓存指针,
+ * 只在初始化时查找. 导出时遍历所有指标, 可以写成 Prometheus 文本格式.
+ */
+class MetricsRegistry {
+public:
+  enum MetricType { kCounter, kGauge, kHistogram };
+  struct Entry {
+    std::string name;
+    MetricLabels labels;
+    std::string help;
+    MetricType type;
+    std::unique_ptr<MetricCounter> counter;
+    std::unique_ptr<MetricGauge> gauge;
+    std::unique_ptr<LatencyHistogram> histogram;
+  };
+
+  static MetricsRegistry &instance();
+
+  MetricCounter *counter(const std::string &name,
+                         const MetricLabels &labels = MetricLabels(),
+                         const std::string &help = std::string());
+  MetricGauge *gauge(const std::string &name,
+                     const MetricLabels &labels = MetricLabels(),
+                     const std::string &help = std::string());
+  LatencyHistogram *histogram(const std::string &name,
+                              const MetricLabels &labels = MetricLabels(),
+                              const std::string &help = std::string());
+
+  void visit(const std::function<void(const Entry &)> &visitor) const;
+
+  /**
+   * @description: 写 Prometheus 文本格式(直方图导出为 summary), 先写临时文件再改名,
+   * 可以直接给 node_exporter 的 textfile collector 读取
+   * @param {std::string} path : 输出文件
+   * @return {bool} : 写入失败返回false
+   */
+  bool write_prometheus(const std::string &path) const;
+
+private:
+  MetricsRegistry() = default;
+  Entry *find_or_create(const std::string &name, const MetricLabels &labels,
+                        const std::string &help, MetricType type);
+
+  mutable std::mutex mutex_;
+  std::deque<Entry> entries_; // deque 追加时不移动已有元素
+  std::map<std::string, Entry *> index_;
+};
@@ -34,6 +34,14 @@ void filiter_by_contour_area(std::vector<std::vector<cv::Point>> *contours,
  */
 cv::Mat resize_img(const cv::Mat &img, int output_w, int output_h);
 
+/**
+ * @description: 同上, 结果写入调用方持有的缓存, 尺寸不变时不重新分配内存
+ * @param {cv::Mat*} out : output_w*output_h 的输出图像
+ * @param {cv::Mat*} resized : 缩放后的中间图像
+ */
+void resize_img(const cv::Mat &img, int output_w, int output_h, cv::Mat *out,
+                cv::Mat *resized);
+
 /**
  * @description:
  * 计算检测出的bbox在输入的原图中的坐标(输入检测的图像被resize_img函数无畸变的resize至input_width*input_height，所以检测出的bbox需要变换回真实的bbox)
@@ -11,7 +11,9 @@
 #pragma once
 // c system headers
 #include <dirent.h>
+#include <sys/stat.h>
 // c++ system headers
+#include <cerrno>
 #include <string>
 #include <vector>
 // third party headers
@@ -25,3 +27,17 @@
  * @return {int} : status
  */
 int read_file_from_dir(const char *p_dir_name, std::vector<std::string> *file_names);
+
+/**
+ * @description: 逐级创建文件夹, 已存在时也返回 true
+ * @param {std::string} dir : 文件夹路径
+ * @return {bool} : status
+ */
+bool make_dirs(const std::string &dir);
+
+/**
+ * @description: 话题名转成可以用作文件名的字符串, "/front/image_raw" -> "front_image_raw"
+ * @param {std::string} name : 话题名
+ * @return {std::string} : 文件名
+ */
+std::string file_safe_name(const std::string &name);
@@ -0,0 +1,117 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 14:20:07
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 14:20:07
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/include/common_utils/trace.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// cpp system headers
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @description: 轻量级耗时追踪
+ * 每个线程写自己的环形缓存(单写者, 无锁), 只在 dump 时加锁遍历所有线程的缓存,
+ * 导出为 Chrome trace JSON, 用 chrome://tracing 或 ui.perfetto.dev 打开.
+ * 编译时定义 DISABLE_TRACE 后 TRACE_SCOPE 等宏展开为空, 没有任何开销.
+ */
+struct TraceEvent {
+  const char *name = nullptr; // 只能是字符串常量, 不做拷贝
+  int64_t begin_ns = 0;       // steady_clock
+  int64_t end_ns = 0;
+  int32_t arg = -1;           // 例如相机序号, -1 表示没有
+};
+
+class TraceRecorder {
+public:
+  static TraceRecorder &instance();
+
+  // 运行时开关, 关闭时 ScopedTrace 只读一次原子变量
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // 之后新建的线程缓存的事件数
+  void set_buffer_capacity(size_t capacity);
+  // 当前线程在trace中显示的名字
+  void set_thread_name(const std::string &name);
+
+  void record(const char *name, int64_t begin_ns, int64_t end_ns, int32_t arg);
+
+  /**
+   * @description: 把所有线程缓存中的事件导出为 Chrome trace JSON
+   * @param {std::string} path : 输出文件
+   * @return {bool} : 文件写入失败返回false
+   */
+  bool dump_chrome_trace(const std::string &path);
+
+  static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+private:
+  struct ThreadBuffer {
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> head{0}; // 已写入的事件总数
+    int tid = 0;
+    std::string thread_name;
+  };
+
+  TraceRecorder() = default;
+  ThreadBuffer *thread_buffer();
+
+  std::atomic<bool> enabled_{true};
+  std::atomic<size_t> capacity_{16384};
+  std::mutex mutex_;
+  // 线程退出后缓存仍然保留, dump 时可以看到已退出线程的事件
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+};
+
+class ScopedTrace {
+public:
+  explicit ScopedTrace(const char *name, int32_t arg = -1)
+      : name_(TraceRecorder::instance().enabled() ? name : nullptr),
+        arg_(arg), begin_ns_(name_ ? TraceRecorder::now_ns() : 0) {}
+  ~ScopedTrace() {
+    if (name_ != nullptr) {
+      TraceRecorder::instance().record(name_, begin_ns_,
+                                       TraceRecorder::now_ns(), arg_);
+    }
+  }
+  ScopedTrace(const ScopedTrace &) = delete;
+  ScopedTrace &operator=(const ScopedTrace &) = delete;
+
+private:
+  const char *name_;
+  int32_t arg_;
+  int64_t begin_ns_;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef DISABLE_TRACE
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_ARG(name, arg)
+#define TRACE_THREAD_NAME(name)
+#else
+// 记录当前作用域的耗时, name 必须是字符串常量
+#define TRACE_SCOPE(name) \
+  ScopedTrace TRACE_CONCAT(trace_scope_, __COUNTER__)(name)
+#define TRACE_SCOPE_ARG(name, arg) \
+  ScopedTrace TRACE_CONCAT(trace_scope_, __COUNTER__)(name, arg)
+#define TRACE_THREAD_NAME(name) \
+  TraceRecorder::instance().set_thread_name(name)
+#endif
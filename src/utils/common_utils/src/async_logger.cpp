@@ -0,0 +1,288 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 16:35:18
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 16:35:18
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/src/async_logger.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+// cpp system headers
+#include <chrono>
+#include <cstdio>
+// local headers
+#include "common_utils/async_logger.hpp"
+
+namespace {
+
+int current_tid() {
+  thread_local int tid = static_cast<int>(syscall(SYS_gettid));
+  return tid;
+}
+
+int64_t steady_now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+char level_tag(LogLevel level) {
+  switch (level) {
+  case LogLevel::kDebug:
+    return 'D';
+  case LogLevel::kInfo:
+    return 'I';
+  case LogLevel::kWarn:
+    return 'W';
+  case LogLevel::kError:
+    return 'E';
+  default:
+    return 'F';
+  }
+}
+
+// [I] [2022-05-16 10:40:54.123] [tid] text
+std::string format_line(const LogRecord &record) {
+  const time_t sec = static_cast<time_t>(record.wall_ns / 1000000000);
+  const int ms = static_cast<int>((record.wall_ns / 1000000) % 1000);
+  struct tm tm_local;
+  localtime_r(&sec, &tm_local);
+  char prefix[64];
+  const size_t n = strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S",
+                            &tm_local);
+  char head[128];
+  std::snprintf(head, sizeof(head), "[%c] [%.*s.%03d] [%d] ",
+                level_tag(record.level),
+                static_cast<int>(n), prefix, ms, record.tid);
+  return std::string(head) + record.text;
+}
+
+void default_sink(const LogRecord &record, const std::string &line) {
+  FILE *out = record.level >= LogLevel::kWarn ? stderr : stdout;
+  std::fwrite(line.data(), 1, line.size(), out);
+  std::fputc('\n', out);
+}
+
+} // namespace
+
+bool parse_log_level(const std::string &name, LogLevel *level) {
+  if (name == "debug") {
+    *level = LogLevel::kDebug;
+  } else if (name == "info") {
+    *level = LogLevel::kInfo;
+  } else if (name == "warn") {
+    *level = LogLevel::kWarn;
+  } else if (name == "error") {
+    *level = LogLevel::kError;
+  } else if (name == "fatal") {
+    *level = LogLevel::kFatal;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *log_level_name(LogLevel level) {
+  switch (level) {
+  case LogLevel::kDebug:
+    return "debug";
+  case LogLevel::kInfo:
+    return "info";
+  case LogLevel::kWarn:
+    return "warn";
+  case LogLevel::kError:
+    return "error";
+  case LogLevel::kFatal:
+    return "fatal";
+  default:
+    return "unknown";
+  }
+}
+
+/////////////////////////////// LogRateLimiter ///////////////////////////////
+
+bool LogRateLimiter::allow(uint64_t *suppressed) {
+  const int64_t now = steady_now_ns();
+  int64_t next = next_ns_.load(std::memory_order_relaxed);
+  // 多个线程同时到期时只有CAS成功的一个放行
+  if (now < next || !next_ns_.compare_exchange_strong(
+                        next, now + period_ns_, std::memory_order_relaxed)) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+/////////////////////////////// AsyncLogger ///////////////////////////////
+
+AsyncLogger &AsyncLogger::instance() {
+  static AsyncLogger logger;
+  return logger;
+}
+
+AsyncLogger::AsyncLogger() : cells_(new Cell[kQueueCapacity]) {
+  static_assert((kQueueCapacity & (kQueueCapacity - 1)) == 0,
+                "kQueueCapacity must be a power of two");
+  for (size_t i = 0; i < kQueueCapacity; ++i) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  thread_ = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger() { shutdown(); }
+
+void AsyncLogger::set_sink(Sink sink) {
+  std::lock_guard<std::mutex> lock(sink_mutex_);
+  sink_ = std::move(sink);
+}
+
+void AsyncLogger::log(LogLevel level, std::string text) {
+  if (!enabled(level)) {
+    return;
+  }
+  if (stop_.load(std::memory_order_relaxed)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  LogRecord record;
+  record.level = level;
+  record.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+  record.tid = current_tid();
+  record.text = std::move(text);
+  if (!try_push(std::move(record))) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  submitted_.fetch_add(1, std::memory_order_release);
+  // 后台线程空闲时才唤醒, notify 不持有锁, 不会阻塞
+  if (waiting_.load(std::memory_order_acquire)) {
+    wait_cv_.notify_one();
+  }
+}
+
+bool AsyncLogger::try_push(LogRecord &&record) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell &cell = cells_[pos & (kQueueCapacity - 1)];
+    const size_t seq = cell.sequence.load(std::memory_order_acquire);
+    const intptr_t diff =
+        static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        cell.record = std::move(record);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false; // 队列已满
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool AsyncLogger::try_pop(LogRecord *record) {
+  Cell &cell = cells_[dequeue_pos_ & (kQueueCapacity - 1)];
+  const size_t seq = cell.sequence.load(std::memory_order_acquire);
+  if (seq != dequeue_pos_ + 1) {
+    return false;
+  }
+  *record = std::move(cell.record);
+  cell.record.text.clear();
+  cell.sequence.store(dequeue_pos_ + kQueueCapacity, std::memory_order_release);
+  ++dequeue_pos_;
+  return true;
+}
+
+bool AsyncLogger::flush(int timeout_ms) {
+  const uint64_t target = submitted_.load(std::memory_order_acquire);
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (written_.load(std::memory_order_acquire) < target) {
+    if (!thread_.joinable() || std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    wait_cv_.notify_one();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+void AsyncLogger::shutdown() {
+  if (stop_.exchange(true)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cv_.notify_one();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void AsyncLogger::run() {
+  for (;;) {
+    if (drain() > 0) {
+      continue;
+    }
+    if (stop_.load(std::memory_order_acquire)) {
+      drain();
+      return;
+    }
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    waiting_.store(true, std::memory_order_seq_cst);
+    // 生产者可能在设置 waiting_ 之前入队, 定时醒来兜底
+    wait_cv_.wait_for(lock, std::chrono::milliseconds(20));
+    waiting_.store(false, std::memory_order_relaxed);
+  }
+}
+
+size_t AsyncLogger::drain() {
+  size_t count = 0;
+  LogRecord record;
+  std::lock_guard<std::mutex> lock(sink_mutex_);
+  while (try_pop(&record)) {
+    write(record);
+    written_.fetch_add(1, std::memory_order_release);
+    ++count;
+  }
+  const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+  if (dropped != reported_dropped_) {
+    LogRecord report;
+    report.level = LogLevel::kWarn;
+    report.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+    report.tid = current_tid();
+    report.text = "[ AsyncLogger ] queue full, dropped " +
+                  std::to_string(dropped - reported_dropped_) + " messages";
+    reported_dropped_ = dropped;
+    write(report);
+  }
+  if (count > 0 && !sink_) {
+    std::fflush(stdout);
+    std::fflush(stderr);
+  }
+  return count;
+}
+
+void AsyncLogger::write(const LogRecord &record) {
+  const std::string line = format_line(record);
+  if (sink_) {
+    sink_(record, line);
+  } else {
+    default_sink(record, line);
+  }
+}
@@ -0,0 +1,104 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 11:02:36
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 11:02:36
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/src/camera_undistorter.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <algorithm>
+// local headers
+#include "common_utils/camera_undistorter.hpp"
+
+bool CameraUndistorter::init(cv::Rect crop, cv::Size output_size,
+                             bool build_maps) {
+  if (intrinsics_.size() != 4 || distortion_coeffs_.size() < 4 ||
+      img_size_.area() <= 0) {
+    return false;
+  }
+  k_ = (cv::Mat_<double>(3, 3) << intrinsics_[0], 0, intrinsics_[2], 0,
+        intrinsics_[1], intrinsics_[3], 0, 0, 1);
+  d_ = cv::Mat(distortion_coeffs_, true).reshape(1, 1);
+
+  if (crop.area() <= 0) {
+    crop = cv::Rect(cv::Point(0, 0), img_size_);
+  }
+  crop &= cv::Rect(cv::Point(0, 0), img_size_);
+  if (crop.area() <= 0) {
+    return false;
+  }
+  output_size_ = output_size.area() > 0 ? output_size : crop.size();
+
+  // 把裁剪和缩放合并到输出内参中, remap 一次完成去畸变+裁剪+缩放
+  double sx = static_cast<double>(output_size_.width) / crop.width;
+  double sy = static_cast<double>(output_size_.height) / crop.height;
+  output_k_ = k_.clone();
+  output_k_.at<double>(0, 0) *= sx;
+  output_k_.at<double>(1, 1) *= sy;
+  output_k_.at<double>(0, 2) =
+      (intrinsics_[2] - crop.x + 0.5) * sx - 0.5;
+  output_k_.at<double>(1, 2) =
+      (intrinsics_[3] - crop.y + 0.5) * sy - 0.5;
+
+  if (build_maps) {
+    cv::initUndistortRectifyMap(k_, d_, cv::Mat(), output_k_, output_size_,
+                                CV_16SC2, map1_, map2_);
+  }
+  return true;
+}
+
+void CameraUndistorter::correct(const cv::Mat &src, cv::Mat *dst,
+                                int stripes) const {
+  CV_Assert(!map1_.empty() && src.size() == img_size_);
+  CV_Assert(dst->data != src.data);
+  dst->create(output_size_, src.type());
+  if (stripes <= 0) {
+    stripes = std::max(cv::getNumThreads(), 1);
+  }
+  stripes = std::min(stripes, output_size_.height);
+
+  const int rows_per_stripe = (output_size_.height + stripes - 1) / stripes;
+  cv::Mat &out = *dst;
+  // 映射表里是绝对坐标, 每个分块只需要取对应行的映射表
+  cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range &range) {
+    for (int s = range.start; s < range.end; ++s) {
+      int row_begin = s * rows_per_stripe;
+      int row_end = std::min(row_begin + rows_per_stripe, output_size_.height);
+      if (row_begin >= row_end) {
+        continue;
+      }
+      cv::Mat out_stripe = out.rowRange(row_begin, row_end);
+      cv::remap(src, out_stripe, map1_.rowRange(row_begin, row_end),
+                map2_.rowRange(row_begin, row_end), cv::INTER_LINEAR,
+                cv::BORDER_CONSTANT);
+    }
+  });
+}
+
+void CameraUndistorter::undistort_points(const std::vector<cv::Point2f> &src,
+                                         std::vector<cv::Point2f> *dst) const {
+  if (src.empty()) {
+    dst->clear();
+    return;
+  }
+  cv::undistortPoints(src, *dst, k_, d_, cv::noArray(), output_k_);
+}
+
+cv::Rect2f CameraUndistorter::undistort_rect(const cv::Rect &rect) const {
+  std::vector<cv::Point2f> corners = {
+      cv::Point2f(rect.x, rect.y), cv::Point2f(rect.x + rect.width, rect.y),
+      cv::Point2f(rect.x, rect.y + rect.height),
+      cv::Point2f(rect.x + rect.width, rect.y + rect.height)};
+  std::vector<cv::Point2f> undistorted;
+  undistort_points(corners, &undistorted);
+  float l = std::min(undistorted[0].x, undistorted[2].x);
+  float r = std::max(undistorted[1].x, undistorted[3].x);
+  float t = std::min(undistorted[0].y, undistorted[1].y);
+  float b = std::max(undistorted[2].y, undistorted[3].y);
+  return cv::Rect2f(l, t, r - l, b - t);
+}
@@ -0,0 +1,520 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 21:18:40
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 21:18:40
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/src/detection_log.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// cpp system headers
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "common_utils/detection_log.hpp"
+
+namespace {
+
+constexpr uint64_t kGrowBytes = 4u << 20;
+
+uint64_t align8(uint64_t n) { return (n + 7) & ~static_cast<uint64_t>(7); }
+
+// 数据块内各列的偏移, 写入和读取共用
+struct DataBlockLayout {
+  uint64_t stamp, publish, seq, camera, flags, count;
+  uint64_t x, y, w, h, prob, depth, cls;
+  uint64_t total;
+};
+
+DataBlockLayout data_block_layout(uint64_t rows, uint64_t objects) {
+  DataBlockLayout l;
+  uint64_t offset = 0;
+  auto column = [&offset](uint64_t bytes) {
+    const uint64_t begin = offset;
+    offset += align8(bytes);
+    return begin;
+  };
+  l.stamp = column(rows * sizeof(int64_t));
+  l.publish = column(rows * sizeof(int64_t));
+  l.seq = column(rows * sizeof(uint32_t));
+  l.camera = column(rows * sizeof(uint8_t));
+  l.flags = column(rows * sizeof(uint8_t));
+  l.count = column(rows * sizeof(uint16_t));
+  l.x = column(objects * sizeof(int16_t));
+  l.y = column(objects * sizeof(int16_t));
+  l.w = column(objects * sizeof(int16_t));
+  l.h = column(objects * sizeof(int16_t));
+  l.prob = column(objects * sizeof(float));
+  l.depth = column(objects * sizeof(float));
+  l.cls = column(objects * sizeof(uint8_t));
+  l.total = offset;
+  return l;
+}
+
+template <typename T>
+void put_column(std::vector<uint8_t> *payload, uint64_t offset,
+                const std::vector<T> &values) {
+  if (!values.empty()) {
+    std::memcpy(payload->data() + offset, values.data(),
+                values.size() * sizeof(T));
+  }
+}
+
+// 目标按行存放在写入缓存中, 写块时按字段转置成列
+template <typename T, typename F>
+void put_object_column(std::vector<uint8_t> *payload, uint64_t offset,
+                       const std::vector<DetectionLogObject> &objects,
+                       F field) {
+  T *out = reinterpret_cast<T *>(payload->data() + offset);
+  for (size_t i = 0; i < objects.size(); i++) {
+    out[i] = field(objects[i]);
+  }
+}
+
+template <typename T>
+const T *column_at(const uint8_t *payload, uint64_t offset) {
+  return reinterpret_cast<const T *>(payload + offset);
+}
+
+} // namespace
+
+DetectionLogWriter::~DetectionLogWriter() { close(); }
+
+bool DetectionLogWriter::open(const std::string &path,
+                              const std::vector<std::string> &camera_names,
+                              int rows_per_block, int index_interval) {
+  close();
+  rows_per_block_ = std::max(rows_per_block, 1);
+  index_interval_ = std::max(index_interval, 1);
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    ALOG_ERROR_STREAM("[ DetectionLogWriter ] cannot open " << path << " : "
+                                                            << strerror(errno));
+    return false;
+  }
+  std::string names;
+  for (const std::string &name : camera_names) {
+    names += name;
+    names += '\n';
+  }
+  DetectionLogFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kDetectionLogMagic;
+  header.version = kDetectionLogVersion;
+  header.camera_count = static_cast<uint32_t>(camera_names.size());
+  header.names_bytes = static_cast<uint32_t>(names.size());
+  header.header_bytes =
+      static_cast<uint32_t>(align8(sizeof(header) + names.size()));
+  header.created_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+  size_ = 0;
+  if (!reserve(header.header_bytes)) {
+    close();
+    return false;
+  }
+  std::memcpy(map_, &header, sizeof(header));
+  std::memcpy(map_ + sizeof(header), names.data(), names.size());
+  size_ = header.header_bytes;
+  last_index_offset_ = 0;
+  pending_index_.clear();
+  return true;
+}
+
+bool DetectionLogWriter::reserve(uint64_t bytes) {
+  if (size_ + bytes <= capacity_) {
+    return true;
+  }
+  // 按 4MB 的整数倍预分配, 扩容时重新映射
+  const uint64_t capacity =
+      std::max(capacity_ * 2, (size_ + bytes + kGrowBytes - 1) / kGrowBytes *
+                                  kGrowBytes);
+  if (ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+    ALOG_ERROR_STREAM_THROTTLE(
+        5.0, "[ DetectionLogWriter ] ftruncate failed : " << strerror(errno));
+    return false;
+  }
+  void *map =
+      mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    ALOG_ERROR_STREAM_THROTTLE(
+        5.0, "[ DetectionLogWriter ] mmap failed : " << strerror(errno));
+    return false;
+  }
+  if (map_ != nullptr) {
+    munmap(map_, capacity_);
+  }
+  map_ = static_cast<uint8_t *>(map);
+  capacity_ = capacity;
+  return true;
+}
+
+bool DetectionLogWriter::append(const DetectionLogRow &row) {
+  if (fd_ < 0) {
+    return false;
+  }
+  stamp_ns_.push_back(row.stamp_ns);
+  publish_ns_.push_back(row.publish_ns);
+  seq_.push_back(row.seq);
+  camera_.push_back(row.camera);
+  flags_.push_back(row.flags);
+  const size_t count =
+      std::min<size_t>(row.objects.size(), std::numeric_limits<uint16_t>::max());
+  object_count_.push_back(static_cast<uint16_t>(count));
+  objects_.insert(objects_.end(), row.objects.begin(),
+                  row.objects.begin() + count);
+  if (static_cast<int>(stamp_ns_.size()) >= rows_per_block_) {
+    return write_data_block();
+  }
+  return true;
+}
+
+bool DetectionLogWriter::write_block(uint32_t type, uint32_t rows,
+                                     int64_t min_stamp_ns,
+                                     int64_t max_stamp_ns,
+                                     const std::vector<uint8_t> &payload) {
+  DetectionLogBlockHeader header;
+  header.type = type;
+  header.rows = rows;
+  header.payload_bytes = payload.size();
+  header.min_stamp_ns = min_stamp_ns;
+  header.max_stamp_ns = max_stamp_ns;
+  if (!reserve(sizeof(header) + payload.size())) {
+    return false;
+  }
+  // 先写内容再写块头, 读取方看到有效的块头时内容已经完整
+  if (!payload.empty()) {
+    std::memcpy(map_ + size_ + sizeof(header), payload.data(), payload.size());
+  }
+  std::memcpy(map_ + size_, &header, sizeof(header));
+  size_ += sizeof(header) + payload.size();
+  return true;
+}
+
+bool DetectionLogWriter::write_data_block() {
+  const uint32_t rows = static_cast<uint32_t>(stamp_ns_.size());
+  if (rows == 0) {
+    return true;
+  }
+  const DataBlockLayout l = data_block_layout(rows, objects_.size());
+  payload_.assign(l.total, 0);
+  put_column(&payload_, l.stamp, stamp_ns_);
+  put_column(&payload_, l.publish, publish_ns_);
+  put_column(&payload_, l.seq, seq_);
+  put_column(&payload_, l.camera, camera_);
+  put_column(&payload_, l.flags, flags_);
+  put_column(&payload_, l.count, object_count_);
+  put_object_column<int16_t>(&payload_, l.x, objects_,
+                             [](const DetectionLogObject &o) { return o.x; });
+  put_object_column<int16_t>(&payload_, l.y, objects_,
+                             [](const DetectionLogObject &o) { return o.y; });
+  put_object_column<int16_t>(&payload_, l.w, objects_,
+                             [](const DetectionLogObject &o) { return o.w; });
+  put_object_column<int16_t>(&payload_, l.h, objects_,
+                             [](const DetectionLogObject &o) { return o.h; });
+  put_object_column<float>(&payload_, l.prob, objects_,
+                           [](const DetectionLogObject &o) { return o.prob; });
+  put_object_column<float>(&payload_, l.depth, objects_,
+                           [](const DetectionLogObject &o) { return o.depth; });
+  put_object_column<uint8_t>(&payload_, l.cls, objects_,
+                             [](const DetectionLogObject &o) { return o.cls; });
+
+  const auto range = std::minmax_element(stamp_ns_.begin(), stamp_ns_.end());
+  const uint64_t offset = size_;
+  if (!write_block(kDetectionLogDataBlock, rows, *range.first, *range.second,
+                   payload_)) {
+    return false;
+  }
+  pending_index_.push_back(
+      DetectionLogIndexEntry{offset, *range.first, *range.second, rows, 0});
+
+  stamp_ns_.clear();
+  publish_ns_.clear();
+  seq_.clear();
+  camera_.clear();
+  flags_.clear();
+  object_count_.clear();
+  objects_.clear();
+  if (static_cast<int>(pending_index_.size()) >= index_interval_) {
+    return write_index_block();
+  }
+  return true;
+}
+
+bool DetectionLogWriter::write_index_block() {
+  if (pending_index_.empty()) {
+    return true;
+  }
+  const size_t entries_bytes =
+      pending_index_.size() * sizeof(DetectionLogIndexEntry);
+  payload_.resize(entries_bytes + sizeof(uint64_t));
+  std::memcpy(payload_.data(), pending_index_.data(), entries_bytes);
+  std::memcpy(payload_.data() + entries_bytes, &last_index_offset_,
+              sizeof(uint64_t));
+  int64_t min_stamp_ns = pending_index_.front().min_stamp_ns;
+  int64_t max_stamp_ns = pending_index_.front().max_stamp_ns;
+  for (const DetectionLogIndexEntry &entry : pending_index_) {
+    min_stamp_ns = std::min(min_stamp_ns, entry.min_stamp_ns);
+    max_stamp_ns = std::max(max_stamp_ns, entry.max_stamp_ns);
+  }
+  const uint64_t offset = size_;
+  if (!write_block(kDetectionLogIndexBlock,
+                   static_cast<uint32_t>(pending_index_.size()), min_stamp_ns,
+                   max_stamp_ns, payload_)) {
+    return false;
+  }
+  last_index_offset_ = offset;
+  reinterpret_cast<DetectionLogFileHeader *>(map_)->last_index_offset = offset;
+  pending_index_.clear();
+  return true;
+}
+
+bool DetectionLogWriter::flush() {
+  if (fd_ < 0) {
+    return false;
+  }
+  return write_data_block() && write_index_block();
+}
+
+void DetectionLogWriter::close() {
+  if (fd_ < 0) {
+    return;
+  }
+  flush();
+  if (map_ != nullptr) {
+    munmap(map_, capacity_);
+    map_ = nullptr;
+  }
+  // 去掉预分配的部分
+  if (ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+    ALOG_WARN_STREAM("[ DetectionLogWriter ] ftruncate failed : "
+                     << strerror(errno));
+  }
+  ::close(fd_);
+  fd_ = -1;
+  capacity_ = 0;
+  size_ = 0;
+}
+
+DetectionLogReader::~DetectionLogReader() { close(); }
+
+bool DetectionLogReader::open(const std::string &path) {
+  close();
+  fd_ = ::open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(DetectionLogFileHeader)) {
+    close();
+    return false;
+  }
+  size_ = static_cast<uint64_t>(st.st_size);
+  void *map = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    close();
+    return false;
+  }
+  map_ = static_cast<const uint8_t *>(map);
+  const DetectionLogFileHeader *header =
+      reinterpret_cast<const DetectionLogFileHeader *>(map_);
+  if (header->magic != kDetectionLogMagic ||
+      header->version != kDetectionLogVersion ||
+      header->header_bytes > size_ ||
+      sizeof(*header) + header->names_bytes > header->header_bytes) {
+    close();
+    return false;
+  }
+  created_ns_ = header->created_ns;
+  const char *names = reinterpret_cast<const char *>(map_ + sizeof(*header));
+  std::string name;
+  for (uint32_t i = 0; i < header->names_bytes; i++) {
+    if (names[i] == '\n') {
+      camera_names_.push_back(name);
+      name.clear();
+    } else {
+      name += names[i];
+    }
+  }
+
+  // 有索引时只读索引块, 最后一个索引块之后的数据块顺序查找
+  uint64_t tail = header->header_bytes;
+  if (header->last_index_offset == 0 ||
+      !load_index(header->last_index_offset, &tail)) {
+    blocks_.clear();
+    tail = header->header_bytes;
+  }
+  walk_blocks(tail);
+
+  for (const Block &block : blocks_) {
+    if (rows_ == 0) {
+      min_stamp_ns_ = block.min_stamp_ns;
+      max_stamp_ns_ = block.max_stamp_ns;
+    }
+    min_stamp_ns_ = std::min(min_stamp_ns_, block.min_stamp_ns);
+    max_stamp_ns_ = std::max(max_stamp_ns_, block.max_stamp_ns);
+    rows_ += block.rows;
+  }
+  return true;
+}
+
+void DetectionLogReader::close() {
+  if (map_ != nullptr) {
+    munmap(const_cast<uint8_t *>(map_), size_);
+    map_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+  camera_names_.clear();
+  blocks_.clear();
+  created_ns_ = 0;
+  min_stamp_ns_ = 0;
+  max_stamp_ns_ = 0;
+  rows_ = 0;
+}
+
+const DetectionLogBlockHeader *
+DetectionLogReader::block_at(uint64_t offset) const {
+  if (offset % 8 != 0 || offset + sizeof(DetectionLogBlockHeader) > size_) {
+    return nullptr;
+  }
+  const DetectionLogBlockHeader *header =
+      reinterpret_cast<const DetectionLogBlockHeader *>(map_ + offset);
+  if ((header->type != kDetectionLogDataBlock &&
+       header->type != kDetectionLogIndexBlock) ||
+      header->payload_bytes > size_ - offset - sizeof(*header)) {
+    return nullptr;
+  }
+  return header;
+}
+
+bool DetectionLogReader::load_index(uint64_t index_offset,
+                                    uint64_t *tail_offset) {
+  // 索引块从后往前串联, 先收集再按写入顺序展开
+  std::vector<const DetectionLogBlockHeader *> chain;
+  uint64_t offset = index_offset;
+  while (offset != 0) {
+    const DetectionLogBlockHeader *header = block_at(offset);
+    if (header == nullptr || header->type != kDetectionLogIndexBlock ||
+        header->payload_bytes !=
+            header->rows * sizeof(Block) + sizeof(uint64_t) ||
+        chain.size() > size_ / sizeof(*header)) {
+      return false;
+    }
+    chain.push_back(header);
+    const uint8_t *payload = reinterpret_cast<const uint8_t *>(header + 1);
+    std::memcpy(&offset, payload + header->rows * sizeof(Block),
+                sizeof(uint64_t));
+    if (offset >= index_offset) {
+      return false;
+    }
+  }
+  for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+    const Block *entries = reinterpret_cast<const Block *>(*it + 1);
+    for (uint32_t i = 0; i < (*it)->rows; i++) {
+      const DetectionLogBlockHeader *data = block_at(entries[i].offset);
+      if (data == nullptr || data->type != kDetectionLogDataBlock) {
+        return false;
+      }
+      blocks_.push_back(entries[i]);
+    }
+  }
+  const DetectionLogBlockHeader *last = chain.front();
+  *tail_offset = index_offset + sizeof(*last) + last->payload_bytes;
+  return true;
+}
+
+void DetectionLogReader::walk_blocks(uint64_t offset) {
+  while (const DetectionLogBlockHeader *header = block_at(offset)) {
+    if (header->type == kDetectionLogDataBlock) {
+      blocks_.push_back(Block{offset, header->min_stamp_ns,
+                              header->max_stamp_ns, header->rows, 0});
+    }
+    offset += sizeof(*header) + header->payload_bytes;
+  }
+}
+
+uint64_t DetectionLogReader::scan(
+    int64_t begin_ns, int64_t end_ns,
+    const std::function<bool(const DetectionLogRow &)> &fn) const {
+  uint64_t visited = 0;
+  DetectionLogRow row;
+  for (const Block &block : blocks_) {
+    if (block.max_stamp_ns < begin_ns || block.min_stamp_ns > end_ns) {
+      continue;
+    }
+    const DetectionLogBlockHeader *header = block_at(block.offset);
+    const uint8_t *payload = reinterpret_cast<const uint8_t *>(header + 1);
+    const uint32_t rows = header->rows;
+    // 先用行列算出目标数, 再校验整个块的大小
+    const DataBlockLayout rows_only = data_block_layout(rows, 0);
+    if (rows_only.total > header->payload_bytes) {
+      continue;
+    }
+    const uint16_t *count = column_at<uint16_t>(payload, rows_only.count);
+    uint64_t objects = 0;
+    for (uint32_t r = 0; r < rows; r++) {
+      objects += count[r];
+    }
+    const DataBlockLayout l = data_block_layout(rows, objects);
+    if (l.total != header->payload_bytes) {
+      continue;
+    }
+    const int64_t *stamp = column_at<int64_t>(payload, l.stamp);
+    const int64_t *publish = column_at<int64_t>(payload, l.publish);
+    const uint32_t *seq = column_at<uint32_t>(payload, l.seq);
+    const uint8_t *camera = column_at<uint8_t>(payload, l.camera);
+    const uint8_t *flags = column_at<uint8_t>(payload, l.flags);
+    const int16_t *x = column_at<int16_t>(payload, l.x);
+    const int16_t *y = column_at<int16_t>(payload, l.y);
+    const int16_t *w = column_at<int16_t>(payload, l.w);
+    const int16_t *h = column_at<int16_t>(payload, l.h);
+    const float *prob = column_at<float>(payload, l.prob);
+    const float *depth = column_at<float>(payload, l.depth);
+    const uint8_t *cls = column_at<uint8_t>(payload, l.cls);
+    uint64_t first = 0;
+    for (uint32_t r = 0; r < rows; first += count[r], r++) {
+      if (stamp[r] < begin_ns || stamp[r] > end_ns) {
+        continue;
+      }
+      row.stamp_ns = stamp[r];
+      row.publish_ns = publish[r];
+      row.seq = seq[r];
+      row.camera = camera[r];
+      row.flags = flags[r];
+      row.objects.resize(count[r]);
+      for (uint16_t k = 0; k < count[r]; k++) {
+        const uint64_t o = first + k;
+        DetectionLogObject &object = row.objects[k];
+        object.x = x[o];
+        object.y = y[o];
+        object.w = w[o];
+        object.h = h[o];
+        object.prob = prob[o];
+        object.depth = depth[o];
+        object.cls = cls[o];
+      }
+      ++visited;
+      if (!fn(row)) {
+        return visited;
+      }
+    }
+  }
+  return visited;
+}
@@ -0,0 +1,138 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 17:20:41
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 17:20:41
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/src/frame_pool.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// cpp system headers
+#include <new>
+// local headers
+#include "common_utils/frame_pool.hpp"
+
+FramePool &FramePool::instance() {
+  // 不析构: 其它静态对象中的 Mat 可能在退出时才释放, 仍然需要 deallocate
+  static FramePool *pool = new FramePool();
+  return *pool;
+}
+
+FramePool::~FramePool() { trim(); }
+
+void FramePool::set_max_cached_bytes(size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_cached_bytes_ = bytes;
+}
+
+FramePoolStats FramePool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void FramePool::trim() {
+  std::map<size_t, std::vector<Block>> blocks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocks.swap(free_blocks_);
+    stats_.cached_bytes = 0;
+  }
+  for (auto &bucket : blocks) {
+    for (const Block &block : bucket.second) {
+      cv::fastFree(block.data);
+      ::operator delete(block.header);
+    }
+  }
+}
+
+cv::UMatData *FramePool::allocate(int dims, const int *sizes, int type,
+                                  void *data, size_t *step,
+                                  AccessFlags /*flags*/,
+                                  cv::UMatUsageFlags /*usage_flags*/) const {
+  // 与 cv::StdMatAllocator 相同的步长计算
+  size_t total = CV_ELEM_SIZE(type);
+  for (int i = dims - 1; i >= 0; i--) {
+    if (step) {
+      if (data && step[i] != CV_AUTOSTEP) {
+        CV_Assert(total <= step[i]);
+        total = step[i];
+      } else {
+        step[i] = total;
+      }
+    }
+    total *= sizes[i];
+  }
+
+  if (data) {
+    // 外部内存不进池
+    cv::UMatData *u = new cv::UMatData(this);
+    u->data = u->origdata = static_cast<uchar *>(data);
+    u->size = total;
+    u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+  }
+
+  Block block = {nullptr, nullptr};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = free_blocks_.find(total);
+    if (it != free_blocks_.end() && !it->second.empty()) {
+      block = it->second.back();
+      it->second.pop_back();
+      stats_.cached_bytes -= total;
+      ++stats_.reuses;
+    } else {
+      ++stats_.allocations;
+    }
+    stats_.in_use_bytes += total;
+  }
+  if (block.data == nullptr) {
+    block.data = static_cast<uchar *>(cv::fastMalloc(total));
+    block.header = ::operator new(sizeof(cv::UMatData));
+  }
+  cv::UMatData *u = new (block.header) cv::UMatData(this);
+  u->data = u->origdata = block.data;
+  u->size = total;
+  return u;
+}
+
+bool FramePool::allocate(cv::UMatData *data, AccessFlags /*access_flags*/,
+                         cv::UMatUsageFlags /*usage_flags*/) const {
+  return data != nullptr;
+}
+
+void FramePool::deallocate(cv::UMatData *u) const {
+  if (u == nullptr) {
+    return;
+  }
+  CV_Assert(u->urefcount == 0);
+  CV_Assert(u->refcount == 0);
+  if (u->flags & cv::UMatData::USER_ALLOCATED) {
+    delete u;
+    return;
+  }
+  const size_t size = u->size;
+  const Block block = {u, u->origdata};
+  u->~UMatData();
+
+  bool cached = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.in_use_bytes -= size;
+    if (stats_.cached_bytes + size <= max_cached_bytes_) {
+      // vector 的容量稳定后 push_back 不再分配
+      free_blocks_[size].push_back(block);
+      stats_.cached_bytes += size;
+      cached = true;
+    } else {
+      ++stats_.releases;
+    }
+  }
+  if (!cached) {
+    cv::fastFree(block.data);
+    ::operator delete(block.header);
+  }
+}
@@ -0,0 +1,314 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 15:02:44
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 15:02:44
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/src/metrics.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <stdio.h>
+// cpp system headers
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+// local headers
+#include "common_utils/metrics.hpp"
+
+namespace {
+
+std::string labels_key(const std::string &name, const MetricLabels &labels) {
+  std::string key = name;
+  for (const auto &label : labels) {
+    key += '\x1f' + label.first + '=' + label.second;
+  }
+  return key;
+}
+
+std::string escape_label_value(const std::string &value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+// {a="1",b="2"}, extra 为额外追加的标签(例如 quantile)
+std::string format_labels(const MetricLabels &labels,
+                          const std::string &extra = std::string()) {
+  if (labels.empty() && extra.empty()) {
+    return std::string();
+  }
+  std::string out = "{";
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if (i > 0) {
+      out += ',';
+    }
+    out += labels[i].first + "=\"" + escape_label_value(labels[i].second) + "\"";
+  }
+  if (!extra.empty()) {
+    if (!labels.empty()) {
+      out += ',';
+    }
+    out += extra;
+  }
+  return out + "}";
+}
+
+} // namespace
+
+/////////////////////////////// HistogramSnapshot ///////////////////////////////
+
+double HistogramSnapshot::percentile(double q) const {
+  if (count == 0 || buckets.empty()) {
+    return 0.0;
+  }
+  q = std::min(std::max(q, 0.0), 1.0);
+  const uint64_t rank =
+      std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count)));
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    cumulative += buckets[i];
+    if (cumulative >= rank) {
+      const int index = static_cast<int>(i);
+      const uint64_t lower = LatencyHistogram::bucket_lower(index);
+      const uint64_t upper = LatencyHistogram::bucket_upper(index);
+      double value = upper - lower <= 1 ? static_cast<double>(lower)
+                                        : (lower + (upper - 1)) / 2.0;
+      return std::min(std::max(value, static_cast<double>(min)),
+                      static_cast<double>(max));
+    }
+  }
+  return static_cast<double>(max);
+}
+
+HistogramSnapshot
+HistogramSnapshot::since(const HistogramSnapshot &earlier) const {
+  HistogramSnapshot delta;
+  delta.count = count - std::min(count, earlier.count);
+  delta.sum = sum - std::min(sum, earlier.sum);
+  delta.buckets = buckets;
+  int first = -1;
+  int last = -1;
+  for (size_t i = 0; i < delta.buckets.size(); ++i) {
+    if (i < earlier.buckets.size()) {
+      delta.buckets[i] -= std::min(delta.buckets[i], earlier.buckets[i]);
+    }
+    if (delta.buckets[i] > 0) {
+      if (first < 0) {
+        first = static_cast<int>(i);
+      }
+      last = static_cast<int>(i);
+    }
+  }
+  // 区间内的精确极值已经丢失, 用桶的边界近似
+  if (first >= 0) {
+    delta.min = std::max(min, LatencyHistogram::bucket_lower(first));
+    delta.max = std::min(max, LatencyHistogram::bucket_upper(last) - 1);
+  }
+  return delta;
+}
+
+/////////////////////////////// LatencyHistogram ///////////////////////////////
+
+LatencyHistogram::LatencyHistogram() {
+  for (auto &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+int LatencyHistogram::bucket_index(uint64_t value) {
+  if (value < static_cast<uint64_t>(kSubBuckets)) {
+    return static_cast<int>(value);
+  }
+  const int exponent = 63 - __builtin_clzll(value);
+  if (exponent > kMaxExponent) {
+    return kNumBuckets - 1;
+  }
+  const int sub = static_cast<int>((value >> (exponent - kSubBucketBits)) &
+                                   (kSubBuckets - 1));
+  return kSubBuckets + (exponent - kSubBucketBits) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucket_lower(int index) {
+  if (index < kSubBuckets) {
+    return static_cast<uint64_t>(index);
+  }
+  const int exponent = (index - kSubBuckets) / kSubBuckets + kSubBucketBits;
+  const uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+  return (kSubBuckets + sub) << (exponent - kSubBucketBits);
+}
+
+uint64_t LatencyHistogram::bucket_upper(int index) {
+  return index + 1 >= kNumBuckets ? UINT64_MAX : bucket_lower(index + 1);
+}
+
+void LatencyHistogram::record(uint64_t value) {
+  buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  uint64_t current = min_.load(std::memory_order_relaxed);
+  while (value < current &&
+         !min_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+  current = max_.load(std::memory_order_relaxed);
+  while (value > current &&
+         !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+  // 各字段分别读取, 与并发的 record 之间可能差一两个样本, 对统计没有影响
+  HistogramSnapshot snapshot;
+  snapshot.buckets.resize(kNumBuckets);
+  for (int i = 0; i < kNumBuckets; ++i) {
+    snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    snapshot.count += snapshot.buckets[i];
+  }
+  snapshot.sum = sum_.load(std::memory_order_relaxed);
+  snapshot.min = snapshot.count > 0 ? min_.load(std::memory_order_relaxed) : 0;
+  snapshot.max = max_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+/////////////////////////////// MetricsRegistry ///////////////////////////////
+
+MetricsRegistry &MetricsRegistry::instance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Entry *
+MetricsRegistry::find_or_create(const std::string &name,
+                                const MetricLabels &labels,
+                                const std::string &help, MetricType type) {
+  const std::string key = labels_key(name, labels);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    return it->second->type == type ? it->second : nullptr;
+  }
+  entries_.emplace_back();
+  Entry *entry = &entries_.back();
+  entry->name = name;
+  entry->labels = labels;
+  entry->help = help;
+  entry->type = type;
+  switch (type) {
+  case kCounter:
+    entry->counter.reset(new MetricCounter());
+    break;
+  case kGauge:
+    entry->gauge.reset(new MetricGauge());
+    break;
+  case kHistogram:
+    entry->histogram.reset(new LatencyHistogram());
+    break;
+  }
+  index_[key] = entry;
+  return entry;
+}
+
+MetricCounter *MetricsRegistry::counter(const std::string &name,
+                                        const MetricLabels &labels,
+                                        const std::string &help) {
+  Entry *entry = find_or_create(name, labels, help, kCounter);
+  return entry ? entry->counter.get() : nullptr;
+}
+
+MetricGauge *MetricsRegistry::gauge(const std::string &name,
+                                    const MetricLabels &labels,
+                                    const std::string &help) {
+  Entry *entry = find_or_create(name, labels, help, kGauge);
+  return entry ? entry->gauge.get() : nullptr;
+}
+
+LatencyHistogram *MetricsRegistry::histogram(const std::string &name,
+                                             const MetricLabels &labels,
+                                             const std::string &help) {
+  Entry *entry = find_or_create(name, labels, help, kHistogram);
+  return entry ? entry->histogram.get() : nullptr;
+}
+
+void MetricsRegistry::visit(
+    const std::function<void(const Entry &)> &visitor) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const Entry &entry : entries_) {
+    visitor(entry);
+  }
+}
+
+bool MetricsRegistry::write_prometheus(const std::string &path) const {
+  // 同名指标必须连续输出, HELP/TYPE 只输出一次
+  std::vector<const Entry *> sorted;
+  visit([&](const Entry &entry) { sorted.push_back(&entry); });
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Entry *a, const Entry *b) { return a->name < b->name; });
+
+  std::ostringstream out;
+  std::string last_name;
+  for (const Entry *entry_ptr : sorted) {
+    const Entry &entry = *entry_ptr;
+    if (entry.name != last_name) {
+      if (!entry.help.empty()) {
+        out << "# HELP " << entry.name << " " << entry.help << "\n";
+      }
+      out << "# TYPE " << entry.name << " "
+          << (entry.type == kCounter ? "counter"
+                                     : entry.type == kGauge ? "gauge"
+                                                            : "summary")
+          << "\n";
+      last_name = entry.name;
+    }
+    switch (entry.type) {
+    case kCounter:
+      out << entry.name << format_labels(entry.labels) << " "
+          << entry.counter->value() << "\n";
+      break;
+    case kGauge:
+      out << entry.name << format_labels(entry.labels) << " "
+          << entry.gauge->value() << "\n";
+      break;
+    case kHistogram: {
+      const HistogramSnapshot snapshot = entry.histogram->snapshot();
+      const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+      for (double q : quantiles) {
+        std::ostringstream label;
+        label << "quantile=\"" << q << "\"";
+        out << entry.name << format_labels(entry.labels, label.str()) << " "
+            << snapshot.percentile(q) << "\n";
+      }
+      out << entry.name << "_sum" << format_labels(entry.labels) << " "
+          << snapshot.sum << "\n";
+      out << entry.name << "_count" << format_labels(entry.labels) << " "
+          << snapshot.count << "\n";
+      break;
+    }
+    }
+  }
+
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    if (!file.good()) {
+      return false;
+    }
+    file << out.str();
+    if (!file.good()) {
+      return false;
+    }
+  }
+  return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
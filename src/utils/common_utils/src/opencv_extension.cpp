@@ -34,6 +34,14 @@ void filiter_by_contour_area(std::vector<std::vector<cv::Point>> *contours,
 }
 
 cv::Mat resize_img(const cv::Mat &img, int output_w, int output_h) {
+  cv::Mat out;
+  cv::Mat re;
+  resize_img(img, output_w, output_h, &out, &re);
+  return out;
+}
+
+void resize_img(const cv::Mat &img, int output_w, int output_h, cv::Mat *out,
+                cv::Mat *resized) {
   int w, h, x, y;
   float r_w = output_w / (img.cols * 1.0);
   float r_h = output_h / (img.rows * 1.0);
@@ -48,11 +56,10 @@ cv::Mat resize_img(const cv::Mat &img, int output_w, int output_h) {
     x = (output_w - w) / 2;
     y = 0;
   }
-  cv::Mat re(h, w, CV_8UC3);
-  cv::resize(img, re, re.size(), 0, 0, cv::INTER_LINEAR);
-  cv::Mat out(output_h, output_w, CV_8UC3, cv::Scalar(128, 128, 128));
-  re.copyTo(out(cv::Rect(x, y, re.cols, re.rows)));
-  return out;
+  cv::resize(img, *resized, cv::Size(w, h), 0, 0, cv::INTER_LINEAR);
+  out->create(output_h, output_w, CV_8UC3);
+  out->setTo(cv::Scalar(128, 128, 128));
+  resized->copyTo((*out)(cv::Rect(x, y, resized->cols, resized->rows)));
 }
 
 cv::Rect get_rect(const cv::Mat &img, float bbox[4], int input_width,
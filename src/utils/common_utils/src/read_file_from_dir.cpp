@@ -26,3 +26,33 @@ int read_file_from_dir(const char *p_dir_name, std::vector<std::string> *file_na
   closedir(p_dir);
   return 0;
 }
+
+bool make_dirs(const std::string &dir) {
+  for (size_t pos = 1; pos <= dir.size(); pos++) {
+    if (pos != dir.size() && dir[pos] != '/') {
+      continue;
+    }
+    const std::string sub = dir.substr(0, pos);
+    if (mkdir(sub.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string file_safe_name(const std::string &name) {
+  std::string out;
+  for (char c : name) {
+    if (c == '/') {
+      if (!out.empty() && out.back() != '_') {
+        out += '_';
+      }
+    } else {
+      out += c;
+    }
+  }
+  while (!out.empty() && out.back() == '_') {
+    out.pop_back();
+  }
+  return out;
+}
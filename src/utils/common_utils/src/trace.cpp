@@ -0,0 +1,147 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 14:20:07
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 14:20:07
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/common_utils/src/trace.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+// c system headers
+#include <sys/syscall.h>
+#include <unistd.h>
+// cpp system headers
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+// local headers
+#include "common_utils/trace.hpp"
+
+namespace {
+
+void write_json_string(std::ostream &out, const std::string &str) {
+  out << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out << buf;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+} // namespace
+
+TraceRecorder &TraceRecorder::instance() {
+  static TraceRecorder recorder;
+  return recorder;
+}
+
+void TraceRecorder::set_buffer_capacity(size_t capacity) {
+  capacity_ = std::max<size_t>(capacity, 1);
+}
+
+void TraceRecorder::set_thread_name(const std::string &name) {
+  ThreadBuffer *buffer = thread_buffer();
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer->thread_name = name;
+}
+
+TraceRecorder::ThreadBuffer *TraceRecorder::thread_buffer() {
+  thread_local ThreadBuffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    std::shared_ptr<ThreadBuffer> created(new ThreadBuffer());
+    created->events.resize(capacity_);
+    created->tid = static_cast<int>(syscall(SYS_gettid));
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.push_back(created);
+    buffer = created.get();
+  }
+  return buffer;
+}
+
+void TraceRecorder::record(const char *name, int64_t begin_ns, int64_t end_ns,
+                           int32_t arg) {
+  ThreadBuffer *buffer = thread_buffer();
+  // 只有本线程写, head 用 release 发布, dump 线程用 acquire 读取
+  uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  TraceEvent &event = buffer->events[head % buffer->events.size()];
+  event.name = name;
+  event.begin_ns = begin_ns;
+  event.end_ns = end_ns;
+  event.arg = arg;
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::dump_chrome_trace(const std::string &path) {
+  std::ofstream out(path);
+  if (!out.good()) {
+    return false;
+  }
+  const int pid = static_cast<int>(getpid());
+  bool first = true;
+  auto separator = [&]() {
+    out << (first ? "\n" : ",\n");
+    first = false;
+  };
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  std::vector<TraceEvent> snapshot;
+  for (const auto &buffer : buffers_) {
+    const uint64_t capacity = buffer->events.size();
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const uint64_t begin = head > capacity ? head - capacity : 0;
+    snapshot.clear();
+    for (uint64_t i = begin; i < head; ++i) {
+      snapshot.push_back(buffer->events[i % capacity]);
+    }
+    // 拷贝期间写线程可能覆盖了最旧的几条, 丢掉这部分
+    const uint64_t head_after = buffer->head.load(std::memory_order_acquire);
+    const uint64_t valid_begin =
+        head_after >= capacity ? head_after - capacity + 1 : 0;
+    const size_t skip =
+        valid_begin > begin
+            ? static_cast<size_t>(std::min<uint64_t>(valid_begin - begin,
+                                                     snapshot.size()))
+            : 0;
+
+    separator();
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+    write_json_string(out, buffer->thread_name.empty()
+                               ? "thread " + std::to_string(buffer->tid)
+                               : buffer->thread_name);
+    out << "}}";
+
+    char ts[64];
+    for (size_t i = skip; i < snapshot.size(); ++i) {
+      const TraceEvent &event = snapshot[i];
+      if (event.name == nullptr) {
+        continue;
+      }
+      separator();
+      out << "{\"name\":";
+      write_json_string(out, event.name);
+      std::snprintf(ts, sizeof(ts), ",\"ts\":%.3f,\"dur\":%.3f",
+                    event.begin_ns / 1e3,
+                    (event.end_ns - event.begin_ns) / 1e3);
+      out << ",\"ph\":\"X\"" << ts << ",\"pid\":" << pid
+          << ",\"tid\":" << buffer->tid;
+      if (event.arg >= 0) {
+        out << ",\"args\":{\"arg\":" << event.arg << "}";
+      }
+      out << "}";
+    }
+  }
+  out << "\n]}\n";
+  return out.good();
+}
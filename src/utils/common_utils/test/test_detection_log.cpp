@@ -0,0 +1,176 @@
+#include "common_utils/detection_log.hpp"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+const int64_t kStart = 1700000000000000000LL;
+const int64_t kStep = 100000000LL;  // 100ms
+
+std::string temp_path(const char* name)
+{
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "/tmp/%s_%d.crlog", name, static_cast<int>(getpid()));
+  return buf;
+}
+
+// 第 i 行: 相机轮流, 目标数 0~3, 各字段都由 i 推出
+DetectionLogRow make_row(int i)
+{
+  DetectionLogRow row;
+  row.stamp_ns = kStart + i * kStep;
+  row.publish_ns = row.stamp_ns + 20000000;
+  row.seq = 1000 + i;
+  row.camera = i % 4;
+  row.flags = (i % 3 == 0 ? kDetectionLogSomeone : 0) | (i % 7 == 0 ? kDetectionLogKeyframe : 0);
+  for (int k = 0; k < i % 4; ++k)
+  {
+    DetectionLogObject o;
+    o.x = i + k;
+    o.y = -i;
+    o.w = 10 + k;
+    o.h = 20 + k;
+    o.prob = 0.5f + 0.01f * k;
+    o.depth = 0.1f * i;
+    o.cls = k;
+    row.objects.push_back(o);
+  }
+  return row;
+}
+
+void expect_row(const DetectionLogRow& want, const DetectionLogRow& got)
+{
+  EXPECT_EQ(want.stamp_ns, got.stamp_ns);
+  EXPECT_EQ(want.publish_ns, got.publish_ns);
+  EXPECT_EQ(want.seq, got.seq);
+  EXPECT_EQ(want.camera, got.camera);
+  EXPECT_EQ(want.flags, got.flags);
+  ASSERT_EQ(want.objects.size(), got.objects.size());
+  for (size_t k = 0; k < want.objects.size(); ++k)
+  {
+    EXPECT_EQ(want.objects[k].x, got.objects[k].x);
+    EXPECT_EQ(want.objects[k].y, got.objects[k].y);
+    EXPECT_EQ(want.objects[k].w, got.objects[k].w);
+    EXPECT_EQ(want.objects[k].h, got.objects[k].h);
+    EXPECT_EQ(want.objects[k].prob, got.objects[k].prob);
+    EXPECT_EQ(want.objects[k].depth, got.objects[k].depth);
+    EXPECT_EQ(want.objects[k].cls, got.objects[k].cls);
+  }
+}
+
+std::vector<DetectionLogRow> read_all(const DetectionLogReader& reader, int64_t begin, int64_t end)
+{
+  std::vector<DetectionLogRow> rows;
+  reader.scan(begin, end, [&rows](const DetectionLogRow& row) {
+    rows.push_back(row);
+    return true;
+  });
+  return rows;
+}
+
+const std::vector<std::string> kCameras = { "/camera/front", "/camera/back", "/camera/left", "/camera/right" };
+}  // namespace
+
+TEST(DetectionLog, roundTripAcrossBlocksAndIndexChain)
+{
+  const std::string path = temp_path("test_detection_log");
+  const int rows = 50;
+  {
+    DetectionLogWriter writer;
+    // 每块4行, 每2个数据块一个索引块: 12个满块, 6个索引块串成链, 最后2行在 close 时写出
+    ASSERT_TRUE(writer.open(path, kCameras, 4, 2));
+    for (int i = 0; i < rows; ++i)
+      ASSERT_TRUE(writer.append(make_row(i)));
+    writer.close();
+  }
+
+  DetectionLogReader reader;
+  ASSERT_TRUE(reader.open(path));
+  EXPECT_EQ(kCameras, reader.camera_names());
+  EXPECT_EQ(static_cast<uint64_t>(rows), reader.rows());
+  EXPECT_EQ(13u, reader.blocks());
+  EXPECT_EQ(kStart, reader.min_stamp_ns());
+  EXPECT_EQ(kStart + (rows - 1) * kStep, reader.max_stamp_ns());
+
+  const std::vector<DetectionLogRow> all = read_all(reader, kStart, kStart + rows * kStep);
+  ASSERT_EQ(static_cast<size_t>(rows), all.size());
+  for (int i = 0; i < rows; ++i)
+    expect_row(make_row(i), all[i]);
+  reader.close();
+  std::remove(path.c_str());
+}
+
+TEST(DetectionLog, crashLeavesZeroFilledTail)
+{
+  const std::string path = temp_path("test_detection_log_live");
+  const std::string crashed = temp_path("test_detection_log_crashed");
+  DetectionLogWriter writer;
+  // 每块2行, 每3个数据块一个索引块
+  ASSERT_TRUE(writer.open(path, kCameras, 2, 3));
+  for (int i = 0; i < 15; ++i)
+    ASSERT_TRUE(writer.append(make_row(i)));
+  // 7个数据块已写出, 索引覆盖前6块, 第7块只能顺序找到, 第15行还在缓存中.
+  // 复制正在写的文件, 相当于进程在此刻退出: 末尾是预分配的 0
+  {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::ofstream out(crashed.c_str(), std::ios::binary);
+    out << in.rdbuf();
+  }
+  std::ifstream copy(crashed.c_str(), std::ios::binary | std::ios::ate);
+  EXPECT_GT(static_cast<uint64_t>(copy.tellg()), writer.bytes());
+
+  DetectionLogReader reader;
+  ASSERT_TRUE(reader.open(crashed));
+  EXPECT_EQ(14u, reader.rows());
+  EXPECT_EQ(7u, reader.blocks());
+  const std::vector<DetectionLogRow> all = read_all(reader, kStart, kStart + 100 * kStep);
+  ASSERT_EQ(14u, all.size());
+  for (int i = 0; i < 14; ++i)
+    expect_row(make_row(i), all[i]);
+  reader.close();
+
+  // 正常关闭后最后一行也在
+  writer.close();
+  ASSERT_TRUE(reader.open(path));
+  EXPECT_EQ(15u, reader.rows());
+  reader.close();
+  std::remove(path.c_str());
+  std::remove(crashed.c_str());
+}
+
+TEST(DetectionLog, timeRangeScan)
+{
+  const std::string path = temp_path("test_detection_log_range");
+  {
+    DetectionLogWriter writer;
+    ASSERT_TRUE(writer.open(path, kCameras, 8, 4));
+    for (int i = 0; i < 100; ++i)
+      ASSERT_TRUE(writer.append(make_row(i)));
+  }
+
+  DetectionLogReader reader;
+  ASSERT_TRUE(reader.open(path));
+  // 边界包含在内, 范围跨越多个块
+  const std::vector<DetectionLogRow> range = read_all(reader, kStart + 10 * kStep, kStart + 37 * kStep);
+  ASSERT_EQ(28u, range.size());
+  for (size_t i = 0; i < range.size(); ++i)
+    expect_row(make_row(10 + i), range[i]);
+
+  EXPECT_TRUE(read_all(reader, kStart - 10 * kStep, kStart - 1).empty());
+  EXPECT_TRUE(read_all(reader, kStart + 100 * kStep, kStart + 200 * kStep).empty());
+
+  // 回调返回 false 时停止
+  int visited = 0;
+  EXPECT_EQ(5u, reader.scan(kStart, kStart + 100 * kStep, [&visited](const DetectionLogRow&) { return ++visited < 5; }));
+  EXPECT_EQ(5, visited);
+  reader.close();
+  std::remove(path.c_str());
+}
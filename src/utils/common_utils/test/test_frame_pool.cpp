@@ -0,0 +1,40 @@
+#include "common_utils/frame_pool.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(FramePool, releasedBufferIsReused)
+{
+  cv::Mat a;
+  use_frame_pool(&a);
+  a.create(120, 160, CV_8UC1);
+  const uchar* first = a.data;
+  a.release();
+
+  cv::Mat b;
+  use_frame_pool(&b);
+  b.create(120, 160, CV_8UC1);
+  EXPECT_EQ(first, b.data);
+}
+
+TEST(FramePool, cacheIsBounded)
+{
+  FramePool& pool = FramePool::instance();
+  pool.trim();
+  pool.set_max_cached_bytes(100 * 100);
+
+  cv::Mat a, b;
+  use_frame_pool(&a);
+  use_frame_pool(&b);
+  a.create(100, 100, CV_8UC1);
+  b.create(100, 100, CV_8UC1);
+  const uint64_t releases = pool.stats().releases;
+  a.release();
+  b.release();
+  // 第二块超出上限, 直接释放
+  EXPECT_EQ(releases + 1, pool.stats().releases);
+  EXPECT_EQ(100u * 100u, pool.stats().cached_bytes);
+
+  pool.set_max_cached_bytes(256u << 20);
+  pool.trim();
+  EXPECT_EQ(0u, pool.stats().cached_bytes);
+}
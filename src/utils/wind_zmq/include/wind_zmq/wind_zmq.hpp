@@ -14,7 +14,11 @@
 #include <unistd.h>
 #include <zmq.h>
 // cpp system headers
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -23,48 +27,123 @@
 #include "opencv2/opencv.hpp"
 // ros
 #include "ros/ros.h"
+// local headers
+#include "common_utils/async_logger.hpp"
+#include "wind_zmq/zmq_poller.hpp"
+
+// 订阅端处理不过来(发送队列达到SNDHWM)时的发送策略
+enum class ZeroMQSendPolicy {
+  kDropNewest,       // 直接丢弃本次要发送的消息
+  kDropOldest,       // 本地缓存最近N条,队列满时丢弃最旧的一条
+  kBlockWithTimeout, // 阻塞等待,最多 send_timeout_ms 毫秒
+  kConflate,         // 只保留最新一条,适用于"someone"这类状态量
+};
+
+/**
+ * @description: 解析策略名称 drop_newest/drop_oldest/block/conflate
+ * @return {bool} : 名称无法识别时返回false
+ */
+bool parse_send_policy(const std::string &name, ZeroMQSendPolicy *policy);
+
+struct ZeroMQPublisherOptions {
+  ZeroMQSendPolicy send_policy = ZeroMQSendPolicy::kDropNewest;
+  int sndhwm = 10;             // 每个订阅者的发送队列长度(消息数)
+  int linger_ms = 0;           // 关闭socket时等待未发送消息的时间
+  int send_timeout_ms = 5;     // kBlockWithTimeout 的最长阻塞时间
+  int pending_queue_size = 4;  // kDropOldest 的本地缓存长度
+  bool tcp_keepalive = true;
+  int tcp_keepalive_idle_s = 10;
+  int tcp_keepalive_intvl_s = 5;
+  int tcp_keepalive_cnt = 3;
+};
+
+struct ZeroMQPublisherStats {
+  uint64_t sent = 0;
+  uint64_t dropped = 0; // 因为订阅端过慢而丢弃的消息数
+  uint64_t delayed = 0; // 没能立即发出(阻塞等待或进入本地缓存)的消息数
+};
 
 class ZeroMQPublisher {
 public:
-  ZeroMQPublisher(std::string zmq_pub_topic, std::string zmq_pub_port)
-      : zmq_pub_topic_(zmq_pub_topic), zmq_pub_port_(zmq_pub_port) {}
+  ZeroMQPublisher(std::string zmq_pub_topic, std::string zmq_pub_port,
+                  ZeroMQPublisherOptions options = ZeroMQPublisherOptions())
+      : options_(options), zmq_pub_topic_(zmq_pub_topic),
+        zmq_pub_port_(zmq_pub_port) {}
+  // 使用外部共享的context(例如 ZeroMQPoller::context()),不再单独创建
+  ZeroMQPublisher(std::string zmq_pub_topic, std::string zmq_pub_port,
+                  void *shared_context,
+                  ZeroMQPublisherOptions options = ZeroMQPublisherOptions())
+      : context_(shared_context), own_context_(false), options_(options),
+        zmq_pub_topic_(zmq_pub_topic), zmq_pub_port_(zmq_pub_port) {}
+  // 关闭socket, 共享的context需要所有socket关闭后才能 zmq_ctx_term
+  ~ZeroMQPublisher();
   bool init();
   bool publish_str(std::string msg);
+  // 在数据帧之后追加第三帧(例如时间戳), extra 为空时与 publish_str(msg) 相同.
+  // 只读前两帧的旧订阅端会把第三帧当作无法识别的topic跳过
+  bool publish_str(const std::string &msg, const std::string &extra);
   bool send_msg(std::string msg);
   bool publish_img(const cv::Mat &image);
+  // 重新尝试发送本地缓存中的消息(kDropOldest/kConflate)
+  void flush();
+  ZeroMQPublisherStats get_stats() const;
 
 private:
-  void *context_;
-  void *zmq_send_publisher_;
+  enum SendResult { kSent, kAgain, kFailed };
+
+  struct PendingMessage {
+    std::string topic;
+    std::string data;
+    std::string extra;
+  };
+
+  bool publish(const std::string &topic, const void *data, size_t size,
+               const std::string &extra = std::string());
+  SendResult try_send(const std::string &topic, const void *data, size_t size,
+                      const std::string &extra, int flags);
+  void flush_pending();
+
+  void *context_ = nullptr;
+  bool own_context_ = true;
+  ZeroMQPublisherOptions options_;
+  void *zmq_send_publisher_ = nullptr;
   std::string zmq_pub_topic_;
   std::string zmq_pub_port_;
+
+  // kDropOldest/kConflate 的本地缓存
+  std::mutex pending_mutex_;
+  std::deque<PendingMessage> pending_;
+
+  std::atomic<uint64_t> sent_count_{0};
+  std::atomic<uint64_t> dropped_count_{0};
+  std::atomic<uint64_t> delayed_count_{0};
 };
 
+/**
+ * @description: 单个topic的订阅, 接收由 ZeroMQPoller 完成, 不再单独创建线程.
+ * 不传 poller 时自己持有一个, 多个订阅可以共用同一个 poller 的 context 和I/O线程.
+ */
 class ZeroMQSubscriber {
 public:
   ZeroMQSubscriber(std::string zmq_sub_topic, std::string zmq_sub_port,
-                   std::string msgs_type, int cols, int rows)
+                   std::string msgs_type, int cols, int rows,
+                   ZeroMQPoller *poller = nullptr)
       : zmq_sub_topic_(zmq_sub_topic), zmq_sub_port_(zmq_sub_port),
-        msgs_type_(msgs_type), cols_(cols), rows_(rows) {}
+        msgs_type_(msgs_type), cols_(cols), rows_(rows), poller_(poller) {}
   bool init();
   bool get_str(std::string *str);
+  // 返回最近收到的一帧, 没有新消息时仍为上一帧
   bool get_img(cv::Mat *img);
-  void recv_str();
-  void recv_img();
 
 private:
-  void *context_;
-  void *zmq_recv_subscriber_;
   std::string zmq_sub_topic_;
   std::string zmq_sub_port_;
   std::string msgs_type_; // msgs_type_ = "str" or "img"
   int cols_;
   int rows_;
-  bool recv_topic_flag_ = false;
-  bool recv_msg_if_update_flag_ = false;
-  std::thread receive_info_thread_;
-  std::string store_str_;
-  int buffer_size_ = 1000;
+  std::unique_ptr<ZeroMQPoller> own_poller_;
+  ZeroMQPoller *poller_;
+  int subscription_id_ = -1;
+  std::string img_buffer_;
   cv::Mat store_img_;
-  bool end_thread_flag_ = false;
 };
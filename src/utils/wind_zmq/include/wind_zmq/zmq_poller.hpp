@@ -0,0 +1,94 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 09:12:41
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 09:12:41
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/wind_zmq/include/wind_zmq/zmq_poller.hpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#pragma once
+// c system headers
+#include <zmq.h>
+// cpp system headers
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// third party headers
+// ros
+#include "ros/ros.h"
+
+/**
+ * @description: 多路ZeroMQ订阅复用器
+ * 一个进程内共用一个zmq context和一个I/O线程,通过zmq_poll同时监听任意数量的
+ * SUB socket,收到的消息分发到注册的回调,或者保存最新一帧供 get_str 轮询读取.
+ * 消息格式与 ZeroMQPublisher 一致: 第一帧为topic,之后的帧为数据.
+ */
+class ZeroMQPoller {
+public:
+  // topic : 消息的topic帧, msg : 数据帧(多帧时为第一个数据帧), extra :
+  // 数据帧之后的附加帧(例如时间戳)
+  typedef std::function<void(const std::string &topic, const std::string &msg,
+                             const std::vector<std::string> &extra)>
+      Callback;
+
+  explicit ZeroMQPoller(int poll_timeout_ms = 100)
+      : poll_timeout_ms_(poll_timeout_ms) {}
+  ~ZeroMQPoller();
+
+  bool init();
+
+  /**
+   * @description: 添加一个订阅,可以在 start 之前或之后调用
+   * @param {std::string} zmq_sub_topic : 订阅的topic,为空时接收所有消息
+   * @param {std::string} zmq_sub_port : 连接地址, 例如 tcp://127.0.0.1:1973
+   * @param {Callback} callback : 收到消息后在I/O线程中调用,为空时只保存最新一帧
+   * @return {int} : 订阅id, 失败返回-1
+   */
+  int add_subscription(const std::string &zmq_sub_topic,
+                       const std::string &zmq_sub_port,
+                       Callback callback = Callback());
+
+  bool start();
+  // 关闭所有订阅和context, 使用 context() 创建的 ZeroMQPublisher 需要先析构,
+  // 否则 zmq_ctx_term 会一直等待它的socket关闭
+  void stop();
+
+  // 读取订阅收到的最新消息,没有新消息时返回false
+  bool get_str(int subscription_id, std::string *str);
+
+  // 共享的context,可以传给 ZeroMQPublisher 避免每个发布者单独创建
+  void *context() const { return context_; }
+
+private:
+  struct Subscription {
+    std::string topic;
+    std::string port;
+    void *socket = nullptr;
+    Callback callback;
+    std::mutex mutex;
+    std::string latest;
+    bool updated = false;
+    uint64_t received = 0;
+  };
+
+  void poll_loop();
+  bool receive(Subscription *sub);
+
+  int poll_timeout_ms_;
+  void *context_ = nullptr;
+  std::thread poll_thread_;
+  std::atomic<bool> running_{false};
+
+  // subscriptions_ 只会追加, I/O线程每轮检查是否有新加入的订阅
+  std::mutex subscriptions_mutex_;
+  std::vector<std::unique_ptr<Subscription>> subscriptions_;
+};
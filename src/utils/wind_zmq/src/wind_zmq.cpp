@@ -10,8 +10,34 @@
  */
 #include "wind_zmq/wind_zmq.hpp"
 
+bool parse_send_policy(const std::string &name, ZeroMQSendPolicy *policy) {
+  if (name == "drop_newest") {
+    *policy = ZeroMQSendPolicy::kDropNewest;
+  } else if (name == "drop_oldest") {
+    *policy = ZeroMQSendPolicy::kDropOldest;
+  } else if (name == "block") {
+    *policy = ZeroMQSendPolicy::kBlockWithTimeout;
+  } else if (name == "conflate") {
+    *policy = ZeroMQSendPolicy::kConflate;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+ZeroMQPublisher::~ZeroMQPublisher() {
+  if (zmq_send_publisher_ != NULL) {
+    zmq_close(zmq_send_publisher_);
+  }
+  if (own_context_ && context_ != NULL) {
+    zmq_ctx_term(context_);
+  }
+}
+
 bool ZeroMQPublisher::init() {
-  context_ = zmq_ctx_new();
+  if (own_context_) {
+    context_ = zmq_ctx_new();
+  }
   if (context_ == NULL) {
     ROS_ERROR_STREAM("[ ZeroMQPublisher ] zmq_ctx_new failed");
     return false;
@@ -22,7 +48,45 @@ bool ZeroMQPublisher::init() {
     ROS_ERROR_STREAM("[ ZeroMQPublisher ] zmq_socket failed");
     return false;
   }
-  int ret = zmq_bind(zmq_send_publisher_, zmq_pub_port_.c_str());
+
+  // conflate只关心最新状态,zmq内部也只排队一条
+  int sndhwm = options_.send_policy == ZeroMQSendPolicy::kConflate
+                   ? 1
+                   : options_.sndhwm;
+  int keepalive = options_.tcp_keepalive ? 1 : 0;
+  int ret = 0;
+  ret |= zmq_setsockopt(zmq_send_publisher_, ZMQ_SNDHWM, &sndhwm,
+                        sizeof(sndhwm));
+  ret |= zmq_setsockopt(zmq_send_publisher_, ZMQ_LINGER, &options_.linger_ms,
+                        sizeof(options_.linger_ms));
+  ret |= zmq_setsockopt(zmq_send_publisher_, ZMQ_SNDTIMEO,
+                        &options_.send_timeout_ms,
+                        sizeof(options_.send_timeout_ms));
+  ret |= zmq_setsockopt(zmq_send_publisher_, ZMQ_TCP_KEEPALIVE, &keepalive,
+                        sizeof(keepalive));
+  if (options_.tcp_keepalive) {
+    ret |= zmq_setsockopt(zmq_send_publisher_, ZMQ_TCP_KEEPALIVE_IDLE,
+                          &options_.tcp_keepalive_idle_s,
+                          sizeof(options_.tcp_keepalive_idle_s));
+    ret |= zmq_setsockopt(zmq_send_publisher_, ZMQ_TCP_KEEPALIVE_INTVL,
+                          &options_.tcp_keepalive_intvl_s,
+                          sizeof(options_.tcp_keepalive_intvl_s));
+    ret |= zmq_setsockopt(zmq_send_publisher_, ZMQ_TCP_KEEPALIVE_CNT,
+                          &options_.tcp_keepalive_cnt,
+                          sizeof(options_.tcp_keepalive_cnt));
+  }
+#ifdef ZMQ_XPUB_NODROP
+  // 默认情况下PUB在队列满时静默丢弃,打开后会返回EAGAIN,丢包可以被统计
+  int nodrop = 1;
+  ret |= zmq_setsockopt(zmq_send_publisher_, ZMQ_XPUB_NODROP, &nodrop,
+                        sizeof(nodrop));
+#endif
+  if (ret != 0) {
+    ROS_ERROR_STREAM("[ ZeroMQPublisher ] zmq_setsockopt failed");
+    return false;
+  }
+
+  ret = zmq_bind(zmq_send_publisher_, zmq_pub_port_.c_str());
   if (ret != 0) {
     ROS_ERROR_STREAM("[ ZeroMQPublisher ] zmq_bind failed");
     return false;
@@ -32,165 +96,202 @@ bool ZeroMQPublisher::init() {
 }
 
 bool ZeroMQPublisher::publish_str(const std::string msg) {
-  int ret = -1;
-  ret = zmq_send(zmq_send_publisher_, zmq_pub_topic_.c_str(),
-                 strlen(zmq_pub_topic_.c_str()), ZMQ_SNDMORE);
-  if (ret == -1) {
-    ROS_WARN_STREAM("[ ZeroMQPublisher ] publish failed");
-    return false;
-  }
-  ret = zmq_send(zmq_send_publisher_, msg.c_str(), strlen(msg.c_str()), 0);
-  if (ret == -1) {
-    ROS_WARN_STREAM("[ ZeroMQPublisher ] publish failed");
-    return false;
-  }
-  return true;
+  return publish(zmq_pub_topic_, msg.data(), msg.size());
+}
+
+bool ZeroMQPublisher::publish_str(const std::string &msg,
+                                  const std::string &extra) {
+  return publish(zmq_pub_topic_, msg.data(), msg.size(), extra);
 }
 
 bool ZeroMQPublisher::send_msg(std::string msg) {
-  int ret = -1;
-  ret = zmq_send(zmq_send_publisher_, msg.c_str(), strlen(msg.c_str()), 0);
-  if (ret == -1) {
-    ROS_WARN_STREAM("[ ZeroMQPublisher ] send_msg failed");
-    return false;
-  }
-  return true;
+  return publish(std::string(), msg.data(), msg.size());
 }
 
 bool ZeroMQPublisher::publish_img(const cv::Mat &image) {
-  int ret = -1;
-  ret = zmq_send(zmq_send_publisher_, zmq_pub_topic_.c_str(),
-                 strlen(zmq_pub_topic_.c_str()), ZMQ_SNDMORE);
-  if (ret == -1) {
-    ROS_WARN_STREAM("[ ZeroMQPublisher ] publish failed");
+  if (image.empty()) {
     return false;
   }
+  if (!image.isContinuous()) {
+    cv::Mat continuous = image.clone();
+    return publish(zmq_pub_topic_, continuous.data,
+                   continuous.total() * continuous.elemSize());
+  }
+  return publish(zmq_pub_topic_, image.data, image.total() * image.elemSize());
+}
 
-  int height = image.rows;
-  int width = image.cols;
+void ZeroMQPublisher::flush() {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  flush_pending();
+}
 
-  ret = zmq_send(zmq_send_publisher_, image.data,
-                 (height * width * 3 * sizeof(uint8_t)), ZMQ_NOBLOCK);
-  if (ret == -1) {
-    ROS_WARN_STREAM("[ ZeroMQPublisher ] publish_img failed");
-    return false;
+ZeroMQPublisherStats ZeroMQPublisher::get_stats() const {
+  ZeroMQPublisherStats stats;
+  stats.sent = sent_count_;
+  stats.dropped = dropped_count_;
+  stats.delayed = delayed_count_;
+  return stats;
+}
+
+bool ZeroMQPublisher::publish(const std::string &topic, const void *data,
+                              size_t size, const std::string &extra) {
+  switch (options_.send_policy) {
+  case ZeroMQSendPolicy::kDropNewest: {
+    SendResult ret = try_send(topic, data, size, extra, ZMQ_DONTWAIT);
+    if (ret == kAgain) {
+      ++dropped_count_;
+    }
+    return ret == kSent;
   }
-  return true;
+  case ZeroMQSendPolicy::kBlockWithTimeout: {
+    SendResult ret = try_send(topic, data, size, extra, ZMQ_DONTWAIT);
+    if (ret != kAgain) {
+      return ret == kSent;
+    }
+    // 队列已满,阻塞等待,超时时间由ZMQ_SNDTIMEO决定
+    ++delayed_count_;
+    ret = try_send(topic, data, size, extra, 0);
+    if (ret == kAgain) {
+      ++dropped_count_;
+    }
+    return ret == kSent;
+  }
+  case ZeroMQSendPolicy::kDropOldest:
+  case ZeroMQSendPolicy::kConflate: {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    flush_pending();
+    if (pending_.empty()) {
+      SendResult ret = try_send(topic, data, size, extra, ZMQ_DONTWAIT);
+      if (ret != kAgain) {
+        return ret == kSent;
+      }
+    }
+    size_t capacity = options_.send_policy == ZeroMQSendPolicy::kConflate
+                          ? 1
+                          : std::max(options_.pending_queue_size, 1);
+    while (pending_.size() >= capacity) {
+      pending_.pop_front();
+      ++dropped_count_;
+    }
+    PendingMessage message;
+    message.topic = topic;
+    message.data.assign(static_cast<const char *>(data), size);
+    message.extra = extra;
+    pending_.push_back(std::move(message));
+    ++delayed_count_;
+    return true;
+  }
+  default:
+    break;
+  }
+  return false;
 }
 
-///////////////////////////////////////////////////////////////////////////////
-bool ZeroMQSubscriber::init() {
-  context_ = zmq_ctx_new();
-  if (context_ == NULL) {
-    ROS_ERROR_STREAM("[ ZeroMQSubscriber ] zmq_ctx_new failed");
-    return false;
+void ZeroMQPublisher::flush_pending() {
+  while (!pending_.empty()) {
+    const auto &front = pending_.front();
+    SendResult ret = try_send(front.topic, front.data.data(), front.data.size(),
+                              front.extra, ZMQ_DONTWAIT);
+    if (ret == kAgain) {
+      return;
+    }
+    if (ret == kFailed) {
+      ++dropped_count_;
+    }
+    pending_.pop_front();
   }
-  zmq_recv_subscriber_ = zmq_socket(context_, ZMQ_SUB);
-  if (zmq_recv_subscriber_ == NULL) {
-    ROS_ERROR_STREAM("[ ZeroMQSubscriber ] zmq_socket failed");
-    return false;
+}
+
+ZeroMQPublisher::SendResult ZeroMQPublisher::try_send(const std::string &topic,
+                                                      const void *data,
+                                                      size_t size,
+                                                      const std::string &extra,
+                                                      int flags) {
+  int ret = -1;
+  if (!topic.empty()) {
+    // topic帧被接受后,同一条多帧消息的剩余帧一定会一起进入队列,
+    // 所以只需要在第一帧上判断是否需要丢弃
+    ret = zmq_send(zmq_send_publisher_, topic.data(), topic.size(),
+                   flags | ZMQ_SNDMORE);
+    if (ret == -1) {
+      if (zmq_errno() == EAGAIN) {
+        return kAgain;
+      }
+      ALOG_WARN_STREAM_THROTTLE(1.0, "[ ZeroMQPublisher ] publish failed : "
+                                             << zmq_strerror(zmq_errno()));
+      return kFailed;
+    }
   }
-  int ret = zmq_connect(zmq_recv_subscriber_, zmq_sub_port_.c_str());
-  if (ret != 0) {
-    ROS_ERROR_STREAM("[ ZeroMQSubscriber ] zmq_connect failed");
-    ROS_ERROR_STREAM(
-        "[ ZeroMQSubscriber ] zmq_sub_topic_ : " << zmq_sub_topic_);
-    ROS_ERROR_STREAM("[ ZeroMQSubscriber ] zmq_sub_port_ : " << zmq_sub_port_);
-    return false;
+  const int more = extra.empty() ? 0 : ZMQ_SNDMORE;
+  ret = zmq_send(zmq_send_publisher_, data, size,
+                 (topic.empty() ? flags : 0) | more);
+  if (ret == -1) {
+    if (topic.empty() && zmq_errno() == EAGAIN) {
+      return kAgain;
+    }
+    ALOG_WARN_STREAM_THROTTLE(1.0, "[ ZeroMQPublisher ] publish failed : "
+                                           << zmq_strerror(zmq_errno()));
+    return kFailed;
   }
+  if (!extra.empty()) {
+    ret = zmq_send(zmq_send_publisher_, extra.data(), extra.size(), 0);
+    if (ret == -1) {
+      ALOG_WARN_STREAM_THROTTLE(1.0, "[ ZeroMQPublisher ] publish failed : "
+                                             << zmq_strerror(zmq_errno()));
+      return kFailed;
+    }
+  }
+  ++sent_count_;
+  return kSent;
+}
 
-  ret = zmq_setsockopt(zmq_recv_subscriber_, ZMQ_SUBSCRIBE, "", 0);
-  if (ret != 0) {
-    ROS_ERROR_STREAM("[ ZeroMQSubscriber ] zmq_setsockopt failed");
+///////////////////////////////////////////////////////////////////////////////
+bool ZeroMQSubscriber::init() {
+  if (msgs_type_ != "str" && msgs_type_ != "img") {
+    ROS_ERROR_STREAM("[ ZeroMQSubscriber ] msgs_type_ error");
     return false;
   }
-  if (msgs_type_ == "str") {
-    receive_info_thread_ = std::thread(&ZeroMQSubscriber::recv_str, this);
-    receive_info_thread_.detach();
-  } else if (msgs_type_ == "img") {
-    buffer_size_ = (rows_ * cols_ * 3);
-    receive_info_thread_ = std::thread(&ZeroMQSubscriber::recv_img, this);
-    receive_info_thread_.detach();
-  } else {
-    ROS_ERROR_STREAM("[ ZeroMQSubscriber ] msgs_type_ error");
+  if (poller_ == nullptr) {
+    own_poller_.reset(new ZeroMQPoller());
+    if (!own_poller_->init()) {
+      return false;
+    }
+    poller_ = own_poller_.get();
+  }
+  // 只保存最新一帧, 不注册回调, 订阅先于共享的 poller 析构也是安全的
+  subscription_id_ = poller_->add_subscription(zmq_sub_topic_, zmq_sub_port_);
+  if (subscription_id_ < 0) {
+    ROS_ERROR_STREAM("[ ZeroMQSubscriber ] subscribe failed, zmq_sub_topic_ : "
+                     << zmq_sub_topic_ << " zmq_sub_port_ : " << zmq_sub_port_);
     return false;
   }
-  return true;
+  return poller_->start();
 }
 
 bool ZeroMQSubscriber::get_str(std::string *str) {
-  if (recv_msg_if_update_flag_) {
-    *str = store_str_;
-    recv_msg_if_update_flag_ = false;
-    return true;
-  } else {
+  if (poller_ == nullptr || !poller_->get_str(subscription_id_, str)) {
     ROS_DEBUG_STREAM("[ ZeroMQSubscriber ] get_msg msg has not updated");
     return false;
   }
+  return true;
 }
 
 bool ZeroMQSubscriber::get_img(cv::Mat *img) {
-  if (!store_img_.empty()) {
-    *img = store_img_.clone();
-    return true;
-  } else {
-    ROS_DEBUG_STREAM("[ ZeroMQSubscriber ] get_img img has not updated");
-    return false;
-  }
-}
-
-void ZeroMQSubscriber::recv_str() {
-  while (1) {
-    char *info_buffer_ptr = new char[buffer_size_];
-    int ret = zmq_recv(zmq_recv_subscriber_, info_buffer_ptr, buffer_size_, 0);
-    if (ret == -1) {
-      ROS_WARN_STREAM("[ ZeroMQSubscriber ] recv_msg failed");
-      continue;
-    }
-
-    std::string tmp = "";
-    for (int i = 0; i < ret; ++i) {
-      tmp += info_buffer_ptr[i];
-    }
-
-    if (recv_topic_flag_ == false && tmp[0] == zmq_sub_topic_[0]) {
-      recv_topic_flag_ = true;
-    } else if (recv_topic_flag_ == true && tmp != "") {
-      store_str_ = tmp;
-      recv_topic_flag_ = false;
-      recv_msg_if_update_flag_ = true;
+  if (poller_ != nullptr && poller_->get_str(subscription_id_, &img_buffer_)) {
+    if (img_buffer_.size() == static_cast<size_t>(rows_ * cols_ * 3)) {
+      store_img_.create(rows_, cols_, CV_8UC3);
+      std::copy(img_buffer_.begin(), img_buffer_.end(), store_img_.data);
     } else {
-      continue;
+      ALOG_WARN_STREAM_THROTTLE(1.0, "[ ZeroMQSubscriber ] image size "
+                                         << img_buffer_.size()
+                                         << " does not match " << cols_ << "x"
+                                         << rows_);
     }
-    delete info_buffer_ptr;
-    if (end_thread_flag_) {
-      break;
-    }
-    usleep(30000);
   }
-  return;
-}
-
-void ZeroMQSubscriber::recv_img() {
-  while (1) {
-    char *info_buffer_ptr = new char[buffer_size_];
-
-    int ret = zmq_recv(zmq_recv_subscriber_, info_buffer_ptr, buffer_size_, 0);
-    if (ret == -1) {
-      ROS_WARN_STREAM("[ ZeroMQSubscriber ] recv_msg failed");
-      continue;
-    }
-    // 跳过topic的校验
-    if (ret < buffer_size_) {
-      continue;
-    }
-    cv::Mat my_mat(rows_, cols_, CV_8UC3, info_buffer_ptr);
-    store_img_ = my_mat.clone();
-    delete info_buffer_ptr;
-    if (end_thread_flag_) {
-      break;
-    }
-    usleep(30000);
+  if (store_img_.empty()) {
+    ROS_DEBUG_STREAM("[ ZeroMQSubscriber ] get_img img has not updated");
+    return false;
   }
-  return;
+  *img = store_img_.clone();
+  return true;
 }
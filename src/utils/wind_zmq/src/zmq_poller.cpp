@@ -0,0 +1,198 @@
+/*
+ * @Description:
+ * @version: 1.0.0
+ * @Author: ls
+ * @Date: 2026-10-19 09:12:41
+ * @LastEditors: ls
+ * @LastEditTime: 2026-10-19 09:12:41
+ * @todo:
+ * @FilePath: /catkin_cr_batch/src/utils/wind_zmq/src/zmq_poller.cpp
+ * @Copyright (C) 2021-2022 plusgo Company Limited. All rights reserved.
+ * @Licensed under the Apache License, Version 2.0 (the License)
+ */
+#include "wind_zmq/zmq_poller.hpp"
+
+ZeroMQPoller::~ZeroMQPoller() { stop(); }
+
+bool ZeroMQPoller::init() {
+  context_ = zmq_ctx_new();
+  if (context_ == NULL) {
+    ROS_ERROR_STREAM("[ ZeroMQPoller ] zmq_ctx_new failed");
+    return false;
+  }
+  return true;
+}
+
+int ZeroMQPoller::add_subscription(const std::string &zmq_sub_topic,
+                                   const std::string &zmq_sub_port,
+                                   Callback callback) {
+  if (context_ == NULL) {
+    ROS_ERROR_STREAM("[ ZeroMQPoller ] add_subscription before init");
+    return -1;
+  }
+  void *socket = zmq_socket(context_, ZMQ_SUB);
+  if (socket == NULL) {
+    ROS_ERROR_STREAM("[ ZeroMQPoller ] zmq_socket failed");
+    return -1;
+  }
+  int linger = 0;
+  zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+  int ret = zmq_connect(socket, zmq_sub_port.c_str());
+  if (ret != 0) {
+    ROS_ERROR_STREAM("[ ZeroMQPoller ] zmq_connect failed, zmq_sub_port : "
+                     << zmq_sub_port);
+    zmq_close(socket);
+    return -1;
+  }
+  // 按topic前缀过滤,只有topic帧匹配的多帧消息才会被接收
+  ret = zmq_setsockopt(socket, ZMQ_SUBSCRIBE, zmq_sub_topic.c_str(),
+                       zmq_sub_topic.size());
+  if (ret != 0) {
+    ROS_ERROR_STREAM("[ ZeroMQPoller ] zmq_setsockopt failed");
+    zmq_close(socket);
+    return -1;
+  }
+
+  std::unique_ptr<Subscription> sub(new Subscription());
+  sub->topic = zmq_sub_topic;
+  sub->port = zmq_sub_port;
+  sub->socket = socket;
+  sub->callback = callback;
+
+  std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+  subscriptions_.push_back(std::move(sub));
+  return static_cast<int>(subscriptions_.size()) - 1;
+}
+
+bool ZeroMQPoller::start() {
+  if (context_ == NULL) {
+    ROS_ERROR_STREAM("[ ZeroMQPoller ] start before init");
+    return false;
+  }
+  if (running_) {
+    return true;
+  }
+  running_ = true;
+  poll_thread_ = std::thread(&ZeroMQPoller::poll_loop, this);
+  return true;
+}
+
+void ZeroMQPoller::stop() {
+  running_ = false;
+  if (poll_thread_.joinable()) {
+    poll_thread_.join();
+  }
+  std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+  for (auto &sub : subscriptions_) {
+    if (sub->socket != nullptr) {
+      zmq_close(sub->socket);
+      sub->socket = nullptr;
+    }
+  }
+  subscriptions_.clear();
+  if (context_ != NULL) {
+    zmq_ctx_term(context_);
+    context_ = NULL;
+  }
+}
+
+bool ZeroMQPoller::get_str(int subscription_id, std::string *str) {
+  Subscription *sub = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    if (subscription_id < 0 ||
+        subscription_id >= static_cast<int>(subscriptions_.size())) {
+      return false;
+    }
+    sub = subscriptions_[subscription_id].get();
+  }
+  std::lock_guard<std::mutex> lock(sub->mutex);
+  if (!sub->updated) {
+    return false;
+  }
+  str->swap(sub->latest);
+  sub->updated = false;
+  return true;
+}
+
+void ZeroMQPoller::poll_loop() {
+  std::vector<Subscription *> polled;
+  std::vector<zmq_pollitem_t> items;
+  while (running_) {
+    {
+      // 接管在 start 之后新加入的订阅
+      std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+      for (size_t i = polled.size(); i < subscriptions_.size(); ++i) {
+        polled.push_back(subscriptions_[i].get());
+        zmq_pollitem_t item;
+        item.socket = subscriptions_[i]->socket;
+        item.fd = 0;
+        item.events = ZMQ_POLLIN;
+        item.revents = 0;
+        items.push_back(item);
+      }
+    }
+    if (items.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(poll_timeout_ms_));
+      continue;
+    }
+
+    int ret = zmq_poll(items.data(), static_cast<int>(items.size()),
+                       poll_timeout_ms_);
+    if (ret < 0) {
+      if (zmq_errno() == ETERM) {
+        break;
+      }
+      continue;
+    }
+    for (size_t i = 0; i < items.size() && ret > 0; ++i) {
+      if (items[i].revents & ZMQ_POLLIN) {
+        // 一次把socket中排队的消息全部取完,避免慢速订阅堆积
+        while (receive(polled[i])) {
+        }
+      }
+    }
+  }
+}
+
+bool ZeroMQPoller::receive(Subscription *sub) {
+  std::string topic;
+  std::string msg;
+  std::vector<std::string> extra;
+  int frame_index = 0;
+  int more = 1;
+  while (more) {
+    zmq_msg_t frame;
+    zmq_msg_init(&frame);
+    // 第一帧非阻塞,后续帧属于同一条多帧消息,已经全部到达
+    int ret = zmq_msg_recv(&frame, sub->socket,
+                           frame_index == 0 ? ZMQ_DONTWAIT : 0);
+    if (ret == -1) {
+      zmq_msg_close(&frame);
+      return false;
+    }
+    std::string data(static_cast<const char *>(zmq_msg_data(&frame)),
+                     zmq_msg_size(&frame));
+    more = zmq_msg_more(&frame);
+    zmq_msg_close(&frame);
+
+    if (frame_index == 0) {
+      topic.swap(data);
+    } else if (frame_index == 1) {
+      msg.swap(data);
+    } else {
+      extra.push_back(data);
+    }
+    ++frame_index;
+  }
+
+  ++sub->received;
+  if (sub->callback) {
+    sub->callback(topic, msg, extra);
+  } else {
+    std::lock_guard<std::mutex> lock(sub->mutex);
+    sub->latest.swap(msg);
+    sub->updated = true;
+  }
+  return true;
+}
@@ -0,0 +1,140 @@
+#include "wind_zmq/wind_zmq.hpp"
+#include "wind_zmq/zmq_poller.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+// PUB/SUB 建立连接之前发出的消息会被丢弃, 重复发送直到 done 返回 true
+template <typename Done>
+bool publish_until(ZeroMQPublisher* publisher, const std::string& msg, const std::string& extra, Done done)
+{
+  for (int i = 0; i < 200; ++i)
+  {
+    publisher->publish_str(msg, extra);
+    if (done())
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+}  // namespace
+
+TEST(ZeroMQPoller, inprocRoundTripThenStop)
+{
+  ZeroMQPoller poller(10);
+  ASSERT_TRUE(poller.init());
+  // inproc 需要共用同一个 context
+  std::unique_ptr<ZeroMQPublisher> publisher(
+      new ZeroMQPublisher("peddet", "inproc://poller_round_trip", poller.context()));
+  ASSERT_TRUE(publisher->init());
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::string> received;
+  std::vector<std::string> extras;
+  const int callback_id = poller.add_subscription(
+      "peddet", "inproc://poller_round_trip",
+      [&](const std::string& topic, const std::string& msg, const std::vector<std::string>& extra) {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ("peddet", topic);
+        received.push_back(msg);
+        extras.insert(extras.end(), extra.begin(), extra.end());
+        cv.notify_all();
+      });
+  const int latest_id = poller.add_subscription("peddet", "inproc://poller_round_trip");
+  // 其他 topic 的消息被 zmq 过滤
+  const int other_id = poller.add_subscription("other", "inproc://poller_round_trip");
+  ASSERT_EQ(0, callback_id);
+  ASSERT_EQ(1, latest_id);
+  ASSERT_EQ(2, other_id);
+  ASSERT_TRUE(poller.start());
+
+  std::string latest;
+  EXPECT_TRUE(publish_until(publisher.get(), "yes", "1.5 0@1.0", [&]() { return poller.get_str(latest_id, &latest); }));
+  EXPECT_EQ("yes", latest);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(2), [&]() { return !received.empty(); }));
+    EXPECT_EQ("yes", received.back());
+    ASSERT_FALSE(extras.empty());
+    EXPECT_EQ("1.5 0@1.0", extras.back());
+  }
+  // 读取后清除更新标志
+  std::string again;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  while (poller.get_str(latest_id, &again))
+  {
+  }
+  EXPECT_FALSE(poller.get_str(latest_id, &again));
+  EXPECT_FALSE(poller.get_str(other_id, &again));
+  EXPECT_FALSE(poller.get_str(7, &again));
+
+  // 共享 context 的发布者先析构, stop 不会阻塞在 zmq_ctx_term
+  publisher.reset();
+  const auto begin = std::chrono::steady_clock::now();
+  poller.stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(1));
+  EXPECT_FALSE(poller.get_str(latest_id, &again));
+  // 重复 stop 没有副作用
+  poller.stop();
+}
+
+TEST(ZeroMQPoller, subscriberSharesPoller)
+{
+  ZeroMQPoller poller(10);
+  ASSERT_TRUE(poller.init());
+  std::unique_ptr<ZeroMQPublisher> publisher(
+      new ZeroMQPublisher("peddet", "inproc://poller_subscriber", poller.context()));
+  ASSERT_TRUE(publisher->init());
+
+  ZeroMQSubscriber first("peddet", "inproc://poller_subscriber", "str", 0, 0, &poller);
+  ZeroMQSubscriber second("peddet", "inproc://poller_subscriber", "str", 0, 0, &poller);
+  ASSERT_TRUE(first.init());
+  ASSERT_TRUE(second.init());
+
+  std::string a;
+  std::string b;
+  bool got_a = false;
+  bool got_b = false;
+  EXPECT_TRUE(publish_until(publisher.get(), "no", "", [&]() {
+    got_a = got_a || first.get_str(&a);
+    got_b = got_b || second.get_str(&b);
+    return got_a && got_b;
+  }));
+  EXPECT_EQ("no", a);
+  EXPECT_EQ("no", b);
+
+  publisher.reset();
+  poller.stop();
+}
+
+TEST(ZeroMQPoller, subscriberOwnsPoller)
+{
+  ZeroMQPublisher publisher("img", "tcp://127.0.0.1:19731");
+  ASSERT_TRUE(publisher.init());
+  {
+    ZeroMQSubscriber subscriber("img", "tcp://127.0.0.1:19731", "img", 4, 2);
+    ASSERT_TRUE(subscriber.init());
+    cv::Mat sent(2, 4, CV_8UC3, cv::Scalar(1, 2, 3));
+    cv::Mat img;
+    for (int i = 0; i < 200 && !subscriber.get_img(&img); ++i)
+    {
+      publisher.publish_img(sent);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_FALSE(img.empty());
+    EXPECT_EQ(0, cv::norm(img, sent, cv::NORM_INF));
+    // 没有新消息时仍返回上一帧
+    EXPECT_TRUE(subscriber.get_img(&img));
+  }
+  // 析构时自己的 poller 停止, 不影响发布者
+  EXPECT_TRUE(publisher.publish_str("still alive"));
+}